@@ -5,22 +5,28 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <string>
 
 #include <vector>
 #include <iomanip>
 #include <cmath>
 #include <limits>
+#include <algorithm>
 
 //include for time
 #include <chrono>
 using namespace std::chrono_literals;
 
-#define TINYOBJLOADER_IMPLEMENTATION
+//the loader itself is compiled into P6 (TriangleMesh.cpp)
 #include "tiny_obj_loader.h"
 
 #include "p6/MyVector.h"
 #include "p6/P6Particle.h"
+#include "p6/ParticleWorld.h"
+#include "p6/StepScheduler.h"
+#include "p6/TriggerVolumes.h"
 
 
 float x_mod = 0;
@@ -36,6 +42,25 @@ void Key_Callback(GLFWwindow* window, int key, int scancode, int action, int mod
     if (key == GLFW_KEY_S) z_mod -= 0.1f;
 }
 
+//one entry of the race, its physics state lives in the particle world
+struct Racer {
+    std::string name;
+    glm::vec3 color;
+    P6::MyVector start;
+    float acceleration;
+    float speed;
+
+    Racer(const std::string& name, glm::vec3 color, P6::MyVector start, float acceleration, float speed)
+        : name(name), color(color), start(start), acceleration(acceleration), speed(speed) {}
+
+    P6::ParticleHandle handle;
+    P6::MyVector initialVelocity;
+    bool finished = false;
+    float magVelocity = 0.0f;
+    //simulated seconds, timed where the racer crossed the finish inside its step
+    double finishTime = 0;
+};
+
 static std::string numbering(int num) {
     switch (num % 10) {
     case 1:
@@ -169,70 +194,47 @@ int main(void) {
     P6::MyVector scale(10, 10, 10);
 
 
-    //time in between frames
+    //time in between physics steps
     constexpr std::chrono::nanoseconds timestep(16ms);
-
-    //particle array
-    P6::P6Particle particles[4]{
-        P6::P6Particle(),  // red
-        P6::P6Particle(),  // green
-        P6::P6Particle(),  // blue
-        P6::P6Particle()   // yellow
+    //a fixed 16ms step no matter the refresh rate, at most 5 steps per frame
+    P6::StepScheduler scheduler(timestep, 5);
+
+    //racers live in a particle world, everything else about them stays with the racer
+    P6::ParticleWorld world(4);
+
+    Racer racers[4] = {
+        //top left (red)
+        Racer("Red", glm::vec3(1.0f, 0.0f, 0.0f), P6::MyVector(-350, 350, 201), 14.5f, 80.f),
+        //top right (green)
+        Racer("Green", glm::vec3(0.0f, 1.0f, 0.0f), P6::MyVector(350, 350, 173), 8.f, 90.f),
+        //bottom right (blue)
+        Racer("Blue", glm::vec3(0.0f, 0.0f, 1.0f), P6::MyVector(350, -350, -300), 1.f, 130.f),
+        //bottom left (yellow)
+        Racer("Yellow", glm::vec3(1.0f, 1.0f, 0.0f), P6::MyVector(-350, -350, -150), 3.f, 110.f)
     };
 
-    //colors
-    glm::vec3 particlecolor[4] = {
-        glm::vec3(1.0f, 0.0f, 0.0f), //red
-        glm::vec3(0.0f, 1.0f, 0.0f), //green
-        glm::vec3(0.0f, 0.0f, 1.0f), //blue
-        glm::vec3(1.0f, 1.0f, 0.0f) //yellow
-    };
+    for (Racer& racer : racers) {
+        //every racer heads for the origin
+        P6::P6Particle particle;
+        particle.Position = racer.start;
+        particle.Acceleration = particle.Position.Direction().scalarMultiplication(racer.acceleration).scalarMultiplication(-1.f);
+        particle.Velocity = particle.Position.Direction().scalarMultiplication(racer.speed).scalarMultiplication(-1.f);
+        particle.active = true;
+        //massless particles are immovable to the boundaries
+        particle.mass = 1.0f;
+
+        //initial velocity for computation
+        racer.initialVelocity = particle.Velocity;
+        racer.handle = world.spawn(particle);
+    }
 
-    //particle
-
-    //top left (red)
-    particles[0].Position = P6::MyVector(-350, 350, 201);
-    //top right (green)
-    particles[1].Position = P6::MyVector(350, 350, 173);
-    //bottom right (blue)
-    particles[2].Position = P6::MyVector(350, -350, -300);
-    //bottom left (yellow)
-    particles[3].Position = P6::MyVector(-350, -350, -150);
-
-
-    ////this is 100m/s to the right
-    //particle.Velocity = P6::MyVector(0, 0, 0);
-
-    //this is 100m/s to the left
-
-    //particle red
-    particles[0].Acceleration = particles[0].Position.Direction().scalarMultiplication(14.5f).scalarMultiplication(-1.f);
-    particles[0].Velocity = particles[0].Position.Direction().scalarMultiplication(80.f).scalarMultiplication(-1.f);
-    //particle green
-    particles[1].Acceleration = particles[1].Position.Direction().scalarMultiplication(8.f).scalarMultiplication(-1.f);
-    particles[1].Velocity = particles[1].Position.Direction().scalarMultiplication(90.f).scalarMultiplication(-1.f);
-    //particle blue
-    particles[2].Acceleration = particles[2].Position.Direction().scalarMultiplication(1.f).scalarMultiplication(-1.f);
-    particles[2].Velocity = particles[2].Position.Direction().scalarMultiplication(130.f).scalarMultiplication(-1.f);
-    //particle yellow
-    particles[3].Acceleration = particles[3].Position.Direction().scalarMultiplication(3.f).scalarMultiplication(-1.f);
-    particles[3].Velocity = particles[3].Position.Direction().scalarMultiplication(110.f).scalarMultiplication(-1.f);
-
-    ////initial velocity for computation
-    //glm::vec3 iVelocity[4] = {
-    //    glm::vec3(80, -80, -80), //red
-    //    glm::vec3(-90, -90, -90), //green
-    //    glm::vec3(-130, 130, 130), //blue
-    //    glm::vec3(110, 110, 110) //yellow
-    //};
-
-    //initial velocity for computation
-    P6::MyVector iVelocity[4] = {
-        particles[0].Velocity, //red
-        particles[1].Velocity, //blue
-        particles[2].Velocity, //greeen
-        particles[3].Velocity //yellow
-    };
+    //nothing leaves the view volume glm::ortho sets up; grown by the racers' radius so the ones
+    //starting on its corners keep their centres there
+    world.boundaries().addBox(P6::Aabb(P6::MyVector(-351, -351, -351), P6::MyVector(351, 351, 351)));
+
+    //the finish line, a box orig around the origin
+    P6::TriggerVolumes triggers;
+    const uint32_t finishLine = triggers.addBox(P6::Aabb(P6::MyVector(-orig, -orig, -orig), P6::MyVector(orig, orig, orig)));
 
 
 
@@ -240,20 +242,10 @@ int main(void) {
     using clock = std::chrono::high_resolution_clock;
     auto curr_time = clock::now();
     auto prev_time = curr_time;
-    std::chrono::nanoseconds curr_ns(0);
-
-    bool timeStop = false;
-    bool isMoving = true;
 
     bool end_race = false;
     bool resultPrinted = false;
 
-    std::vector<bool> finished(4, false);
-    std::vector<float> MagVelocity(4, 0.0f);
-
-    std::vector<std::chrono::time_point<std::chrono::high_resolution_clock>> startTime(4, clock::now());
-    std::vector<std::chrono::time_point<std::chrono::high_resolution_clock>> endTime(4);
-
 
 
 
@@ -263,75 +255,51 @@ int main(void) {
         curr_time = clock::now();
         auto dur = std::chrono::duration_cast<std::chrono::nanoseconds>(curr_time - prev_time);
         prev_time = curr_time;
-        curr_ns += dur;
-
 
-        if (curr_ns >= timestep) {
-            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(curr_ns);
-            curr_ns -= curr_ns;
+        int steps = scheduler.advance(dur);
+        for (int step = 0; step < steps; step++) {
             end_race = true;
 
-            for (int i = 0; i < 4; i++) { //double check again
-                if (!finished[i]) {
-
-                    particles[i].update((float)ms.count() / 1000);
-                    int pos_x = particles[i].Position.x;
-                    int pos_y = particles[i].Position.y;
-                    int pos_z = particles[i].Position.z;
-
-                    if (std::abs(pos_x) < orig && std::abs(pos_y) < orig && std::abs(pos_z) < orig) {
-                        finished[i] = true;
-                        endTime[i] = clock::now();
-                        MagVelocity[i] = particles[i].Velocity.Magnitude();
-                    }
-                    else {
-                        end_race = false;
-                    }
+            //finished racers are inactive, so the world leaves them where they stopped
+            world.update(scheduler.seconds());
+
+            //crossings come earliest first, so a racer that got there earlier within the same step still ranks first
+            triggers.update(world, scheduler.seconds());
+            for (const P6::TriggerEvent& event : triggers.events()) {
+                if (event.zone != finishLine || event.kind != P6::TriggerEvent::Enter) continue;
+                for (Racer& racer : racers) {
+                    if (racer.finished || racer.handle != event.particle) continue;
+                    P6::ParticleView particle = world[racer.handle];
+                    racer.finished = true;
+                    particle.SetActive(false);
+                    racer.finishTime = event.time;
+                    racer.magVelocity = particle.GetVelocity().Magnitude();
                 }
             }
+            for (const Racer& racer : racers) {
+                if (!racer.finished) end_race = false;
+            }
 
             if (end_race && !resultPrinted) {
-                std::vector<int> index = { 0, 1, 2, 3 };
-
-                for (int i = 0; i < index.size() - 1; i++) {
-                    for (int j = 0; j < index.size() - i - 1; j++) {
-                        auto time_diff_a = std::chrono::duration_cast<std::chrono::milliseconds>(endTime[index[j]] - startTime[index[j]]);
-                        auto time_diff_b = std::chrono::duration_cast<std::chrono::milliseconds>(endTime[index[j + 1]] - startTime[index[j + 1]]);
-
-                        if (time_diff_a.count() > time_diff_b.count()) {
-                            std::swap(index[j], index[j + 1]);
-                        }
-                    }
+                std::vector<const Racer*> standings;
+                for (const Racer& racer : racers) {
+                    standings.push_back(&racer);
                 }
+                std::stable_sort(standings.begin(), standings.end(), [](const Racer* a, const Racer* b) {
+                    return a->finishTime < b->finishTime;
+                });
 
                 int rank = 1;
-                for (int i : index) {
-                    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(endTime[i] - startTime[i]).count();
-
-                    float avgVelocityX = (iVelocity[i].x + particles[i].Velocity.x) / 2.0f;
-                    float avgVelocityY = (iVelocity[i].y + particles[i].Velocity.y) / 2.0f;
-                    float avgVelocityZ = (iVelocity[i].z + particles[i].Velocity.z) / 2.0f;
-
-                    std::cout << rank << numbering(rank) << " : ";
-
-                    //Particle display pain int he ass                   
-
-                    if (particlecolor[i] == glm::vec3(0.0f, 1.0f, 0.0f)) {
-                        std::cout << "Green" << std::endl;
-                    }
-                    else if (particlecolor[i] == glm::vec3(1.0f, 0.0f, 0.0f)) {
-                        std::cout << "Red" << std::endl;
-                    }
-                    else if (particlecolor[i] == glm::vec3(0.0f, 0.0f, 1.0f)) {
-                        std::cout << "Blue" << std::endl;
-                    }
-                    else if (particlecolor[i] == glm::vec3(1.0f, 1.0f, 0.0f)) {
-                        std::cout << "Yellow" << std::endl;
-                    }
-
-                    std::cout << "Mag. of Velocity: " << std::fixed << std::setprecision(2) << MagVelocity[i] << " m/s" << std::endl;
+                for (const Racer* racer : standings) {
+                    P6::MyVector finalVelocity = world[racer->handle].GetVelocity();
+                    float avgVelocityX = (racer->initialVelocity.x + finalVelocity.x) / 2.0f;
+                    float avgVelocityY = (racer->initialVelocity.y + finalVelocity.y) / 2.0f;
+                    float avgVelocityZ = (racer->initialVelocity.z + finalVelocity.z) / 2.0f;
+
+                    std::cout << rank << numbering(rank) << " : " << racer->name << std::endl;
+                    std::cout << "Mag. of Velocity: " << std::fixed << std::setprecision(2) << racer->magVelocity << " m/s" << std::endl;
                     std::cout << "Average Velocity: (" << std::fixed << std::setprecision(2) << avgVelocityX << ", " << avgVelocityY << ", " << avgVelocityZ << ") m/s" << std::endl;
-                    std::cout << static_cast<float>(elapsed / 1000.f) << " secs" << std::endl;
+                    std::cout << std::setprecision(3) << racer->finishTime << " secs" << std::endl;
                     std::cout << "\n";
                     rank++;
                 }
@@ -347,8 +315,10 @@ int main(void) {
         glBindVertexArray(VAO);
 
         //draw array of particles
-        for (int i = 0; i < 4; ++i) {
-            glm::mat4 transformation_matrix = glm::translate(glm::mat4(1.0f), glm::vec3(particles[i].Position));
+        for (const Racer& racer : racers) {
+            //drawn between the last two steps, so motion stays smooth when frames and steps don't line up
+            P6::MyVector position = world[racer.handle].GetInterpolatedPosition(scheduler.alpha());
+            glm::mat4 transformation_matrix = glm::translate(glm::mat4(1.0f), glm::vec3(position));
             transformation_matrix = glm::scale(transformation_matrix, glm::vec3(scale));
             transformation_matrix = glm::rotate(transformation_matrix, glm::radians(0.0f), glm::normalize(glm::vec3(0.0, 1.0, 0.0)));
 
@@ -357,7 +327,7 @@ int main(void) {
 
             //set color
             unsigned int colorLoc = glGetUniformLocation(shaderProg, "objectColor");
-            glUniform3fv(colorLoc, 1, glm::value_ptr(particlecolor[i]));
+            glUniform3fv(colorLoc, 1, glm::value_ptr(racer.color));
 
             glDrawElements(GL_TRIANGLES, mesh_indices.size(), GL_UNSIGNED_INT, 0);
         }
@@ -0,0 +1,81 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "p6/ParticleKernels.h"
+#include "perf.h"
+
+int perf_myvector();
+int perf_integrators();
+int perf_particle();
+int perf_race();
+int perf_broadphase();
+int perf_contacts();
+int perf_mesh();
+int perf_queries();
+int perf_sleep();
+int perf_boundaries();
+int perf_springs();
+int perf_links();
+int perf_cloth();
+
+namespace {
+	void Usage() {
+		std::printf(
+			"usage: P6-Bench [options]\n"
+			"  --json FILE          write every result to FILE as JSON\n"
+			"  --warmup N           untimed passes before measuring (default 2)\n"
+			"  --repetitions N      timed passes per benchmark (default 10)\n"
+			"  --large              include the 1e7-particle runs\n"
+			"  --filter NAME        only run suites whose name contains NAME:\n"
+			"                       myvector, integrators, particle, race, broadphase,\n"
+			"                       contacts, mesh, queries, sleep, boundaries,\n"
+			"                       springs, links, cloth\n");
+	}
+}
+
+int main(int argc, char** argv) {
+	const char* json = nullptr;
+	perf::Config& config = perf::config();
+
+	for (int i = 1; i < argc; i++) {
+		const bool hasValue = i + 1 < argc;
+		if (std::strcmp(argv[i], "--json") == 0 && hasValue) json = argv[++i];
+		else if (std::strcmp(argv[i], "--warmup") == 0 && hasValue) config.warmup = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--repetitions") == 0 && hasValue) config.repetitions = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--large") == 0) config.large = true;
+		else if (std::strcmp(argv[i], "--filter") == 0 && hasValue) config.filter = argv[++i];
+		else {
+			Usage();
+			return 2;
+		}
+	}
+	if (config.repetitions < 1) config.repetitions = 1;
+	if (config.warmup < 0) config.warmup = 0;
+
+	std::printf("P6 benchmarks, %s, %d warmup + %d timed passes\n", P6::SimdLevelName(P6::ActiveSimdLevel()), config.warmup, config.repetitions);
+
+	int Error = 0;
+
+	Error += perf_myvector();
+	Error += perf_integrators();
+	Error += perf_particle();
+	Error += perf_race();
+	Error += perf_broadphase();
+	Error += perf_contacts();
+	Error += perf_mesh();
+	Error += perf_queries();
+	Error += perf_sleep();
+	Error += perf_boundaries();
+	Error += perf_springs();
+	Error += perf_links();
+	Error += perf_cloth();
+
+	if (json && !perf::WriteJson(json)) {
+		std::printf("could not write %s\n", json);
+		Error++;
+	}
+
+	std::printf("%s\n", Error == 0 ? "all benchmarks passed" : "some benchmarks reported mismatches");
+	return Error;
+}
@@ -0,0 +1,97 @@
+#include "perf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "p6/ParticleKernels.h"
+
+namespace {
+	std::vector<perf::Result>& Collected() {
+		static std::vector<perf::Result> results;
+		return results;
+	}
+
+	//benchmark names are plain identifiers, only quotes and backslashes need escaping
+	std::string Escape(const std::string& text) {
+		std::string out;
+		for (char c : text) {
+			if (c == '"' || c == '\\') out += '\\';
+			out += c;
+		}
+		return out;
+	}
+}
+
+perf::Config& perf::config() {
+	static Config current;
+	return current;
+}
+
+perf::Stats perf::Summarize(std::vector<double> samples) {
+	Stats stats;
+	if (samples.empty()) return stats;
+
+	std::sort(samples.begin(), samples.end());
+	const size_t n = samples.size();
+	stats.min = samples[0];
+	stats.median = n % 2 ? samples[n / 2] : 0.5 * (samples[n / 2 - 1] + samples[n / 2]);
+
+	double sum = 0;
+	for (double s : samples) sum += s;
+	stats.mean = sum / n;
+
+	double variance = 0;
+	for (double s : samples) variance += (s - stats.mean) * (s - stats.mean);
+	stats.stddev = n > 1 ? std::sqrt(variance / (n - 1)) : 0;
+	return stats;
+}
+
+void perf::Report(const char* suite, const std::string& name, const char* unit, size_t count, size_t steps, const Stats& stats) {
+	//throughput from the median, it ignores the odd interrupted repetition
+	const double perSecond = stats.median > 0 ? 1e9 / stats.median : 0;
+	std::string units = unit;
+	units = units.back() == 'y' ? units.substr(0, units.size() - 1) + "ies" : units + "s";
+	std::printf("- %-34s %9zu %-10s %8.3f ns/%s-step (min %.3f, +-%.3f)  %8.1f M %s-steps/s\n",
+		name.c_str(), count, units.c_str(), stats.median, unit, stats.min, stats.stddev, perSecond / 1e6, unit);
+
+	Result result;
+	result.suite = suite;
+	result.name = name;
+	result.unit = unit;
+	result.count = count;
+	result.steps = steps;
+	result.nsPerStep = stats;
+	Collected().push_back(result);
+}
+
+bool perf::Selected(const char* suite) {
+	return config().filter.empty() || std::string(suite).find(config().filter) != std::string::npos;
+}
+
+const std::vector<perf::Result>& perf::Results() {
+	return Collected();
+}
+
+bool perf::WriteJson(const char* path) {
+	FILE* file = std::fopen(path, "w");
+	if (!file) return false;
+
+	std::fprintf(file, "{\n");
+	std::fprintf(file, "  \"simd\": \"%s\",\n", P6::SimdLevelName(P6::ActiveSimdLevel()));
+	std::fprintf(file, "  \"warmup\": %d,\n", config().warmup);
+	std::fprintf(file, "  \"repetitions\": %d,\n", config().repetitions);
+	std::fprintf(file, "  \"benchmarks\": [\n");
+	const std::vector<Result>& results = Collected();
+	for (size_t i = 0; i < results.size(); i++) {
+		const Result& r = results[i];
+		const Stats& s = r.nsPerStep;
+		std::fprintf(file, "    {\"suite\": \"%s\", \"name\": \"%s\", \"unit\": \"%s\", \"count\": %zu, \"steps\": %zu, ",
+			Escape(r.suite).c_str(), Escape(r.name).c_str(), Escape(r.unit).c_str(), r.count, r.steps);
+		std::fprintf(file, "\"ns_per_step\": {\"min\": %.4f, \"median\": %.4f, \"mean\": %.4f, \"stddev\": %.4f}, ",
+			s.min, s.median, s.mean, s.stddev);
+		std::fprintf(file, "\"steps_per_second\": %.1f}%s\n", s.median > 0 ? 1e9 / s.median : 0.0, i + 1 < results.size() ? "," : "");
+	}
+	std::fprintf(file, "  ]\n}\n");
+	return std::fclose(file) == 0;
+}
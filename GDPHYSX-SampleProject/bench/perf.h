@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+//Small timing harness shared by the perf_* files.
+//Every benchmark runs a few untimed warmup passes, then a number of timed repetitions,
+//and reports ns per unit-step and unit-steps/second with min/median/mean/stddev, where the unit
+//is whatever the benchmark counts: particles, triangles, nodes, springs, links or queries.
+//Results are collected so main can write them out as JSON for regression tracking.
+namespace perf {
+	struct Config {
+		int warmup = 2;
+		int repetitions = 10;
+		//adds the 1e7-particle runs, they need about 1.5 GB
+		bool large = false;
+		//only suites whose name contains this run, empty runs everything
+		std::string filter;
+	};
+
+	Config& config();
+
+	//per repetition, in nanoseconds per unit-step
+	struct Stats {
+		double min = 0;
+		double median = 0;
+		double mean = 0;
+		double stddev = 0;
+	};
+
+	struct Result {
+		std::string suite;
+		std::string name;
+		//singular, e.g. "particle"
+		std::string unit;
+		size_t count = 0;
+		size_t steps = 0;
+		Stats nsPerStep;
+	};
+
+	Stats Summarize(std::vector<double> samples);
+
+	//runs pass() config().warmup times untimed, then config().repetitions times timed
+	//one pass covers count * steps unit-steps
+	template <typename Pass>
+	Stats Measure(size_t count, size_t steps, Pass pass) {
+		for (int i = 0; i < config().warmup; i++) pass();
+
+		const double unitSteps = static_cast<double>(count) * static_cast<double>(steps);
+		std::vector<double> samples;
+		for (int i = 0; i < config().repetitions; i++) {
+			auto start = std::chrono::steady_clock::now();
+			pass();
+			auto end = std::chrono::steady_clock::now();
+			samples.push_back(std::chrono::duration<double, std::nano>(end - start).count() / unitSteps);
+		}
+		return Summarize(samples);
+	}
+
+	//prints one line and keeps the result for WriteJson; unit names what count counts, singular
+	void Report(const char* suite, const std::string& name, const char* unit, size_t count, size_t steps, const Stats& stats);
+
+	bool Selected(const char* suite);
+
+	const std::vector<Result>& Results();
+	bool WriteJson(const char* path);
+}
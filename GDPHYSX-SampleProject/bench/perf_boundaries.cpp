@@ -0,0 +1,250 @@
+#include "p6/BoundaryKernels.h"
+#include "p6/JobSystem.h"
+#include "p6/ParticleKernels.h"
+#include "p6/ParticleWorld.h"
+#include "perf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+	//fast particles of mixed sizes, most inside the box and some already through a side
+	void SpawnSparks(P6::ParticleWorld& world, size_t count, float side, unsigned seed) {
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f), radius(0.2f, 1.0f);
+		for (size_t i = 0; i < count; i++) {
+			P6::P6Particle particle;
+			particle.Position = P6::MyVector(unit(random), unit(random), unit(random)) * (1.1f * side);
+			particle.Velocity = P6::MyVector(unit(random), unit(random), unit(random)) * 50.0f;
+			particle.Acceleration = P6::MyVector(0, -9.8f, 0);
+			particle.radius = radius(random);
+			particle.mass = 1.0f;
+			//every seventh is inactive and every eleventh immovable, both have to be left alone
+			particle.active = i % 7 != 3;
+			if (i % 11 == 5) particle.mass = 0;
+			world.spawn(particle);
+		}
+	}
+
+	P6::BoundaryBox Box(float side, float restitution, float friction) {
+		P6::BoundaryBox box;
+		box.minX = box.minY = box.minZ = -side;
+		box.maxX = box.maxY = box.maxZ = side;
+		box.restitution = restitution;
+		box.friction = friction;
+		return box;
+	}
+
+	std::vector<P6::SimdLevel> Levels() {
+		std::vector<P6::SimdLevel> levels;
+		for (P6::SimdLevel level : { P6::SimdLevel::Scalar, P6::SimdLevel::SSE2, P6::SimdLevel::AVX2 }) {
+			if (level <= P6::DetectSimdLevel()) levels.push_back(level);
+		}
+		return levels;
+	}
+
+	bool SameBits(const float* a, const float* b, size_t count) {
+		return std::memcmp(a, b, count * sizeof(float)) == 0;
+	}
+
+	//fused multiply-adds round once instead of twice
+	bool Close(const float* a, const float* b, size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			if (std::abs(a[i] - b[i]) > 1e-4f * (1.0f + std::abs(a[i]))) return false;
+		}
+		return true;
+	}
+
+	//the columns a boundary pass writes
+	std::vector<const float*> Written(const P6::ParticleStreams& s) {
+		return { s.posX, s.posY, s.posZ, s.velX, s.velY, s.velZ };
+	}
+
+	//one particle against one boundary, through the world so the dispatch is covered too
+	P6::ParticleView Single(P6::ParticleWorld& world, const P6::MyVector& position, const P6::MyVector& velocity) {
+		world.clear();
+		P6::P6Particle particle;
+		particle.mass = 1.0f;
+		particle.radius = 0.5f;
+		particle.active = true;
+		particle.Position = position;
+		particle.Velocity = velocity;
+		return world[world.spawn(particle)];
+	}
+
+	int CheckBoundaries() {
+		int Error = 0;
+		const P6::SimdLevel active = P6::ActiveSimdLevel();
+
+		//every kernel against the scalar one, a plane at an angle and a box, two steps so the
+		//particles that were pushed back are tested again
+		const size_t Count = 4003;
+		const float side = 20.0f;
+		P6::BoundaryPlane slope;
+		slope.nx = 0.6f;
+		slope.ny = 0.8f;
+		slope.offset = -10.0f;
+		slope.restitution = 0.7f;
+		slope.friction = 0.3f;
+		const P6::BoundaryBox box = Box(side, 0.5f, 0.2f);
+		std::vector<P6::ParticleWorld*> worlds;
+		for (P6::SimdLevel level : Levels()) {
+			P6::ParticleWorld* world = new P6::ParticleWorld(Count);
+			SpawnSparks(*world, Count, side, 41);
+			const P6::ParticleStreams& s = world->buffer().streams();
+			for (int step = 0; step < 2; step++) {
+				P6::PlaneKernelFor(level)(s, 0, Count, slope, 0.016f);
+				P6::BoxKernelFor(level)(s, 0, Count, box, 0.016f);
+			}
+			worlds.push_back(world);
+		}
+		const P6::ParticleStreams& reference = worlds[0]->buffer().streams();
+		for (size_t w = 1; w < worlds.size(); w++) {
+			const std::vector<const float*> want = Written(reference), got = Written(worlds[w]->buffer().streams());
+			for (size_t c = 0; c < want.size(); c++) {
+				Error += (Levels()[w] == P6::SimdLevel::SSE2 ? SameBits(want[c], got[c], Count) : Close(want[c], got[c], Count)) ? 0 : 1;
+			}
+		}
+		for (P6::ParticleWorld* world : worlds) delete world;
+
+		//particles left alone, and everyone else inside the box with the slope's side cut off
+		size_t pushed = 0;
+		float hop = 0;
+		{
+			P6::ParticleWorld world(Count), untouched(Count);
+			SpawnSparks(world, Count, side, 41);
+			SpawnSparks(untouched, Count, side, 41);
+			world.boundaries().addBox(P6::Aabb(P6::MyVector(-side, -side, -side), P6::MyVector(side, side, side)), 0.5f, 0.2f);
+			const P6::ParticleStreams& s = world.buffer().streams();
+			const P6::ParticleStreams& u = untouched.buffer().streams();
+			world.boundaries().apply(s, Count, 0.016f);
+			for (size_t i = 0; i < Count; i++) {
+				const bool fixed = !s.active[i] || !(s.invMass[i] > 0);
+				const bool moved = s.posX[i] != u.posX[i] || s.posY[i] != u.posY[i] || s.posZ[i] != u.posZ[i];
+				pushed += moved ? 1 : 0;
+				if (fixed) {
+					Error += moved ? 1 : 0;
+					continue;
+				}
+				const float limit = side - s.radius[i] + 1e-4f;
+				Error += std::abs(s.posX[i]) <= limit && std::abs(s.posY[i]) <= limit && std::abs(s.posZ[i]) <= limit ? 0 : 1;
+			}
+			Error += pushed > 0 ? 0 : 1;
+
+			//the same bits on threads
+			P6::ParticleWorld threaded(Count);
+			SpawnSparks(threaded, Count, side, 41);
+			threaded.boundaries() = world.boundaries();
+			P6::JobSystem jobs(4);
+			threaded.boundaries().apply(threaded.buffer().streams(), Count, 0.016f, &jobs);
+			const std::vector<const float*> want = Written(s), got = Written(threaded.buffer().streams());
+			for (size_t c = 0; c < want.size(); c++) Error += SameBits(want[c], got[c], Count) ? 0 : 1;
+		}
+
+		for (P6::SimdLevel level : Levels()) {
+			P6::SetSimdLevel(level);
+			P6::ParticleWorld world(8);
+			const size_t floor = world.boundaries().addPlane(P6::MyVector(0, 2, 0), 0.0f, 0.5f, 0.0f);
+
+			//a hit bounces back with the restitution and lands on the surface
+			P6::ParticleView ball = Single(world, P6::MyVector(0, 0.25f, 0), P6::MyVector(0, -10.0f, 0));
+			world.boundaries().apply(world.buffer().streams(), world.size(), 0.016f);
+			Error += ball.GetPosition().y == 0.5f && std::abs(ball.GetVelocity().y - 5.0f) < 1e-5f ? 0 : 1;
+			//leaving already, only put back
+			ball = Single(world, P6::MyVector(0, 0.25f, 0), P6::MyVector(0, 3.0f, 0));
+			world.boundaries().apply(world.buffer().streams(), world.size(), 0.016f);
+			Error += ball.GetPosition().y == 0.5f && ball.GetVelocity().y == 3.0f ? 0 : 1;
+
+			//friction takes friction times the normal change off the sliding speed, and stops slow ones
+			world.boundaries().plane(floor).restitution = 0;
+			world.boundaries().plane(floor).friction = 0.5f;
+			ball = Single(world, P6::MyVector(0, 0.4f, 0), P6::MyVector(10.0f, -2.0f, 0));
+			world.boundaries().apply(world.buffer().streams(), world.size(), 0.016f);
+			Error += std::abs(ball.GetVelocity().x - 9.0f) < 1e-5f && ball.GetVelocity().y == 0 ? 0 : 1;
+			ball = Single(world, P6::MyVector(0, 0.4f, 0), P6::MyVector(0.5f, -2.0f, 0));
+			world.boundaries().apply(world.buffer().streams(), world.size(), 0.016f);
+			Error += ball.GetVelocity().x == 0 ? 0 : 1;
+
+			//dropped under a constant acceleration, it comes to rest on the floor and falls asleep
+			world.boundaries().plane(floor).restitution = 0.5f;
+			world.setSleeping(true, 0.1f, 30);
+			Single(world, P6::MyVector(0, 5.0f, 0), P6::MyVector(3.0f, 0, 0)).SetAcceleration(P6::MyVector(0, -9.8f, 0));
+			const P6::ParticleHandle handle = world.handleAt(0);
+			for (int step = 0; step < 400; step++) world.update(0.016f);
+			Error += world.sleeping(handle) && std::abs(world[handle].GetPosition().y - 0.5f) < 1e-4f ? 0 : 1;
+
+			//the same with gravity bound through the registry, and no sleeping to hide a hop
+			P6::ParticleWorld bound(8);
+			bound.boundaries().addPlane(P6::MyVector(0, 1, 0), 0.0f, 0.5f, 0.0f);
+			Single(bound, P6::MyVector(0, 5.0f, 0), P6::MyVector(3.0f, 0, 0));
+			const P6::ParticleHandle dropped = bound.handleAt(0);
+			bound.forces().bind(bound.forces().add(P6::GravityForce()), dropped);
+			for (int step = 0; step < 400; step++) {
+				bound.update(0.016f);
+				if (step >= 300) hop = std::max(hop, std::abs(bound[dropped].GetVelocity().y));
+			}
+			Error += std::abs(bound[dropped].GetPosition().y - 0.5f) < 1e-4f ? 0 : 1;
+		}
+		P6::SetSimdLevel(active);
+		Error += hop < 1e-3f ? 0 : 1;
+
+		std::printf("  boundaries check: %zu kernel levels agree, %zu of %zu particles pushed back in, resting speed %g under registry gravity\n",
+			Levels().size(), pushed, Count, hop);
+		return Error;
+	}
+}
+
+int perf_boundaries() {
+	int Error = 0;
+	if (!perf::Selected("boundaries")) return Error;
+
+	const P6::SimdLevel active = P6::ActiveSimdLevel();
+	const unsigned threads = std::max(2u, std::thread::hardware_concurrency());
+	P6::JobSystem jobs(threads);
+	const size_t Steps = 10;
+	for (size_t count : { 100000, 1000000 }) {
+		std::printf("perf_boundaries: %zu particles in a containment box\n", count);
+		//about one in twenty outside, as fast sparks after a step
+		const float side = 100.0f;
+		P6::ParticleWorld world(count);
+		SpawnSparks(world, count, side, 43);
+		const P6::ParticleStreams& s = world.buffer().streams();
+		const P6::BoundaryBox box = Box(side, 0.5f, 0.2f);
+
+		for (P6::SimdLevel level : Levels()) {
+			const P6::BoxKernel collide = P6::BoxKernelFor(level);
+			perf::Stats stats = perf::Measure(count, Steps, [&]() {
+				for (size_t step = 0; step < Steps; step++) collide(s, 0, count, box, 0.016f);
+			});
+			perf::Report("boundaries", std::string("box ") + P6::SimdLevelName(level), "particle", count, Steps, stats);
+		}
+		world.boundaries().addBox(P6::Aabb(P6::MyVector(-side, -side, -side), P6::MyVector(side, side, side)), 0.5f, 0.2f);
+		perf::Stats stats = perf::Measure(count, Steps, [&]() {
+			for (size_t step = 0; step < Steps; step++) world.boundaries().apply(s, count, 0.016f, &jobs);
+		});
+		perf::Report("boundaries", "box, " + std::to_string(threads) + " threads", "particle", count, Steps, stats);
+
+		//what the pass adds to a whole step
+		double bare = 0;
+		for (int withBox = 0; withBox < 2; withBox++) {
+			if (withBox == 0) world.boundaries().clear();
+			else world.boundaries().addBox(P6::Aabb(P6::MyVector(-side, -side, -side), P6::MyVector(side, side, side)), 0.5f, 0.2f);
+			stats = perf::Measure(count, Steps, [&]() {
+				for (size_t step = 0; step < Steps; step++) world.update(0.016f);
+			});
+			perf::Report("boundaries", withBox ? "world.update with the box" : "world.update without", "particle", count, Steps, stats);
+			if (withBox == 0) bare = stats.median;
+			else std::printf("  the box adds %.2f ns per particle-step\n", stats.median - bare);
+		}
+	}
+	P6::SetSimdLevel(active);
+	Error += CheckBoundaries();
+
+	return Error;
+}
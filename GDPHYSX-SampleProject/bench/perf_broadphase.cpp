@@ -0,0 +1,355 @@
+#include "p6/ParticleBuffer.h"
+#include "p6/ParticleWorld.h"
+#include "p6/SpatialHashGrid.h"
+#include "p6/SweepAndPrune.h"
+#include "p6/TreeBroadphase.h"
+#include "p6/TriangleMesh.h"
+#include "perf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <string>
+#include <utility>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+//quiz.obj from the demo's 3D folder, tiled copies x copies times side by side
+//falls back to a bumpy grid of the same size when the bench runs away from the project folder
+//perf_mesh builds its level with it too
+P6::TriangleMesh MakeLevel(int copies) {
+	P6::TriangleMesh quiz;
+	std::string error;
+	const bool found = quiz.load("3D/quiz.obj", error) || quiz.load("../3D/quiz.obj", error);
+
+	P6::TriangleMesh level;
+	if (found) {
+		const P6::Aabb bounds = quiz.bounds();
+		const float stepX = bounds.max.x - bounds.min.x, stepZ = bounds.max.z - bounds.min.z;
+		for (int cx = 0; cx < copies; cx++) {
+			for (int cz = 0; cz < copies; cz++) {
+				P6::MyVector a, b, c;
+				const P6::MyVector offset(cx * stepX, 0, cz * stepZ);
+				for (size_t t = 0; t < quiz.triangleCount(); t++) {
+					quiz.triangle(t, a, b, c);
+					level.addTriangle(a + offset, b + offset, c + offset);
+				}
+			}
+		}
+		return level;
+	}
+
+	const int side = static_cast<int>(std::sqrt(422.0f * copies * copies)) + 1;
+	auto height = [](int x, int z) { return 2.0f * std::sin(0.3f * x) * std::cos(0.2f * z); };
+	for (int x = 0; x < side; x++) {
+		for (int z = 0; z < side; z++) {
+			const P6::MyVector p00(x, height(x, z), z), p10(x + 1, height(x + 1, z), z);
+			const P6::MyVector p01(x, height(x, z + 1), z + 1), p11(x + 1, height(x + 1, z + 1), z + 1);
+			level.addTriangle(p00, p10, p11);
+			level.addTriangle(p00, p11, p01);
+		}
+	}
+	return level;
+}
+
+namespace {
+	//equal radius particles scattered through a cube, about 0.5 neighbours each
+	P6::ParticleBuffer MakeCloud(size_t count, unsigned seed) {
+		const float Radius = 0.5f;
+		const float Density = 0.2f;
+		const float side = std::cbrt(static_cast<float>(count) / Density);
+
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> coordinate(-0.5f * side, 0.5f * side);
+
+		P6::ParticleBuffer buffer(count);
+		for (size_t i = 0; i < count; i++) {
+			P6::P6Particle particle;
+			particle.Position = P6::MyVector(coordinate(random), coordinate(random), coordinate(random));
+			particle.radius = Radius;
+			particle.active = true;
+			buffer.add(particle);
+		}
+		return buffer;
+	}
+
+	bool PairLess(const P6::ParticlePair& l, const P6::ParticlePair& r) {
+		return l.a != r.a ? l.a < r.a : l.b < r.b;
+	}
+
+	std::vector<P6::ParticlePair> BruteForce(const P6::ParticleStreams& s, size_t count) {
+		std::vector<P6::ParticlePair> pairs;
+		for (uint32_t a = 0; a < count; a++) {
+			for (uint32_t b = a + 1; b < count; b++) {
+				float dx = s.posX[b] - s.posX[a], dy = s.posY[b] - s.posY[a], dz = s.posZ[b] - s.posZ[a];
+				float reach = s.radius[a] + s.radius[b];
+				if (dx * dx + dy * dy + dz * dz < reach * reach) pairs.push_back(P6::ParticlePair{ a, b });
+			}
+		}
+		return pairs;
+	}
+
+	//radii from 0.1 to 5, drifting slowly so the sweep and prune lists stay nearly sorted
+	void SpawnMixed(P6::ParticleWorld& world, size_t count, std::mt19937& random) {
+		const float side = std::cbrt(static_cast<float>(count) / 0.005f);
+		std::uniform_real_distribution<float> coordinate(-0.5f * side, 0.5f * side);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> logRadius(std::log(0.1f), std::log(5.0f));
+
+		for (size_t i = 0; i < count; i++) {
+			P6::P6Particle particle;
+			particle.Position = P6::MyVector(coordinate(random), coordinate(random), coordinate(random));
+			particle.Velocity = P6::MyVector(unit(random), unit(random), unit(random)) * 2.0f;
+			particle.radius = std::exp(logRadius(random));
+			particle.active = true;
+			world.spawn(particle);
+		}
+	}
+
+	//strict AABB overlap of every pair, as slots
+	std::set<std::pair<uint32_t, uint32_t>> BruteForceBoxes(const P6::ParticleWorld& world) {
+		std::set<std::pair<uint32_t, uint32_t>> pairs;
+		const P6::ParticleStreams& s = world.buffer().streams();
+		for (size_t i = 0; i < world.size(); i++) {
+			for (size_t j = i + 1; j < world.size(); j++) {
+				const float ri = s.radius[i], rj = s.radius[j];
+				//same expressions as the boxes, so rounding can't disagree
+				const bool x = s.posX[i] - ri < s.posX[j] + rj && s.posX[j] - rj < s.posX[i] + ri;
+				const bool y = s.posY[i] - ri < s.posY[j] + rj && s.posY[j] - rj < s.posY[i] + ri;
+				const bool z = s.posZ[i] - ri < s.posZ[j] + rj && s.posZ[j] - rj < s.posZ[i] + ri;
+				if (x && y && z) {
+					uint32_t a = world.handleAt(i).slot, b = world.handleAt(j).slot;
+					pairs.insert(std::make_pair(std::min(a, b), std::max(a, b)));
+				}
+			}
+		}
+		return pairs;
+	}
+
+	int CheckSweepAndPrune() {
+		int Error = 0;
+		std::mt19937 random(3);
+		P6::ParticleWorld world(3000);
+		SpawnMixed(world, 2000, random);
+
+		//pair set rebuilt only from the add/remove events
+		P6::SweepAndPrune sap;
+		std::set<std::pair<uint32_t, uint32_t>> tracked;
+		for (int step = 0; step < 60; step++) {
+			world.update(0.05f);
+
+			//churn: kill a few, spawn a few, some slots get reused in the same step
+			if (step % 10 == 5) {
+				for (int k = 0; k < 50; k++) world.kill(world.handleAt(random() % world.size()));
+				SpawnMixed(world, 80, random);
+			}
+
+			sap.update(world);
+			for (const P6::PairEvent& e : sap.removed()) tracked.erase(std::make_pair(std::min(e.a.slot, e.b.slot), std::max(e.a.slot, e.b.slot)));
+			for (const P6::PairEvent& e : sap.added()) tracked.insert(std::make_pair(std::min(e.a.slot, e.b.slot), std::max(e.a.slot, e.b.slot)));
+		}
+
+		std::set<std::pair<uint32_t, uint32_t>> expected = BruteForceBoxes(world);
+		std::printf("  sweep and prune check: %zu tracked, %zu expected, %zu counted\n", tracked.size(), expected.size(), sap.pairCount());
+		Error += tracked == expected ? 0 : 1;
+		Error += sap.pairCount() == expected.size() ? 0 : 1;
+		return Error;
+	}
+
+	//particles spread over the level's bounds
+	void SpawnOver(P6::ParticleWorld& world, const P6::Aabb& bounds, size_t count, std::mt19937& random) {
+		std::uniform_real_distribution<float> x(bounds.min.x, bounds.max.x), y(bounds.min.y, bounds.max.y), z(bounds.min.z, bounds.max.z);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		for (size_t i = 0; i < count; i++) {
+			P6::P6Particle particle;
+			particle.Position = P6::MyVector(x(random), y(random), z(random));
+			particle.Velocity = P6::MyVector(unit(random), unit(random), unit(random)) * 2.0f;
+			particle.radius = 0.5f;
+			particle.active = true;
+			world.spawn(particle);
+		}
+	}
+
+	int CheckTreeBroadphase() {
+		int Error = 0;
+		std::mt19937 random(9);
+		P6::ParticleWorld world(3000);
+		SpawnMixed(world, 2000, random);
+
+		P6::TriangleMesh level = MakeLevel(1);
+		P6::TreeBroadphase broadphase;
+		broadphase.addStatic(level);
+
+		std::vector<P6::ParticlePair> pairs;
+		std::vector<P6::StaticPair> touching;
+		for (int step = 0; step < 60; step++) {
+			world.update(0.05f);
+			if (step % 10 == 5) {
+				for (int k = 0; k < 50; k++) world.kill(world.handleAt(random() % world.size()));
+				SpawnMixed(world, 80, random);
+			}
+			broadphase.update(world);
+			Error += broadphase.particleTree().validate() ? 0 : 1;
+		}
+		Error += broadphase.staticTree().validate() ? 0 : 1;
+
+		pairs.clear();
+		broadphase.findPairs(pairs, touching);
+		std::set<std::pair<uint32_t, uint32_t>> found;
+		for (const P6::ParticlePair& pair : pairs) {
+			uint32_t a = world.handleAt(pair.a).slot, b = world.handleAt(pair.b).slot;
+			found.insert(std::make_pair(std::min(a, b), std::max(a, b)));
+		}
+		Error += found.size() == pairs.size() ? 0 : 1;
+		Error += found == BruteForceBoxes(world) ? 0 : 1;
+
+		//static pairs against every triangle box
+		std::set<std::pair<uint32_t, uint32_t>> expected, foundStatic;
+		const P6::ParticleStreams& s = world.buffer().streams();
+		for (size_t i = 0; i < world.size(); i++) {
+			const P6::Aabb box = P6::Aabb::Around(P6::MyVector(s.posX[i], s.posY[i], s.posZ[i]), s.radius[i]);
+			for (size_t t = 0; t < level.triangleCount(); t++) {
+				if (box.overlaps(level.triangleBounds(t))) expected.insert(std::make_pair(static_cast<uint32_t>(i), static_cast<uint32_t>(t)));
+			}
+		}
+		for (const P6::StaticPair& pair : touching) foundStatic.insert(std::make_pair(pair.particle, pair.shape));
+		std::printf("  tree check: %zu particle pairs, %zu static pairs, height %d, area ratio %.1f\n",
+			pairs.size(), touching.size(), broadphase.particleTree().height(), broadphase.particleTree().areaRatio());
+		Error += foundStatic == expected && touching.size() == expected.size() ? 0 : 1;
+		return Error;
+	}
+}
+
+int perf_broadphase() {
+	int Error = 0;
+	if (!perf::Selected("broadphase")) return Error;
+
+	std::vector<size_t> sizes = { 1000, 10000, 100000, 1000000 };
+
+	std::printf("perf_broadphase: spatial hash rebuild + pair search, one step per pass\n");
+	for (size_t count : sizes) {
+		P6::ParticleBuffer buffer = MakeCloud(count, 7);
+		P6::SpatialHashGrid grid;
+		std::vector<P6::ParticlePair> pairs;
+		pairs.reserve(count * 2);
+
+		perf::Stats stats = perf::Measure(count, 1, [&]() {
+			pairs.clear();
+			grid.build(buffer.streams(), buffer.size());
+			grid.findPairs(pairs);
+		});
+		perf::Report("broadphase", "SpatialHashGrid build + pairs", "particle", count, 1, stats);
+		std::printf("  %zu pairs\n", pairs.size());
+	}
+
+	//mixed sizes, coherent motion: incremental sweep and prune against a full grid rebuild
+	std::printf("perf_broadphase: mixed radii 0.1-5, world.update then the broadphase, one step per pass\n");
+	for (size_t count : { 10000, 100000 }) {
+		std::mt19937 random(5);
+		P6::ParticleWorld world(count);
+		SpawnMixed(world, count, random);
+
+		P6::SweepAndPrune sap;
+		sap.update(world);
+		size_t events = 0;
+		perf::Stats stats = perf::Measure(count, 1, [&]() {
+			world.update(0.016f);
+			sap.update(world);
+			events += sap.added().size() + sap.removed().size();
+		});
+		perf::Report("broadphase", "world.update + SweepAndPrune", "particle", count, 1, stats);
+		std::printf("  %zu pairs, %.1f events per step\n", sap.pairCount(), static_cast<double>(events) / (perf::config().warmup + perf::config().repetitions));
+
+		P6::SpatialHashGrid grid;
+		std::vector<P6::ParticlePair> pairs;
+		std::vector<P6::StaticPair> touching;
+		stats = perf::Measure(count, 1, [&]() {
+			world.update(0.016f);
+			pairs.clear();
+			grid.build(world.buffer().streams(), world.size());
+			grid.findPairs(pairs);
+		});
+		perf::Report("broadphase", "world.update + SpatialHashGrid", "particle", count, 1, stats);
+
+		P6::TreeBroadphase tree;
+		tree.update(world);
+		size_t reinserted = 0;
+		stats = perf::Measure(count, 1, [&]() {
+			world.update(0.016f);
+			pairs.clear();
+			tree.update(world);
+			tree.findPairs(pairs, touching);
+			reinserted += tree.reinserted();
+		});
+		perf::Report("broadphase", "world.update + TreeBroadphase", "particle", count, 1, stats);
+		std::printf("  %zu pairs, %.1f reinserted per step\n", pairs.size(), static_cast<double>(reinserted) / (perf::config().warmup + perf::config().repetitions));
+	}
+	Error += CheckSweepAndPrune();
+
+	//static level geometry: one tree descent per particle against a scan over every triangle
+	std::printf("perf_broadphase: 10000 particles against static triangles, static pairs only\n");
+	for (int copies : { 1, 4, 8 }) {
+		P6::TriangleMesh level = MakeLevel(copies);
+		std::mt19937 random(13);
+		P6::ParticleWorld world(10000);
+		SpawnOver(world, level.bounds(), 10000, random);
+
+		P6::TreeBroadphase tree;
+		tree.addStatic(level);
+		tree.update(world);
+		std::vector<P6::ParticlePair> pairs;
+		std::vector<P6::StaticPair> touching;
+		perf::Stats stats = perf::Measure(world.size(), 1, [&]() {
+			touching.clear();
+			for (size_t i = 0; i < world.size(); i++) {
+				const P6::ParticleView particle = world.buffer()[i];
+				tree.staticTree().query(P6::Aabb::Around(particle.GetPosition(), particle.GetRadius()), [&](int32_t node) {
+					touching.push_back(P6::StaticPair{ static_cast<uint32_t>(i), tree.staticTree().userData(node) });
+					return true;
+				});
+			}
+		});
+		perf::Report("broadphase", "static tree, " + std::to_string(level.triangleCount()) + " triangles", "particle", world.size(), 1, stats);
+		std::printf("  %zu static pairs, tree height %d\n", touching.size(), tree.staticTree().height());
+
+		std::vector<P6::Aabb> boxes;
+		for (size_t t = 0; t < level.triangleCount(); t++) boxes.push_back(level.triangleBounds(t));
+		size_t scanned = 0;
+		stats = perf::Measure(world.size(), 1, [&]() {
+			scanned = 0;
+			for (size_t i = 0; i < world.size(); i++) {
+				const P6::ParticleView particle = world.buffer()[i];
+				const P6::Aabb box = P6::Aabb::Around(particle.GetPosition(), particle.GetRadius());
+				for (const P6::Aabb& triangle : boxes) scanned += box.overlaps(triangle) ? 1 : 0;
+			}
+		});
+		perf::Report("broadphase", "linear scan, " + std::to_string(level.triangleCount()) + " triangles", "particle", world.size(), 1, stats);
+		Error += scanned == touching.size() ? 0 : 1;
+	}
+	Error += CheckTreeBroadphase();
+
+	//same pair set as checking everything against everything
+	const size_t CheckCount = 4000;
+	P6::ParticleBuffer buffer = MakeCloud(CheckCount, 11);
+	std::vector<P6::ParticlePair> expected = BruteForce(buffer.streams(), buffer.size());
+
+	perf::Stats naive = perf::Measure(CheckCount, 1, [&]() {
+		expected = BruteForce(buffer.streams(), buffer.size());
+	});
+	perf::Report("broadphase", "brute force O(n^2)", "particle", CheckCount, 1, naive);
+
+	P6::SpatialHashGrid grid;
+	std::vector<P6::ParticlePair> found;
+	grid.build(buffer.streams(), buffer.size());
+	grid.findPairs(found);
+	std::sort(found.begin(), found.end(), PairLess);
+	std::sort(expected.begin(), expected.end(), PairLess);
+
+	Error += found.size() == expected.size() ? 0 : 1;
+	for (size_t i = 0; i < std::min(found.size(), expected.size()); i++) {
+		Error += found[i].a == expected[i].a && found[i].b == expected[i].b ? 0 : 1;
+	}
+
+	return Error;
+}
@@ -0,0 +1,228 @@
+#include "p6/JobSystem.h"
+#include "p6/ParticleWorld.h"
+#include "perf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+	const float Step = 0.016f;
+	const float Spacing = 0.1f;
+
+	P6::P6Particle Cloth() {
+		P6::P6Particle particle;
+		particle.mass = 0.01f;
+		particle.active = true;
+		particle.radius = 0.04f;
+		particle.Acceleration = P6::MyVector(0, -9.8f, 0);
+		return particle;
+	}
+
+	const P6::MyVector Across(Spacing * 0.8f, 0, Spacing * 0.6f), Down(0, -Spacing, 0);
+
+	//a curtain hanging from its top row, pins 0 to side - 1 left to right
+	size_t Curtain(P6::ParticleWorld& world, size_t side) {
+		P6::ClothSolver& cloth = world.cloth();
+		const size_t curtain = cloth.addGrid(world, side, side, P6::MyVector(), Across, Down, Cloth());
+		for (size_t column = 0; column < side; column++) cloth.pin(curtain, column, 0, Across * static_cast<float>(column));
+		return curtain;
+	}
+
+	//the same curtain the force way: springs along the grid lines and diagonals, the top row on anchored springs
+	void SpringCurtain(P6::ParticleWorld& world, size_t side, float stiffness) {
+		std::vector<P6::ParticleHandle> grid;
+		for (size_t row = 0; row < side; row++) {
+			for (size_t column = 0; column < side; column++) {
+				P6::P6Particle particle = Cloth();
+				particle.Position = Across * static_cast<float>(column) + Down * static_cast<float>(row);
+				grid.push_back(world.spawn(particle));
+			}
+		}
+		P6::SpringForces& springs = world.forces().springs();
+		auto at = [&](size_t column, size_t row) { return grid[row * side + column]; };
+		const float diagonal = Spacing * std::sqrt(2.0f);
+		for (size_t row = 0; row < side; row++) {
+			for (size_t column = 0; column < side; column++) {
+				if (column + 1 < side) springs.addSpring(at(column, row), at(column + 1, row), Spacing, stiffness, 0.02f);
+				if (row + 1 < side) springs.addSpring(at(column, row), at(column, row + 1), Spacing, stiffness, 0.02f);
+				if (column + 1 < side && row + 1 < side) {
+					springs.addSpring(at(column, row), at(column + 1, row + 1), diagonal, 0.5f * stiffness, 0.01f);
+					springs.addSpring(at(column + 1, row), at(column, row + 1), diagonal, 0.5f * stiffness, 0.01f);
+				}
+			}
+		}
+		for (size_t column = 0; column < side; column++) {
+			springs.addAnchored(at(column, 0), Across * static_cast<float>(column), 0, 10.0f * stiffness, 0.1f);
+		}
+	}
+
+	//worst stretch along the grid lines, NaN as soon as anything isn't finite
+	float Stretch(P6::ParticleWorld& world, size_t curtain, size_t side) {
+		P6::ClothSolver& cloth = world.cloth();
+		float worst = 0;
+		for (size_t row = 0; row < side; row++) {
+			for (size_t column = 0; column < side; column++) {
+				if (!world.alive(cloth.particle(curtain, column, row))) continue;
+				const P6::MyVector p = world[cloth.particle(curtain, column, row)].GetPosition();
+				if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z)) return NAN;
+				for (int direction = 0; direction < 2; direction++) {
+					const size_t c = column + (direction == 0), r = row + (direction == 1);
+					if (c >= side || r >= side || !world.alive(cloth.particle(curtain, c, r))) continue;
+					const float length = (world[cloth.particle(curtain, c, r)].GetPosition() - p).Magnitude();
+					worst = std::max(worst, (length - Spacing) / Spacing);
+				}
+			}
+		}
+		return worst;
+	}
+
+	std::vector<float> Positions(const P6::ParticleWorld& world) {
+		const P6::ParticleStreams& s = world.buffer().streams();
+		std::vector<float> out(s.posX, s.posX + world.size());
+		out.insert(out.end(), s.posY, s.posY + world.size());
+		out.insert(out.end(), s.posZ, s.posZ + world.size());
+		return out;
+	}
+
+	int CheckCloth() {
+		int Error = 0;
+		const size_t Side = 32;
+
+		//both modes hold a curtain up at the normal step, Jacobi on three times the iterations; the pins hold it exactly
+		float stretch[2] = {};
+		for (int mode = 0; mode < 2; mode++) {
+			P6::ParticleWorld world(Side * Side);
+			const size_t curtain = Curtain(world, Side);
+			P6::ClothSolver& cloth = world.cloth();
+			if (mode == 1) {
+				cloth.setMode(P6::ClothMode::Jacobi);
+				cloth.setIterations(30);
+			}
+			for (int step = 0; step < 300; step++) {
+				world.update(Step);
+				stretch[mode] = std::max(stretch[mode], Stretch(world, curtain, Side));
+			}
+			Error += std::isfinite(stretch[mode]) ? 0 : 1;
+			Error += world[cloth.particle(curtain, Side - 1, 0)].GetPosition().x == Across.x * (Side - 1) ? 0 : 1;
+			//still hanging, not piled up at the rail
+			Error += world[cloth.particle(curtain, Side / 2, Side - 1)].GetPosition().y < -0.9f * Spacing * (Side - 1) ? 0 : 1;
+		}
+		Error += stretch[0] < 0.1f && stretch[1] < 0.25f ? 0 : 1;
+
+		//Jacobi gives the same bits without threads and on any number of them
+		std::vector<std::vector<float>> runs;
+		for (unsigned threads : { 0u, 2u, 4u }) {
+			P6::JobSystem jobs(std::max(threads, 1u));
+			P6::ParticleWorld world(Side * Side);
+			Curtain(world, Side);
+			world.cloth().setMode(P6::ClothMode::Jacobi);
+			if (threads > 0) world.setJobs(&jobs);
+			for (int step = 0; step < 50; step++) world.update(Step);
+			runs.push_back(Positions(world));
+			world.setJobs(nullptr);
+		}
+		Error += runs[0] == runs[1] && runs[0] == runs[2] ? 0 : 1;
+
+		//moved pins drag the curtain along; a torn out particle leaves a hole, not NaNs
+		{
+			P6::ParticleWorld world(Side * Side);
+			const size_t curtain = Curtain(world, Side);
+			P6::ClothSolver& cloth = world.cloth();
+			for (int step = 0; step < 100; step++) {
+				for (uint32_t pin = 0; pin < Side; pin++) cloth.movePin(pin, Across * static_cast<float>(pin) + P6::MyVector(0, 0.01f * step, 0));
+				world.update(Step);
+			}
+			const P6::ParticleView corner = world[cloth.particle(curtain, 0, 0)];
+			Error += corner.GetPosition().y == 0.01f * 99 && std::abs(corner.GetVelocity().y - 0.01f / Step) < 1e-3f ? 0 : 1;
+			Error += world[cloth.particle(curtain, Side / 2, Side - 1)].GetPosition().y > 0.5f - Spacing * Side ? 0 : 1;
+			world.kill(cloth.particle(curtain, Side / 2, Side / 2));
+			for (int step = 0; step < 100; step++) world.update(Step);
+			Error += std::isfinite(Stretch(world, curtain, Side)) ? 0 : 1;
+		}
+
+		//dropped flat on a floor with friction, a cloth comes to rest and sleeps as one; touching one particle wakes it all
+		{
+			P6::ParticleWorld world(Side * Side);
+			world.setSleeping(true, 0.05f, 30);
+			world.boundaries().addPlane(P6::MyVector(0, 1, 0), 0, 0, 0.8f);
+			P6::ClothSolver& cloth = world.cloth();
+			const size_t sheet = cloth.addGrid(world, Side, Side, P6::MyVector(0, 0.5f, 0), P6::MyVector(Spacing, 0, 0), P6::MyVector(0, 0, Spacing), Cloth());
+			for (int step = 0; step < 300; step++) world.update(Step);
+			Error += world.awakeCount() == 0 ? 0 : 1;
+			world.wake(cloth.particle(sheet, 3, 3));
+			Error += world.awakeCount() == Side * Side ? 0 : 1;
+		}
+
+		//the force way at the same step: springs stiff enough to hold the curtain within a few percent blow it apart
+		float springStretch = 0;
+		{
+			P6::ParticleWorld world(Side * Side);
+			SpringCurtain(world, Side, 600.0f);
+			for (int step = 0; step < 300 && std::isfinite(springStretch); step++) {
+				world.update(Step);
+				const P6::ParticleStreams& s = world.buffer().streams();
+				for (size_t i = 0; i + 1 < world.size(); i++) {
+					if ((i + 1) % Side == 0) continue;
+					const float dx = s.posX[i + 1] - s.posX[i], dy = s.posY[i + 1] - s.posY[i], dz = s.posZ[i + 1] - s.posZ[i];
+					springStretch = std::max(springStretch, (std::sqrt(dx * dx + dy * dy + dz * dz) - Spacing) / Spacing);
+				}
+			}
+		}
+
+		std::printf("  cloth check: a %zux%zu curtain stretched %.2f%% Gauss-Seidel, %.2f%% Jacobi; springs at the same step: %s%.0f%%\n",
+			Side, Side, 100.0f * stretch[0], 100.0f * stretch[1], std::isfinite(springStretch) ? "" : "blew up, ", 100.0f * springStretch);
+		return Error;
+	}
+}
+
+int perf_cloth() {
+	int Error = 0;
+	if (!perf::Selected("cloth")) return Error;
+
+	const unsigned threads = std::max(2u, std::thread::hardware_concurrency());
+	P6::JobSystem jobs(threads);
+	const size_t Steps = 10;
+	for (size_t side : { 64, 256 }) {
+		const size_t count = side * side;
+		P6::ParticleWorld world(count);
+		Curtain(world, side);
+		P6::ClothSolver& cloth = world.cloth();
+		std::printf("perf_cloth: a %zux%zu curtain, %zu constraints, %d iterations\n", side, side, cloth.constraintCount(), 10);
+
+		//whole steps, per particle
+		cloth.setMode(P6::ClothMode::GaussSeidel);
+		perf::Stats stats = perf::Measure(count, Steps, [&]() {
+			for (size_t step = 0; step < Steps; step++) world.update(Step);
+		});
+		perf::Report("cloth", "Gauss-Seidel", "particle", count, Steps, stats);
+
+		cloth.setMode(P6::ClothMode::Jacobi);
+		stats = perf::Measure(count, Steps, [&]() {
+			for (size_t step = 0; step < Steps; step++) world.update(Step);
+		});
+		perf::Report("cloth", "Jacobi", "particle", count, Steps, stats);
+
+		world.setJobs(&jobs);
+		stats = perf::Measure(count, Steps, [&]() {
+			for (size_t step = 0; step < Steps; step++) world.update(Step);
+		});
+		perf::Report("cloth", "Jacobi, " + std::to_string(threads) + " threads", "particle", count, Steps, stats);
+		world.setJobs(nullptr);
+
+		//what the springs cost for the same grid, before they need the smaller steps to stay together
+		P6::ParticleWorld springs(count);
+		SpringCurtain(springs, side, 600.0f);
+		stats = perf::Measure(count, Steps, [&]() {
+			for (size_t step = 0; step < Steps; step++) springs.update(Step);
+		});
+		perf::Report("cloth", "springs, one step", "particle", count, Steps, stats);
+	}
+	Error += CheckCloth();
+
+	return Error;
+}
@@ -0,0 +1,322 @@
+#include "p6/ContactResolver.h"
+#include "p6/JobSystem.h"
+#include "p6/ParticleWorld.h"
+#include "perf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+	//radius 0.5 spheres on a jittered lattice 0.9 apart, so each one overlaps about six neighbours,
+	//all moving in random directions: a pile right after something dropped into it
+	void SpawnPile(P6::ParticleWorld& world, size_t count, unsigned seed) {
+		const int side = static_cast<int>(std::ceil(std::cbrt(static_cast<double>(count))));
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> jitter(-0.03f, 0.03f);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+		for (size_t i = 0; i < count; i++) {
+			const int x = static_cast<int>(i % side), y = static_cast<int>((i / side) % side), z = static_cast<int>(i / (side * side));
+			P6::P6Particle particle;
+			particle.Position = P6::MyVector(0.9f * x + jitter(random), 0.9f * y + jitter(random), 0.9f * z + jitter(random));
+			particle.Velocity = P6::MyVector(unit(random), unit(random), unit(random));
+			particle.mass = 1.0f + 0.5f * unit(random);
+			particle.radius = 0.5f;
+			particle.active = true;
+			world.spawn(particle);
+		}
+	}
+
+	//positions and velocities, so every timed pass resolves the same pile
+	struct Snapshot {
+		std::vector<float> columns[6];
+
+		void save(const P6::ParticleStreams& s, size_t count) {
+			float* source[6] = { s.posX, s.posY, s.posZ, s.velX, s.velY, s.velZ };
+			for (int c = 0; c < 6; c++) columns[c].assign(source[c], source[c] + count);
+		}
+
+		void restore(const P6::ParticleStreams& s) const {
+			float* target[6] = { s.posX, s.posY, s.posZ, s.velX, s.velY, s.velZ };
+			for (int c = 0; c < 6; c++) std::memcpy(target[c], columns[c].data(), columns[c].size() * sizeof(float));
+		}
+	};
+
+	P6::MyVector Momentum(const P6::ParticleStreams& s, size_t count) {
+		double x = 0, y = 0, z = 0;
+		for (size_t i = 0; i < count; i++) {
+			x += s.mass[i] * s.velX[i];
+			y += s.mass[i] * s.velY[i];
+			z += s.mass[i] * s.velZ[i];
+		}
+		return P6::MyVector(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z));
+	}
+
+	//impulses come in equal and opposite pairs, and with a big enough budget nothing is left closing or
+	//overlapping. Every particle of the pile overlaps its neighbours, so the whole pile has to spread out
+	//and the position pass needs about two million iterations to get under its tolerance
+	int CheckResolver() {
+		int Error = 0;
+		const size_t Budget = 4000000;
+		P6::ParticleWorld world(4096);
+		SpawnPile(world, 4096, 17);
+		world.setCollisions(true, 0.3f);
+		world.contacts().setIterations(Budget);
+
+		const P6::ParticleStreams& s = world.buffer().streams();
+		const P6::MyVector before = Momentum(s, world.size());
+		world.update(0);
+		const P6::MyVector after = Momentum(s, world.size());
+		Error += (after - before).Magnitude() < 1e-2f ? 0 : 1;
+
+		P6::ContactResolver& contacts = world.contacts();
+		int closing = 0;
+		for (size_t c = 0; c < contacts.size(); c++) {
+			if (contacts.contacts()[c].separatingVelocity(s) < -1e-3f) closing++;
+		}
+		Error += closing == 0 ? 0 : 1;
+		Error += contacts.velocityIterations() < Budget ? 0 : 1;
+		//the position pass stopped because it was done, not because it ran out
+		float deepest = 0;
+		for (size_t c = 0; c < contacts.size(); c++) deepest = std::max(deepest, contacts.contacts()[c].penetration);
+		Error += contacts.positionIterations() < Budget && deepest <= 1e-4f ? 0 : 1;
+
+		//head on, equal masses, fully elastic: they swap velocities
+		P6::ParticleWorld pair(2);
+		P6::P6Particle particle;
+		particle.mass = 1.0f;
+		particle.radius = 1.0f;
+		particle.active = true;
+		particle.Position = P6::MyVector(-0.9f, 0, 0);
+		particle.Velocity = P6::MyVector(3, 0, 0);
+		P6::ParticleHandle left = pair.spawn(particle);
+		particle.Position = P6::MyVector(0.9f, 0, 0);
+		particle.Velocity = P6::MyVector(-1, 0, 0);
+		P6::ParticleHandle right = pair.spawn(particle);
+		pair.setCollisions(true, 1.0f);
+		pair.update(0);
+		Error += std::abs(pair[left].GetVelocity().x + 1.0f) < 1e-5f && std::abs(pair[right].GetVelocity().x - 3.0f) < 1e-5f ? 0 : 1;
+		Error += pair[right].GetPosition().x - pair[left].GetPosition().x >= 2.0f - 1e-5f ? 0 : 1;
+
+		//resting on an immovable particle, gravity as a constant acceleration or bound through the registry:
+		//either way the weight isn't bounced back and it comes to rest
+		float hop[2] = {};
+		for (int registry = 0; registry < 2; registry++) {
+			P6::ParticleWorld stack(2);
+			stack.setCollisions(true, 0.5f);
+			P6::P6Particle ground;
+			ground.radius = 1.0f;
+			ground.active = true;
+			stack.spawn(ground);
+			particle.Position = P6::MyVector(0, 2.0f, 0);
+			particle.Velocity = P6::MyVector();
+			particle.Acceleration = registry ? P6::MyVector() : P6::MyVector(0, -9.8f, 0);
+			const P6::ParticleHandle top = stack.spawn(particle);
+			if (registry) stack.forces().bind(stack.forces().add(P6::GravityForce()), top);
+			for (int step = 0; step < 300; step++) {
+				stack.update(0.016f);
+				if (step >= 200) hop[registry] = std::max(hop[registry], std::abs(stack[top].GetVelocity().y));
+			}
+		}
+		Error += hop[0] < 1e-3f && hop[1] < 1e-3f ? 0 : 1;
+
+		std::printf("  resolver check: %zu contacts, %zu velocity + %zu position iterations, %d still closing, %g deepest; resting speed %g / %g with registry gravity\n",
+			contacts.size(), contacts.velocityIterations(), contacts.positionIterations(), closing, deepest, hop[0], hop[1]);
+		return Error;
+	}
+
+	uint64_t Hash(const P6::ParticleStreams& s, size_t count) {
+		//FNV-1a over the raw bits of positions and velocities
+		uint64_t hash = 14695981039346656037ull;
+		const float* columns[6] = { s.posX, s.posY, s.posZ, s.velX, s.velY, s.velZ };
+		for (const float* column : columns) {
+			const unsigned char* bytes = reinterpret_cast<const unsigned char*>(column);
+			for (size_t i = 0; i < count * sizeof(float); i++) hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+		return hash;
+	}
+
+	//a few steps of a pile with a given number of threads
+	uint64_t ColoredRun(unsigned threads) {
+		P6::JobSystem jobs(threads);
+		P6::ParticleWorld world(20000);
+		SpawnPile(world, 20000, 23);
+		world.setCollisions(true, 0.3f);
+		world.setJobs(&jobs);
+		for (int step = 0; step < 5; step++) world.update(0.016f);
+		return Hash(world.buffer().streams(), world.size());
+	}
+
+	//the same bits whatever the thread count, and with no shared particles inside a colour
+	int CheckColored() {
+		int Error = 0;
+		const uint64_t reference = ColoredRun(1);
+		for (unsigned threads : { 2u, 3u, 8u }) Error += ColoredRun(threads) == reference ? 0 : 1;
+		Error += ColoredRun(3) == ColoredRun(3) ? 0 : 1;
+
+		P6::JobSystem jobs(4);
+		P6::ParticleWorld world(4096);
+		SpawnPile(world, 4096, 17);
+		world.setCollisions(true, 0.3f);
+		world.setJobs(&jobs);
+		world.contacts().setSweeps(1000);
+		const P6::ParticleStreams& s = world.buffer().streams();
+		const P6::MyVector before = Momentum(s, world.size());
+		world.update(0);
+		Error += (Momentum(s, world.size()) - before).Magnitude() < 1e-2f ? 0 : 1;
+
+		P6::ContactResolver& contacts = world.contacts();
+		int closing = 0;
+		for (size_t c = 0; c < contacts.size(); c++) {
+			if (contacts.contacts()[c].separatingVelocity(s) < -1e-3f) closing++;
+		}
+		Error += closing == 0 ? 0 : 1;
+		std::printf("  coloured check: %zu contacts in %zu colours, %zu velocity + %zu position sweeps, %d still closing\n",
+			contacts.size(), contacts.colorCount(), contacts.velocityIterations(), contacts.positionIterations(), closing);
+		return Error;
+	}
+
+	//a 0.25 radius bullet at 500 m/s covers 8 units per 16 ms step, a wall of unit spheres is one unit thick
+	size_t ShootWall(P6::ParticleWorld& world, bool fast) {
+		P6::P6Particle particle;
+		particle.mass = 1.0f;
+		particle.radius = 0.5f;
+		particle.active = true;
+		for (int y = -2; y <= 2; y++) {
+			for (int z = -2; z <= 2; z++) {
+				particle.Position = P6::MyVector(5.0f, static_cast<float>(y), static_cast<float>(z));
+				world.spawn(particle);
+			}
+		}
+
+		P6::P6Particle bullet;
+		bullet.mass = 0.1f;
+		bullet.radius = 0.25f;
+		bullet.active = true;
+		bullet.fast = fast;
+		bullet.Position = P6::MyVector(0, 0.1f, -0.05f);
+		bullet.Velocity = P6::MyVector(500.0f, 0, 0);
+		return world.indexOf(world.spawn(bullet));
+	}
+
+	int CheckFast() {
+		int Error = 0;
+
+		//without the flag it ends up behind the wall, untouched
+		P6::ParticleWorld plain(32);
+		plain.setCollisions(true, 0.5f);
+		size_t bullet = ShootWall(plain, false);
+		plain.update(0.016f);
+		const float plainX = plain.buffer()[bullet].GetPosition().x;
+		Error += plainX > 6.0f ? 0 : 1;
+
+		//with it, it hits the middle of the wall and comes back
+		P6::ParticleWorld swept(32);
+		swept.setCollisions(true, 0.5f);
+		bullet = ShootWall(swept, true);
+		const P6::MyVector before = Momentum(swept.buffer().streams(), swept.size());
+		swept.update(0.016f);
+		const P6::ParticleView shot = swept.buffer()[bullet];
+		Error += shot.GetPosition().x < 5.0f && shot.GetVelocity().x < 0 ? 0 : 1;
+		Error += (Momentum(swept.buffer().streams(), swept.size()) - before).Magnitude() < 1e-2f ? 0 : 1;
+
+		float pushed = 0;
+		for (size_t i = 0; i < swept.size(); i++) {
+			if (i != bullet) pushed = std::max(pushed, swept.buffer()[i].GetVelocity().x);
+		}
+		Error += pushed > 50.0f ? 0 : 1;
+		std::printf("  fast check: plain bullet at x %.2f, swept bullet at x %.2f going %.1f m/s, wall hit at %.1f m/s\n",
+			plainX, shot.GetPosition().x, shot.GetVelocity().x, pushed);
+		return Error;
+	}
+}
+
+int perf_contacts() {
+	int Error = 0;
+	if (!perf::Selected("contacts")) return Error;
+
+	std::printf("perf_contacts: contact generation + resolution of a fresh pile, per particle\n");
+	for (size_t count : { 1000, 10000, 100000 }) {
+		P6::ParticleWorld world(count);
+		SpawnPile(world, count, 3);
+		world.setCollisions(true, 0.3f);
+
+		Snapshot pile;
+		pile.save(world.buffer().streams(), world.size());
+		perf::Stats stats = perf::Measure(count, 1, [&]() {
+			pile.restore(world.buffer().streams());
+			world.update(0.016f);
+		});
+		perf::Report("contacts", "world.update + ContactResolver", "particle", count, 1, stats);
+
+		P6::ContactResolver& contacts = world.contacts();
+		std::printf("  %zu contacts, %zu velocity + %zu position iterations\n", contacts.size(), contacts.velocityIterations(), contacts.positionIterations());
+	}
+	Error += CheckResolver();
+
+	//the same pile through the coloured solver, one thread up to every hardware thread
+	const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<unsigned> threadCounts;
+	for (unsigned threads = 1; threads < hardware; threads *= 2) threadCounts.push_back(threads);
+	threadCounts.push_back(hardware);
+
+	const size_t PileSize = 100000;
+	std::printf("perf_contacts: coloured solver on a %zu particle pile, %u hardware threads\n", PileSize, hardware);
+	double single = 0;
+	for (unsigned threads : threadCounts) {
+		P6::JobSystem jobs(threads);
+		P6::ParticleWorld world(PileSize);
+		SpawnPile(world, PileSize, 3);
+		world.setCollisions(true, 0.3f);
+		world.setJobs(&jobs);
+
+		Snapshot pile;
+		pile.save(world.buffer().streams(), world.size());
+		perf::Stats stats = perf::Measure(PileSize, 1, [&]() {
+			pile.restore(world.buffer().streams());
+			world.update(0.016f);
+		});
+		perf::Report("contacts", "world.update + resolveColored, " + std::to_string(threads) + " threads", "particle", PileSize, 1, stats);
+		if (threads == 1) single = stats.median;
+
+		P6::ContactResolver& contacts = world.contacts();
+		std::printf("  %zu colours, %zu velocity + %zu position sweeps, %.2fx over one thread\n",
+			contacts.colorCount(), contacts.velocityIterations(), contacts.positionIterations(), stats.median > 0 ? single / stats.median : 0.0);
+	}
+	Error += CheckColored();
+
+	//a few hundred fast particles through a pile: swept each step, against shrinking the step for everyone
+	std::printf("perf_contacts: 256 fast particles (80 m/s) in a %zu particle pile, 16 ms steps\n", PileSize);
+	for (int variant = 0; variant < 2; variant++) {
+		P6::ParticleWorld world(PileSize + 256);
+		SpawnPile(world, PileSize, 3);
+		std::mt19937 random(29);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		for (int k = 0; k < 256; k++) {
+			P6::P6Particle particle = world.buffer().get(random() % PileSize);
+			particle.Velocity = P6::MyVector(unit(random), unit(random), unit(random)).Direction() * 80.0f;
+			particle.fast = variant == 0;
+			world.spawn(particle);
+		}
+		world.setCollisions(true, 0.3f);
+
+		Snapshot pile;
+		pile.save(world.buffer().streams(), world.size());
+		//80 m/s is 1.28 units per step, 8 substeps bring that under the 0.25 a particle may move safely
+		const int substeps = variant == 0 ? 1 : 8;
+		perf::Stats stats = perf::Measure(world.size(), 1, [&]() {
+			pile.restore(world.buffer().streams());
+			for (int k = 0; k < substeps; k++) world.update(0.016f / substeps);
+		});
+		perf::Report("contacts", variant == 0 ? "swept fast particles, 1 step" : "everyone, 8 substeps", "particle", world.size(), 1, stats);
+	}
+	Error += CheckFast();
+
+	return Error;
+}
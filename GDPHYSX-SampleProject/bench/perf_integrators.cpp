@@ -0,0 +1,140 @@
+#include "p6/Integrators.h"
+#include "p6/ParticleBuffer.h"
+#include "perf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+	//undamped spring to the origin, a = -k x
+	//omega = 20 rad/s is stiff next to a 60 Hz step: omega * dt = 1/3
+	const float Stiffness = 400.0f;
+	const float Omega = 20.0f;
+	const float Duration = 5.0f;
+
+	struct Result {
+		//largest relative energy change over all particles
+		double energyDrift;
+		//largest position error against the closed-form solution, over the amplitude
+		double positionError;
+	};
+
+	P6::MyVector StartPosition(size_t i) {
+		float f = static_cast<float>(i);
+		return P6::MyVector(1.0f + 0.001f * f, -0.5f, 0.25f * std::sin(f));
+	}
+
+	P6::MyVector StartVelocity(size_t i) {
+		float f = static_cast<float>(i);
+		return P6::MyVector(0.0f, 10.0f * std::cos(f), 5.0f);
+	}
+
+	double Energy(const P6::MyVector& p, const P6::MyVector& v) {
+		return 0.5 * v.dotProduct(v) + 0.5 * Stiffness * p.dotProduct(p);
+	}
+
+	P6::ParticleBuffer MakeBuffer(size_t count) {
+		P6::ParticleBuffer buffer(count);
+		for (size_t i = 0; i < count; i++) {
+			P6::P6Particle particle;
+			particle.mass = 1.0f;
+			particle.Position = StartPosition(i);
+			particle.Velocity = StartVelocity(i);
+			particle.active = true;
+			buffer.add(particle);
+		}
+		return buffer;
+	}
+
+	struct SpringAcceleration {
+		P6::MyVector operator()(size_t, const P6::MyVector& position, const P6::MyVector&) const {
+			return position * -Stiffness;
+		}
+	};
+
+	template <typename Integrator>
+	Result Run(size_t count, float dt) {
+		P6::ParticleBuffer buffer = MakeBuffer(count);
+
+		const int steps = static_cast<int>(std::lround(Duration / dt));
+		for (int s = 0; s < steps; s++) buffer.integrate<Integrator>(dt, SpringAcceleration());
+
+		Result result;
+		result.energyDrift = 0;
+		result.positionError = 0;
+
+		//x(t) = x0 cos(wt) + v0 / w sin(wt)
+		const double t = static_cast<double>(steps) * dt;
+		const float c = static_cast<float>(std::cos(Omega * t));
+		const float s = static_cast<float>(std::sin(Omega * t));
+		for (size_t i = 0; i < count; i++) {
+			P6::MyVector p0 = StartPosition(i);
+			P6::MyVector v0 = StartVelocity(i);
+			P6::MyVector exact = p0 * c + v0 * (s / Omega);
+			P6::MyVector p = buffer[i].GetPosition();
+			P6::MyVector v = buffer[i].GetVelocity();
+
+			double e0 = Energy(p0, v0);
+			double amplitude = std::sqrt(2.0 * e0 / Stiffness);
+			result.energyDrift = std::max(result.energyDrift, std::abs(Energy(p, v) - e0) / e0);
+			result.positionError = std::max(result.positionError, (p - exact).Magnitude() / amplitude);
+		}
+		return result;
+	}
+
+	template <typename Integrator>
+	void Accuracy(const char* name, size_t count, float dt, Result& out) {
+		out = Run<Integrator>(count, dt);
+		if (std::isfinite(out.energyDrift) && out.energyDrift < 1e6) {
+			std::printf("  %-22s energy drift %10.3e  position error %10.3e\n", name, out.energyDrift, out.positionError);
+		}
+		else {
+			std::printf("  %-22s diverged\n", name);
+		}
+	}
+
+	//cost does not depend on dt, so each scheme is timed once
+	template <typename Integrator>
+	void Timing(const char* name, size_t count) {
+		const size_t Steps = 20;
+		P6::ParticleBuffer buffer = MakeBuffer(count);
+		perf::Stats stats = perf::Measure(count, Steps, [&]() {
+			for (size_t s = 0; s < Steps; s++) buffer.integrate<Integrator>(1.0f / 60.0f, SpringAcceleration());
+		});
+		perf::Report("integrators", name, "particle", count, Steps, stats);
+	}
+}
+
+int perf_integrators() {
+	int Error = 0;
+	if (!perf::Selected("integrators")) return Error;
+
+	const size_t Count = 10000;
+	const float Steps[] = { 1.0f / 240.0f, 1.0f / 120.0f, 1.0f / 60.0f, 1.0f / 30.0f };
+
+	std::printf("perf_integrators: %zu particles on a spring, omega = %.0f rad/s\n", Count, Omega);
+	Timing<P6::ConstantAcceleration>("constant acceleration", Count);
+	Timing<P6::SemiImplicitEuler>("semi-implicit Euler", Count);
+	Timing<P6::VelocityVerlet>("velocity Verlet", Count);
+	Timing<P6::RK4>("RK4", Count);
+
+	std::printf("accuracy after %.0f s simulated:\n", Duration);
+	for (float dt : Steps) {
+		std::printf("- dt = 1/%.0f s (omega * dt = %.3f)\n", 1.0f / dt, Omega * dt);
+
+		Result legacy, euler, verlet, rk4;
+		Accuracy<P6::ConstantAcceleration>("constant acceleration", Count, dt, legacy);
+		Accuracy<P6::SemiImplicitEuler>("semi-implicit Euler", Count, dt, euler);
+		Accuracy<P6::VelocityVerlet>("velocity Verlet", Count, dt, verlet);
+		Accuracy<P6::RK4>("RK4", Count, dt, rk4);
+
+		//the symplectic schemes stay bounded while omega * dt < 2
+		Error += euler.energyDrift < 1.0 ? 0 : 1;
+		Error += verlet.energyDrift < 1.0 ? 0 : 1;
+		//fourth order beats second order whenever RK4 itself is stable, omega * dt < 2.8
+		Error += rk4.positionError <= verlet.positionError ? 0 : 1;
+	}
+
+	return Error;
+}
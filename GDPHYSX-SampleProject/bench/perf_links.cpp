@@ -0,0 +1,252 @@
+#include "p6/JobSystem.h"
+#include "p6/ParticleWorld.h"
+#include "perf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+	const float Step = 0.016f;
+
+	P6::P6Particle Bead(const P6::MyVector& position, float mass = 1.0f, float radius = 0.2f) {
+		P6::P6Particle particle;
+		particle.mass = mass;
+		particle.active = true;
+		particle.radius = radius;
+		particle.Position = position;
+		particle.Acceleration = P6::MyVector(0, -9.8f, 0);
+		return particle;
+	}
+
+	//a chain hung from anchor by a rod, laid out sideways so it swings down
+	std::vector<P6::ParticleHandle> Chain(P6::ParticleWorld& world, size_t count, const P6::MyVector& anchor, float length) {
+		std::vector<P6::ParticleHandle> handles;
+		for (size_t i = 0; i < count; i++) {
+			handles.push_back(world.spawn(Bead(anchor + P6::MyVector(length * (i + 1), 0, 0))));
+			if (i == 0) world.links().addAnchoredRod(handles[0], anchor, length);
+			else world.links().addRod(handles[i - 1], handles[i], length);
+		}
+		return handles;
+	}
+
+	//a rope bridge: two rows of side + 1 beads, rods along, across and diagonally, the four end beads
+	//pinned to the banks by rods. It starts hung in a V with a fifth of slack; pinned at both ends,
+	//a straight deck of rods couldn't sag without stretching
+	void Bridge(P6::ParticleWorld& world, size_t side, float length) {
+		const float across = 0.8f * length, down = 0.6f * length;
+		auto at = [&](size_t k, int r) {
+			const float middle = 0.5f * (side + 2);
+			const float fromBank = middle - std::abs(static_cast<float>(k) - middle);
+			return P6::MyVector(across * k, -down * fromBank, length * r);
+		};
+		std::vector<P6::ParticleHandle> rows[2];
+		for (size_t i = 0; i <= side; i++) {
+			for (int r = 0; r < 2; r++) rows[r].push_back(world.spawn(Bead(at(i + 1, r))));
+		}
+		P6::ParticleLinks& links = world.links();
+		for (size_t i = 0; i <= side; i++) {
+			links.addRod(rows[0][i], rows[1][i], length);
+			if (i == side) break;
+			for (int r = 0; r < 2; r++) links.addRod(rows[r][i], rows[r][i + 1], length);
+			links.addRod(rows[0][i], rows[1][i + 1], (at(i + 2, 1) - at(i + 1, 0)).Magnitude());
+		}
+		for (int r = 0; r < 2; r++) {
+			links.addAnchoredRod(rows[r][0], at(0, r), length);
+			links.addAnchoredRod(rows[r][side], at(side + 2, r), length);
+		}
+	}
+
+	float Distance(P6::ParticleWorld& world, P6::ParticleHandle a, const P6::MyVector& b) {
+		return (world[a].GetPosition() - b).Magnitude();
+	}
+
+	//worst |distance - length| / length over the chain
+	float Stretch(P6::ParticleWorld& world, const std::vector<P6::ParticleHandle>& chain, const P6::MyVector& anchor, float length) {
+		float worst = std::abs(Distance(world, chain[0], anchor) - length) / length;
+		for (size_t i = 1; i < chain.size(); i++) {
+			worst = std::max(worst, std::abs(Distance(world, chain[i], world[chain[i - 1]].GetPosition()) - length) / length);
+		}
+		return worst;
+	}
+
+	int CheckLinks() {
+		int Error = 0;
+
+		//a swinging chain at the normal step: within several percent on the resolver's default iterations,
+		//within one given more
+		const P6::MyVector top(0, 30.0f, 0);
+		float chainStretch = 0;
+		for (size_t iterations : { 0, 1200 }) {
+			P6::ParticleWorld world(64);
+			world.contacts().setIterations(iterations);
+			const std::vector<P6::ParticleHandle> chain = Chain(world, 20, top, 1.0f);
+			float lowest = top.y;
+			chainStretch = 0;
+			for (int step = 0; step < 600; step++) {
+				world.update(Step);
+				chainStretch = std::max(chainStretch, Stretch(world, chain, top, 1.0f));
+				lowest = std::min(lowest, world[chain.back()].GetPosition().y);
+			}
+			//it swung through hanging straight down
+			Error += lowest < top.y - 19.0f ? 0 : 1;
+			Error += chainStretch < (iterations == 0 ? 0.1f : 0.01f) ? 0 : 1;
+		}
+
+		//the same chain on threads: resolveColored, the same bits on any thread count
+		{
+			P6::JobSystem two(2), four(4);
+			P6::ParticleWorld a(64), b(64);
+			const std::vector<P6::ParticleHandle> ca = Chain(a, 20, top, 1.0f), cb = Chain(b, 20, top, 1.0f);
+			a.setJobs(&two);
+			b.setJobs(&four);
+			a.contacts().setSweeps(50);
+			b.contacts().setSweeps(50);
+			float threadedStretch = 0;
+			for (int step = 0; step < 300; step++) {
+				a.update(Step);
+				b.update(Step);
+				threadedStretch = std::max(threadedStretch, Stretch(a, ca, top, 1.0f));
+			}
+			bool same = true;
+			for (size_t i = 0; i < ca.size(); i++) {
+				same = same && a[ca[i]].GetPosition().x == b[cb[i]].GetPosition().x && a[ca[i]].GetPosition().y == b[cb[i]].GetPosition().y;
+			}
+			Error += same && threadedStretch < 0.01f ? 0 : 1;
+		}
+
+		//a rod holds against ends thrown at and away from each other, and a cable only stops them going apart
+		{
+			P6::ParticleWorld world(8);
+			P6::P6Particle bead = Bead(P6::MyVector(0, 0, 0));
+			bead.Acceleration = P6::MyVector();
+			bead.Velocity = P6::MyVector(5.0f, 0, 0);
+			const P6::ParticleHandle left = world.spawn(bead);
+			bead.Position = P6::MyVector(2.0f, 0, 0);
+			bead.Velocity = P6::MyVector(-5.0f, 0, 0);
+			const P6::ParticleHandle right = world.spawn(bead);
+			world.links().addRod(left, right, 2.0f);
+			world.update(Step);
+			const float closing = Distance(world, left, world[right].GetPosition());
+			//rod set to a cable's length going the other way
+			world[left].SetVelocity(P6::MyVector(-5.0f, 0, 0));
+			world[right].SetVelocity(P6::MyVector(5.0f, 0, 0));
+			world.update(Step);
+			const float opening = Distance(world, left, world[right].GetPosition());
+			Error += std::abs(closing - 2.0f) < 1e-3f && std::abs(opening - 2.0f) < 1e-3f ? 0 : 1;
+			Error += world[left].GetVelocity().Magnitude() < 1e-3f ? 0 : 1;
+
+			world.links().clear();
+			world.links().addCable(left, right, 3.0f, 0);
+			world[left].SetVelocity(P6::MyVector(1.0f, 0, 0));
+			world.update(Step);
+			//slack: nothing to resolve
+			Error += world.contacts().size() == 0 ? 0 : 1;
+			world[left].SetVelocity(P6::MyVector(-20.0f, 0, 0));
+			for (int step = 0; step < 10; step++) world.update(Step);
+			Error += Distance(world, left, world[right].GetPosition()) < 3.0f + 1e-3f ? 0 : 1;
+		}
+
+		//dropped on an anchored cable, a bead is caught at the cable's length and hangs there
+		float caught = 0;
+		{
+			P6::ParticleWorld world(4);
+			const P6::ParticleHandle bead = world.spawn(Bead(top + P6::MyVector(1.0f, 0, 0)));
+			world.links().addAnchoredCable(bead, top, 5.0f, 0.3f);
+			float longest = 0;
+			for (int step = 0; step < 600; step++) {
+				world.update(Step);
+				longest = std::max(longest, Distance(world, bead, top));
+			}
+			caught = Distance(world, bead, top);
+			Error += longest < 5.0f * 1.01f && std::abs(caught - 5.0f) < 0.01f ? 0 : 1;
+		}
+
+		//a loaded bridge: a shower of balls lands on the deck, the rods stay put
+		float bridgeStretch = 0;
+		{
+			const size_t Side = 20;
+			P6::ParticleWorld world(256);
+			world.setCollisions(true, 0.2f);
+			Bridge(world, Side, 1.0f);
+			for (size_t i = 0; i < 40; i++) world.spawn(Bead(P6::MyVector(1.0f + 0.8f * (i / 2), 3.0f + (i % 4), 0.5f), 0.5f, 0.5f));
+			P6::ParticleLinks& links = world.links();
+			for (int step = 0; step < 400; step++) {
+				world.update(Step);
+				links.locate(world);
+				const P6::ParticleStreams& s = world.buffer().streams();
+				for (size_t l = 0; l < links.size(); l++) {
+					const uint32_t a = links.firstIndices()[l], b = links.secondIndices()[l];
+					if (b == P6::ParticleLinks::None) continue;
+					const float dx = s.posX[a] - s.posX[b], dy = s.posY[a] - s.posY[b], dz = s.posZ[a] - s.posZ[b];
+					bridgeStretch = std::max(bridgeStretch, std::abs(std::sqrt(dx * dx + dy * dy + dz * dz) - links.length(l)) / links.length(l));
+				}
+			}
+		}
+		Error += bridgeStretch < 0.03f ? 0 : 1;
+
+		//a still chain falls asleep as one island, waking one bead wakes all of it; killed beads drop their links
+		{
+			P6::ParticleWorld world(64);
+			world.setSleeping(true, 0.05f, 30);
+			std::vector<P6::ParticleHandle> chain;
+			for (size_t i = 0; i < 10; i++) {
+				chain.push_back(world.spawn(Bead(top - P6::MyVector(0, 1.0f * (i + 1), 0))));
+				if (i == 0) world.links().addAnchoredRod(chain[0], top, 1.0f);
+				else world.links().addRod(chain[i - 1], chain[i], 1.0f);
+			}
+			for (int step = 0; step < 200; step++) world.update(Step);
+			Error += world.awakeCount() == 0 ? 0 : 1;
+			world.wake(chain.back());
+			Error += world.awakeCount() == chain.size() ? 0 : 1;
+			world.kill(chain[4]);
+			world[chain.back()].SetVelocity(P6::MyVector(5.0f, 0, 0));
+			for (int step = 0; step < 100; step++) world.update(Step);
+			//the lower half fell away, the upper half still hangs from the anchor
+			Error += world[chain[5]].GetPosition().y < top.y - 15.0f && std::abs(Distance(world, chain[3], top) - 4.0f) < 0.05f ? 0 : 1;
+		}
+
+		std::printf("  links check: a swinging 20-bead chain stretched %.3f%% on 1200 iterations, a loaded bridge %.3f%%, a cable caught its bead at %.4f\n",
+			100.0f * chainStretch, 100.0f * bridgeStretch, caught);
+		return Error;
+	}
+}
+
+int perf_links() {
+	int Error = 0;
+	if (!perf::Selected("links")) return Error;
+
+	const unsigned threads = std::max(2u, std::thread::hardware_concurrency());
+	P6::JobSystem one(1), jobs(threads);
+	const size_t Steps = 10;
+	for (size_t side : { 100, 1000 }) {
+		P6::ParticleWorld probe(2 * (side + 1));
+		Bridge(probe, side, 1.0f);
+		const size_t count = probe.links().size();
+		std::printf("perf_links: a bridge of %zu rods between %zu particles\n", count, probe.size());
+
+		//whole steps, per link; every row starts from a freshly built bridge, so each solver steps through the same states
+		auto run = [&](P6::JobSystem* pool, const std::string& name) {
+			P6::ParticleWorld world(2 * (side + 1));
+			Bridge(world, side, 1.0f);
+			world.setJobs(pool);
+			perf::Stats stats = perf::Measure(count, Steps, [&]() {
+				for (size_t step = 0; step < Steps; step++) world.update(Step);
+			});
+			perf::Report("links", name, "link", count, Steps, stats);
+			world.setJobs(nullptr);
+		};
+
+		//the resolver's defaults without jobs: the heap resolver on twice as many iterations as contacts
+		run(nullptr, "bridge step, heap resolver");
+		//with jobs the coloured sweeps take over, on one worker and on all of them
+		run(&one, "bridge step, coloured, 1 thread");
+		run(&jobs, "bridge step, coloured, " + std::to_string(threads) + " threads");
+	}
+	Error += CheckLinks();
+
+	return Error;
+}
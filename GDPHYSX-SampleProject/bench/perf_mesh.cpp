@@ -0,0 +1,468 @@
+#include "p6/ParticleKernels.h"
+#include "p6/ParticleWorld.h"
+#include "p6/SignedDistanceField.h"
+#include "p6/TriangleBvh.h"
+#include "p6/TriangleKernels.h"
+#include "p6/TriangleMesh.h"
+#include "perf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+//perf_broadphase.cpp
+P6::TriangleMesh MakeLevel(int copies);
+
+namespace {
+	//Ericson's closest point on a triangle, region by region, as the reference for the kernels
+	P6::MyVector ClosestOnTriangle(const P6::MyVector& p, const P6::MyVector& a, const P6::MyVector& b, const P6::MyVector& c) {
+		const P6::MyVector ab = b - a, ac = c - a, ap = p - a;
+		const float d1 = ab.dotProduct(ap), d2 = ac.dotProduct(ap);
+		if (d1 <= 0 && d2 <= 0) return a;
+
+		const P6::MyVector bp = p - b;
+		const float d3 = ab.dotProduct(bp), d4 = ac.dotProduct(bp);
+		if (d3 >= 0 && d4 <= d3) return b;
+
+		const float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0 && d1 >= 0 && d3 <= 0) return a + ab * (d1 / (d1 - d3));
+
+		const P6::MyVector cp = p - c;
+		const float d5 = ab.dotProduct(cp), d6 = ac.dotProduct(cp);
+		if (d6 >= 0 && d5 <= d6) return c;
+
+		const float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0 && d2 >= 0 && d6 <= 0) return a + ac * (d2 / (d2 - d6));
+
+		const float va = d3 * d6 - d5 * d4;
+		if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+		const float denom = 1.0f / (va + vb + vc);
+		return a + ab * (vb * denom) + ac * (vc * denom);
+	}
+
+	std::vector<P6::SimdLevel> Levels() {
+		std::vector<P6::SimdLevel> levels;
+		for (P6::SimdLevel level : { P6::SimdLevel::Scalar, P6::SimdLevel::SSE2, P6::SimdLevel::AVX2 }) {
+			if (level <= P6::DetectSimdLevel()) levels.push_back(level);
+		}
+		return levels;
+	}
+
+	//every kernel against the reference, on packets of random triangles around random points
+	int CheckKernels() {
+		int Error = 0;
+		std::mt19937 random(5);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		auto point = [&](float scale) { return P6::MyVector(unit(random), unit(random), unit(random)) * scale; };
+
+		size_t tested = 0, hits = 0;
+		float worst = 0;
+		for (int round = 0; round < 2000; round++) {
+			P6::TrianglePacket packet;
+			P6::MyVector corners[P6::TrianglePacket::Lanes][3];
+			packet.count = 1 + round % P6::TrianglePacket::Lanes;
+			for (int lane = 0; lane < P6::TrianglePacket::Lanes; lane++) {
+				if (lane < packet.count) {
+					do {
+						for (P6::MyVector& corner : corners[lane]) corner = point(2.0f);
+					} while (!P6::TrianglePacket::Usable(corners[lane][0], corners[lane][1], corners[lane][2]));
+				}
+				else {
+					for (int k = 0; k < 3; k++) corners[lane][k] = corners[packet.count - 1][k];
+				}
+				packet.set(lane, corners[lane][0], corners[lane][1], corners[lane][2], static_cast<uint32_t>(lane));
+			}
+			const P6::MyVector center = point(3.0f);
+			const float radius = 0.5f + 0.5f * (unit(random) + 1.0f);
+
+			for (P6::SimdLevel level : Levels()) {
+				P6::SphereTriangleHits found;
+				const unsigned mask = P6::SphereTriangleKernelFor(level)(packet, center, radius, found);
+				for (int lane = 0; lane < packet.count; lane++) {
+					const P6::MyVector expected = ClosestOnTriangle(center, corners[lane][0], corners[lane][1], corners[lane][2]);
+					const P6::MyVector got(found.x[lane], found.y[lane], found.z[lane]);
+					const float error = (got - expected).Magnitude();
+					worst = std::max(worst, error);
+					if (error > 1e-4f) Error++;
+
+					//right at the radius either answer is fine
+					const float distance = (center - expected).Magnitude();
+					const bool hit = (mask >> lane) & 1u;
+					if (std::abs(distance - radius) > 1e-4f && hit != (distance < radius)) Error++;
+					tested++;
+					hits += hit ? 1 : 0;
+				}
+				if (mask >> packet.count) Error++;
+			}
+		}
+		std::printf("  kernel check: %zu triangle tests, %zu hits, worst closest point error %.2g\n", tested, hits, worst);
+		return Error;
+	}
+
+	//the BVH finds exactly the triangles a test of every one of them finds
+	int CheckBvh(const P6::TriangleMesh& level, const P6::TriangleBvh& bvh) {
+		int Error = 0;
+		std::mt19937 random(6);
+		const P6::Aabb bounds = level.bounds();
+		std::uniform_real_distribution<float> x(bounds.min.x, bounds.max.x), y(bounds.min.y, bounds.max.y), z(bounds.min.z, bounds.max.z);
+		const P6::SphereTriangleKernel kernel = P6::SphereTriangleKernelFor(P6::ActiveSimdLevel());
+
+		size_t found = 0;
+		for (int query = 0; query < 300; query++) {
+			const P6::MyVector center(x(random), y(random), z(random));
+			const float radius = 0.5f + static_cast<float>(query % 5);
+
+			std::set<uint32_t> got, expected, borderline;
+			bvh.overlapSphere(center, radius, kernel, [&](const P6::TriangleHit& hit) { got.insert(hit.triangle); });
+			for (size_t t = 0; t < level.triangleCount(); t++) {
+				P6::MyVector a, b, c;
+				level.triangle(t, a, b, c);
+				if (!P6::TrianglePacket::Usable(a, b, c)) continue;
+				const float distance = (center - ClosestOnTriangle(center, a, b, c)).Magnitude();
+				if (std::abs(distance - radius) < 1e-3f) borderline.insert(static_cast<uint32_t>(t));
+				else if (distance < radius) expected.insert(static_cast<uint32_t>(t));
+			}
+			for (uint32_t t : borderline) got.erase(t);
+			if (got != expected) Error++;
+			found += expected.size();
+		}
+		std::printf("  bvh check: %zu triangles, %zu nodes, depth %d, %zu hits over 300 spheres\n", bvh.triangleCount(), bvh.nodeCount(), bvh.depth(), found);
+		return Error;
+	}
+
+	//a ball dropped on a two-triangle floor bounces and never sinks in
+	int CheckBounce() {
+		P6::TriangleMesh floor;
+		floor.addTriangle(P6::MyVector(-10, 0, -10), P6::MyVector(-10, 0, 10), P6::MyVector(10, 0, 10));
+		floor.addTriangle(P6::MyVector(-10, 0, -10), P6::MyVector(10, 0, 10), P6::MyVector(10, 0, -10));
+		P6::TriangleBvh bvh;
+		bvh.build(floor);
+
+		P6::ParticleWorld world(1);
+		world.setCollisions(false, 0.8f);
+		world.setStaticMesh(&bvh);
+		P6::P6Particle ball;
+		ball.Position = P6::MyVector(0.3f, 5.0f, -0.2f);
+		ball.Acceleration = P6::MyVector(0, -9.8f, 0);
+		ball.radius = 0.5f;
+		ball.mass = 1.0f;
+		ball.active = true;
+		const P6::ParticleHandle handle = world.spawn(ball);
+
+		float lowest = 5.0f, peak = 0;
+		bool falling = true;
+		for (int step = 0; step < 300; step++) {
+			world.update(0.016f);
+			const P6::MyVector p = world[handle].GetPosition();
+			lowest = std::min(lowest, p.y);
+			if (falling && world[handle].GetVelocity().y > 0) falling = false;
+			if (!falling) peak = std::max(peak, p.y);
+		}
+		//e = 0.8 brings it back to about 0.8^2 of the drop
+		std::printf("  bounce check: lowest %.3f, first peak %.2f\n", lowest, peak);
+		return lowest > 0.45f && peak > 2.0f ? 0 : 1;
+	}
+
+	//one of the demo's models, scaled up so the bench particles are small next to it
+	P6::TriangleMesh LoadModel(const char* name, float scale) {
+		P6::TriangleMesh mesh;
+		std::string error;
+		if (mesh.load(std::string("3D/") + name, error) || mesh.load(std::string("../3D/") + name, error)) {
+			mesh.transform(P6::MyVector(scale, scale, scale), P6::MyVector());
+		}
+		return mesh;
+	}
+
+	//closed box, faces wound outwards
+	P6::TriangleMesh MakeBox(const P6::MyVector& low, const P6::MyVector& high) {
+		P6::TriangleMesh box;
+		const P6::MyVector corner[8] = {
+			P6::MyVector(low.x, low.y, low.z), P6::MyVector(high.x, low.y, low.z), P6::MyVector(high.x, high.y, low.z), P6::MyVector(low.x, high.y, low.z),
+			P6::MyVector(low.x, low.y, high.z), P6::MyVector(high.x, low.y, high.z), P6::MyVector(high.x, high.y, high.z), P6::MyVector(low.x, high.y, high.z),
+		};
+		const int faces[6][4] = { { 0, 3, 2, 1 }, { 4, 5, 6, 7 }, { 0, 1, 5, 4 }, { 3, 7, 6, 2 }, { 0, 4, 7, 3 }, { 1, 2, 6, 5 } };
+		for (const auto& f : faces) {
+			box.addTriangle(corner[f[0]], corner[f[1]], corner[f[2]]);
+			box.addTriangle(corner[f[0]], corner[f[2]], corner[f[3]]);
+		}
+		return box;
+	}
+
+	//the baked field against the exact distance to every triangle; inside(p) returns -1 where it
+	//can't tell, otherwise whether p is inside, and the field's sign has to agree
+	template <typename Inside>
+	int CheckField(const char* name, const P6::TriangleMesh& mesh, const P6::SignedDistanceField& field, Inside inside) {
+		int Error = 0;
+		std::mt19937 random(9);
+		const P6::Aabb bounds = field.bounds();
+		std::uniform_real_distribution<float> x(bounds.min.x, bounds.max.x), y(bounds.min.y, bounds.max.y), z(bounds.min.z, bounds.max.z);
+		const float cell = field.cellSize(), band = field.bandWidth();
+
+		size_t nearby = 0, signs = 0;
+		float worst = 0;
+		for (int query = 0; query < 400; query++) {
+			//half the points close to the surface, where the particles touch it
+			P6::MyVector p(x(random), y(random), z(random));
+			if (query % 2 == 0) {
+				P6::MyVector a, b, c;
+				mesh.triangle(random() % mesh.triangleCount(), a, b, c);
+				p = P6::MyVector((a + b + c) * (1.0f / 3.0f)) + P6::MyVector(x(random) - x(random), y(random) - y(random), z(random) - z(random)) * (band / (bounds.max.x - bounds.min.x));
+			}
+
+			float exact = band;
+			for (size_t t = 0; t < mesh.triangleCount(); t++) {
+				P6::MyVector a, b, c;
+				mesh.triangle(t, a, b, c);
+				exact = std::min(exact, (p - ClosestOnTriangle(p, a, b, c)).Magnitude());
+			}
+			float distance;
+			P6::MyVector gradient;
+			if (!field.sample(p, distance, gradient)) continue;
+
+			//blending eight nodes is off by up to about a cell around edges and corners
+			if (exact < band - 2 * cell) {
+				const float error = std::abs(std::abs(distance) - exact);
+				worst = std::max(worst, error);
+				if (error > cell) Error++;
+				nearby++;
+			}
+			const int expected = inside(p);
+			if (expected >= 0 && exact > 1.5f * cell) {
+				if ((distance < 0) != (expected == 1)) Error++;
+				signs++;
+			}
+		}
+		std::printf("  field check, %s: %u x %u x %u nodes, %zu near points, worst distance error %.3f cells, %zu signs checked\n",
+			name, field.dimension(0), field.dimension(1), field.dimension(2), nearby, worst / cell, signs);
+		return Error;
+	}
+
+	//the cache is written once, read back bit for bit, and thrown away when the settings change
+	int CheckCache(const P6::TriangleMesh& mesh) {
+		int Error = 0;
+		const char* path = "perf_mesh.sdf";
+		std::string error;
+
+		P6::SignedDistanceField baked, loaded, other;
+		if (!baked.bakeCached(mesh, 0.5f, 2.0f, path, error) || baked.fromCache()) Error++;
+		if (!loaded.bakeCached(mesh, 0.5f, 2.0f, path, error) || !loaded.fromCache()) Error++;
+
+		std::mt19937 random(10);
+		const P6::Aabb bounds = baked.bounds();
+		std::uniform_real_distribution<float> x(bounds.min.x, bounds.max.x), y(bounds.min.y, bounds.max.y), z(bounds.min.z, bounds.max.z);
+		for (int query = 0; query < 1000; query++) {
+			const P6::MyVector p(x(random), y(random), z(random));
+			if (baked.distance(p) != loaded.distance(p)) Error++;
+		}
+
+		if (!other.bakeCached(mesh, 0.5f, 3.0f, path, error) || other.fromCache()) Error++;
+		if (!other.bakeCached(mesh, 0.5f, 3.0f, path, error) || !other.fromCache()) Error++;
+
+		//a cut short file is refused
+		{
+			std::ofstream out(path, std::ios::binary | std::ios::trunc);
+			out.write("P6DF", 4);
+		}
+		if (loaded.load(path, error) || !loaded.empty()) Error++;
+		std::remove(path);
+
+		std::printf("  cache check: %zu nodes round trip\n", baked.nodeCount());
+		return Error;
+	}
+
+	//a ball dropped on a box bounces off the field like it does off the mesh
+	int CheckFieldBounce() {
+		const P6::TriangleMesh slab = MakeBox(P6::MyVector(-10, -1, -10), P6::MyVector(10, 0, 10));
+		P6::SignedDistanceField field;
+		field.bake(slab, 0.1f, 1.0f);
+
+		P6::ParticleWorld world(1);
+		world.setCollisions(false, 0.8f);
+		world.setStaticField(&field);
+		P6::P6Particle ball;
+		ball.Position = P6::MyVector(0.3f, 5.0f, -0.2f);
+		ball.Acceleration = P6::MyVector(0, -9.8f, 0);
+		ball.radius = 0.5f;
+		ball.mass = 1.0f;
+		ball.active = true;
+		const P6::ParticleHandle handle = world.spawn(ball);
+
+		float lowest = 5.0f, peak = 0;
+		bool falling = true;
+		for (int step = 0; step < 300; step++) {
+			world.update(0.016f);
+			const P6::MyVector p = world[handle].GetPosition();
+			lowest = std::min(lowest, p.y);
+			if (falling && world[handle].GetVelocity().y > 0) falling = false;
+			if (!falling) peak = std::max(peak, p.y);
+		}
+		std::printf("  field bounce check: lowest %.3f, first peak %.2f\n", lowest, peak);
+		return lowest > 0.45f && peak > 2.0f ? 0 : 1;
+	}
+
+	//particles spread over the level, falling
+	void Rain(P6::ParticleWorld& world, const P6::Aabb& bounds, size_t count, unsigned seed) {
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> x(bounds.min.x, bounds.max.x), y(bounds.min.y, bounds.max.y), z(bounds.min.z, bounds.max.z);
+		for (size_t i = 0; i < count; i++) {
+			P6::P6Particle particle;
+			particle.Position = P6::MyVector(x(random), y(random), z(random));
+			particle.Acceleration = P6::MyVector(0, -9.8f, 0);
+			particle.radius = 0.25f;
+			particle.mass = 1.0f;
+			particle.active = true;
+			world.spawn(particle);
+		}
+	}
+}
+
+int perf_mesh() {
+	int Error = 0;
+	if (!perf::Selected("mesh")) return Error;
+
+	const P6::SimdLevel active = P6::ActiveSimdLevel();
+	Error += CheckKernels();
+	Error += CheckBounce();
+
+	std::printf("perf_mesh: SAH BVH build, quiz.obj tiled\n");
+	for (int copies : { 1, 4, 8 }) {
+		const P6::TriangleMesh level = MakeLevel(copies);
+		P6::TriangleBvh bvh;
+		perf::Stats stats = perf::Measure(level.triangleCount(), 1, [&]() { bvh.build(level); });
+		perf::Report("mesh", "build, per triangle", "triangle", level.triangleCount(), 1, stats);
+		if (copies == 1) Error += CheckBvh(level, bvh);
+	}
+
+	//narrowphase alone: one packet against spheres around it, per triangle tested
+	std::printf("perf_mesh: sphere against 8 triangles, per triangle\n");
+	{
+		const P6::TriangleMesh level = MakeLevel(1);
+		P6::TriangleBvh bvh;
+		bvh.build(level);
+		std::vector<P6::TrianglePacket> packets;
+		for (size_t t = 0; t + 8 <= level.triangleCount(); t += 8) {
+			P6::TrianglePacket packet;
+			packet.count = 8;
+			for (int lane = 0; lane < 8; lane++) {
+				P6::MyVector a, b, c;
+				level.triangle(t + lane, a, b, c);
+				packet.set(lane, a, b, c, static_cast<uint32_t>(t + lane));
+			}
+			packets.push_back(packet);
+		}
+		const P6::MyVector center = (bvh.bounds().min + bvh.bounds().max) * 0.5f;
+		for (P6::SimdLevel level : Levels()) {
+			const P6::SphereTriangleKernel kernel = P6::SphereTriangleKernelFor(level);
+			//called through a pointer, so the compiler can't drop the calls
+			P6::SphereTriangleHits found;
+			perf::Stats stats = perf::Measure(packets.size() * 8, 100, [&]() {
+				for (int round = 0; round < 100; round++) {
+					const P6::MyVector p = center + P6::MyVector(0.01f * round, 0, 0);
+					for (const P6::TrianglePacket& packet : packets) kernel(packet, p, 20.0f, found);
+				}
+			});
+			perf::Report("mesh", std::string("kernel ") + P6::SimdLevelName(level), "triangle", packets.size() * 8, 100, stats);
+		}
+	}
+
+	//the whole step: particles falling through the level and bouncing off it
+	const size_t Steps = 10;
+	std::printf("perf_mesh: particles raining on quiz.obj x16, %zu steps per pass, no particle-particle contacts\n", Steps);
+	{
+		const P6::TriangleMesh level = MakeLevel(4);
+		P6::TriangleBvh bvh;
+		bvh.build(level);
+		for (size_t count : { 10000, 50000 }) {
+			for (P6::SimdLevel simd : Levels()) {
+				P6::SetSimdLevel(simd);
+				P6::ParticleWorld world(count);
+				world.setStaticMesh(&bvh);
+				size_t contacts = 0;
+				perf::Stats stats = perf::Measure(count, Steps, [&]() {
+					world.clear();
+					Rain(world, bvh.bounds(), count, 8);
+					contacts = 0;
+					for (size_t s = 0; s < Steps; s++) {
+						world.update(0.016f);
+						contacts += world.contacts().size();
+					}
+				});
+				perf::Report("mesh", std::string("rain ") + P6::SimdLevelName(simd), "particle", count, Steps, stats);
+				std::printf("  %.1f mesh contacts per step, %zu triangles\n", static_cast<double>(contacts) / Steps, bvh.triangleCount());
+			}
+		}
+	}
+	P6::SetSimdLevel(active);
+
+	//the same rain on bunny.obj, through the BVH and through a baked distance field
+	std::printf("perf_mesh: signed distance field, bunny.obj x100\n");
+	{
+		Error += CheckCache(MakeBox(P6::MyVector(-3, -2, -1), P6::MyVector(3, 2, 1)));
+		Error += CheckFieldBounce();
+
+		const P6::TriangleMesh cube = MakeBox(P6::MyVector(-3, -3, -3), P6::MyVector(3, 3, 3));
+		P6::SignedDistanceField cubeField;
+		//nodes land right on the edges and diagonals, every row has to cross the surface once
+		cubeField.bake(cube, 0.25f, 1.0f);
+		Error += CheckField("box", cube, cubeField, [](const P6::MyVector& p) {
+			return std::max({ std::abs(p.x), std::abs(p.y), std::abs(p.z) }) < 3.0f ? 1 : 0;
+		});
+
+		const P6::TriangleMesh ball = LoadModel("sphere.obj", 5.0f);
+		if (ball.triangleCount() > 0) {
+			P6::SignedDistanceField ballField;
+			ballField.bake(ball, 0.1f, 0.5f);
+			Error += CheckField("sphere.obj", ball, ballField, [](const P6::MyVector& p) { return p.Magnitude() < 5.0f ? 1 : 0; });
+		}
+
+		const P6::TriangleMesh bunny = LoadModel("bunny.obj", 100.0f);
+		if (bunny.triangleCount() == 0) {
+			std::printf("  bunny.obj not found, skipped\n");
+			return Error;
+		}
+		P6::SignedDistanceField field;
+		field.bake(bunny, 0.2f, 1.0f);
+		//nothing outside the model can be inside it, whatever the holes in its bottom do to the rows
+		const P6::Aabb model = bunny.bounds();
+		Error += CheckField("bunny.obj", bunny, field, [&](const P6::MyVector& p) { return model.contains(P6::Aabb(p, p)) ? -1 : 0; });
+		perf::Stats stats = perf::Measure(field.nodeCount(), 1, [&]() { field.bake(bunny, 0.2f, 1.0f); });
+		perf::Report("mesh", "field bake, per node", "node", field.nodeCount(), 1, stats);
+
+		//what every run after the first pays instead
+		const char* path = "perf_mesh.sdf";
+		std::string error;
+		if (!field.save(path, error)) Error++;
+		stats = perf::Measure(field.nodeCount(), 1, [&]() { field.load(path, error); });
+		perf::Report("mesh", "field cache load, per node", "node", field.nodeCount(), 1, stats);
+		std::remove(path);
+
+		P6::TriangleBvh bvh;
+		bvh.build(bunny);
+		const size_t count = 10000;
+		for (int useField = 0; useField < 2; useField++) {
+			P6::ParticleWorld world(count);
+			if (useField) world.setStaticField(&field);
+			else world.setStaticMesh(&bvh);
+			size_t contacts = 0;
+			stats = perf::Measure(count, Steps, [&]() {
+				world.clear();
+				Rain(world, bvh.bounds(), count, 11);
+				contacts = 0;
+				for (size_t s = 0; s < Steps; s++) {
+					world.update(0.016f);
+					contacts += world.contacts().size();
+				}
+			});
+			perf::Report("mesh", useField ? "rain, field" : "rain, bvh", "particle", count, Steps, stats);
+			std::printf("  %.1f contacts per step\n", static_cast<double>(contacts) / Steps);
+		}
+	}
+
+	return Error;
+}
@@ -0,0 +1,129 @@
+#include "p6/MyVector.h"
+#include "perf.h"
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#ifdef _MSC_VER
+#define P6_BENCH_NOINLINE __declspec(noinline)
+#else
+#define P6_BENCH_NOINLINE __attribute__((noinline))
+#endif
+
+//the header-only vector is usable in constant expressions
+static_assert((P6::MyVector(1, 2, 3) + P6::MyVector(4, 5, 6) * 2.0f).at(1) == 12.0f, "constexpr expression");
+#ifndef P6_MYVECTOR_SIMD
+static_assert(P6::MyVector(1, 2, 3).dotProduct(P6::MyVector(4, 5, 6)) == 32.0f, "constexpr dotProduct");
+#else
+static_assert(sizeof(P6::MyVector) == sizeof(glm::vec4) && alignof(P6::MyVector) == 16, "MyVector is a vec4 register");
+#endif
+
+namespace {
+	//MyVector as it was before it went header-only: by-value arguments and out-of-line
+	//operators, noinline stands in for the translation unit boundary
+	struct LegacyVector {
+		float x, y, z;
+
+		LegacyVector() : x(0), y(0), z(0) {}
+		LegacyVector(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+
+		P6_BENCH_NOINLINE LegacyVector operator+(const LegacyVector v) {
+			return LegacyVector(this->x + v.x, this->y + v.y, this->z + v.z);
+		}
+
+		P6_BENCH_NOINLINE LegacyVector scalarMultiplication(const float toScale) {
+			return LegacyVector(toScale * x, toScale * y, toScale * z);
+		}
+	};
+
+	template <typename Vector>
+	struct Body {
+		Vector Position;
+		Vector Velocity;
+		Vector Acceleration;
+	};
+
+	void StepLegacy(std::vector<Body<LegacyVector>>& bodies, float time) {
+		float NewTime = time * time;
+		for (Body<LegacyVector>& b : bodies) {
+			b.Position = b.Position + (b.Velocity.scalarMultiplication(time)) + (b.Acceleration.scalarMultiplication(NewTime).scalarMultiplication(0.5f));
+			b.Velocity = b.Velocity + (b.Acceleration.scalarMultiplication(time));
+		}
+	}
+
+	void StepFused(std::vector<Body<P6::MyVector>>& bodies, float time) {
+		float NewTime = time * time;
+		for (Body<P6::MyVector>& b : bodies) {
+			b.Position = b.Position + b.Velocity * time + b.Acceleration * NewTime * 0.5f;
+			b.Velocity += b.Acceleration * time;
+		}
+	}
+
+	template <typename Vector>
+	std::vector<Body<Vector>> MakeBodies(size_t count) {
+		std::vector<Body<Vector>> bodies(count);
+		for (size_t i = 0; i < count; i++) {
+			float f = static_cast<float>(i);
+			bodies[i].Position = Vector(f, -f, 0.5f * f);
+			bodies[i].Velocity = Vector(1.0f, 2.0f, -3.0f);
+			bodies[i].Acceleration = Vector(-0.1f * f, 0.2f, 9.8f);
+		}
+		return bodies;
+	}
+
+	//Magnitude, Direction, dotProduct and vectorProduct, which go through glm/simd with P6_MYVECTOR_SIMD
+	float Geometry(const std::vector<Body<P6::MyVector>>& bodies) {
+		float sum = 0;
+		for (const Body<P6::MyVector>& b : bodies) {
+			P6::MyVector n = b.Velocity.vectorProduct(b.Acceleration).Direction();
+			sum += n.dotProduct(b.Position) + b.Position.Magnitude();
+		}
+		return sum;
+	}
+}
+
+int perf_myvector() {
+	int Error = 0;
+	if (!perf::Selected("myvector")) return Error;
+
+	const size_t Count = 100000;
+	const size_t Steps = 10;
+
+	std::vector<Body<LegacyVector>> legacy = MakeBodies<LegacyVector>(Count);
+	std::vector<Body<P6::MyVector>> fused = MakeBodies<P6::MyVector>(Count);
+
+	std::printf("perf_myvector: %zu bodies x %zu steps per repetition\n", Count, Steps);
+	perf::Stats legacyStats = perf::Measure(Count, Steps, [&]() {
+		for (size_t s = 0; s < Steps; s++) StepLegacy(legacy, 0.016f);
+	});
+	perf::Report("myvector", "out-of-line, by value", "body", Count, Steps, legacyStats);
+
+	perf::Stats fusedStats = perf::Measure(Count, Steps, [&]() {
+		for (size_t s = 0; s < Steps; s++) StepFused(fused, 0.016f);
+	});
+	perf::Report("myvector", "header-only, fused", "body", Count, Steps, fusedStats);
+	std::printf("  fused speedup: %.1fx\n", legacyStats.median / fusedStats.median);
+
+	volatile float sink = 0;
+	perf::Stats geometryStats = perf::Measure(Count, Steps, [&]() {
+		for (size_t s = 0; s < Steps; s++) sink = sink + Geometry(fused);
+	});
+#ifdef P6_MYVECTOR_SIMD
+	const char* geometry = "cross/normalize/dot/length, simd";
+#else
+	const char* geometry = "cross/normalize/dot/length";
+#endif
+	perf::Report("myvector", geometry, "body", Count, Steps, geometryStats);
+
+	//both ran the same number of steps with the same operations in the same order, only the temporaries are gone
+	for (size_t i = 0; i < Count; i++) {
+		const LegacyVector& a = legacy[i].Position;
+		const P6::MyVector& b = fused[i].Position;
+		float error = std::abs(a.x - b.x) + std::abs(a.y - b.y) + std::abs(a.z - b.z);
+		float scale = std::abs(a.x) + std::abs(a.y) + std::abs(a.z) + 1.0f;
+		Error += error <= scale * 1e-5f ? 0 : 1;
+	}
+
+	return Error;
+}
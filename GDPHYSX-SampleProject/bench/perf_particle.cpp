@@ -0,0 +1,109 @@
+#include "p6/ForceGenerators.h"
+#include "p6/ParticleBuffer.h"
+#include "p6/ParticleKernels.h"
+#include "p6/ParticleWorld.h"
+#include "perf.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+	P6::P6Particle MakeParticle(size_t i) {
+		float f = static_cast<float>(i % 1000);
+		P6::P6Particle particle;
+		particle.mass = 1.0f;
+		particle.Position = P6::MyVector(f, -f, 0.5f * f);
+		particle.Velocity = P6::MyVector(1.0f, 2.0f, -3.0f);
+		particle.Acceleration = P6::MyVector(0.0f, -9.8f, 0.0f);
+		particle.active = true;
+		return particle;
+	}
+
+	//at least 1e6 particle-steps per pass so small sizes still time something measurable
+	size_t StepsFor(size_t count) {
+		return std::max<size_t>(1, 1000000 / count);
+	}
+
+	void BenchParticleUpdate(size_t count) {
+		std::vector<P6::P6Particle> particles(count);
+		for (size_t i = 0; i < count; i++) particles[i] = MakeParticle(i);
+
+		const size_t steps = StepsFor(count);
+		perf::Stats stats = perf::Measure(count, steps, [&]() {
+			for (size_t s = 0; s < steps; s++) {
+				for (P6::P6Particle& particle : particles) particle.update(0.016f);
+			}
+		});
+		perf::Report("particle", "P6Particle::update", "particle", count, steps, stats);
+	}
+
+	void BenchBufferUpdate(size_t count, P6::SimdLevel level) {
+		P6::ParticleBuffer buffer(count);
+		for (size_t i = 0; i < count; i++) buffer.add(MakeParticle(i));
+
+		P6::SimdLevel previous = P6::ActiveSimdLevel();
+		P6::SetSimdLevel(level);
+		const size_t steps = StepsFor(count);
+		perf::Stats stats = perf::Measure(count, steps, [&]() {
+			for (size_t s = 0; s < steps; s++) buffer.update(0.016f);
+		});
+		P6::SetSimdLevel(previous);
+
+		perf::Report("particle", std::string("ParticleBuffer::update ") + P6::SimdLevelName(level), "particle", count, steps, stats);
+	}
+
+	//the whole world step: force registry, integration and clearing the accumulators
+	void BenchWorldUpdate(size_t count) {
+		P6::ParticleWorld world(count);
+		std::vector<P6::ParticleHandle> handles(count);
+		for (size_t i = 0; i < count; i++) handles[i] = world.spawn(MakeParticle(i));
+		P6::ForceRegistry& forces = world.forces();
+		forces.bind(forces.add(P6::DragForce{ 0.01f, 0.001f }), handles.data(), handles.size());
+
+		const size_t steps = StepsFor(count);
+		perf::Stats stats = perf::Measure(count, steps, [&]() {
+			for (size_t s = 0; s < steps; s++) world.update(0.016f);
+		});
+		perf::Report("particle", "ParticleWorld::update + drag", "particle", count, steps, stats);
+	}
+}
+
+int perf_particle() {
+	int Error = 0;
+	if (!perf::Selected("particle")) return Error;
+
+	std::vector<size_t> sizes = { 1000, 10000, 100000, 1000000 };
+	if (perf::config().large) sizes.push_back(10000000);
+
+	std::printf("perf_particle: one step = update(0.016)\n");
+	for (size_t count : sizes) {
+		BenchParticleUpdate(count);
+		for (int level = 0; level <= static_cast<int>(P6::DetectSimdLevel()); level++) {
+			BenchBufferUpdate(count, static_cast<P6::SimdLevel>(level));
+		}
+		BenchWorldUpdate(count);
+	}
+
+	//the SoA path has to agree with P6Particle::update
+	P6::ParticleBuffer buffer(64);
+	std::vector<P6::P6Particle> reference;
+	for (size_t i = 0; i < 64; i++) {
+		reference.push_back(MakeParticle(i));
+		buffer.add(reference.back());
+	}
+	for (int s = 0; s < 100; s++) {
+		buffer.update(0.016f);
+		for (P6::P6Particle& particle : reference) particle.update(0.016f);
+	}
+	for (size_t i = 0; i < reference.size(); i++) {
+		P6::MyVector a = reference[i].Position;
+		P6::MyVector b = buffer[i].GetPosition();
+		float error = std::abs(a.x - b.x) + std::abs(a.y - b.y) + std::abs(a.z - b.z);
+		float scale = std::abs(a.x) + std::abs(a.y) + std::abs(a.z) + 1.0f;
+		Error += error <= scale * 1e-5f ? 0 : 1;
+	}
+
+	return Error;
+}
@@ -0,0 +1,260 @@
+#include "p6/JobSystem.h"
+#include "p6/ParticleKernels.h"
+#include "p6/ParticleWorld.h"
+#include "p6/RayKernels.h"
+#include "p6/SceneQueries.h"
+#include "perf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+	//particles of mixed sizes spread through a cube
+	void SpawnCloud(P6::ParticleWorld& world, size_t count, float side, unsigned seed) {
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> position(-side, side), radius(0.2f, 0.5f);
+		for (size_t i = 0; i < count; i++) {
+			P6::P6Particle particle;
+			particle.Position = P6::MyVector(position(random), position(random), position(random));
+			particle.radius = radius(random);
+			particle.mass = 1.0f;
+			//every seventh is inactive and has to be left out
+			particle.active = i % 7 != 3;
+			world.spawn(particle);
+		}
+	}
+
+	//rays from around and inside the cloud towards random points of it
+	std::vector<P6::Ray> MakeRays(size_t count, float side, unsigned seed) {
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::vector<P6::Ray> rays(count);
+		for (size_t i = 0; i < count; i++) {
+			const float reach = i % 2 == 0 ? 1.5f * side : side;
+			rays[i].origin = P6::MyVector(unit(random), unit(random), unit(random)) * reach;
+			rays[i].direction = P6::MyVector(P6::MyVector(unit(random), unit(random), unit(random)) * side) - rays[i].origin;
+			//some short, some axis aligned, which walk the grid along its faces
+			if (i % 5 == 1) rays[i].maxDistance = side * 0.3f;
+			if (i % 11 == 4) rays[i].direction = P6::MyVector(0, 0, i % 2 == 0 ? 1.0f : -1.0f);
+		}
+		return rays;
+	}
+
+	std::vector<P6::SphereQuery> MakeSpheres(size_t count, float side, unsigned seed) {
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> position(-1.2f * side, 1.2f * side), radius(0.0f, 3.0f);
+		std::vector<P6::SphereQuery> spheres(count);
+		for (P6::SphereQuery& sphere : spheres) {
+			sphere.center = P6::MyVector(position(random), position(random), position(random));
+			sphere.radius = radius(random);
+		}
+		return spheres;
+	}
+
+	std::vector<P6::MyVector> MakePoints(size_t count, float side, unsigned seed) {
+		std::mt19937 random(seed);
+		//some outside, where the search starts at the cloud's edge
+		std::uniform_real_distribution<float> position(-1.2f * side, 1.2f * side);
+		std::vector<P6::MyVector> points(count);
+		for (P6::MyVector& p : points) p = P6::MyVector(position(random), position(random), position(random));
+		return points;
+	}
+
+	std::vector<P6::SimdLevel> Levels() {
+		std::vector<P6::SimdLevel> levels;
+		for (P6::SimdLevel level : { P6::SimdLevel::Scalar, P6::SimdLevel::SSE2, P6::SimdLevel::AVX2 }) {
+			if (level <= P6::DetectSimdLevel()) levels.push_back(level);
+		}
+		return levels;
+	}
+
+	bool SameHit(const P6::RayHit& a, const P6::RayHit& b) {
+		return a.particle == b.particle && a.distance == b.distance;
+	}
+
+	//fused multiply-adds move distances by a few ulp, and may pick the other of two spheres hit at
+	//almost the same point
+	bool CloseHit(const P6::RayHit& a, const P6::RayHit& b) {
+		return a.particle.IsValid() == b.particle.IsValid() && std::abs(a.distance - b.distance) <= 1e-5f * (1.0f + a.distance);
+	}
+
+	//every query against a test of every particle, on every kernel and thread count
+	int CheckQueries() {
+		int Error = 0;
+		const float side = 12.0f;
+		P6::ParticleWorld world(4000);
+		SpawnCloud(world, 4000, side, 31);
+		const P6::ParticleStreams& s = world.buffer().streams();
+
+		P6::SceneQueries queries;
+		queries.build(world);
+
+		//the brute force answers, the scalar kernel over all the active particles
+		std::vector<float> x, y, z, r;
+		std::vector<size_t> dense;
+		for (size_t i = 0; i < world.size(); i++) {
+			if (!s.active[i]) continue;
+			x.push_back(s.posX[i]);
+			y.push_back(s.posY[i]);
+			z.push_back(s.posZ[i]);
+			r.push_back(s.radius[i]);
+			dense.push_back(i);
+		}
+		if (queries.size() != dense.size()) Error++;
+
+		//the scalar kernel first, its distances are the brute force's bit for bit
+		const P6::SimdLevel active = P6::ActiveSimdLevel();
+		P6::SetSimdLevel(P6::SimdLevel::Scalar);
+		const std::vector<P6::Ray> rays = MakeRays(2000, side, 32);
+		size_t hits = 0;
+		for (const P6::Ray& ray : rays) {
+			const P6::MyVector direction = ray.direction * (1.0f / ray.direction.Magnitude());
+			float best = ray.maxDistance;
+			const size_t slot = P6::Kernels::RaySpheresScalar(x.data(), y.data(), z.data(), r.data(), x.size(), ray.origin, direction, best);
+			const P6::RayHit hit = queries.raycast(ray);
+			if (slot == x.size()) {
+				if (hit.particle.IsValid()) Error++;
+				continue;
+			}
+			hits++;
+			//equal distances may go to either sphere
+			if (!hit.particle.IsValid() || hit.distance != best) Error++;
+			else if (hit.particle != world.handleAt(dense[slot])) {
+				const size_t other = world.indexOf(hit.particle);
+				const P6::MyVector center(s.posX[other], s.posY[other], s.posZ[other]);
+				if (std::abs((hit.point - center).Magnitude() - s.radius[other]) > 1e-3f) Error++;
+			}
+		}
+
+		//the same answers from every kernel, and the same bits on threads
+		std::vector<P6::RayHit> reference(rays.size()), got(rays.size()), threaded(rays.size());
+		queries.raycast(rays.data(), rays.size(), reference.data());
+		P6::JobSystem jobs(4);
+		for (P6::SimdLevel level : Levels()) {
+			P6::SetSimdLevel(level);
+			queries.raycast(rays.data(), rays.size(), got.data());
+			queries.raycast(rays.data(), rays.size(), threaded.data(), &jobs);
+			for (size_t i = 0; i < rays.size(); i++) {
+				Error += SameHit(got[i], threaded[i]) ? 0 : 1;
+				Error += SameHit(reference[i], got[i]) || (level == P6::SimdLevel::AVX2 && CloseHit(reference[i], got[i])) ? 0 : 1;
+			}
+		}
+		P6::SetSimdLevel(active);
+
+		//overlaps: the same set, each particle once
+		const std::vector<P6::SphereQuery> spheres = MakeSpheres(1000, side, 33);
+		P6::OverlapResults results, threadedResults;
+		queries.overlap(spheres.data(), spheres.size(), results);
+		queries.overlap(spheres.data(), spheres.size(), threadedResults, &jobs);
+		if (results.offsets != threadedResults.offsets || results.particles != threadedResults.particles) Error++;
+		for (size_t q = 0; q < spheres.size(); q++) {
+			std::vector<uint32_t> expected, found;
+			for (size_t k = 0; k < x.size(); k++) {
+				const float dx = x[k] - spheres[q].center.x, dy = y[k] - spheres[q].center.y, dz = z[k] - spheres[q].center.z;
+				const float touch = spheres[q].radius + r[k];
+				if (dx * dx + dy * dy + dz * dz < touch * touch) expected.push_back(world.handleAt(dense[k]).slot);
+			}
+			for (const P6::ParticleHandle* h = results.begin(q); h != results.end(q); h++) found.push_back(h->slot);
+			std::sort(expected.begin(), expected.end());
+			std::sort(found.begin(), found.end());
+			if (found != expected) Error++;
+		}
+
+		//nearest: the same distance, within reach or not at all
+		const std::vector<P6::MyVector> points = MakePoints(1000, side, 34);
+		std::vector<P6::NearestHit> nearest(points.size()), nearestThreaded(points.size());
+		const float reach = 4.0f;
+		queries.nearest(points.data(), points.size(), nearest.data(), reach);
+		queries.nearest(points.data(), points.size(), nearestThreaded.data(), reach, &jobs);
+		size_t reached = 0;
+		for (size_t q = 0; q < points.size(); q++) {
+			float best2 = reach * reach;
+			for (size_t k = 0; k < x.size(); k++) {
+				const float dx = x[k] - points[q].x, dy = y[k] - points[q].y, dz = z[k] - points[q].z;
+				best2 = std::min(best2, dx * dx + dy * dy + dz * dz);
+			}
+			const bool within = best2 < reach * reach;
+			if (nearest[q].particle.IsValid() != within) Error++;
+			else if (within && nearest[q].distance != std::sqrt(best2)) Error++;
+			if (nearest[q].particle != nearestThreaded[q].particle) Error++;
+			reached += within ? 1 : 0;
+		}
+
+		std::printf("  query check: %zu particles, %zu of %zu rays hit, %zu overlaps, %zu of %zu points near one\n",
+			queries.size(), hits, rays.size(), results.particles.size(), reached, points.size());
+		return Error;
+	}
+}
+
+int perf_queries() {
+	int Error = 0;
+	if (!perf::Selected("queries")) return Error;
+
+	Error += CheckQueries();
+
+	const P6::SimdLevel active = P6::ActiveSimdLevel();
+	const unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+	P6::JobSystem jobs(threads);
+
+	for (size_t count : { 10000, 100000 }) {
+		//the same density at every size
+		const float side = 6.0f * std::cbrt(static_cast<float>(count) / 1000.0f);
+		std::printf("perf_queries: %zu particles, per query\n", count);
+		P6::ParticleWorld world(count);
+		SpawnCloud(world, count, side, 41);
+
+		P6::SceneQueries queries;
+		perf::Stats stats = perf::Measure(count, 1, [&]() { queries.build(world); });
+		perf::Report("queries", "build, per particle", "particle", count, 1, stats);
+
+		const size_t Batch = 10000;
+		const std::vector<P6::Ray> rays = MakeRays(Batch, side, 42);
+		std::vector<P6::RayHit> hits(Batch);
+		for (P6::SimdLevel level : Levels()) {
+			P6::SetSimdLevel(level);
+			stats = perf::Measure(Batch, 1, [&]() { queries.raycast(rays.data(), rays.size(), hits.data()); });
+			perf::Report("queries", std::string("raycast ") + P6::SimdLevelName(level), "query", Batch, 1, stats);
+		}
+		P6::SetSimdLevel(active);
+		stats = perf::Measure(Batch, 1, [&]() { queries.raycast(rays.data(), rays.size(), hits.data(), &jobs); });
+		perf::Report("queries", "raycast, " + std::to_string(threads) + " threads", "query", Batch, 1, stats);
+
+		//what the grid saves: the same rays against every particle, on a slice of the batch
+		{
+			const P6::ParticleStreams& s = world.buffer().streams();
+			const size_t slice = 100;
+			float sink = 0;
+			stats = perf::Measure(slice, 1, [&]() {
+				for (size_t i = 0; i < slice; i++) {
+					const P6::MyVector direction = rays[i].direction * (1.0f / rays[i].direction.Magnitude());
+					float best = rays[i].maxDistance;
+					P6::RaySphereKernelFor(active)(s.posX, s.posY, s.posZ, s.radius, world.size(), rays[i].origin, direction, best);
+					sink += best;
+				}
+			});
+			perf::Report("queries", "raycast, every particle", "query", slice, 1, stats);
+			if (sink < 0) Error++;
+		}
+
+		const std::vector<P6::SphereQuery> spheres = MakeSpheres(Batch, side, 43);
+		P6::OverlapResults results;
+		stats = perf::Measure(Batch, 1, [&]() { queries.overlap(spheres.data(), spheres.size(), results); });
+		perf::Report("queries", "overlap", "query", Batch, 1, stats);
+		stats = perf::Measure(Batch, 1, [&]() { queries.overlap(spheres.data(), spheres.size(), results, &jobs); });
+		perf::Report("queries", "overlap, " + std::to_string(threads) + " threads", "query", Batch, 1, stats);
+
+		const std::vector<P6::MyVector> points = MakePoints(Batch, side, 44);
+		std::vector<P6::NearestHit> nearest(Batch);
+		stats = perf::Measure(Batch, 1, [&]() { queries.nearest(points.data(), points.size(), nearest.data()); });
+		perf::Report("queries", "nearest", "query", Batch, 1, stats);
+		stats = perf::Measure(Batch, 1, [&]() { queries.nearest(points.data(), points.size(), nearest.data(), 1e30f, &jobs); });
+		perf::Report("queries", "nearest, " + std::to_string(threads) + " threads", "query", Batch, 1, stats);
+	}
+
+	return Error;
+}
@@ -0,0 +1,138 @@
+#include "p6/ParticleWorld.h"
+#include "p6/TriggerVolumes.h"
+#include "perf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace {
+	//the race loop of GDPHYSX-SampleProject.cpp without the window
+	struct Race {
+		P6::ParticleWorld world;
+		P6::TriggerVolumes triggers;
+		std::vector<P6::ParticleHandle> handles;
+		//per racer: simulated seconds to the finish, negative until then
+		std::vector<double> finishTime;
+		size_t finishedCount = 0;
+
+		explicit Race(size_t racers) : world(racers), handles(racers), finishTime(racers, -1.0) {
+			//the demo's finish line, the box a unit around the origin
+			triggers.addBox(P6::Aabb(P6::MyVector(-1, -1, -1), P6::MyVector(1, 1, 1)));
+		}
+
+		void start() {
+			world.clear();
+			triggers.resetClock();
+			finishedCount = 0;
+			for (size_t i = 0; i < handles.size(); i++) {
+				//spread over a sphere around the finish, speeds and accelerations in the demo's range
+				float a = 2.39996f * static_cast<float>(i);
+				float z = 1.0f - 2.0f * (static_cast<float>(i) + 0.5f) / static_cast<float>(handles.size());
+				float r = std::sqrt(1.0f - z * z);
+				P6::MyVector start = P6::MyVector(r * std::cos(a), r * std::sin(a), z) * 500.0f;
+				float t = static_cast<float>(i % 7) / 6.0f;
+
+				P6::P6Particle particle;
+				particle.Position = start;
+				particle.Acceleration = start.Direction() * (-(1.0f + 13.5f * t));
+				particle.Velocity = start.Direction() * (-(80.0f + 50.0f * t));
+				particle.active = true;
+				handles[i] = world.spawn(particle);
+				finishTime[i] = -1.0;
+			}
+		}
+
+		void step(float time) {
+			world.update(time);
+
+			//same finish as the demo: stopped and timed where they cross into the box
+			triggers.update(world, time);
+			for (const P6::TriggerEvent& event : triggers.events()) {
+				if (event.kind != P6::TriggerEvent::Enter) continue;
+				//a fresh world hands out slots in spawn order
+				const uint32_t racer = event.particle.slot;
+				if (finishTime[racer] >= 0) continue;
+				finishTime[racer] = event.time;
+				world[event.particle].SetActive(false);
+				finishedCount++;
+			}
+		}
+	};
+
+	//racers at constant speed finish at a time known in closed form, wherever the steps fall
+	int CheckFinishTimes() {
+		int Error = 0;
+		const size_t racers = 64;
+		Race race(racers);
+		race.world.clear();
+		race.triggers.resetClock();
+		std::vector<double> expected(racers);
+		for (size_t i = 0; i < racers; i++) {
+			const float distance = 100.0f + 3.7f * static_cast<float>(i);
+			const float speed = 90.0f + 0.9f * static_cast<float>(i);
+			P6::P6Particle particle;
+			particle.Position = P6::MyVector(distance, 0.25f, -0.25f);
+			particle.Velocity = P6::MyVector(-speed, 0, 0);
+			particle.active = true;
+			race.handles[i] = race.world.spawn(particle);
+			//the box face is 1 short of the origin
+			expected[i] = (distance - 1.0) / speed;
+		}
+		for (int s = 0; s < 300 && race.finishedCount < racers; s++) race.step(0.016f);
+
+		double worst = 0;
+		for (size_t i = 0; i < racers; i++) {
+			if (race.finishTime[i] < 0) {
+				Error++;
+				continue;
+			}
+			worst = std::max(worst, std::abs(race.finishTime[i] - expected[i]));
+		}
+		//a step is 16ms, the old end-of-step test was off by up to that much
+		if (worst > 1e-4) Error++;
+
+		//one step jumps further than the box is wide, so the end-of-step test never sees these
+		P6::ParticleWorld world(1);
+		P6::TriggerVolumes triggers;
+		triggers.addSphere(P6::MyVector(0, 0, 0), 1.0f);
+		P6::P6Particle bullet;
+		bullet.Position = P6::MyVector(-5, 0, 0);
+		bullet.Velocity = P6::MyVector(500, 0, 0);
+		bullet.active = true;
+		world.spawn(bullet);
+		world.update(0.016f);
+		triggers.update(world, 0.016f);
+		const bool through = triggers.events().size() == 2 && triggers.events()[0].kind == P6::TriggerEvent::Enter
+			&& std::abs(triggers.events()[0].time - 4.0 / 500.0) < 1e-6 && std::abs(triggers.events()[1].time - 6.0 / 500.0) < 1e-6;
+		if (!through) Error++;
+
+		std::printf("  finish check: %zu/%zu timed, worst error %.2g s, pass-through %s\n", race.finishedCount, racers, worst, through ? "seen" : "missed");
+		return Error;
+	}
+}
+
+int perf_race() {
+	int Error = 0;
+	if (!perf::Selected("race")) return Error;
+
+	//the demo race is decided within 300 steps of 16ms
+	const size_t Steps = 300;
+	const size_t sizes[] = { 4, 1000, 100000 };
+
+	std::printf("perf_race: %zu steps per race, respawn included\n", Steps);
+	for (size_t racers : sizes) {
+		Race race(racers);
+		perf::Stats stats = perf::Measure(racers, Steps, [&]() {
+			race.start();
+			for (size_t s = 0; s < Steps; s++) race.step(0.016f);
+		});
+		perf::Report("race", "race step", "racer", racers, Steps, stats);
+		std::printf("  %zu of %zu finished\n", race.finishedCount, racers);
+	}
+
+	Error += CheckFinishTimes();
+
+	return Error;
+}
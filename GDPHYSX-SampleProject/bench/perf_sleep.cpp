@@ -0,0 +1,178 @@
+#include "p6/ForceRegistry.h"
+#include "p6/ParticleWorld.h"
+#include "perf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+	//unit spheres at rest on a lattice 1.5 apart, none touching: a settled scene
+	void SpawnLattice(P6::ParticleWorld& world, size_t count, std::vector<P6::ParticleHandle>& handles) {
+		const int side = static_cast<int>(std::ceil(std::cbrt(static_cast<double>(count))));
+		P6::P6Particle particle;
+		particle.mass = 1.0f;
+		particle.radius = 0.5f;
+		particle.active = true;
+		for (size_t i = 0; i < count; i++) {
+			const int x = static_cast<int>(i % side), y = static_cast<int>((i / side) % side), z = static_cast<int>(i / (side * side));
+			particle.Position = P6::MyVector(1.5f * x, 1.5f * y, 1.5f * z);
+			handles.push_back(world.spawn(particle));
+		}
+	}
+
+	//a few particles flying through the lattice in random directions, they never rest
+	void SpawnMovers(P6::ParticleWorld& world, size_t count, size_t lattice, unsigned seed) {
+		const float side = 1.5f * static_cast<float>(std::ceil(std::cbrt(static_cast<double>(lattice))));
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		P6::P6Particle particle;
+		particle.mass = 1.0f;
+		particle.radius = 0.25f;
+		particle.active = true;
+		for (size_t i = 0; i < count; i++) {
+			//between lattice points, so nobody starts inside anybody
+			particle.Position = P6::MyVector(std::floor(unit(random) * side / 1.5f) * 1.5f + 0.75f,
+				std::floor(unit(random) * side / 1.5f) * 1.5f + 0.75f, std::floor(unit(random) * side / 1.5f) * 1.5f + 0.75f);
+			particle.Velocity = P6::MyVector(unit(random) - 0.5f, unit(random) - 0.5f, unit(random) - 0.5f).Direction() * 5.0f;
+			world.spawn(particle);
+		}
+	}
+
+	bool Near(const P6::MyVector& a, const P6::MyVector& b) {
+		return (a - b).Magnitude() < 1e-5f;
+	}
+
+	//a row of unit spheres squeezed together from both ends
+	struct Row {
+		std::vector<P6::ParticleHandle> handles;
+		P6::ForceGeneratorId<P6::ConstantForce> left, right;
+	};
+
+	Row SpawnRow(P6::ParticleWorld& world, int count) {
+		Row row;
+		P6::P6Particle particle;
+		particle.mass = 1.0f;
+		particle.radius = 0.5f;
+		particle.active = true;
+		for (int i = 0; i < count; i++) {
+			particle.Position = P6::MyVector(0.99f * i, 0, 0);
+			row.handles.push_back(world.spawn(particle));
+		}
+		P6::ConstantForce push;
+		push.force = P6::MyVector(2.0f, 0, 0);
+		row.left = world.forces().add(push);
+		world.forces().bind(row.left, row.handles.front());
+		push.force = P6::MyVector(-2.0f, 0, 0);
+		row.right = world.forces().add(push);
+		world.forces().bind(row.right, row.handles.back());
+		return row;
+	}
+
+	int CheckSleep() {
+		int Error = 0;
+		const int Steps = 30;
+
+		//a resting lattice falls asleep on the step it has rested for long enough, and stays put
+		P6::ParticleWorld world(1000 + 16);
+		std::vector<P6::ParticleHandle> lattice;
+		SpawnLattice(world, 1000, lattice);
+		world.setCollisions(true, 0.5f);
+		world.setSleeping(true, 0.1f, Steps);
+		for (int step = 0; step < Steps - 1; step++) world.update(0.016f);
+		Error += world.awakeCount() == world.size() ? 0 : 1;
+		world.update(0.016f);
+		Error += world.awakeCount() == 0 ? 0 : 1;
+		Error += !world[lattice[0]].IsMoving() ? 0 : 1;
+
+		//a particle shot into it wakes the one it hits and nothing else
+		P6::P6Particle bullet;
+		bullet.mass = 1.0f;
+		bullet.radius = 0.25f;
+		bullet.active = true;
+		bullet.Position = P6::MyVector(-1.0f, 0, 0);
+		bullet.Velocity = P6::MyVector(20.0f, 0, 0);
+		P6::ParticleHandle shot = world.spawn(bullet);
+		Error += world.awakeCount() == 1 && !world.sleeping(shot) ? 0 : 1;
+		for (int step = 0; step < 5; step++) world.update(0.016f);
+		Error += !world.sleeping(lattice[0]) && world[lattice[0]].GetVelocity().x > 1.0f ? 0 : 1;
+		const size_t hitAwake = world.awakeCount();
+		Error += hitAwake >= 2 && hitAwake < 10 ? 0 : 1;
+
+		//kills and spawns on both sides of the split keep every handle on its particle
+		std::vector<P6::MyVector> before;
+		for (P6::ParticleHandle handle : lattice) before.push_back(world[handle].GetPosition());
+		world.kill(lattice[0]);
+		world.kill(lattice[700]);
+		world.kill(shot);
+		P6::ParticleHandle extra = world.spawn(bullet);
+		int moved = 0;
+		for (size_t i = 1; i < lattice.size(); i++) {
+			if (i == 700) continue;
+			moved += Near(world[lattice[i]].GetPosition(), before[i]) ? 0 : 1;
+		}
+		Error += moved == 0 && Near(world[extra].GetPosition(), bullet.Position) && !world.sleeping(extra) ? 0 : 1;
+		size_t asleep = 0;
+		for (size_t i = 0; i < world.size(); i++) asleep += world.sleeping(world.handleAt(i)) ? 1 : 0;
+		Error += asleep == world.size() - world.awakeCount() ? 0 : 1;
+
+		//a squeezed row is one island: it settles and sleeps as a whole, and a change in the push wakes all of it
+		P6::ParticleWorld squeezed(8);
+		Row row = SpawnRow(squeezed, 8);
+		squeezed.setCollisions(true, 0.0f);
+		squeezed.setSleeping(true, 0.1f, Steps);
+		size_t lowest = squeezed.size();
+		int steps = 0;
+		for (; steps < 600 && squeezed.awakeCount() > 0; steps++) {
+			squeezed.update(0.016f);
+			if (squeezed.awakeCount() > 0) lowest = std::min(lowest, squeezed.awakeCount());
+		}
+		Error += squeezed.awakeCount() == 0 && lowest == squeezed.size() ? 0 : 1;
+		for (int step = 0; step < 10; step++) squeezed.update(0.016f);
+		Error += squeezed.awakeCount() == 0 ? 0 : 1;
+		squeezed.forces().get(row.left).force = P6::MyVector(50.0f, 0, 0);
+		squeezed.update(0.016f);
+		Error += squeezed.awakeCount() == squeezed.size() ? 0 : 1;
+		Error += squeezed.wake(row.handles[3]) && !squeezed.sleeping(row.handles[3]) ? 0 : 1;
+
+		std::printf("  sleep check: lattice asleep after %d steps, a hit woke %zu, a squeezed row slept whole after %d steps\n",
+			Steps, hitAwake, steps);
+		return Error;
+	}
+}
+
+int perf_sleep() {
+	int Error = 0;
+	if (!perf::Selected("sleep")) return Error;
+
+	//step cost with most of the scene at rest, against the same scene with sleeping off
+	const size_t Movers = 1000;
+	for (size_t count : { 10000, 100000 }) {
+		std::printf("perf_sleep: %zu resting particles and %zu moving through them\n", count, Movers);
+		double awakeCost = 0;
+		for (int variant = 0; variant < 2; variant++) {
+			P6::ParticleWorld world(count + Movers);
+			std::vector<P6::ParticleHandle> lattice;
+			SpawnLattice(world, count, lattice);
+			SpawnMovers(world, Movers, count, 7);
+			world.setCollisions(true, 0.5f);
+			if (variant == 1) world.setSleeping(true, 0.1f, 30);
+			//long enough for the lattice to fall asleep
+			for (int step = 0; step < 32; step++) world.update(0.016f);
+
+			const size_t Steps = 10;
+			perf::Stats stats = perf::Measure(world.size(), Steps, [&]() {
+				for (size_t step = 0; step < Steps; step++) world.update(0.016f);
+			});
+			perf::Report("sleep", variant == 0 ? "world.update, sleeping off" : "world.update, sleeping on", "particle", world.size(), Steps, stats);
+			if (variant == 0) awakeCost = stats.median;
+			else std::printf("  %zu of %zu awake, %.2fx over sleeping off\n", world.awakeCount(), world.size(), stats.median > 0 ? awakeCost / stats.median : 0.0);
+		}
+	}
+	Error += CheckSleep();
+
+	return Error;
+}
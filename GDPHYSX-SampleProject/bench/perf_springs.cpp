@@ -0,0 +1,258 @@
+#include "p6/ForceRegistry.h"
+#include "p6/JobSystem.h"
+#include "p6/ParticleKernels.h"
+#include "p6/ParticleWorld.h"
+#include "p6/SpringKernels.h"
+#include "perf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+	//the way springs are usually written: one object per spring, reading and writing its two
+	//particles through views and MyVector temporaries
+	struct ObjectSpring {
+		P6::ParticleHandle a, b;
+		float rest = 1.0f;
+		float stiffness = 0;
+		float damping = 0;
+
+		void updateForce(P6::ParticleWorld& world) const {
+			P6::ParticleView first = world[a], second = world[b];
+			const P6::MyVector d = second.GetPosition() - first.GetPosition();
+			const float length = d.Magnitude();
+			if (!(length > 0)) return;
+			const P6::MyVector direction = d * (1.0f / length);
+			const float stretching = (second.GetVelocity() - first.GetVelocity()).dotProduct(direction);
+			const P6::MyVector force = direction * (stiffness * (length - rest) + damping * stretching);
+			first.AddForce(force);
+			second.AddForce(force * -1.0f);
+		}
+	};
+
+	//a square sheet of particles a little stretched, springs to the right and down neighbours
+	//shuffled, neighbouring springs don't sit next to each other in memory
+	void SpawnSheet(P6::ParticleWorld& world, int side, bool shuffled, std::vector<ObjectSpring>* objects, unsigned seed) {
+		std::vector<P6::ParticleHandle> handles;
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> jitter(-0.1f, 0.1f);
+		for (int y = 0; y < side; y++) {
+			for (int x = 0; x < side; x++) {
+				P6::P6Particle particle;
+				particle.mass = 1.0f;
+				particle.active = true;
+				particle.Position = P6::MyVector(1.1f * x + jitter(random), 1.1f * y + jitter(random), jitter(random));
+				particle.Velocity = P6::MyVector(jitter(random), jitter(random), jitter(random));
+				handles.push_back(world.spawn(particle));
+			}
+		}
+
+		std::vector<ObjectSpring> springs;
+		for (int y = 0; y < side; y++) {
+			for (int x = 0; x < side; x++) {
+				ObjectSpring spring;
+				spring.a = handles[y * side + x];
+				spring.stiffness = 40.0f;
+				spring.damping = 0.5f;
+				if (x + 1 < side) {
+					spring.b = handles[y * side + x + 1];
+					springs.push_back(spring);
+				}
+				if (y + 1 < side) {
+					spring.b = handles[(y + 1) * side + x];
+					springs.push_back(spring);
+				}
+			}
+		}
+		if (shuffled) std::shuffle(springs.begin(), springs.end(), random);
+
+		P6::SpringForces& network = world.forces().springs();
+		for (const ObjectSpring& spring : springs) network.addSpring(spring.a, spring.b, spring.rest, spring.stiffness, spring.damping);
+		if (objects) *objects = springs;
+	}
+
+	std::vector<P6::SimdLevel> Levels() {
+		std::vector<P6::SimdLevel> levels;
+		for (P6::SimdLevel level : { P6::SimdLevel::Scalar, P6::SimdLevel::SSE2, P6::SimdLevel::AVX2 }) {
+			if (level <= P6::DetectSimdLevel()) levels.push_back(level);
+		}
+		return levels;
+	}
+
+	std::vector<float> Forces(const P6::ParticleWorld& world) {
+		const P6::ParticleStreams& s = world.buffer().streams();
+		std::vector<float> forces;
+		for (size_t i = 0; i < world.size(); i++) {
+			forces.push_back(s.forceX[i]);
+			forces.push_back(s.forceY[i]);
+			forces.push_back(s.forceZ[i]);
+		}
+		return forces;
+	}
+
+	bool Close(const std::vector<float>& a, const std::vector<float>& b, float tolerance) {
+		if (a.size() != b.size()) return false;
+		for (size_t i = 0; i < a.size(); i++) {
+			if (std::abs(a[i] - b[i]) > tolerance * (1.0f + std::abs(a[i]))) return false;
+		}
+		return true;
+	}
+
+	int CheckSprings() {
+		int Error = 0;
+		const P6::SimdLevel active = P6::ActiveSimdLevel();
+
+		//the kernels on random rows, some of them bungees gone slack and some of no length
+		const size_t Rows = 1003;
+		std::mt19937 random(51);
+		std::uniform_real_distribution<float> unit(-2.0f, 2.0f), positive(0.0f, 2.0f);
+		std::vector<float> dx(Rows), dy(Rows), dz(Rows), dvx(Rows), dvy(Rows), dvz(Rows), rest(Rows), stiffness(Rows), damping(Rows), slack(Rows);
+		for (size_t i = 0; i < Rows; i++) {
+			dx[i] = unit(random); dy[i] = unit(random); dz[i] = unit(random);
+			dvx[i] = unit(random); dvy[i] = unit(random); dvz[i] = unit(random);
+			rest[i] = positive(random);
+			stiffness[i] = 10.0f * positive(random);
+			damping[i] = positive(random);
+			slack[i] = i % 3 == 0 ? rest[i] : 0.0f;
+			if (i % 17 == 0) dx[i] = dy[i] = dz[i] = 0;
+		}
+		std::vector<std::vector<float>> out;
+		for (P6::SimdLevel level : Levels()) {
+			std::vector<float> x = dx, y = dy, z = dz;
+			P6::SpringColumns c;
+			c.dx = x.data(); c.dy = y.data(); c.dz = z.data();
+			c.dvx = dvx.data(); c.dvy = dvy.data(); c.dvz = dvz.data();
+			c.rest = rest.data(); c.stiffness = stiffness.data(); c.damping = damping.data(); c.slack = slack.data();
+			P6::SpringKernelFor(level)(c, 0, Rows);
+			x.insert(x.end(), y.begin(), y.end());
+			x.insert(x.end(), z.begin(), z.end());
+			out.push_back(x);
+		}
+		for (size_t i = 0; i < Rows; i++) {
+			//no length and slack bungees give nothing, whatever the level
+			if (i % 17 == 0 || (i % 3 == 0 && std::sqrt(dx[i] * dx[i] + dy[i] * dy[i] + dz[i] * dz[i]) <= rest[i])) {
+				Error += out[0][i] == 0 && out[0][i + Rows] == 0 && out[0][i + 2 * Rows] == 0 ? 0 : 1;
+			}
+		}
+		for (size_t l = 1; l < out.size(); l++) {
+			Error += (Levels()[l] == P6::SimdLevel::SSE2 ? out[0] == out[l] : Close(out[0], out[l], 1e-5f)) ? 0 : 1;
+		}
+
+		//a sheet: the network against one object per spring, and the same bits on threads
+		const int Side = 40;
+		size_t colors = 0;
+		for (P6::SimdLevel level : Levels()) {
+			P6::SetSimdLevel(level);
+			P6::ParticleWorld world(Side * Side), threaded(Side * Side);
+			std::vector<ObjectSpring> objects;
+			SpawnSheet(world, Side, true, &objects, 52);
+			SpawnSheet(threaded, Side, true, nullptr, 52);
+			P6::JobSystem jobs(4);
+			threaded.setJobs(&jobs);
+
+			world.forces().applyForces(world);
+			threaded.forces().applyForces(threaded);
+			const std::vector<float> network = Forces(world);
+			Error += network == Forces(threaded) ? 0 : 1;
+			world.buffer().clearForces();
+			for (const ObjectSpring& spring : objects) spring.updateForce(world);
+			Error += Close(network, Forces(world), 1e-4f) ? 0 : 1;
+			colors = world.forces().springs().colorCount();
+			threaded.setJobs(nullptr);
+		}
+		//four springs a particle, greedy colouring needs a few more than that at most
+		Error += colors >= 4 && colors <= 8 ? 0 : 1;
+		P6::SetSimdLevel(active);
+
+		//hung from an anchor under gravity, a damped spring settles mg / k below its rest length
+		P6::ParticleWorld world(4);
+		P6::P6Particle bob;
+		bob.mass = 2.0f;
+		bob.active = true;
+		bob.Position = P6::MyVector(0, 5.0f, 0);
+		const P6::ParticleHandle hung = world.spawn(bob);
+		P6::GravityForce gravity;
+		world.forces().bind(world.forces().add(gravity), hung);
+		world.forces().springs().addAnchored(hung, P6::MyVector(0, 10.0f, 0), 3.0f, 20.0f, 4.0f);
+		for (int step = 0; step < 1000; step++) world.update(0.016f);
+		const float settled = world[hung].GetPosition().y;
+		Error += std::abs(settled - (10.0f - 3.0f - 2.0f * 9.8f / 20.0f)) < 1e-3f ? 0 : 1;
+
+		//a bungee does nothing while slack, and a spring to a killed particle stops pulling
+		bob.mass = 1.0f;
+		bob.Position = P6::MyVector(20.0f, 0, 0);
+		const P6::ParticleHandle left = world.spawn(bob);
+		bob.Position = P6::MyVector(21.0f, 0, 0);
+		const P6::ParticleHandle right = world.spawn(bob);
+		world.forces().springs().addBungee(left, right, 2.0f, 10.0f, 1.0f);
+		world.buffer().clearForces();
+		world.forces().applyForces(world);
+		Error += world[left].GetForce().Magnitude() == 0 && world[right].GetForce().Magnitude() == 0 ? 0 : 1;
+		world[right].SetPosition(P6::MyVector(25.0f, 0, 0));
+		//the kill moves right to another index, the spring follows it
+		world.kill(hung);
+		world.buffer().clearForces();
+		world.forces().applyForces(world);
+		Error += std::abs(world[left].GetForce().x - 30.0f) < 1e-4f && world[right].GetForce().x == -world[left].GetForce().x ? 0 : 1;
+		world.kill(right);
+		world.buffer().clearForces();
+		world.forces().applyForces(world);
+		Error += world[left].GetForce().Magnitude() == 0 ? 0 : 1;
+
+		std::printf("  springs check: kernels agree, a %dx%d sheet matches per-spring objects in %zu colours, hung spring settled at %.4f\n",
+			Side, Side, colors, settled);
+		return Error;
+	}
+}
+
+int perf_springs() {
+	int Error = 0;
+	if (!perf::Selected("springs")) return Error;
+
+	const P6::SimdLevel active = P6::ActiveSimdLevel();
+	const unsigned threads = std::max(2u, std::thread::hardware_concurrency());
+	P6::JobSystem jobs(threads);
+	const size_t Steps = 10;
+	for (int side : { 100, 500 }) {
+		P6::ParticleWorld world(side * side);
+		std::vector<ObjectSpring> objects;
+		SpawnSheet(world, side, false, &objects, 53);
+		P6::SpringForces& springs = world.forces().springs();
+		const size_t count = springs.size();
+		std::printf("perf_springs: %zu springs between %zu particles\n", count, world.size());
+
+		//per spring, forces only; the accumulators just keep growing
+		perf::Stats stats = perf::Measure(count, Steps, [&]() {
+			for (size_t step = 0; step < Steps; step++) {
+				for (const ObjectSpring& spring : objects) spring.updateForce(world);
+			}
+		});
+		perf::Report("springs", "one object per spring", "spring", count, Steps, stats);
+		const double objectCost = stats.median;
+
+		for (P6::SimdLevel level : Levels()) {
+			P6::SetSimdLevel(level);
+			stats = perf::Measure(count, Steps, [&]() {
+				for (size_t step = 0; step < Steps; step++) springs.apply(world);
+			});
+			perf::Report("springs", std::string("network ") + P6::SimdLevelName(level), "spring", count, Steps, stats);
+		}
+		P6::SetSimdLevel(active);
+		std::printf("  %.2fx over one object per spring\n", stats.median > 0 ? objectCost / stats.median : 0.0);
+
+		world.setJobs(&jobs);
+		stats = perf::Measure(count, Steps, [&]() {
+			for (size_t step = 0; step < Steps; step++) springs.apply(world);
+		});
+		perf::Report("springs", "network, " + std::to_string(threads) + " threads", "spring", count, Steps, stats);
+		world.setJobs(nullptr);
+	}
+	Error += CheckSprings();
+
+	return Error;
+}
@@ -0,0 +1,244 @@
+#include "Scenario.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+namespace {
+	P6::P6Particle MakeParticle(const P6::MyVector& position, const P6::MyVector& velocity, const P6::MyVector& acceleration, float mass) {
+		P6::P6Particle particle;
+		particle.mass = mass;
+		particle.Position = position;
+		particle.Velocity = velocity;
+		particle.Acceleration = acceleration;
+		particle.active = true;
+		return particle;
+	}
+
+	bool ReadVector(std::istringstream& in, P6::MyVector& out) {
+		return static_cast<bool>(in >> out.x >> out.y >> out.z);
+	}
+
+	//relative to the scenario, so the file works from any folder
+	std::string NextTo(const std::string& scenario, const std::string& file) {
+		const bool absolute = !file.empty() && (file[0] == '/' || file[0] == '\\' || file.find(':') != std::string::npos);
+		const size_t slash = scenario.find_last_of("/\\");
+		if (absolute || slash == std::string::npos) return file;
+		return scenario.substr(0, slash + 1) + file;
+	}
+}
+
+bool Scenario::load(const std::string& path, std::string& error) {
+	std::ifstream file(path);
+	if (!file) {
+		error = "cannot open " + path;
+		return false;
+	}
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line)) {
+		lineNumber++;
+		line = line.substr(0, line.find('#'));
+
+		std::istringstream in(line);
+		std::string command;
+		if (!(in >> command)) continue;
+
+		bool ok = true;
+		if (command == "capacity") {
+			ok = static_cast<bool>(in >> capacity);
+		}
+		else if (command == "timestep") {
+			ok = static_cast<bool>(in >> timestep) && timestep > 0;
+		}
+		else if (command == "steps") {
+			ok = static_cast<bool>(in >> steps) && steps >= 0;
+		}
+		else if (command == "finish") {
+			ok = static_cast<bool>(in >> finish);
+		}
+		else if (command == "gravity") {
+			P6::GravityForce force;
+			ok = ReadVector(in, force.gravity);
+			gravity.push_back(force);
+		}
+		else if (command == "drag") {
+			P6::DragForce force;
+			ok = static_cast<bool>(in >> force.k1 >> force.k2);
+			drag.push_back(force);
+		}
+		else if (command == "attractor") {
+			P6::PointAttractor force;
+			ok = ReadVector(in, force.point) && static_cast<bool>(in >> force.strength);
+			attractors.push_back(force);
+		}
+		else if (command == "collisions") {
+			ok = static_cast<bool>(in >> collisions) && collisions >= 0;
+		}
+		else if (command == "sleep") {
+			ok = static_cast<bool>(in >> sleepSpeed >> sleepSteps) && sleepSpeed >= 0 && sleepSteps > 0;
+		}
+		else if (command == "plane") {
+			P6::MyVector normal;
+			float offset = 0, restitution = 0.5f, friction = 0;
+			ok = ReadVector(in, normal) && static_cast<bool>(in >> offset) && normal.Magnitude() > 0;
+			in >> restitution >> friction;
+			if (ok) boundaries.addPlane(normal, offset, restitution, friction);
+		}
+		else if (command == "box") {
+			P6::Aabb box;
+			float restitution = 0.5f, friction = 0;
+			ok = ReadVector(in, box.min) && ReadVector(in, box.max)
+				&& box.min.x <= box.max.x && box.min.y <= box.max.y && box.min.z <= box.max.z;
+			in >> restitution >> friction;
+			if (ok) boundaries.addBox(box, restitution, friction);
+		}
+		else if (command == "mesh") {
+			std::string file;
+			float scale = 1.0f;
+			ok = static_cast<bool>(in >> file);
+			in >> scale;
+			if (ok) {
+				P6::TriangleMesh mesh;
+				std::string meshError;
+				if (!mesh.load(NextTo(path, file), meshError)) {
+					error = path + ":" + std::to_string(lineNumber) + ": " + meshError;
+					return false;
+				}
+				mesh.transform(P6::MyVector(scale, scale, scale), P6::MyVector());
+				P6::MyVector a, b, c;
+				for (size_t t = 0; t < mesh.triangleCount(); t++) {
+					mesh.triangle(t, a, b, c);
+					level.addTriangle(a, b, c);
+				}
+			}
+		}
+		else if (command == "field") {
+			std::string file;
+			float cell = 0, band = 0, scale = 1.0f;
+			ok = static_cast<bool>(in >> file >> cell >> band) && cell > 0 && band > 0;
+			in >> scale;
+			if (ok) {
+				P6::TriangleMesh mesh;
+				std::string fieldError;
+				file = NextTo(path, file);
+				if (!mesh.load(file, fieldError)) {
+					error = path + ":" + std::to_string(lineNumber) + ": " + fieldError;
+					return false;
+				}
+				mesh.transform(P6::MyVector(scale, scale, scale), P6::MyVector());
+				//an unwritable cache only costs the next run another bake
+				if (!field.bakeCached(mesh, cell, band, file + ".sdf", fieldError)) std::fprintf(stderr, "%s\n", fieldError.c_str());
+			}
+		}
+		else if (command == "particle") {
+			Spawn spawn;
+			P6::MyVector position, velocity, acceleration;
+			float mass = 1.0f;
+			ok = static_cast<bool>(in >> spawn.name) && ReadVector(in, position) && ReadVector(in, velocity) && ReadVector(in, acceleration);
+			in >> mass;
+			spawn.particle = MakeParticle(position, velocity, acceleration, mass);
+			spawns.push_back(spawn);
+		}
+		else if (command == "racer") {
+			//same setup as the racers in GDPHYSX-SampleProject.cpp
+			Spawn spawn;
+			P6::MyVector position;
+			float speed = 0, acceleration = 0;
+			ok = static_cast<bool>(in >> spawn.name) && ReadVector(in, position) && static_cast<bool>(in >> speed >> acceleration);
+			P6::MyVector heading = position.Direction().scalarMultiplication(-1.f);
+			spawn.particle = MakeParticle(position, heading * speed, heading * acceleration, 1.0f);
+			spawns.push_back(spawn);
+		}
+		else if (command == "cloud") {
+			size_t count = 0;
+			unsigned seed = 0;
+			P6::MyVector center;
+			float radius = 0, speed = 0, mass = 1.0f;
+			ok = static_cast<bool>(in >> count >> seed) && ReadVector(in, center) && static_cast<bool>(in >> radius >> speed);
+			in >> mass;
+
+			std::mt19937 random(seed);
+			std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+			auto inBall = [&]() {
+				//rejection sampling keeps the sphere uniform
+				P6::MyVector v;
+				do {
+					v = P6::MyVector(unit(random), unit(random), unit(random));
+				} while (v.dotProduct(v) > 1.0f);
+				return v;
+			};
+			for (size_t i = 0; ok && i < count; i++) {
+				Spawn spawn;
+				spawn.name = "cloud" + std::to_string(i);
+				P6::MyVector offset = inBall();
+				P6::MyVector direction = inBall().Direction();
+				spawn.particle = MakeParticle(center + offset * radius, direction * speed, P6::MyVector(), mass);
+				spawns.push_back(spawn);
+			}
+		}
+		else if (command == "chain") {
+			Chain chain;
+			float mass = 1.0f;
+			ok = static_cast<bool>(in >> chain.count) && ReadVector(in, chain.from) && ReadVector(in, chain.to) && static_cast<bool>(in >> chain.length);
+			in >> mass;
+			chain.first = spawns.size();
+			for (size_t i = 0; ok && i < chain.count; i++) {
+				Spawn spawn;
+				spawn.name = "chain" + std::to_string(chains.size()) + "_" + std::to_string(i);
+				const float along = static_cast<float>(i + 1) / static_cast<float>(chain.count + 1);
+				spawn.particle = MakeParticle(chain.from + (chain.to - chain.from) * along, P6::MyVector(), P6::MyVector(), mass);
+				spawns.push_back(spawn);
+			}
+			if (ok) chains.push_back(chain);
+		}
+		else {
+			error = path + ":" + std::to_string(lineNumber) + ": unknown command " + command;
+			return false;
+		}
+
+		if (!ok) {
+			error = path + ":" + std::to_string(lineNumber) + ": bad arguments for " + command;
+			return false;
+		}
+	}
+
+	if (level.triangleCount() > 0) levelBvh.build(level);
+	return true;
+}
+
+size_t Scenario::worldCapacity() const {
+	return std::max(capacity, spawns.size());
+}
+
+void Scenario::populate(P6::ParticleWorld& world, std::vector<P6::ParticleHandle>& handles) const {
+	handles.assign(spawns.size(), P6::ParticleHandle());
+	for (size_t i = 0; i < spawns.size(); i++) {
+		handles[i] = world.spawn(spawns[i].particle);
+	}
+
+	//every force applies to every particle of the scenario
+	P6::ForceRegistry& forces = world.forces();
+	for (const P6::GravityForce& force : gravity) forces.bind(forces.add(force), handles.data(), handles.size());
+	for (const P6::DragForce& force : drag) forces.bind(forces.add(force), handles.data(), handles.size());
+	for (const P6::PointAttractor& force : attractors) forces.bind(forces.add(force), handles.data(), handles.size());
+
+	P6::ParticleLinks& links = world.links();
+	for (const Chain& chain : chains) {
+		if (chain.count == 0) continue;
+		const P6::ParticleHandle* beads = handles.data() + chain.first;
+		links.addAnchoredRod(beads[0], chain.from, chain.length);
+		for (size_t i = 1; i < chain.count; i++) links.addRod(beads[i - 1], beads[i], chain.length);
+		links.addAnchoredRod(beads[chain.count - 1], chain.to, chain.length);
+	}
+
+	if (collisions >= 0) world.setCollisions(true, collisions);
+	if (sleepSpeed >= 0) world.setSleeping(true, sleepSpeed, sleepSteps);
+	world.boundaries() = boundaries;
+	if (levelBvh.triangleCount() > 0) world.setStaticMesh(&levelBvh);
+	if (!field.empty()) world.setStaticField(&field);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "p6/ForceGenerators.h"
+#include "p6/P6Particle.h"
+#include "p6/ParticleHandle.h"
+#include "p6/ParticleWorld.h"
+#include "p6/SignedDistanceField.h"
+#include "p6/TriangleBvh.h"
+#include "p6/TriangleMesh.h"
+
+//A scenario is a plain text file, one command per line, # starts a comment:
+//
+//	capacity 1024                     pool size, defaults to the number of particles spawned
+//	timestep 0.016                    seconds per step
+//	steps 2000                        steps to run
+//	finish 1                          particles entering this half-size box around the origin stop and get ranked by crossing time
+//	gravity 0 -9.8 0                  GravityForce on every particle
+//	drag 0.1 0.01                     DragForce on every particle
+//	attractor x y z strength          PointAttractor on every particle
+//	collisions restitution            particles collide as spheres (radius 1) instead of passing through
+//	sleep speed steps                 particles slower than speed for steps steps in a row fall asleep
+//	plane nx ny nz offset [restitution friction]
+//	                                  particles stay in front of the plane n.p = offset
+//	box x0 y0 z0 x1 y1 z1 [restitution friction]
+//	                                  particles stay inside the box
+//	mesh path [scale]                 static level geometry from an OBJ file, relative to the scenario file
+//	                                  particles bounce off it with or without collisions
+//	field path cell band [scale]      same, through a signed distance field baked from the OBJ file, cached
+//	                                  next to it as path.sdf and rebaked when the mesh or the settings change
+//	particle name x y z vx vy vz ax ay az [mass]
+//	racer name x y z speed accel      heads for the origin like the racers in the demo
+//	cloud count seed x y z radius speed [mass]
+//	                                  random positions inside a sphere, random directions
+//	chain count x0 y0 z0 x1 y1 z1 length [mass]
+//	                                  count particles evenly between the two points, rods of length between neighbours
+//	                                  and from the end particles to the points; longer than the spacing hangs with slack
+class Scenario {
+	public:
+		struct Spawn {
+			std::string name;
+			P6::P6Particle particle;
+		};
+
+		size_t capacity = 0;
+		float timestep = 0.016f;
+		long steps = 1000;
+		//0 = no finish line
+		float finish = 0;
+
+		std::vector<Spawn> spawns;
+		//spawns[first, first + count) hung between two points
+		struct Chain {
+			size_t first = 0;
+			size_t count = 0;
+			P6::MyVector from, to;
+			float length = 0;
+		};
+		std::vector<Chain> chains;
+		std::vector<P6::GravityForce> gravity;
+		std::vector<P6::DragForce> drag;
+		std::vector<P6::PointAttractor> attractors;
+		//negative = particles pass through each other
+		float collisions = -1.0f;
+		//negative = nothing sleeps
+		float sleepSpeed = -1.0f;
+		int sleepSteps = 60;
+		P6::Boundaries boundaries;
+		//every mesh line merged, and the hierarchy built over it once the file is read
+		P6::TriangleMesh level;
+		P6::TriangleBvh levelBvh;
+		//the last field line
+		P6::SignedDistanceField field;
+
+		//returns false and sets error on a bad file, error names the line
+		bool load(const std::string& path, std::string& error);
+
+		//world capacity needed for every spawn
+		size_t worldCapacity() const;
+		//spawns everything into the world and binds the forces, handles line up with spawns
+		//the world keeps pointers to levelBvh and field, so the scenario has to outlive it
+		void populate(P6::ParticleWorld& world, std::vector<P6::ParticleHandle>& handles) const;
+};
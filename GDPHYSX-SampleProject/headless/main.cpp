@@ -0,0 +1,278 @@
+//P6 without a window: loads a scenario, steps it and reports throughput and the final state.
+//Runs on machines without a display or GPU, nothing here touches GLFW or OpenGL.
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "p6/Integrators.h"
+#include "p6/JobSystem.h"
+#include "p6/ParticleKernels.h"
+#include "p6/ParticleWorld.h"
+#include "p6/StepScheduler.h"
+#include "p6/TriangleBvh.h"
+#include "p6/TriggerVolumes.h"
+#include "Scenario.h"
+
+namespace {
+	typedef void (*StepFn)(P6::ParticleWorld& world, float time);
+
+	void StepKinematic(P6::ParticleWorld& world, float time) {
+		world.update(time);
+	}
+
+	template <typename Integrator>
+	void StepWith(P6::ParticleWorld& world, float time) {
+		world.update<Integrator>(time);
+	}
+
+	struct Options {
+		std::string scenario;
+		long steps = -1;
+		float timestep = 0;
+		const char* integratorName = "kinematic";
+		StepFn step = StepKinematic;
+		bool realtime = false;
+		bool printState = false;
+		//0 = single threaded
+		unsigned threads = 0;
+	};
+
+	void Usage() {
+		std::printf(
+			"usage: P6-Headless <scenario> [options]\n"
+			"  --steps N            steps to run, overrides the scenario\n"
+			"  --dt SECONDS         fixed timestep, overrides the scenario\n"
+			"  --integrator NAME    kinematic (SIMD, default) | euler\n"
+			"  --simd LEVEL         scalar | sse2 | avx2 | avx512, caps the kinematic kernels\n"
+			"  --threads N          solve contacts on N threads (coloured solver)\n"
+			"  --realtime           step at wall-clock rate instead of as fast as possible\n"
+			"  --state              print every particle at the end\n");
+	}
+
+	bool ParseOptions(int argc, char** argv, Options& options) {
+		for (int i = 1; i < argc; i++) {
+			const char* arg = argv[i];
+			const bool hasValue = i + 1 < argc;
+
+			if (std::strcmp(arg, "--steps") == 0 && hasValue) {
+				options.steps = std::atol(argv[++i]);
+			}
+			else if (std::strcmp(arg, "--dt") == 0 && hasValue) {
+				options.timestep = static_cast<float>(std::atof(argv[++i]));
+			}
+			else if (std::strcmp(arg, "--integrator") == 0 && hasValue) {
+				const char* name = argv[++i];
+				if (std::strcmp(name, "kinematic") == 0) options.step = StepKinematic;
+				else if (std::strcmp(name, "euler") == 0) options.step = StepWith<P6::SemiImplicitEuler>;
+				else return false;
+				options.integratorName = name;
+			}
+			else if (std::strcmp(arg, "--simd") == 0 && hasValue) {
+				const char* name = argv[++i];
+				if (std::strcmp(name, "scalar") == 0) P6::SetSimdLevel(P6::SimdLevel::Scalar);
+				else if (std::strcmp(name, "sse2") == 0) P6::SetSimdLevel(P6::SimdLevel::SSE2);
+				else if (std::strcmp(name, "avx2") == 0) P6::SetSimdLevel(P6::SimdLevel::AVX2);
+				else if (std::strcmp(name, "avx512") == 0) P6::SetSimdLevel(P6::SimdLevel::AVX512);
+				else return false;
+			}
+			else if (std::strcmp(arg, "--threads") == 0 && hasValue) {
+				options.threads = static_cast<unsigned>(std::atoi(argv[++i]));
+				if (options.threads == 0) return false;
+			}
+			else if (std::strcmp(arg, "--realtime") == 0) {
+				options.realtime = true;
+			}
+			else if (std::strcmp(arg, "--state") == 0) {
+				options.printState = true;
+			}
+			else if (arg[0] != '-' && options.scenario.empty()) {
+				options.scenario = arg;
+			}
+			else {
+				return false;
+			}
+		}
+		return !options.scenario.empty();
+	}
+
+	//FNV-1a over the raw position and velocity bits, equal hashes mean bit-identical runs
+	uint64_t StateHash(const P6::ParticleBuffer& buffer) {
+		uint64_t hash = 14695981039346656037ull;
+		auto mix = [&hash](const float* column, size_t count) {
+			const unsigned char* bytes = reinterpret_cast<const unsigned char*>(column);
+			for (size_t i = 0; i < count * sizeof(float); i++) {
+				hash = (hash ^ bytes[i]) * 1099511628211ull;
+			}
+		};
+		const P6::ParticleStreams& s = buffer.streams();
+		mix(s.posX, buffer.size()); mix(s.posY, buffer.size()); mix(s.posZ, buffer.size());
+		mix(s.velX, buffer.size()); mix(s.velY, buffer.size()); mix(s.velZ, buffer.size());
+		return hash;
+	}
+
+	struct Finisher {
+		size_t spawn;
+		//simulated seconds, interpolated inside the step that crossed the line
+		double time;
+	};
+}
+
+int main(int argc, char** argv) {
+	Options options;
+	if (!ParseOptions(argc, argv, options)) {
+		Usage();
+		return 2;
+	}
+
+	Scenario scenario;
+	std::string error;
+	if (!scenario.load(options.scenario, error)) {
+		std::fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+	const long steps = options.steps >= 0 ? options.steps : scenario.steps;
+	const float timestep = options.timestep > 0 ? options.timestep : scenario.timestep;
+	const P6::StepScheduler::Duration realStep = std::chrono::duration_cast<P6::StepScheduler::Duration>(std::chrono::duration<float>(timestep));
+	if (options.realtime && realStep.count() <= 0) {
+		std::fprintf(stderr, "--realtime needs a timestep of at least 1 ns, got %g s\n", timestep);
+		return 2;
+	}
+
+	P6::ParticleWorld world(scenario.worldCapacity());
+	P6::JobSystem jobs(options.threads > 0 ? options.threads : 1);
+	if (options.threads > 0) world.setJobs(&jobs);
+	std::vector<P6::ParticleHandle> handles;
+	scenario.populate(world, handles);
+
+	std::vector<Finisher> finishers;
+	std::vector<bool> finished(handles.size(), false);
+	//spawn index by slot, to find the finisher of an event
+	std::vector<size_t> spawnOfSlot(world.capacity(), 0);
+	for (size_t i = 0; i < handles.size(); i++) {
+		if (handles[i].slot < spawnOfSlot.size()) spawnOfSlot[handles[i].slot] = i;
+	}
+
+	//the same finish line as the demo, a trigger box around the origin
+	P6::TriggerVolumes triggers;
+	const float finish = scenario.finish;
+	if (finish > 0) triggers.addBox(P6::Aabb(P6::MyVector(-finish, -finish, -finish), P6::MyVector(finish, finish, finish)));
+
+	auto checkFinish = [&](float time) {
+		triggers.update(world, time);
+		for (const P6::TriggerEvent& event : triggers.events()) {
+			if (event.kind != P6::TriggerEvent::Enter || !world.alive(event.particle)) continue;
+			const size_t i = spawnOfSlot[event.particle.slot];
+			if (finished[i] || handles[i] != event.particle) continue;
+			finished[i] = true;
+			world[event.particle].SetActive(false);
+			finishers.push_back(Finisher{ i, event.time });
+		}
+		return finishers.size() == handles.size();
+	};
+
+	using clock = std::chrono::steady_clock;
+	const auto start = clock::now();
+
+	long done = 0;
+	bool allFinished = false;
+	if (options.realtime) {
+		P6::StepScheduler scheduler(realStep);
+		auto previous = clock::now();
+		while (done < steps && !allFinished) {
+			auto now = clock::now();
+			int due = scheduler.advance(std::chrono::duration_cast<P6::StepScheduler::Duration>(now - previous));
+			previous = now;
+			for (int i = 0; i < due && done < steps && !allFinished; i++) {
+				options.step(world, scheduler.seconds());
+				done++;
+				if (scenario.finish > 0) allFinished = checkFinish(scheduler.seconds());
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+	else {
+		while (done < steps && !allFinished) {
+			options.step(world, timestep);
+			done++;
+			if (scenario.finish > 0) allFinished = checkFinish(timestep);
+		}
+	}
+
+	const double wallSeconds = std::chrono::duration<double>(clock::now() - start).count();
+	const double particleSteps = static_cast<double>(done) * world.size();
+
+	std::printf("scenario:   %s, %zu particles\n", options.scenario.c_str(), world.size());
+	std::printf("integrator: %s (%s)\n", options.integratorName, P6::SimdLevelName(P6::ActiveSimdLevel()));
+	if (world.staticMesh()) {
+		const P6::TriangleBvh& mesh = *world.staticMesh();
+		std::printf("mesh:       %zu triangles, %zu BVH nodes, depth %d\n", mesh.triangleCount(), mesh.nodeCount(), mesh.depth());
+	}
+	if (world.staticField()) {
+		const P6::SignedDistanceField& field = *world.staticField();
+		std::printf("field:      %u x %u x %u nodes, cell %g, band %g, %s\n", field.dimension(0), field.dimension(1), field.dimension(2),
+			field.cellSize(), field.bandWidth(), field.fromCache() ? "from the cache" : "baked");
+	}
+	const P6::Boundaries& boundaries = world.boundaries();
+	if (!boundaries.empty()) std::printf("boundaries: %zu planes, %zu boxes\n", boundaries.planeCount(), boundaries.boxCount());
+	if (!world.links().empty()) std::printf("links:      %zu rods\n", world.links().size());
+	std::printf("simulated:  %ld steps x %g s = %.3f s%s\n", done, timestep, done * timestep, allFinished ? ", everyone finished" : "");
+	std::printf("wall:       %.3f s, %.0f steps/s", wallSeconds, wallSeconds > 0 ? done / wallSeconds : 0.0);
+	if (particleSteps > 0) std::printf(", %.2f ns/particle-step", wallSeconds * 1e9 / particleSteps);
+	std::printf("\n");
+
+	if (scenario.finish > 0) {
+		int rank = 1;
+		for (const Finisher& finisher : finishers) {
+			P6::MyVector velocity = world[handles[finisher.spawn]].GetVelocity();
+			std::printf("  %d. %-10s %.4f s, %.2f m/s\n", rank++, scenario.spawns[finisher.spawn].name.c_str(), finisher.time, velocity.Magnitude());
+		}
+	}
+
+	//summary of where everything ended up
+	P6::MyVector centerOfMass;
+	P6::MyVector lower(INFINITY, INFINITY, INFINITY), upper(-INFINITY, -INFINITY, -INFINITY);
+	double kineticEnergy = 0;
+	for (size_t i = 0; i < world.size(); i++) {
+		P6::ParticleView particle = world.buffer()[i];
+		P6::MyVector p = particle.GetPosition();
+		P6::MyVector v = particle.GetVelocity();
+		centerOfMass += p;
+		lower = P6::MyVector(std::fmin(lower.x, p.x), std::fmin(lower.y, p.y), std::fmin(lower.z, p.z));
+		upper = P6::MyVector(std::fmax(upper.x, p.x), std::fmax(upper.y, p.y), std::fmax(upper.z, p.z));
+		kineticEnergy += 0.5 * particle.GetMass() * v.dotProduct(v);
+	}
+	if (world.size() > 0) centerOfMass = centerOfMass * (1.0f / world.size());
+
+	std::printf("center:     (%.3f, %.3f, %.3f)\n", centerOfMass.x, centerOfMass.y, centerOfMass.z);
+	std::printf("bounds:     (%.3f, %.3f, %.3f) - (%.3f, %.3f, %.3f)\n", lower.x, lower.y, lower.z, upper.x, upper.y, upper.z);
+	std::printf("kinetic:    %.6g J\n", kineticEnergy);
+	if (world.collisionsEnabled() || world.staticMesh() || world.staticField()) {
+		P6::ContactResolver& contacts = world.contacts();
+		if (world.jobSystem()) {
+			std::printf("contacts:   %zu in the last step, %zu colours on %u threads, %zu velocity + %zu position sweeps\n",
+				contacts.size(), contacts.colorCount(), jobs.threadCount(), contacts.velocityIterations(), contacts.positionIterations());
+		}
+		else {
+			std::printf("contacts:   %zu in the last step, %zu velocity + %zu position iterations\n", contacts.size(), contacts.velocityIterations(), contacts.positionIterations());
+		}
+	}
+	if (world.sleepingEnabled()) std::printf("asleep:     %zu of %zu particles\n", world.size() - world.awakeCount(), world.size());
+	std::printf("state hash: %016llx\n", static_cast<unsigned long long>(StateHash(world.buffer())));
+
+	if (options.printState) {
+		for (size_t i = 0; i < handles.size(); i++) {
+			P6::ParticleView particle = world[handles[i]];
+			P6::MyVector p = particle.GetPosition();
+			P6::MyVector v = particle.GetVelocity();
+			std::printf("  %-10s p (%.4f, %.4f, %.4f) v (%.4f, %.4f, %.4f)\n", scenario.spawns[i].name.c_str(), p.x, p.y, p.z, v.x, v.y, v.z);
+		}
+	}
+	return 0;
+}
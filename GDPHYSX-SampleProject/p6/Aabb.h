@@ -0,0 +1,50 @@
+#pragma once
+
+#include <algorithm>
+
+#include "MyVector.h"
+
+namespace P6 {
+	//axis aligned box, min <= max on every axis
+	struct Aabb {
+		MyVector min;
+		MyVector max;
+
+		Aabb() {}
+		Aabb(const MyVector& _min, const MyVector& _max) : min(_min), max(_max) {}
+
+		//the box around a sphere
+		static Aabb Around(const MyVector& center, float radius) {
+			return Aabb(MyVector(center.x - radius, center.y - radius, center.z - radius),
+				MyVector(center.x + radius, center.y + radius, center.z + radius));
+		}
+
+		static Aabb Merge(const Aabb& a, const Aabb& b) {
+			return Aabb(MyVector(std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z)),
+				MyVector(std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z)));
+		}
+
+		//strict, boxes that only touch don't overlap
+		bool overlaps(const Aabb& other) const {
+			return min.x < other.max.x && other.min.x < max.x
+				&& min.y < other.max.y && other.min.y < max.y
+				&& min.z < other.max.z && other.min.z < max.z;
+		}
+
+		bool contains(const Aabb& other) const {
+			return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z
+				&& other.max.x <= max.x && other.max.y <= max.y && other.max.z <= max.z;
+		}
+
+		Aabb expanded(float margin) const {
+			return Aabb(MyVector(min.x - margin, min.y - margin, min.z - margin),
+				MyVector(max.x + margin, max.y + margin, max.z + margin));
+		}
+
+		//the cost measure of the tree heuristics
+		float surfaceArea() const {
+			const float dx = max.x - min.x, dy = max.y - min.y, dz = max.z - min.z;
+			return 2.0f * (dx * dy + dy * dz + dz * dx);
+		}
+	};
+}
@@ -0,0 +1,239 @@
+#include "AabbTree.h"
+
+#include <algorithm>
+
+using namespace P6;
+
+namespace {
+	bool SameBox(const Aabb& a, const Aabb& b) {
+		return a.min.x == b.min.x && a.min.y == b.min.y && a.min.z == b.min.z
+			&& a.max.x == b.max.x && a.max.y == b.max.y && a.max.z == b.max.z;
+	}
+}
+
+AabbTree::AabbTree(float margin) : margin(margin) {}
+
+void AabbTree::clear() {
+	nodes.clear();
+	root = Null;
+	freeList = Null;
+	leaves = 0;
+}
+
+int32_t AabbTree::allocate() {
+	if (freeList == Null) {
+		nodes.push_back(Node());
+		return static_cast<int32_t>(nodes.size() - 1);
+	}
+	const int32_t node = freeList;
+	freeList = nodes[node].parent;
+	nodes[node] = Node();
+	return node;
+}
+
+void AabbTree::release(int32_t node) {
+	nodes[node].parent = freeList;
+	nodes[node].height = -1;
+	freeList = node;
+}
+
+int32_t AabbTree::insert(const Aabb& box, uint32_t userData) {
+	const int32_t leaf = allocate();
+	nodes[leaf].box = box.expanded(margin);
+	nodes[leaf].userData = userData;
+	nodes[leaf].height = 0;
+	insertLeaf(leaf);
+	return leaf;
+}
+
+void AabbTree::remove(int32_t proxy) {
+	removeLeaf(proxy);
+	release(proxy);
+}
+
+bool AabbTree::move(int32_t proxy, const Aabb& box, const MyVector& displacement) {
+	//stretch the fat box along the motion, twice the last step
+	Aabb fat = box.expanded(margin);
+	const MyVector ahead(2.0f * displacement.x, 2.0f * displacement.y, 2.0f * displacement.z);
+	if (ahead.x < 0) fat.min.x += ahead.x; else fat.max.x += ahead.x;
+	if (ahead.y < 0) fat.min.y += ahead.y; else fat.max.y += ahead.y;
+	if (ahead.z < 0) fat.min.z += ahead.z; else fat.max.z += ahead.z;
+
+	//still inside, unless the old fat box is far bigger than needed (a fast proxy that stopped)
+	const Aabb& current = nodes[proxy].box;
+	if (current.contains(box) && fat.expanded(4.0f * margin).contains(current)) return false;
+
+	removeLeaf(proxy);
+	nodes[proxy].box = fat;
+	insertLeaf(proxy);
+	return true;
+}
+
+void AabbTree::insertLeaf(int32_t leaf) {
+	leaves++;
+	if (root == Null) {
+		root = leaf;
+		nodes[root].parent = Null;
+		return;
+	}
+
+	//branch and bound search for the sibling that adds the least surface area to the tree: pairing
+	//with a node costs the merged box plus the growth it causes in every ancestor, and a subtree
+	//can be skipped once even a leaf-sized box inside it could not beat the best cost so far
+	const Aabb box = nodes[leaf].box;
+	const float leafArea = box.surfaceArea();
+	int32_t index = root;
+	float bestCost = Aabb::Merge(nodes[root].box, box).surfaceArea();
+
+	search.clear();
+	search.push_back(Candidate{ root, 0 });
+	while (!search.empty()) {
+		const Candidate candidate = search.back();
+		search.pop_back();
+
+		const Node& node = nodes[candidate.node];
+		const float direct = Aabb::Merge(node.box, box).surfaceArea();
+		const float cost = direct + candidate.inherited;
+		if (cost < bestCost) {
+			bestCost = cost;
+			index = candidate.node;
+		}
+		if (node.isLeaf()) continue;
+
+		const float inherited = candidate.inherited + direct - node.box.surfaceArea();
+		if (leafArea + inherited < bestCost) {
+			//the child that grows less goes on top, good candidates early make the bound tight
+			int32_t near = node.left, far = node.right;
+			if (Aabb::Merge(nodes[far].box, box).surfaceArea() - nodes[far].box.surfaceArea()
+				< Aabb::Merge(nodes[near].box, box).surfaceArea() - nodes[near].box.surfaceArea()) std::swap(near, far);
+			search.push_back(Candidate{ far, inherited });
+			search.push_back(Candidate{ near, inherited });
+		}
+	}
+
+	const int32_t sibling = index;
+	const int32_t oldParent = nodes[sibling].parent;
+	//allocate can grow the array, no references across it
+	const int32_t parent = allocate();
+	nodes[parent].parent = oldParent;
+	nodes[parent].box = Aabb::Merge(box, nodes[sibling].box);
+	nodes[parent].height = nodes[sibling].height + 1;
+	nodes[parent].left = sibling;
+	nodes[parent].right = leaf;
+	nodes[sibling].parent = parent;
+	nodes[leaf].parent = parent;
+
+	if (oldParent == Null) root = parent;
+	else if (nodes[oldParent].left == sibling) nodes[oldParent].left = parent;
+	else nodes[oldParent].right = parent;
+
+	//the new parent pairs a leaf with a sibling of any height, so it may need a rotation itself
+	const int32_t top = balance(parent);
+	refitUp(nodes[top].parent);
+}
+
+void AabbTree::removeLeaf(int32_t leaf) {
+	leaves--;
+	if (leaf == root) {
+		root = Null;
+		return;
+	}
+
+	//the parent goes away and the sibling takes its place
+	const int32_t parent = nodes[leaf].parent;
+	const int32_t grandParent = nodes[parent].parent;
+	const int32_t sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+	release(parent);
+
+	nodes[sibling].parent = grandParent;
+	if (grandParent == Null) {
+		root = sibling;
+		return;
+	}
+	if (nodes[grandParent].left == parent) nodes[grandParent].left = sibling;
+	else nodes[grandParent].right = sibling;
+	refitUp(grandParent);
+}
+
+void AabbTree::refitUp(int32_t index) {
+	while (index != Null) {
+		const int32_t top = balance(index);
+		Node& node = nodes[top];
+		const Aabb box = Aabb::Merge(nodes[node.left].box, nodes[node.right].box);
+		const int height = 1 + std::max(nodes[node.left].height, nodes[node.right].height);
+
+		//nothing above can change once a node comes out the same as before
+		if (top == index && height == node.height && SameBox(box, node.box)) return;
+
+		node.box = box;
+		node.height = height;
+		index = node.parent;
+	}
+}
+
+int32_t AabbTree::balance(int32_t iA) {
+	Node& a = nodes[iA];
+	if (a.isLeaf()) return iA;
+
+	const int32_t iB = a.left, iC = a.right;
+	Node& b = nodes[iB];
+	Node& c = nodes[iC];
+	const int difference = c.height - b.height;
+	if (difference >= -1 && difference <= 1) return iA;
+
+	//rotate the taller child up into A's place, A keeps the shorter child and the shorter
+	//grandchild, the taller grandchild stays with the child that moved up
+	const bool rightTaller = difference > 1;
+	const int32_t iUp = rightTaller ? iC : iB;
+	const int32_t iStay = rightTaller ? iB : iC;
+	Node& up = nodes[iUp];
+	const int32_t iF = up.left, iG = up.right;
+	const int32_t iTall = nodes[iF].height > nodes[iG].height ? iF : iG;
+	const int32_t iShort = iTall == iF ? iG : iF;
+
+	up.parent = a.parent;
+	a.parent = iUp;
+	if (up.parent == Null) root = iUp;
+	else if (nodes[up.parent].left == iA) nodes[up.parent].left = iUp;
+	else nodes[up.parent].right = iUp;
+
+	up.left = iA;
+	up.right = iTall;
+	if (rightTaller) a.right = iShort;
+	else a.left = iShort;
+	nodes[iShort].parent = iA;
+
+	a.box = Aabb::Merge(nodes[iStay].box, nodes[iShort].box);
+	a.height = 1 + std::max(nodes[iStay].height, nodes[iShort].height);
+	up.box = Aabb::Merge(a.box, nodes[iTall].box);
+	up.height = 1 + std::max(a.height, nodes[iTall].height);
+	return iUp;
+}
+
+float AabbTree::areaRatio() const {
+	if (root == Null) return 0;
+	const float rootArea = nodes[root].box.surfaceArea();
+	float total = 0;
+	for (const Node& node : nodes) {
+		if (node.height > 0) total += node.box.surfaceArea();
+	}
+	return rootArea > 0 ? total / rootArea : 0;
+}
+
+bool AabbTree::validate() const {
+	if (root == Null) return leaves == 0;
+	if (nodes[root].parent != Null) return false;
+	return validate(root, Null);
+}
+
+bool AabbTree::validate(int32_t index, int32_t parent) const {
+	const Node& node = nodes[index];
+	if (node.parent != parent) return false;
+	if (node.isLeaf()) return node.right == Null && node.height == 0;
+
+	const Node& left = nodes[node.left];
+	const Node& right = nodes[node.right];
+	if (node.height != 1 + std::max(left.height, right.height)) return false;
+	if (!node.box.contains(left.box) || !node.box.contains(right.box)) return false;
+	return validate(node.left, index) && validate(node.right, index);
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Aabb.h"
+#include "MyVector.h"
+
+namespace P6 {
+	//Dynamic bounding volume tree, the incremental kind used by Box2D and Bullet's btDbvt.
+	//Leaves hold a box and a user value, inner nodes the union of their two children. Leaves are
+	//stored fattened by a margin, so a proxy that moves a little stays inside its fat box and costs
+	//nothing; only when it escapes is it removed and reinserted. Insertion searches for the sibling
+	//that grows the total surface area of the tree the least, then refits the boxes on the way back
+	//up and rotates wherever one side got two levels taller than the other, so the tree stays about
+	//log2(n) deep and a query visits O(log n + hits) nodes.
+	//Nodes live in one array with a free list, proxies are node indices and stay valid until removed.
+	class AabbTree {
+		public:
+			static constexpr int32_t Null = -1;
+
+			//margin 0 stores exact boxes, for things that never move
+			explicit AabbTree(float margin = 0.1f);
+
+			int32_t insert(const Aabb& box, uint32_t userData);
+			void remove(int32_t proxy);
+
+			//the new exact box of a proxy, and how far it moved since the last call
+			//returns true when the proxy left its fat box and was reinserted; the new fat box is
+			//stretched along the displacement, so a steadily moving proxy predicts its next step
+			bool move(int32_t proxy, const Aabb& box, const MyVector& displacement);
+
+			const Aabb& fatBox(int32_t proxy) const { return nodes[proxy].box; }
+			uint32_t userData(int32_t proxy) const { return nodes[proxy].userData; }
+
+			//calls visit(proxy) for every leaf whose fat box overlaps box, stops when it returns false
+			template <typename Visit>
+			void query(const Aabb& box, Visit&& visit) const;
+			//calls visit(proxy) for every leaf, depth first, so neighbours in the tree come one after another
+			template <typename Visit>
+			void forEachLeaf(Visit&& visit) const;
+
+			size_t proxyCount() const { return leaves; }
+			//0 for a single leaf
+			int height() const { return root == Null ? 0 : nodes[root].height; }
+			//sum of inner node areas over the root area, lower is a better tree
+			float areaRatio() const;
+			//checks links, heights and that every parent contains its children
+			bool validate() const;
+
+			void clear();
+
+		private:
+			struct Node {
+				Aabb box;
+				//next free node while in the free list
+				int32_t parent = Null;
+				int32_t left = Null;
+				int32_t right = Null;
+				//0 for leaves, -1 while free
+				int height = -1;
+				uint32_t userData = 0;
+
+				bool isLeaf() const { return left == Null; }
+			};
+
+			int32_t allocate();
+			void release(int32_t node);
+
+			void insertLeaf(int32_t leaf);
+			void removeLeaf(int32_t leaf);
+			//refits and rebalances from node up to the root
+			void refitUp(int32_t node);
+			//returns the new root of the subtree, a when it was already balanced
+			int32_t balance(int32_t a);
+
+			bool validate(int32_t node, int32_t parent) const;
+
+			//a subtree to look at during insertion, with the area growth its ancestors would take
+			struct Candidate {
+				int32_t node;
+				float inherited;
+			};
+
+			std::vector<Node> nodes;
+			int32_t root = Null;
+			int32_t freeList = Null;
+			size_t leaves = 0;
+			float margin;
+			std::vector<Candidate> search;
+	};
+
+	template <typename Visit>
+	void AabbTree::query(const Aabb& box, Visit&& visit) const {
+		//the tree stays balanced, so the stack never gets close to this deep
+		int32_t stack[256];
+		int top = 0;
+		if (root != Null) stack[top++] = root;
+
+		while (top > 0) {
+			const Node& node = nodes[stack[--top]];
+			if (!node.box.overlaps(box)) continue;
+
+			if (node.isLeaf()) {
+				if (!visit(static_cast<int32_t>(&node - nodes.data()))) return;
+			}
+			else {
+				stack[top++] = node.left;
+				stack[top++] = node.right;
+			}
+		}
+	}
+
+	template <typename Visit>
+	void AabbTree::forEachLeaf(Visit&& visit) const {
+		int32_t stack[256];
+		int top = 0;
+		if (root != Null) stack[top++] = root;
+
+		while (top > 0) {
+			const int32_t index = stack[--top];
+			const Node& node = nodes[index];
+			if (node.isLeaf()) {
+				visit(index);
+			}
+			else {
+				stack[top++] = node.right;
+				stack[top++] = node.left;
+			}
+		}
+	}
+}
@@ -0,0 +1,61 @@
+#include "Boundaries.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+
+using namespace P6;
+
+namespace {
+	//particles per chunk: every boundary runs over a chunk while its columns are still in cache,
+	//and a multiple of the widest kernel so only the last chunk has a tail
+	const size_t Chunk = 4096;
+}
+
+size_t Boundaries::addPlane(const MyVector& normal, float offset, float restitution, float friction) {
+	const MyVector n = normal.Direction();
+	BoundaryPlane plane;
+	plane.nx = n.x;
+	plane.ny = n.y;
+	plane.nz = n.z;
+	plane.offset = offset;
+	plane.restitution = restitution;
+	plane.friction = friction;
+	planes.push_back(plane);
+	return planes.size() - 1;
+}
+
+size_t Boundaries::addBox(const Aabb& box, float restitution, float friction) {
+	BoundaryBox inside;
+	inside.minX = box.min.x;
+	inside.minY = box.min.y;
+	inside.minZ = box.min.z;
+	inside.maxX = box.max.x;
+	inside.maxY = box.max.y;
+	inside.maxZ = box.max.z;
+	inside.restitution = restitution;
+	inside.friction = friction;
+	boxes.push_back(inside);
+	return boxes.size() - 1;
+}
+
+void Boundaries::clear() {
+	planes.clear();
+	boxes.clear();
+}
+
+void Boundaries::apply(const ParticleStreams& streams, size_t count, float time, JobSystem* jobs) const {
+	if (empty() || count == 0) return;
+	const PlaneKernel collidePlane = PlaneKernelFor(ActiveSimdLevel());
+	const BoxKernel collideBox = BoxKernelFor(ActiveSimdLevel());
+
+	//every particle only sees its own columns, so the chunks can go in any order
+	auto body = [&](size_t begin, size_t end) {
+		for (size_t first = begin; first < end; first += Chunk) {
+			const size_t last = std::min(first + Chunk, end);
+			for (const BoundaryPlane& plane : planes) collidePlane(streams, first, last, plane, time);
+			for (const BoundaryBox& box : boxes) collideBox(streams, first, last, box, time);
+		}
+	};
+	if (jobs) jobs->parallelFor(count, Chunk, body);
+	else body(0, count);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Aabb.h"
+#include "BoundaryKernels.h"
+#include "MyVector.h"
+
+namespace P6 {
+	class JobSystem;
+
+	//World limits the particles bounce off: infinite planes they stay in front of and axis aligned
+	//boxes they stay inside. Every step runs them as one batched pass over the particle columns right
+	//after integration, before the contacts; a particle well inside a box costs a compare per side.
+	//They aren't contacts, so they don't tie particles into sleeping islands; a particle resting on a
+	//floor sleeps like any other. Works with or without setCollisions.
+	//
+	//	world.boundaries().addPlane(MyVector(0, 1, 0), -350.0f);
+	//	world.boundaries().addBox(Aabb(MyVector(-350, -350, -350), MyVector(350, 350, 350)), 0.8f, 0.1f);
+	class Boundaries {
+		public:
+			//keeps particles on the side the normal points to, at least their radius away from the plane
+			//through normal * offset; the normal is normalized here. Returns the plane's index
+			size_t addPlane(const MyVector& normal, float offset, float restitution = 0.5f, float friction = 0);
+			//keeps particles whole inside the box. Returns the box's index
+			size_t addBox(const Aabb& box, float restitution = 0.5f, float friction = 0);
+
+			size_t planeCount() const { return planes.size(); }
+			size_t boxCount() const { return boxes.size(); }
+			bool empty() const { return planes.empty() && boxes.empty(); }
+			//can be changed between steps
+			BoundaryPlane& plane(size_t index) { return planes[index]; }
+			BoundaryBox& box(size_t index) { return boxes[index]; }
+
+			void clear();
+
+			//pushes particles [0, count) back inside and bounces them, time is the step they just took
+			//with jobs the particles are split in fixed chunks, which doesn't change the result
+			void apply(const ParticleStreams& streams, size_t count, float time, JobSystem* jobs = nullptr) const;
+
+		private:
+			std::vector<BoundaryPlane> planes;
+			std::vector<BoundaryBox> boxes;
+	};
+}
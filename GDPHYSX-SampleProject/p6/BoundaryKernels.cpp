@@ -0,0 +1,87 @@
+#include "BoundaryKernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace P6;
+
+PlaneKernel P6::PlaneKernelFor(SimdLevel level) {
+	switch (level) {
+#if P6_KERNELS_X86
+	case SimdLevel::AVX512:
+	case SimdLevel::AVX2:
+		return Kernels::CollidePlaneAVX2;
+	case SimdLevel::SSE2:
+		return Kernels::CollidePlaneSSE2;
+#endif
+	default:
+		return Kernels::CollidePlaneScalar;
+	}
+}
+
+BoxKernel P6::BoxKernelFor(SimdLevel level) {
+	switch (level) {
+#if P6_KERNELS_X86
+	case SimdLevel::AVX512:
+	case SimdLevel::AVX2:
+		return Kernels::CollideBoxAVX2;
+	case SimdLevel::SSE2:
+		return Kernels::CollideBoxSSE2;
+#endif
+	default:
+		return Kernels::CollideBoxScalar;
+	}
+}
+
+namespace {
+	//one particle against one plane, the SIMD kernels take the same steps in the same order
+	inline void Collide(const ParticleStreams& s, size_t i, float nx, float ny, float nz, float offset, float restitution, float friction, float time) {
+		const float penetration = (offset + s.radius[i]) - ((nx * s.posX[i] + ny * s.posY[i]) + nz * s.posZ[i]);
+		if (!(penetration > 0)) return;
+		s.posX[i] = s.posX[i] + nx * penetration;
+		s.posY[i] = s.posY[i] + ny * penetration;
+		s.posZ[i] = s.posZ[i] + nz * penetration;
+
+		const float vx = s.velX[i], vy = s.velY[i], vz = s.velZ[i];
+		const float vn = (nx * vx + ny * vy) + nz * vz;
+		if (!(vn < 0)) return;
+
+		//closing speed that only this step's acceleration built up isn't bounced, the constant one plus the forces'
+		const float ax = s.accX[i] + s.forceX[i] * s.invMass[i];
+		const float ay = s.accY[i] + s.forceY[i] * s.invMass[i];
+		const float az = s.accZ[i] + s.forceZ[i] * s.invMass[i];
+		const float accelerationCaused = ((nx * ax + ny * ay) + nz * az) * time;
+		float bounce = (0.0f - vn) * restitution;
+		if (accelerationCaused < 0) bounce = std::max(0.0f, bounce + restitution * accelerationCaused);
+
+		//friction takes at most friction times the normal change off the sliding speed
+		const float tx = vx - vn * nx, ty = vy - vn * ny, tz = vz - vn * nz;
+		const float slide = std::sqrt((tx * tx + ty * ty) + tz * tz);
+		const float limit = friction * (bounce - vn);
+		const float keep = slide > limit ? 1.0f - limit / slide : 0.0f;
+
+		s.velX[i] = tx * keep + nx * bounce;
+		s.velY[i] = ty * keep + ny * bounce;
+		s.velZ[i] = tz * keep + nz * bounce;
+	}
+}
+
+void Kernels::CollidePlaneScalar(const ParticleStreams& s, size_t begin, size_t end, const BoundaryPlane& plane, float time) {
+	for (size_t i = begin; i < end; i++) {
+		if (!s.active[i] || !(s.invMass[i] > 0)) continue;
+		Collide(s, i, plane.nx, plane.ny, plane.nz, plane.offset, plane.restitution, plane.friction, time);
+	}
+}
+
+void Kernels::CollideBoxScalar(const ParticleStreams& s, size_t begin, size_t end, const BoundaryBox& box, float time) {
+	const float e = box.restitution, mu = box.friction;
+	for (size_t i = begin; i < end; i++) {
+		if (!s.active[i] || !(s.invMass[i] > 0)) continue;
+		Collide(s, i, 1, 0, 0, box.minX, e, mu, time);
+		Collide(s, i, -1, 0, 0, -box.maxX, e, mu, time);
+		Collide(s, i, 0, 1, 0, box.minY, e, mu, time);
+		Collide(s, i, 0, -1, 0, -box.maxY, e, mu, time);
+		Collide(s, i, 0, 0, 1, box.minZ, e, mu, time);
+		Collide(s, i, 0, 0, -1, -box.maxZ, e, mu, time);
+	}
+}
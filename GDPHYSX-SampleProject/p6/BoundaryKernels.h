@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+
+#include "ParticleKernels.h"
+#include "ParticleStreams.h"
+
+namespace P6 {
+	//a half-space the particles are kept in: n.p >= offset + radius, n unit length
+	struct BoundaryPlane {
+		float nx = 0, ny = 1, nz = 0;
+		float offset = 0;
+		//0 stops them dead, 1 bounces back with the full speed
+		float restitution = 0.5f;
+		//Coulomb coefficient, the sliding speed taken away is at most friction times the bounce
+		float friction = 0;
+	};
+
+	//an axis aligned box the particles are kept inside, its six sides are planes facing in
+	struct BoundaryBox {
+		float minX = 0, minY = 0, minZ = 0;
+		float maxX = 0, maxY = 0, maxZ = 0;
+		float restitution = 0.5f;
+		float friction = 0;
+	};
+
+	//Keeps particles [begin, end) on the inside: a sphere that went through is put back onto the
+	//surface, and if it was still heading out its normal speed is bounced back by the restitution and
+	//its sliding speed is cut by friction times the change. Like ParticleContact::resolveVelocity,
+	//speed the step's acceleration built up isn't bounced, the constant one plus the accumulated forces'
+	//(gravity bound through the ForceRegistry), so particles come to rest on a floor instead of hopping.
+	//Inactive and immovable particles are left alone.
+	//The box kernel does its six sides in one pass over the particles: x low, x high, y, z.
+	typedef void (*PlaneKernel)(const ParticleStreams& streams, size_t begin, size_t end, const BoundaryPlane& plane, float time);
+	typedef void (*BoxKernel)(const ParticleStreams& streams, size_t begin, size_t end, const BoundaryBox& box, float time);
+
+	//the kernels for a level; AVX-512 gets the AVX2 ones, the pass is bound by memory
+	PlaneKernel PlaneKernelFor(SimdLevel level);
+	BoxKernel BoxKernelFor(SimdLevel level);
+
+	//SSE2 does the scalar kernels' operations in the same order and is bit-identical;
+	//AVX2 fuses multiply-adds, so positions and velocities may differ in the last few ulp
+	namespace Kernels {
+		void CollidePlaneScalar(const ParticleStreams& streams, size_t begin, size_t end, const BoundaryPlane& plane, float time);
+		void CollideBoxScalar(const ParticleStreams& streams, size_t begin, size_t end, const BoundaryBox& box, float time);
+#if P6_KERNELS_X86
+		void CollidePlaneSSE2(const ParticleStreams& streams, size_t begin, size_t end, const BoundaryPlane& plane, float time);
+		void CollideBoxSSE2(const ParticleStreams& streams, size_t begin, size_t end, const BoundaryBox& box, float time);
+		void CollidePlaneAVX2(const ParticleStreams& streams, size_t begin, size_t end, const BoundaryPlane& plane, float time);
+		void CollideBoxAVX2(const ParticleStreams& streams, size_t begin, size_t end, const BoundaryBox& box, float time);
+#endif
+	}
+}
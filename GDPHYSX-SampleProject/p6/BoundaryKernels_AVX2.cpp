@@ -0,0 +1,143 @@
+#include "BoundaryKernels.h"
+
+#if P6_KERNELS_X86
+
+#include <immintrin.h>
+
+using namespace P6;
+
+namespace {
+	//one plane in every lane
+	struct Plane {
+		__m256 nx, ny, nz, offset, restitution, friction;
+	};
+
+	P6_TARGET_AVX2 inline Plane Broadcast(float nx, float ny, float nz, float offset, float restitution, float friction) {
+		return Plane{ _mm256_set1_ps(nx), _mm256_set1_ps(ny), _mm256_set1_ps(nz), _mm256_set1_ps(offset), _mm256_set1_ps(restitution), _mm256_set1_ps(friction) };
+	}
+
+	P6_TARGET_AVX2 inline __m256 Select(__m256 mask, __m256 a, __m256 b) {
+		return _mm256_blendv_ps(b, a, mask);
+	}
+
+	//eight particles loaded once and pushed back by any number of planes
+	//velocities and accelerations are only loaded once something is hit
+	struct Lanes {
+		__m256 px, py, pz, radius;
+		//active and with mass
+		__m256 movable;
+		bool moving;
+		__m256 vx, vy, vz, ax, ay, az;
+	};
+
+	P6_TARGET_AVX2 inline bool Load(const ParticleStreams& s, size_t i, Lanes& l) {
+		const __m256i active = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(s.active + i)));
+		const __m256 inactive = _mm256_castsi256_ps(_mm256_cmpeq_epi32(active, _mm256_setzero_si256()));
+		l.movable = _mm256_andnot_ps(inactive, _mm256_cmp_ps(_mm256_loadu_ps(s.invMass + i), _mm256_setzero_ps(), _CMP_GT_OQ));
+		if (_mm256_movemask_ps(l.movable) == 0) return false;
+
+		l.px = _mm256_loadu_ps(s.posX + i); l.py = _mm256_loadu_ps(s.posY + i); l.pz = _mm256_loadu_ps(s.posZ + i);
+		l.radius = _mm256_loadu_ps(s.radius + i);
+		l.moving = false;
+		return true;
+	}
+
+	P6_TARGET_AVX2 inline void LoadMotion(const ParticleStreams& s, size_t i, Lanes& l) {
+		l.vx = _mm256_loadu_ps(s.velX + i); l.vy = _mm256_loadu_ps(s.velY + i); l.vz = _mm256_loadu_ps(s.velZ + i);
+		//the constant acceleration plus the accumulated forces'
+		const __m256 invMass = _mm256_loadu_ps(s.invMass + i);
+		l.ax = _mm256_fmadd_ps(_mm256_loadu_ps(s.forceX + i), invMass, _mm256_loadu_ps(s.accX + i));
+		l.ay = _mm256_fmadd_ps(_mm256_loadu_ps(s.forceY + i), invMass, _mm256_loadu_ps(s.accY + i));
+		l.az = _mm256_fmadd_ps(_mm256_loadu_ps(s.forceZ + i), invMass, _mm256_loadu_ps(s.accZ + i));
+		l.moving = true;
+	}
+
+	P6_TARGET_AVX2 inline void Store(const ParticleStreams& s, size_t i, const Lanes& l) {
+		_mm256_storeu_ps(s.posX + i, l.px); _mm256_storeu_ps(s.posY + i, l.py); _mm256_storeu_ps(s.posZ + i, l.pz);
+		_mm256_storeu_ps(s.velX + i, l.vx); _mm256_storeu_ps(s.velY + i, l.vy); _mm256_storeu_ps(s.velZ + i, l.vz);
+	}
+
+	//the steps of the SSE2 Collide with fused multiply-adds, returns whether any lane was touched
+	P6_TARGET_AVX2 inline bool Collide(const ParticleStreams& s, size_t i, Lanes& l, const Plane& p, __m256 time) {
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 distance = _mm256_fmadd_ps(p.nz, l.pz, _mm256_fmadd_ps(p.ny, l.py, _mm256_mul_ps(p.nx, l.px)));
+		const __m256 penetration = _mm256_sub_ps(_mm256_add_ps(p.offset, l.radius), distance);
+		const __m256 hit = _mm256_and_ps(l.movable, _mm256_cmp_ps(penetration, zero, _CMP_GT_OQ));
+		if (_mm256_movemask_ps(hit) == 0) return false;
+		if (!l.moving) LoadMotion(s, i, l);
+		l.px = Select(hit, _mm256_fmadd_ps(p.nx, penetration, l.px), l.px);
+		l.py = Select(hit, _mm256_fmadd_ps(p.ny, penetration, l.py), l.py);
+		l.pz = Select(hit, _mm256_fmadd_ps(p.nz, penetration, l.pz), l.pz);
+
+		const __m256 vn = _mm256_fmadd_ps(p.nz, l.vz, _mm256_fmadd_ps(p.ny, l.vy, _mm256_mul_ps(p.nx, l.vx)));
+		const __m256 closing = _mm256_and_ps(hit, _mm256_cmp_ps(vn, zero, _CMP_LT_OQ));
+		if (_mm256_movemask_ps(closing) == 0) return true;
+
+		const __m256 accelerationCaused = _mm256_mul_ps(_mm256_fmadd_ps(p.nz, l.az, _mm256_fmadd_ps(p.ny, l.ay, _mm256_mul_ps(p.nx, l.ax))), time);
+		__m256 bounce = _mm256_mul_ps(_mm256_sub_ps(zero, vn), p.restitution);
+		bounce = Select(_mm256_cmp_ps(accelerationCaused, zero, _CMP_LT_OQ), _mm256_max_ps(_mm256_fmadd_ps(p.restitution, accelerationCaused, bounce), zero), bounce);
+
+		const __m256 tx = _mm256_fnmadd_ps(vn, p.nx, l.vx);
+		const __m256 ty = _mm256_fnmadd_ps(vn, p.ny, l.vy);
+		const __m256 tz = _mm256_fnmadd_ps(vn, p.nz, l.vz);
+		const __m256 slide = _mm256_sqrt_ps(_mm256_fmadd_ps(tz, tz, _mm256_fmadd_ps(ty, ty, _mm256_mul_ps(tx, tx))));
+		const __m256 limit = _mm256_mul_ps(p.friction, _mm256_sub_ps(bounce, vn));
+		//0 / 0 where nothing slides, the mask throws it away
+		const __m256 keep = _mm256_and_ps(_mm256_cmp_ps(slide, limit, _CMP_GT_OQ), _mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_div_ps(limit, slide)));
+
+		l.vx = Select(closing, _mm256_fmadd_ps(tx, keep, _mm256_mul_ps(p.nx, bounce)), l.vx);
+		l.vy = Select(closing, _mm256_fmadd_ps(ty, keep, _mm256_mul_ps(p.ny, bounce)), l.vy);
+		l.vz = Select(closing, _mm256_fmadd_ps(tz, keep, _mm256_mul_ps(p.nz, bounce)), l.vz);
+		return true;
+	}
+}
+
+P6_TARGET_AVX2 void Kernels::CollidePlaneAVX2(const ParticleStreams& s, size_t begin, size_t end, const BoundaryPlane& plane, float time) {
+	const Plane p = Broadcast(plane.nx, plane.ny, plane.nz, plane.offset, plane.restitution, plane.friction);
+	const __m256 t = _mm256_set1_ps(time);
+
+	size_t i = begin;
+	for (; i + 8 <= end; i += 8) {
+		Lanes l;
+		if (Load(s, i, l) && Collide(s, i, l, p, t)) Store(s, i, l);
+	}
+
+	CollidePlaneSSE2(s, i, end, plane, time);
+}
+
+P6_TARGET_AVX2 void Kernels::CollideBoxAVX2(const ParticleStreams& s, size_t begin, size_t end, const BoundaryBox& box, float time) {
+	const float e = box.restitution, mu = box.friction;
+	const Plane sides[6] = {
+		Broadcast(1, 0, 0, box.minX, e, mu), Broadcast(-1, 0, 0, -box.maxX, e, mu),
+		Broadcast(0, 1, 0, box.minY, e, mu), Broadcast(0, -1, 0, -box.maxY, e, mu),
+		Broadcast(0, 0, 1, box.minZ, e, mu), Broadcast(0, 0, -1, -box.maxZ, e, mu)
+	};
+	const __m256 t = _mm256_set1_ps(time);
+	const __m256 low[3] = { _mm256_set1_ps(box.minX), _mm256_set1_ps(box.minY), _mm256_set1_ps(box.minZ) };
+	const __m256 high[3] = { _mm256_set1_ps(-box.maxX), _mm256_set1_ps(-box.maxY), _mm256_set1_ps(-box.maxZ) };
+	const __m256 zero = _mm256_setzero_ps();
+
+	size_t i = begin;
+	for (; i + 8 <= end; i += 8) {
+		Lanes l;
+		if (!Load(s, i, l)) continue;
+
+		//particles well inside are the common case: one compare per side says a side's penetration
+		//would come out positive, exactly as Collide works it out for an axis normal
+		const __m256 p[3] = { l.px, l.py, l.pz };
+		__m256 out = zero;
+		for (int axis = 0; axis < 3; axis++) {
+			out = _mm256_or_ps(out, _mm256_cmp_ps(_mm256_add_ps(low[axis], l.radius), p[axis], _CMP_GT_OQ));
+			out = _mm256_or_ps(out, _mm256_cmp_ps(_mm256_add_ps(high[axis], l.radius), _mm256_sub_ps(zero, p[axis]), _CMP_GT_OQ));
+		}
+		if (_mm256_movemask_ps(_mm256_and_ps(out, l.movable)) == 0) continue;
+
+		bool touched = false;
+		for (const Plane& side : sides) touched = Collide(s, i, l, side, t) || touched;
+		if (touched) Store(s, i, l);
+	}
+
+	CollideBoxSSE2(s, i, end, box, time);
+}
+
+#endif
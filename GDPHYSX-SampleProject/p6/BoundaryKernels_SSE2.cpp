@@ -0,0 +1,147 @@
+#include "BoundaryKernels.h"
+
+#if P6_KERNELS_X86
+
+#include <cstring>
+#include <emmintrin.h>
+
+using namespace P6;
+
+namespace {
+	//one plane in every lane
+	struct Plane {
+		__m128 nx, ny, nz, offset, restitution, friction;
+	};
+
+	P6_TARGET_SSE2 inline Plane Broadcast(float nx, float ny, float nz, float offset, float restitution, float friction) {
+		return Plane{ _mm_set1_ps(nx), _mm_set1_ps(ny), _mm_set1_ps(nz), _mm_set1_ps(offset), _mm_set1_ps(restitution), _mm_set1_ps(friction) };
+	}
+
+	P6_TARGET_SSE2 inline __m128 Select(__m128 mask, __m128 a, __m128 b) {
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+	//four particles loaded once and pushed back by any number of planes
+	//velocities and accelerations are only loaded once something is hit
+	struct Lanes {
+		__m128 px, py, pz, radius;
+		//active and with mass
+		__m128 movable;
+		bool moving;
+		__m128 vx, vy, vz, ax, ay, az;
+	};
+
+	P6_TARGET_SSE2 inline bool Load(const ParticleStreams& s, size_t i, Lanes& l) {
+		int bytes;
+		std::memcpy(&bytes, s.active + i, sizeof(bytes));
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i active = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+		const __m128 inactive = _mm_castsi128_ps(_mm_cmpeq_epi32(active, zero));
+		l.movable = _mm_andnot_ps(inactive, _mm_cmpgt_ps(_mm_loadu_ps(s.invMass + i), _mm_setzero_ps()));
+		if (_mm_movemask_ps(l.movable) == 0) return false;
+
+		l.px = _mm_loadu_ps(s.posX + i); l.py = _mm_loadu_ps(s.posY + i); l.pz = _mm_loadu_ps(s.posZ + i);
+		l.radius = _mm_loadu_ps(s.radius + i);
+		l.moving = false;
+		return true;
+	}
+
+	P6_TARGET_SSE2 inline void LoadMotion(const ParticleStreams& s, size_t i, Lanes& l) {
+		l.vx = _mm_loadu_ps(s.velX + i); l.vy = _mm_loadu_ps(s.velY + i); l.vz = _mm_loadu_ps(s.velZ + i);
+		//the constant acceleration plus the accumulated forces'
+		const __m128 invMass = _mm_loadu_ps(s.invMass + i);
+		l.ax = _mm_add_ps(_mm_loadu_ps(s.accX + i), _mm_mul_ps(_mm_loadu_ps(s.forceX + i), invMass));
+		l.ay = _mm_add_ps(_mm_loadu_ps(s.accY + i), _mm_mul_ps(_mm_loadu_ps(s.forceY + i), invMass));
+		l.az = _mm_add_ps(_mm_loadu_ps(s.accZ + i), _mm_mul_ps(_mm_loadu_ps(s.forceZ + i), invMass));
+		l.moving = true;
+	}
+
+	P6_TARGET_SSE2 inline void Store(const ParticleStreams& s, size_t i, const Lanes& l) {
+		_mm_storeu_ps(s.posX + i, l.px); _mm_storeu_ps(s.posY + i, l.py); _mm_storeu_ps(s.posZ + i, l.pz);
+		_mm_storeu_ps(s.velX + i, l.vx); _mm_storeu_ps(s.velY + i, l.vy); _mm_storeu_ps(s.velZ + i, l.vz);
+	}
+
+	//the scalar Collide on four lanes, returns whether any lane was touched
+	P6_TARGET_SSE2 inline bool Collide(const ParticleStreams& s, size_t i, Lanes& l, const Plane& p, __m128 time) {
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p.nx, l.px), _mm_mul_ps(p.ny, l.py)), _mm_mul_ps(p.nz, l.pz));
+		const __m128 penetration = _mm_sub_ps(_mm_add_ps(p.offset, l.radius), distance);
+		const __m128 hit = _mm_and_ps(l.movable, _mm_cmpgt_ps(penetration, zero));
+		if (_mm_movemask_ps(hit) == 0) return false;
+		if (!l.moving) LoadMotion(s, i, l);
+		l.px = Select(hit, _mm_add_ps(l.px, _mm_mul_ps(p.nx, penetration)), l.px);
+		l.py = Select(hit, _mm_add_ps(l.py, _mm_mul_ps(p.ny, penetration)), l.py);
+		l.pz = Select(hit, _mm_add_ps(l.pz, _mm_mul_ps(p.nz, penetration)), l.pz);
+
+		const __m128 vn = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p.nx, l.vx), _mm_mul_ps(p.ny, l.vy)), _mm_mul_ps(p.nz, l.vz));
+		const __m128 closing = _mm_and_ps(hit, _mm_cmplt_ps(vn, zero));
+		if (_mm_movemask_ps(closing) == 0) return true;
+
+		const __m128 accelerationCaused = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(p.nx, l.ax), _mm_mul_ps(p.ny, l.ay)), _mm_mul_ps(p.nz, l.az)), time);
+		__m128 bounce = _mm_mul_ps(_mm_sub_ps(zero, vn), p.restitution);
+		bounce = Select(_mm_cmplt_ps(accelerationCaused, zero), _mm_max_ps(_mm_add_ps(bounce, _mm_mul_ps(p.restitution, accelerationCaused)), zero), bounce);
+
+		const __m128 tx = _mm_sub_ps(l.vx, _mm_mul_ps(vn, p.nx));
+		const __m128 ty = _mm_sub_ps(l.vy, _mm_mul_ps(vn, p.ny));
+		const __m128 tz = _mm_sub_ps(l.vz, _mm_mul_ps(vn, p.nz));
+		const __m128 slide = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, tx), _mm_mul_ps(ty, ty)), _mm_mul_ps(tz, tz)));
+		const __m128 limit = _mm_mul_ps(p.friction, _mm_sub_ps(bounce, vn));
+		//0 / 0 where nothing slides, the mask throws it away
+		const __m128 keep = _mm_and_ps(_mm_cmpgt_ps(slide, limit), _mm_sub_ps(_mm_set1_ps(1.0f), _mm_div_ps(limit, slide)));
+
+		l.vx = Select(closing, _mm_add_ps(_mm_mul_ps(tx, keep), _mm_mul_ps(p.nx, bounce)), l.vx);
+		l.vy = Select(closing, _mm_add_ps(_mm_mul_ps(ty, keep), _mm_mul_ps(p.ny, bounce)), l.vy);
+		l.vz = Select(closing, _mm_add_ps(_mm_mul_ps(tz, keep), _mm_mul_ps(p.nz, bounce)), l.vz);
+		return true;
+	}
+}
+
+P6_TARGET_SSE2 void Kernels::CollidePlaneSSE2(const ParticleStreams& s, size_t begin, size_t end, const BoundaryPlane& plane, float time) {
+	const Plane p = Broadcast(plane.nx, plane.ny, plane.nz, plane.offset, plane.restitution, plane.friction);
+	const __m128 t = _mm_set1_ps(time);
+
+	size_t i = begin;
+	for (; i + 4 <= end; i += 4) {
+		Lanes l;
+		if (Load(s, i, l) && Collide(s, i, l, p, t)) Store(s, i, l);
+	}
+
+	CollidePlaneScalar(s, i, end, plane, time);
+}
+
+P6_TARGET_SSE2 void Kernels::CollideBoxSSE2(const ParticleStreams& s, size_t begin, size_t end, const BoundaryBox& box, float time) {
+	const float e = box.restitution, mu = box.friction;
+	const Plane sides[6] = {
+		Broadcast(1, 0, 0, box.minX, e, mu), Broadcast(-1, 0, 0, -box.maxX, e, mu),
+		Broadcast(0, 1, 0, box.minY, e, mu), Broadcast(0, -1, 0, -box.maxY, e, mu),
+		Broadcast(0, 0, 1, box.minZ, e, mu), Broadcast(0, 0, -1, -box.maxZ, e, mu)
+	};
+	const __m128 t = _mm_set1_ps(time);
+	const __m128 low[3] = { _mm_set1_ps(box.minX), _mm_set1_ps(box.minY), _mm_set1_ps(box.minZ) };
+	const __m128 high[3] = { _mm_set1_ps(-box.maxX), _mm_set1_ps(-box.maxY), _mm_set1_ps(-box.maxZ) };
+	const __m128 zero = _mm_setzero_ps();
+
+	size_t i = begin;
+	for (; i + 4 <= end; i += 4) {
+		Lanes l;
+		if (!Load(s, i, l)) continue;
+
+		//particles well inside are the common case: one compare per side says a side's penetration
+		//would come out positive, exactly as Collide works it out for an axis normal
+		const __m128 p[3] = { l.px, l.py, l.pz };
+		__m128 out = zero;
+		for (int axis = 0; axis < 3; axis++) {
+			out = _mm_or_ps(out, _mm_cmpgt_ps(_mm_add_ps(low[axis], l.radius), p[axis]));
+			out = _mm_or_ps(out, _mm_cmpgt_ps(_mm_add_ps(high[axis], l.radius), _mm_sub_ps(zero, p[axis])));
+		}
+		if (_mm_movemask_ps(_mm_and_ps(out, l.movable)) == 0) continue;
+
+		bool touched = false;
+		for (const Plane& side : sides) touched = Collide(s, i, l, side, t) || touched;
+		if (touched) Store(s, i, l);
+	}
+
+	CollideBoxScalar(s, i, end, box, time);
+}
+
+#endif
@@ -0,0 +1,323 @@
+#include "ClothSolver.h"
+#include "JobSystem.h"
+#include "ParticleWorld.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace P6;
+
+namespace {
+	//constraints and particles per chunk of the parallel passes
+	const size_t Grain = 2048;
+}
+
+size_t ClothSolver::addGrid(ParticleWorld& world, size_t columns, size_t rows, const MyVector& corner, const MyVector& across,
+	const MyVector& down, const P6Particle& prototype) {
+	const size_t count = columns * rows;
+	if (count == 0 || world.size() + count > world.capacity()) return NotFound;
+
+	Grid grid;
+	grid.first = memberHandle.size();
+	grid.columns = columns;
+	grid.rows = rows;
+	std::vector<MyVector> at(count);
+	for (size_t row = 0; row < rows; row++) {
+		for (size_t column = 0; column < columns; column++) {
+			P6Particle particle = prototype;
+			particle.Position = corner + across * static_cast<float>(column) + down * static_cast<float>(row);
+			at[row * columns + column] = particle.Position;
+			memberHandle.push_back(world.spawn(particle));
+		}
+	}
+
+	//stretch, shear then bend, each in grid order
+	auto local = [&](size_t column, size_t row) { return static_cast<uint32_t>(grid.first + row * columns + column); };
+	auto tie = [&](size_t c0, size_t r0, size_t c1, size_t r1, Kind type) {
+		addConstraint(local(c0, r0), local(c1, r1), type, at[r0 * columns + c0], at[r1 * columns + c1]);
+	};
+	for (size_t row = 0; row < rows; row++) {
+		for (size_t column = 0; column < columns; column++) {
+			if (column + 1 < columns) tie(column, row, column + 1, row, Stretch);
+			if (row + 1 < rows) tie(column, row, column, row + 1, Stretch);
+		}
+	}
+	for (size_t row = 0; row + 1 < rows; row++) {
+		for (size_t column = 0; column + 1 < columns; column++) {
+			tie(column, row, column + 1, row + 1, Shear);
+			tie(column + 1, row, column, row + 1, Shear);
+		}
+	}
+	for (size_t row = 0; row < rows; row++) {
+		for (size_t column = 0; column < columns; column++) {
+			if (column + 2 < columns) tie(column, row, column + 2, row, Bend);
+			if (row + 2 < rows) tie(column, row, column, row + 2, Bend);
+		}
+	}
+
+	cloths.push_back(grid);
+	adjacencyDirty = true;
+	located = false;
+	return cloths.size() - 1;
+}
+
+void ClothSolver::addConstraint(uint32_t a, uint32_t b, Kind type, const MyVector& pa, const MyVector& pb) {
+	constraintA.push_back(a);
+	constraintB.push_back(b);
+	rest.push_back((pb - pa).Magnitude());
+	kind.push_back(type);
+}
+
+ParticleHandle ClothSolver::particle(size_t cloth, size_t column, size_t row) const {
+	const Grid& grid = cloths[cloth];
+	return memberHandle[grid.first + row * grid.columns + column];
+}
+
+uint32_t ClothSolver::pin(size_t cloth, size_t column, size_t row, const MyVector& at) {
+	const Grid& grid = cloths[cloth];
+	pinMember.push_back(static_cast<uint32_t>(grid.first + row * grid.columns + column));
+	pinX.push_back(at.x);
+	pinY.push_back(at.y);
+	pinZ.push_back(at.z);
+	return static_cast<uint32_t>(pinMember.size() - 1);
+}
+
+void ClothSolver::movePin(uint32_t pin, const MyVector& at) {
+	pinX[pin] = at.x;
+	pinY[pin] = at.y;
+	pinZ[pin] = at.z;
+}
+
+void ClothSolver::setStiffness(float stretch, float shear, float bend) {
+	stretchStiffness = stretch;
+	shearStiffness = shear;
+	bendStiffness = bend;
+}
+
+void ClothSolver::clear() {
+	cloths.clear();
+	memberHandle.clear();
+	memberIndex.clear();
+	constraintA.clear();
+	constraintB.clear();
+	rest.clear();
+	kind.clear();
+	live.clear();
+	pinMember.clear();
+	pinX.clear();
+	pinY.clear();
+	pinZ.clear();
+	adjacencyDirty = true;
+	located = false;
+}
+
+void ClothSolver::locate(const ParticleWorld& world) {
+	if (located && locatedWorld == &world && locatedLayout == world.layoutVersion()) return;
+
+	memberIndex.resize(memberHandle.size());
+	for (size_t m = 0; m < memberHandle.size(); m++) {
+		const size_t index = world.indexOf(memberHandle[m]);
+		memberIndex[m] = index == ParticleWorld::NotFound ? None : static_cast<uint32_t>(index);
+	}
+	live.resize(constraintA.size());
+	for (size_t c = 0; c < constraintA.size(); c++) {
+		live[c] = memberIndex[constraintA[c]] != None && memberIndex[constraintB[c]] != None ? 1 : 0;
+	}
+	located = true;
+	locatedWorld = &world;
+	locatedLayout = world.layoutVersion();
+}
+
+void ClothSolver::buildAdjacency() {
+	const size_t count = memberHandle.size();
+	touchStart.assign(count + 1, 0);
+	for (size_t c = 0; c < constraintA.size(); c++) {
+		touchStart[constraintA[c] + 1]++;
+		touchStart[constraintB[c] + 1]++;
+	}
+	for (size_t m = 0; m < count; m++) touchStart[m + 1] += touchStart[m];
+
+	//the starts double as write cursors and get shifted back afterwards
+	touching.resize(touchStart[count]);
+	for (uint32_t c = 0; c < constraintA.size(); c++) {
+		touching[touchStart[constraintA[c]]++] = c * 2;
+		touching[touchStart[constraintB[c]]++] = c * 2 + 1;
+	}
+	for (size_t m = count; m > 0; m--) touchStart[m] = touchStart[m - 1];
+	touchStart[0] = 0;
+	adjacencyDirty = false;
+}
+
+void ClothSolver::projectGaussSeidel(const float* stiffness) {
+	const uint32_t* ca = constraintA.data();
+	const uint32_t* cb = constraintB.data();
+	const float* length = rest.data();
+	const uint8_t* type = kind.data();
+	const uint8_t* alive = live.data();
+	const float* w = weight.data();
+	float* x = px.data();
+	float* y = py.data();
+	float* z = pz.data();
+	for (size_t c = 0; c < constraintA.size(); c++) {
+		const uint32_t a = ca[c], b = cb[c];
+		const float wa = w[a], wb = w[b];
+		if (!alive[c] || wa + wb <= 0) continue;
+		const float dx = x[b] - x[a], dy = y[b] - y[a], dz = z[b] - z[a];
+		const float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+		if (!(distance > 0)) continue;
+		const float s = stiffness[type[c]] * (distance - length[c]) / (distance * (wa + wb));
+		x[a] += wa * s * dx;
+		y[a] += wa * s * dy;
+		z[a] += wa * s * dz;
+		x[b] -= wb * s * dx;
+		y[b] -= wb * s * dy;
+		z[b] -= wb * s * dz;
+	}
+}
+
+void ClothSolver::projectJacobi(const float* stiffness, JobSystem* jobs) {
+	const size_t constraints = constraintA.size();
+	const size_t count = memberHandle.size();
+	cx.resize(constraints);
+	cy.resize(constraints);
+	cz.resize(constraints);
+
+	//every constraint from the same positions, into its own slot
+	auto correct = [&](size_t begin, size_t end) {
+		const uint32_t* ca = constraintA.data();
+		const uint32_t* cb = constraintB.data();
+		const float* length = rest.data();
+		const uint8_t* type = kind.data();
+		const uint8_t* alive = live.data();
+		const float* w = weight.data();
+		const float* x = px.data();
+		const float* y = py.data();
+		const float* z = pz.data();
+		float* gx = cx.data();
+		float* gy = cy.data();
+		float* gz = cz.data();
+		for (size_t c = begin; c < end; c++) {
+			const uint32_t a = ca[c], b = cb[c];
+			const float dx = x[b] - x[a], dy = y[b] - y[a], dz = z[b] - z[a];
+			const float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+			const float total = w[a] + w[b];
+			const float s = alive[c] && total > 0 && distance > 0 ? stiffness[type[c]] * (distance - length[c]) / (distance * total) : 0.0f;
+			gx[c] = s * dx;
+			gy[c] = s * dy;
+			gz[c] = s * dz;
+		}
+	};
+
+	//each particle sums its own constraints' slots in adjacency order, no two chunks write the same particle;
+	//the sum is averaged over the constraints' stiffness, so the soft bend and shear ones don't dilute the stretch
+	auto gather = [&](size_t begin, size_t end) {
+		const uint32_t* start = touchStart.data();
+		const uint32_t* entry = touching.data();
+		const uint8_t* type = kind.data();
+		const uint8_t* alive = live.data();
+		const float* w = weight.data();
+		const float* gx = cx.data();
+		const float* gy = cy.data();
+		const float* gz = cz.data();
+		float* x = px.data();
+		float* y = py.data();
+		float* z = pz.data();
+		for (size_t m = begin; m < end; m++) {
+			if (w[m] <= 0) continue;
+			float sx = 0, sy = 0, sz = 0, share = 0;
+			for (uint32_t t = start[m]; t < start[m + 1]; t++) {
+				const uint32_t c = entry[t] >> 1;
+				if (!alive[c]) continue;
+				const float sign = entry[t] & 1 ? -1.0f : 1.0f;
+				sx += sign * gx[c];
+				sy += sign * gy[c];
+				sz += sign * gz[c];
+				share += stiffness[type[c]];
+			}
+			if (!(share > 0)) continue;
+			const float scale = relaxation * w[m] / share;
+			x[m] += scale * sx;
+			y[m] += scale * sy;
+			z[m] += scale * sz;
+		}
+	};
+
+	if (jobs) {
+		jobs->parallelFor(constraints, Grain, correct);
+		jobs->parallelFor(count, Grain, gather);
+	}
+	else {
+		correct(0, constraints);
+		gather(0, count);
+	}
+}
+
+void ClothSolver::solve(ParticleWorld& world, float time) {
+	const size_t count = memberHandle.size();
+	if (count == 0 || time <= 0) return;
+
+	locate(world);
+	if (adjacencyDirty) buildAdjacency();
+	px.resize(count);
+	py.resize(count);
+	pz.resize(count);
+	weight.resize(count);
+	held.assign(count, 0);
+	for (uint32_t m : pinMember) held[m] = 1;
+
+	const ParticleStreams& s = world.buffer().streams();
+	const size_t awake = world.awakeCount();
+	JobSystem* jobs = world.jobSystem();
+	auto forChunks = [&](const auto& body) {
+		if (jobs) jobs->parallelFor(count, Grain, body);
+		else body(0, count);
+	};
+
+	//into grid order; only awake, active particles with mass give way
+	forChunks([&](size_t begin, size_t end) {
+		for (size_t m = begin; m < end; m++) {
+			const uint32_t i = memberIndex[m];
+			if (i == None) {
+				weight[m] = 0;
+				continue;
+			}
+			px[m] = s.posX[i];
+			py[m] = s.posY[i];
+			pz[m] = s.posZ[i];
+			weight[m] = i < awake && s.active[i] && !held[m] ? s.invMass[i] : 0.0f;
+		}
+	});
+	for (size_t p = 0; p < pinMember.size(); p++) {
+		const uint32_t m = pinMember[p];
+		px[m] = pinX[p];
+		py[m] = pinY[p];
+		pz[m] = pinZ[p];
+	}
+
+	//a stiffness of k per solve is 1 - (1 - k)^(1 / n) per iteration
+	const float n = static_cast<float>(std::max(iterations, 1));
+	const float stiffness[3] = {
+		1.0f - std::pow(1.0f - std::min(stretchStiffness, 1.0f), 1.0f / n),
+		1.0f - std::pow(1.0f - std::min(shearStiffness, 1.0f), 1.0f / n),
+		1.0f - std::pow(1.0f - std::min(bendStiffness, 1.0f), 1.0f / n)
+	};
+	for (int iteration = 0; iteration < iterations; iteration++) {
+		if (method == ClothMode::Jacobi) projectJacobi(stiffness, jobs);
+		else projectGaussSeidel(stiffness);
+	}
+
+	//back into the world, the velocity is the whole move of the step
+	const float inverseTime = 1.0f / time;
+	forChunks([&](size_t begin, size_t end) {
+		for (size_t m = begin; m < end; m++) {
+			const uint32_t i = memberIndex[m];
+			if (i == None || i >= awake || (weight[m] <= 0 && !held[m])) continue;
+			s.posX[i] = px[m];
+			s.posY[i] = py[m];
+			s.posZ[i] = pz[m];
+			s.velX[i] = (px[m] - s.prevX[i]) * inverseTime;
+			s.velY[i] = (py[m] - s.prevY[i]) * inverseTime;
+			s.velZ[i] = (pz[m] - s.prevZ[i]) * inverseTime;
+		}
+	});
+}
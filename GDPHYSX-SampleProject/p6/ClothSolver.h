@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MyVector.h"
+#include "P6Particle.h"
+#include "ParticleHandle.h"
+
+namespace P6 {
+	class JobSystem;
+	class ParticleWorld;
+
+	enum class ClothMode {
+		//constraints one after the other, each sees the moves of the ones before; on the calling thread
+		GaussSeidel,
+		//every constraint from the same positions, then each particle takes the stiffness-weighted average of its moves;
+		//spread over the world's JobSystem
+		Jacobi
+	};
+
+	//Position-based cloth: grids of world particles held together by constraints on their positions
+	//instead of springs, so it stays stable at the normal step however stiff it is.
+	//Every step the world's integrator predicts the positions as usual; solve then copies the cloth
+	//particles into local columns in grid order, projects the constraints on them for a few iterations,
+	//writes them back and sets each velocity to how far the particle moved over the step. After that
+	//the boundaries and contacts see the cloth like any other particles. The constraints are distances
+	//along the grid lines (stretch), across its diagonals (shear) and to the particle after next (bend),
+	//plus pins that hold particles at a point.
+	//
+	//Jacobi runs without locks or atomics: a pass over the constraints writes each one's correction
+	//into its own slot, then a pass over the particles sums the slots of that particle's constraints
+	//in a fixed order. Both passes split over the JobSystem, and any thread count gives the same bits.
+	//It needs more iterations than Gauss-Seidel for the same stiffness; over-relaxation makes up some.
+	//
+	//A cloth sleeps and wakes as one island. Killed particles drop their constraints, sleeping or
+	//immovable ones hold the constraints on them like pins.
+	//
+	//	ClothSolver& cloth = world.cloth();
+	//	const size_t flag = cloth.addGrid(world, 64, 64, MyVector(0, 10, 0), MyVector(0.1f, 0, 0), MyVector(0, -0.1f, 0), particle);
+	//	cloth.pin(flag, 0, 0, MyVector(0, 10, 0));
+	//	cloth.setMode(ClothMode::Jacobi);
+	class ClothSolver {
+		public:
+			static constexpr size_t NotFound = static_cast<size_t>(-1);
+			//in members(), a particle that isn't alive any more
+			static constexpr uint32_t None = 0xFFFFFFFFu;
+
+			//spawns columns x rows particles like prototype, the one at (column, row) at corner + across * column + down * row,
+			//and ties them up; the rest lengths are the distances they start at
+			//returns the cloth's index, or NotFound when the world has no room for all of them (nothing is spawned then)
+			size_t addGrid(ParticleWorld& world, size_t columns, size_t rows, const MyVector& corner, const MyVector& across,
+				const MyVector& down, const P6Particle& prototype);
+
+			size_t clothCount() const { return cloths.size(); }
+			ParticleHandle particle(size_t cloth, size_t column, size_t row) const;
+
+			//holds the particle at a point; returns the pin's id, ids count up from 0
+			uint32_t pin(size_t cloth, size_t column, size_t row, const MyVector& at);
+			//can be moved between steps, the cloth follows; wake a sleeping cloth first
+			void movePin(uint32_t pin, const MyVector& at);
+
+			//per solve, 0 gives way completely and 1 is rigid; 1, 0.5 and 0.1 by default
+			//what an iteration uses is worked out from these, so changing the iterations keeps the feel
+			void setStiffness(float stretch, float shear, float bend);
+			//projections per step, 10 by default
+			void setIterations(int count) { iterations = count; }
+			void setMode(ClothMode mode) { method = mode; }
+			ClothMode mode() const { return method; }
+			//Jacobi moves a particle by this times its averaged correction, 1.5 by default; 1 is a plain average,
+			//up to about 2 converges faster, further overshoots
+			void setRelaxation(float omega) { relaxation = omega; }
+
+			size_t constraintCount() const { return constraintA.size(); }
+			bool empty() const { return cloths.empty(); }
+			void clear();
+
+			//projects the constraints on the positions the world just integrated, time is the step it took
+			//ParticleWorld::update calls it right after integrating
+			void solve(ParticleWorld& world, float time);
+
+			//looks the particles up in the world's current layout, only does work after it changed
+			void locate(const ParticleWorld& world);
+			//dense indices of a cloth's particles in grid order as of the last locate, None for dead ones
+			const uint32_t* members(size_t cloth) const { return memberIndex.data() + cloths[cloth].first; }
+			size_t memberCount(size_t cloth) const { return cloths[cloth].columns * cloths[cloth].rows; }
+
+		private:
+			struct Grid {
+				size_t first;
+				size_t columns;
+				size_t rows;
+			};
+			enum Kind : uint8_t { Stretch, Shear, Bend };
+
+			void addConstraint(uint32_t a, uint32_t b, Kind kind, const MyVector& pa, const MyVector& pb);
+			//per particle: its constraints and which end it is, counting sorted; built again after constraints are added
+			void buildAdjacency();
+			void projectGaussSeidel(const float* stiffness);
+			void projectJacobi(const float* stiffness, JobSystem* jobs);
+
+			std::vector<Grid> cloths;
+
+			//per particle, local index = position in these
+			std::vector<ParticleHandle> memberHandle;
+			std::vector<uint32_t> memberIndex;
+			//the working columns: positions, and the inverse mass the projection uses (0 for pinned, sleeping,
+			//immovable or dead particles)
+			std::vector<float> px, py, pz, weight;
+
+			//per constraint, over local indices
+			std::vector<uint32_t> constraintA, constraintB;
+			std::vector<float> rest;
+			std::vector<uint8_t> kind;
+			//0 once either end died, set by locate
+			std::vector<uint8_t> live;
+			//Jacobi: each constraint's correction per unit of inverse mass, its first end moves along it and the second against it
+			std::vector<float> cx, cy, cz;
+
+			//per particle: entries touchStart[i] to touchStart[i + 1] of touching, constraint index * 2 + 1 where it is the second end
+			std::vector<uint32_t> touchStart, touching;
+			bool adjacencyDirty = true;
+
+			std::vector<uint32_t> pinMember;
+			std::vector<float> pinX, pinY, pinZ;
+			//per particle, this solve: 1 for pinned
+			std::vector<uint8_t> held;
+
+			float stretchStiffness = 1.0f;
+			float shearStiffness = 0.5f;
+			float bendStiffness = 0.1f;
+			int iterations = 10;
+			ClothMode method = ClothMode::GaussSeidel;
+			float relaxation = 1.5f;
+
+			const ParticleWorld* locatedWorld = nullptr;
+			size_t locatedLayout = 0;
+			bool located = false;
+	};
+}
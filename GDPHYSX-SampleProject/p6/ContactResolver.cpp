@@ -0,0 +1,258 @@
+#include "ContactResolver.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+
+using namespace P6;
+
+ContactResolver::ContactResolver(size_t iterations) : iterations(iterations) {}
+
+void ContactResolver::place(uint32_t position, uint32_t contact) {
+	heap[position] = contact;
+	heapPosition[contact] = position;
+}
+
+void ContactResolver::siftUp(uint32_t position) {
+	const uint32_t contact = heap[position];
+	while (position > 0) {
+		const uint32_t parent = (position - 1) / 2;
+		if (key[heap[parent]] <= key[contact]) break;
+		place(position, heap[parent]);
+		position = parent;
+	}
+	place(position, contact);
+}
+
+void ContactResolver::siftDown(uint32_t position) {
+	const uint32_t contact = heap[position];
+	const uint32_t count = static_cast<uint32_t>(heap.size());
+	while (true) {
+		uint32_t child = position * 2 + 1;
+		if (child >= count) break;
+		if (child + 1 < count && key[heap[child + 1]] < key[heap[child]]) child++;
+		if (key[contact] <= key[heap[child]]) break;
+		place(position, heap[child]);
+		position = child;
+	}
+	place(position, contact);
+}
+
+void ContactResolver::heapBuild() {
+	const uint32_t count = static_cast<uint32_t>(arena.size());
+	heap.resize(count);
+	heapPosition.resize(count);
+	for (uint32_t i = 0; i < count; i++) place(i, i);
+	for (uint32_t i = count / 2; i > 0; i--) siftDown(i - 1);
+}
+
+void ContactResolver::heapUpdate(uint32_t contact, float newKey) {
+	const float oldKey = key[contact];
+	key[contact] = newKey;
+	if (newKey < oldKey) siftUp(heapPosition[contact]);
+	else siftDown(heapPosition[contact]);
+}
+
+void ContactResolver::buildAdjacency(size_t particleCount) {
+	touchStart.assign(particleCount + 1, 0);
+	for (const ParticleContact& contact : arena) {
+		touchStart[contact.a + 1]++;
+		if (contact.b != ParticleContact::None) touchStart[contact.b + 1]++;
+	}
+	for (size_t i = 0; i < particleCount; i++) touchStart[i + 1] += touchStart[i];
+
+	//the starts double as write cursors and get shifted back afterwards
+	touching.resize(touchStart[particleCount]);
+	for (uint32_t c = 0; c < arena.size(); c++) {
+		touching[touchStart[arena[c].a]++] = c;
+		if (arena[c].b != ParticleContact::None) touching[touchStart[arena[c].b]++] = c;
+	}
+	for (size_t i = particleCount; i > 0; i--) touchStart[i] = touchStart[i - 1];
+	touchStart[0] = 0;
+}
+
+void ContactResolver::resolve(const ParticleStreams& s, size_t particleCount, float time) {
+	velocityUsed = 0;
+	positionUsed = 0;
+	applied.assign(arena.size(), 0.0f);
+	if (arena.empty()) return;
+
+	const size_t budget = iterations > 0 ? iterations : arena.size() * 2;
+	buildAdjacency(particleCount);
+
+	//velocities, the contact closing fastest first
+	key.resize(arena.size());
+	for (size_t c = 0; c < arena.size(); c++) key[c] = arena[c].separatingVelocity(s);
+	heapBuild();
+
+	while (velocityUsed < budget) {
+		const uint32_t worst = heap[0];
+		if (key[worst] >= -velocityTolerance) break;
+
+		const ParticleContact& contact = arena[worst];
+		applied[worst] += contact.resolveVelocity(s, time);
+		velocityUsed++;
+
+		//only contacts on these two particles saw a velocity change
+		for (uint32_t particle : { contact.a, contact.b }) {
+			if (particle == ParticleContact::None) continue;
+			for (uint32_t t = touchStart[particle]; t < touchStart[particle + 1]; t++) {
+				heapUpdate(touching[t], arena[touching[t]].separatingVelocity(s));
+			}
+		}
+		//nothing could change it, e.g. two particles without mass
+		if (heap[0] == worst && key[worst] < -velocityTolerance) heapUpdate(worst, 0);
+	}
+
+	//penetrations, the deepest first; keyed negated so the same min-heap works
+	for (size_t c = 0; c < arena.size(); c++) key[c] = -arena[c].penetration;
+	heapBuild();
+
+	while (positionUsed < budget) {
+		const uint32_t worst = heap[0];
+		if (key[worst] >= -penetrationTolerance) break;
+
+		ParticleContact& contact = arena[worst];
+		MyVector moveA, moveB;
+		if (!contact.resolveInterpenetration(s, moveA, moveB)) {
+			heapUpdate(worst, 0);
+			continue;
+		}
+		positionUsed++;
+
+		//every contact on a moved particle is now deeper or shallower by the move along its normal
+		const uint32_t a = contact.a, b = contact.b;
+		for (uint32_t particle : { a, b }) {
+			if (particle == ParticleContact::None) continue;
+			const MyVector& move = particle == a ? moveA : moveB;
+			for (uint32_t t = touchStart[particle]; t < touchStart[particle + 1]; t++) {
+				ParticleContact& other = arena[touching[t]];
+				const float along = move.x * other.normal.x + move.y * other.normal.y + move.z * other.normal.z;
+				if (other.a == particle) other.penetration -= along;
+				else other.penetration += along;
+				heapUpdate(touching[t], -other.penetration);
+			}
+		}
+	}
+}
+
+void ContactResolver::buildColors(size_t particleCount) {
+	//64 colours fit the masks, a particle in more contacts than that spills into one last
+	//colour that runs on a single thread
+	const uint32_t Spill = 64;
+
+	colorMask.assign(particleCount, 0);
+	contactColor.resize(arena.size());
+	uint32_t colors = 0;
+	for (uint32_t c = 0; c < arena.size(); c++) {
+		const ParticleContact& contact = arena[c];
+		uint64_t used = colorMask[contact.a];
+		if (contact.b != ParticleContact::None) used |= colorMask[contact.b];
+
+		uint32_t color = 0;
+		while (color < Spill && (used >> color) & 1) color++;
+		contactColor[c] = color;
+		colors = std::max(colors, color + 1);
+		if (color == Spill) continue;
+
+		colorMask[contact.a] |= 1ull << color;
+		if (contact.b != ParticleContact::None) colorMask[contact.b] |= 1ull << color;
+	}
+
+	//counting sort by colour, contacts keep their order inside a colour
+	colorStart.assign(colors + 1, 0);
+	for (uint32_t color : contactColor) colorStart[color + 1]++;
+	for (uint32_t k = 0; k < colors; k++) colorStart[k + 1] += colorStart[k];
+	colorOrder.resize(arena.size());
+	for (uint32_t c = 0; c < arena.size(); c++) colorOrder[colorStart[contactColor[c]]++] = c;
+	for (uint32_t k = colors; k > 0; k--) colorStart[k] = colorStart[k - 1];
+	colorStart[0] = 0;
+}
+
+void ContactResolver::resolveColored(const ParticleStreams& s, size_t particleCount, float time, JobSystem& jobs) {
+	velocityUsed = 0;
+	positionUsed = 0;
+	colorStart.clear();
+	applied.assign(arena.size(), 0.0f);
+	if (arena.empty()) return;
+
+	buildColors(particleCount);
+	const size_t colors = colorStart.size() - 1;
+	const size_t Grain = 256;
+	//the spill colour shares particles, it is never split
+	auto grainOf = [&](size_t color) { return color == 64 ? colorStart[color + 1] - colorStart[color] : Grain; };
+
+	//velocities: whether a sweep touched anything is the same on every run, however it was split up
+	std::atomic<bool> changed(true);
+	while (changed.load() && velocityUsed < sweeps) {
+		changed.store(false);
+		for (size_t k = 0; k < colors; k++) {
+			const uint32_t* batch = colorOrder.data() + colorStart[k];
+			jobs.parallelFor(colorStart[k + 1] - colorStart[k], grainOf(k), [&](size_t begin, size_t end) {
+				bool any = false;
+				for (size_t i = begin; i < end; i++) {
+					const ParticleContact& contact = arena[batch[i]];
+					if (contact.separatingVelocity(s) >= -velocityTolerance) continue;
+					applied[batch[i]] += contact.resolveVelocity(s, time);
+					any = true;
+				}
+				if (any) changed.store(true, std::memory_order_relaxed);
+			});
+		}
+		velocityUsed++;
+	}
+
+	//penetrations: each contact reads how far its particles have moved since it was made
+	movedX.assign(particleCount, 0);
+	movedY.assign(particleCount, 0);
+	movedZ.assign(particleCount, 0);
+	changed.store(true);
+	while (changed.load() && positionUsed < sweeps) {
+		changed.store(false);
+		for (size_t k = 0; k < colors; k++) {
+			const uint32_t* batch = colorOrder.data() + colorStart[k];
+			jobs.parallelFor(colorStart[k + 1] - colorStart[k], grainOf(k), [&](size_t begin, size_t end) {
+				bool any = false;
+				for (size_t i = begin; i < end; i++) {
+					ParticleContact& contact = arena[batch[i]];
+					const uint32_t a = contact.a, b = contact.b;
+					float dx = movedX[a], dy = movedY[a], dz = movedZ[a];
+					if (b != ParticleContact::None) {
+						dx -= movedX[b];
+						dy -= movedY[b];
+						dz -= movedZ[b];
+					}
+
+					ParticleContact current = contact;
+					current.penetration -= dx * contact.normal.x + dy * contact.normal.y + dz * contact.normal.z;
+					if (current.penetration <= penetrationTolerance) continue;
+
+					MyVector moveA, moveB;
+					if (!current.resolveInterpenetration(s, moveA, moveB)) continue;
+					movedX[a] += moveA.x;
+					movedY[a] += moveA.y;
+					movedZ[a] += moveA.z;
+					if (b != ParticleContact::None) {
+						movedX[b] += moveB.x;
+						movedY[b] += moveB.y;
+						movedZ[b] += moveB.z;
+					}
+					any = true;
+				}
+				if (any) changed.store(true, std::memory_order_relaxed);
+			});
+		}
+		positionUsed++;
+	}
+
+	//leave the contacts with what is left of their overlap, like resolve does
+	for (ParticleContact& contact : arena) {
+		float dx = movedX[contact.a], dy = movedY[contact.a], dz = movedZ[contact.a];
+		if (contact.b != ParticleContact::None) {
+			dx -= movedX[contact.b];
+			dy -= movedY[contact.b];
+			dz -= movedZ[contact.b];
+		}
+		contact.penetration -= dx * contact.normal.x + dy * contact.normal.y + dz * contact.normal.z;
+	}
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ParticleContact.h"
+#include "ParticleStreams.h"
+
+namespace P6 {
+	class JobSystem;
+
+	//Holds the contacts of a step and resolves them one at a time, worst first.
+	//
+	//Contacts go into an arena that is cleared, not freed, between steps, and every work array
+	//below is kept the same way, so once it has seen its largest step resolve() never allocates.
+	//Velocities are resolved first: a heap keyed on separating velocity hands out the contact
+	//closing fastest, and after each impulse only the contacts sharing one of its two particles
+	//are re-keyed. Then penetrations the same way, deepest first, with the contacts that share a
+	//particle told how far it moved. Both passes stop early once nothing is closing or
+	//overlapping, or when the iteration budget runs out. A dense pile where everything overlaps
+	//has to spread out as a whole, which takes the position pass far more than the default budget;
+	//what is left over comes back as contacts the next step.
+	//
+	//	resolver.clear();
+	//	resolver.add(contact) ...
+	//	resolver.resolve(world.buffer().streams(), world.size(), dt);
+	//
+	//resolveColored is the multi-core version for big piles. It colours the contact graph greedily
+	//so that no two contacts of one colour share a particle, then sweeps colour by colour with each
+	//colour spread over the JobSystem. Contacts in a colour touch disjoint particles, so no locks are
+	//needed and the outcome doesn't depend on which thread ran what: any thread count gives the same
+	//bits. Within a sweep the order is fixed instead of worst first, and it stops after a sweep that
+	//had nothing left to fix.
+	class ContactResolver {
+		public:
+			//iterations 0 uses twice the number of contacts, for each of the two passes
+			explicit ContactResolver(size_t iterations = 0);
+
+			void setIterations(size_t count) { iterations = count; }
+			//closing speeds and overlaps below these count as resolved, a pile never gets them to exactly 0
+			void setTolerances(float velocity, float penetration) {
+				velocityTolerance = velocity;
+				penetrationTolerance = penetration;
+			}
+
+			void add(const ParticleContact& contact) { arena.push_back(contact); }
+			//drops the contacts, keeps the memory
+			void clear() { arena.clear(); }
+			void reserve(size_t count) { arena.reserve(count); }
+
+			size_t size() const { return arena.size(); }
+			ParticleContact* contacts() { return arena.data(); }
+			const ParticleContact* contacts() const { return arena.data(); }
+
+			//particleCount bounds the particle indices the contacts use
+			void resolve(const ParticleStreams& streams, size_t particleCount, float time);
+
+			//same job with the contacts coloured and each colour solved in parallel
+			void resolveColored(const ParticleStreams& streams, size_t particleCount, float time, JobSystem& jobs);
+			//sweeps over every contact resolveColored makes at most, for each of the two passes
+			void setSweeps(size_t count) { sweeps = count; }
+			//colours the last resolveColored needed
+			size_t colorCount() const { return colorStart.empty() ? 0 : colorStart.size() - 1; }
+
+			//the impulse the last resolve applied along each contact's normal in total, by the order they were added
+			//lets whoever made a contact start the next step from it (see ParticleLinks)
+			float impulse(size_t contact) const { return applied[contact]; }
+
+			//iterations the last resolve spent on each pass, sweeps for resolveColored
+			size_t velocityIterations() const { return velocityUsed; }
+			size_t positionIterations() const { return positionUsed; }
+
+		private:
+			//indexed binary min-heap over contact indices
+			void heapBuild();
+			void heapUpdate(uint32_t contact, float newKey);
+			void siftUp(uint32_t position);
+			void siftDown(uint32_t position);
+			void place(uint32_t position, uint32_t contact);
+
+			//contacts by particle, counting sorted into runs
+			void buildAdjacency(size_t particleCount);
+			//fills colorOrder and colorStart
+			void buildColors(size_t particleCount);
+
+			size_t iterations;
+			float velocityTolerance = 1e-3f;
+			float penetrationTolerance = 1e-4f;
+			size_t velocityUsed = 0;
+			size_t positionUsed = 0;
+
+			std::vector<ParticleContact> arena;
+			std::vector<float> applied;
+
+			std::vector<float> key;
+			std::vector<uint32_t> heap;
+			//per contact: where it sits in heap
+			std::vector<uint32_t> heapPosition;
+
+			//per particle: first entry in touching, touchStart[count] = total
+			std::vector<uint32_t> touchStart;
+			std::vector<uint32_t> touching;
+
+			size_t sweeps = 10;
+			//per particle: colours already taken by its contacts, one bit each
+			std::vector<uint64_t> colorMask;
+			std::vector<uint32_t> contactColor;
+			//contacts grouped by colour, colour k is colorOrder[colorStart[k], colorStart[k + 1])
+			std::vector<uint32_t> colorOrder;
+			std::vector<uint32_t> colorStart;
+			//per particle: how far the position pass has moved it so far
+			std::vector<float> movedX, movedY, movedZ;
+	};
+}
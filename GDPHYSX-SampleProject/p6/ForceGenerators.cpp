@@ -0,0 +1,61 @@
+#include "ForceGenerators.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace P6;
+
+void GravityForce::apply(const ParticleStreams& s, const uint32_t* indices, size_t count) const {
+	for (size_t n = 0; n < count; n++) {
+		uint32_t i = indices[n];
+		float mass = s.mass[i];
+		s.forceX[i] += gravity.x * mass;
+		s.forceY[i] += gravity.y * mass;
+		s.forceZ[i] += gravity.z * mass;
+	}
+}
+
+void DragForce::apply(const ParticleStreams& s, const uint32_t* indices, size_t count) const {
+	for (size_t n = 0; n < count; n++) {
+		uint32_t i = indices[n];
+		float vx = s.velX[i];
+		float vy = s.velY[i];
+		float vz = s.velZ[i];
+
+		//-V^ * (k1 |V| + k2 |V|^2) == -V * (k1 + k2 |V|), no division for resting particles
+		float speed = std::sqrt(vx * vx + vy * vy + vz * vz);
+		float drag = k1 + k2 * speed;
+		s.forceX[i] -= vx * drag;
+		s.forceY[i] -= vy * drag;
+		s.forceZ[i] -= vz * drag;
+	}
+}
+
+void ConstantForce::apply(const ParticleStreams& s, const uint32_t* indices, size_t count) const {
+	for (size_t n = 0; n < count; n++) {
+		uint32_t i = indices[n];
+		s.forceX[i] += force.x;
+		s.forceY[i] += force.y;
+		s.forceZ[i] += force.z;
+	}
+}
+
+void PointAttractor::apply(const ParticleStreams& s, const uint32_t* indices, size_t count) const {
+	const float minDistanceSq = minDistance * minDistance;
+	for (size_t n = 0; n < count; n++) {
+		uint32_t i = indices[n];
+		float dx = point.x - s.posX[i];
+		float dy = point.y - s.posY[i];
+		float dz = point.z - s.posZ[i];
+
+		float distanceSq = dx * dx + dy * dy + dz * dz;
+		if (distanceSq == 0) continue;
+
+		//F = m * strength / r^2 along the unit direction
+		float distance = std::sqrt(distanceSq);
+		float scale = s.mass[i] * strength / (std::max(distanceSq, minDistanceSq) * distance);
+		s.forceX[i] += dx * scale;
+		s.forceY[i] += dy * scale;
+		s.forceZ[i] += dz * scale;
+	}
+}
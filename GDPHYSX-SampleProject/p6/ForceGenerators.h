@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "MyVector.h"
+#include "ParticleStreams.h"
+
+namespace P6 {
+	//Force generators are plain structs with a non-virtual apply that adds the force to every
+	//listed particle in one loop over the SoA columns. ForceRegistry keeps one list per type.
+
+	//F = m * g
+	struct GravityForce {
+		MyVector gravity = MyVector(0, -9.8f, 0);
+
+		void apply(const ParticleStreams& s, const uint32_t* indices, size_t count) const;
+	};
+
+	//F = -|V|^ * (k1 |V| + k2 |V|^2), linear plus quadratic drag
+	struct DragForce {
+		float k1 = 0;
+		float k2 = 0;
+
+		void apply(const ParticleStreams& s, const uint32_t* indices, size_t count) const;
+	};
+
+	//same force every step, for pushes and thrusters
+	struct ConstantForce {
+		MyVector force;
+
+		void apply(const ParticleStreams& s, const uint32_t* indices, size_t count) const;
+	};
+
+	//pulls towards a point with strength / distance^2 acceleration
+	//the distance is clamped to minDistance so particles passing through the point stay finite
+	struct PointAttractor {
+		MyVector point;
+		float strength = 0;
+		float minDistance = 1.0f;
+
+		void apply(const ParticleStreams& s, const uint32_t* indices, size_t count) const;
+	};
+}
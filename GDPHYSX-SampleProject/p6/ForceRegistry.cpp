@@ -0,0 +1,43 @@
+#include "ForceRegistry.h"
+#include "ParticleWorld.h"
+
+using namespace P6;
+
+void ForceRegistry::clear() {
+	groups = decltype(groups)();
+	network.clear();
+}
+
+template <typename G>
+void ForceRegistry::applyGroup(Group<G>& group, ParticleWorld& world) {
+	const ParticleStreams& streams = world.buffer().streams();
+
+	for (size_t g = 0; g < group.generators.size(); g++) {
+		std::vector<ParticleHandle>& bound = group.bindings[g];
+
+		//resolve handles to dense indices once, then the generator runs one tight loop
+		indices.clear();
+		for (size_t b = 0; b < bound.size();) {
+			size_t index = world.indexOf(bound[b]);
+			if (index == ParticleWorld::NotFound) {
+				bound[b] = bound.back();
+				bound.pop_back();
+				continue;
+			}
+			indices.push_back(static_cast<uint32_t>(index));
+			b++;
+		}
+
+		group.generators[g].apply(streams, indices.data(), indices.size());
+	}
+}
+
+void ForceRegistry::applyForces(ParticleWorld& world) {
+	if (indices.capacity() < world.capacity()) indices.reserve(world.capacity());
+
+	applyGroup(std::get<Group<GravityForce>>(groups), world);
+	applyGroup(std::get<Group<DragForce>>(groups), world);
+	applyGroup(std::get<Group<ConstantForce>>(groups), world);
+	applyGroup(std::get<Group<PointAttractor>>(groups), world);
+	network.apply(world);
+}
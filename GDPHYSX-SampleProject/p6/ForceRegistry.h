@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+#include "ForceGenerators.h"
+#include "ParticleHandle.h"
+#include "SpringForces.h"
+
+namespace P6 {
+	class ParticleWorld;
+
+	//typed reference to a generator owned by a ForceRegistry
+	template <typename G>
+	struct ForceGeneratorId {
+		uint32_t index = 0xFFFFFFFFu;
+	};
+
+	//Owns force generators and the particles bound to them.
+	//Bindings are grouped by generator type and then by generator, so applyForces runs each
+	//generator once over all of its particles instead of one virtual call per particle per force.
+	class ForceRegistry {
+		public:
+			template <typename G>
+			ForceGeneratorId<G> add(const G& generator) {
+				Group<G>& group = std::get<Group<G>>(groups);
+				group.generators.push_back(generator);
+				group.bindings.emplace_back();
+
+				ForceGeneratorId<G> id;
+				id.index = static_cast<uint32_t>(group.generators.size() - 1);
+				return id;
+			}
+
+			//generators can be changed between steps, e.g. to move an attractor
+			template <typename G>
+			G& get(ForceGeneratorId<G> id) {
+				return std::get<Group<G>>(groups).generators[id.index];
+			}
+
+			template <typename G>
+			void bind(ForceGeneratorId<G> id, ParticleHandle particle) {
+				std::get<Group<G>>(groups).bindings[id.index].push_back(particle);
+			}
+
+			template <typename G>
+			void bind(ForceGeneratorId<G> id, const ParticleHandle* particles, size_t amount) {
+				std::vector<ParticleHandle>& bound = std::get<Group<G>>(groups).bindings[id.index];
+				bound.insert(bound.end(), particles, particles + amount);
+			}
+
+			template <typename G>
+			bool unbind(ForceGeneratorId<G> id, ParticleHandle particle) {
+				std::vector<ParticleHandle>& bound = std::get<Group<G>>(groups).bindings[id.index];
+				for (size_t i = 0; i < bound.size(); i++) {
+					if (bound[i] == particle) {
+						bound[i] = bound.back();
+						bound.pop_back();
+						return true;
+					}
+				}
+				return false;
+			}
+
+			//springs between pairs of particles and from particles to fixed points
+			SpringForces& springs() { return network; }
+
+			//removes every generator, binding and spring
+			void clear();
+
+			//adds every generator's force to the accumulators of its particles, the springs' last
+			//bindings to particles that were killed are dropped on the way
+			void applyForces(ParticleWorld& world);
+
+		private:
+			template <typename G>
+			struct Group {
+				std::vector<G> generators;
+				//particles bound to each generator, same order as generators
+				std::vector<std::vector<ParticleHandle>> bindings;
+			};
+
+			template <typename G>
+			void applyGroup(Group<G>& group, ParticleWorld& world);
+
+			std::tuple<Group<GravityForce>, Group<DragForce>, Group<ConstantForce>, Group<PointAttractor>> groups;
+			SpringForces network;
+
+			//dense indices of the bindings being applied, kept between steps so applying does not allocate
+			std::vector<uint32_t> indices;
+	};
+}
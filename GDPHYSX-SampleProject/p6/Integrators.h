@@ -0,0 +1,86 @@
+#pragma once
+
+#include "MyVector.h"
+
+namespace P6 {
+	//position and velocity of one particle while it is being stepped
+	struct ParticleState {
+		MyVector Position;
+		MyVector Velocity;
+	};
+
+	//Integrators are policies passed as template arguments, e.g. buffer.integrate<RK4>(dt, accel),
+	//so every instantiation inlines the acceleration function and the MyVector expressions.
+	//Each one provides
+	//	template <typename AccelFn> static void step(ParticleState& state, float time, const AccelFn& accel)
+	//where accel(position, velocity) returns the acceleration for that state.
+
+	//what P6Particle::update has always done: p2 = p1 + Vt + [(At^2)/2], then Vf = Vi + At
+	//exact for constant acceleration, first order and unstable once A depends on the state
+	struct ConstantAcceleration {
+		static constexpr int Evaluations = 1;
+
+		template <typename AccelFn>
+		static void step(ParticleState& s, float time, const AccelFn& accel) {
+			const MyVector a = accel(s.Position, s.Velocity);
+			s.Position = s.Position + s.Velocity * time + a * (time * time * 0.5f);
+			s.Velocity += a * time;
+		}
+	};
+
+	//velocity first, then position with the new velocity
+	//first order but symplectic: oscillators keep their energy instead of blowing up
+	struct SemiImplicitEuler {
+		static constexpr int Evaluations = 1;
+
+		template <typename AccelFn>
+		static void step(ParticleState& s, float time, const AccelFn& accel) {
+			s.Velocity += accel(s.Position, s.Velocity) * time;
+			s.Position += s.Velocity * time;
+		}
+	};
+
+	//second order, the end-of-step acceleration sees a first-order velocity estimate
+	//so velocity-dependent forces such as drag still work
+	struct VelocityVerlet {
+		static constexpr int Evaluations = 2;
+
+		template <typename AccelFn>
+		static void step(ParticleState& s, float time, const AccelFn& accel) {
+			const MyVector a0 = accel(s.Position, s.Velocity);
+			s.Position = s.Position + s.Velocity * time + a0 * (time * time * 0.5f);
+			const MyVector a1 = accel(s.Position, s.Velocity + a0 * time);
+			s.Velocity = s.Velocity + (a0 + a1) * (time * 0.5f);
+		}
+	};
+
+	//classic fourth-order Runge-Kutta, four evaluations per step
+	struct RK4 {
+		static constexpr int Evaluations = 4;
+
+		template <typename AccelFn>
+		static void step(ParticleState& s, float time, const AccelFn& accel) {
+			const float half = time * 0.5f;
+
+			const MyVector p1 = s.Position;
+			const MyVector v1 = s.Velocity;
+			const MyVector a1 = accel(p1, v1);
+
+			const MyVector p2 = p1 + v1 * half;
+			const MyVector v2 = v1 + a1 * half;
+			const MyVector a2 = accel(p2, v2);
+
+			const MyVector p3 = p1 + v2 * half;
+			const MyVector v3 = v1 + a2 * half;
+			const MyVector a3 = accel(p3, v3);
+
+			const MyVector p4 = p1 + v3 * time;
+			const MyVector v4 = v1 + a3 * time;
+			const MyVector a4 = accel(p4, v4);
+
+			const float sixth = time / 6.0f;
+			s.Position = p1 + (v1 + v2 * 2.0f + v3 * 2.0f + v4) * sixth;
+			s.Velocity = v1 + (a1 + a2 * 2.0f + a3 * 2.0f + a4) * sixth;
+		}
+	};
+}
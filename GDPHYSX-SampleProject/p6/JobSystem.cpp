@@ -0,0 +1,64 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+using namespace P6;
+
+JobSystem::JobSystem(unsigned threads) : nextIndex(0) {
+	if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+	for (unsigned i = 1; i < threads; i++) workers.emplace_back(&JobSystem::workerLoop, this);
+}
+
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers) worker.join();
+}
+
+void JobSystem::work() {
+	while (true) {
+		const size_t begin = nextIndex.fetch_add(chunkGrain);
+		if (begin >= chunkCount) return;
+		chunkFn(chunkBody, begin, std::min(begin + chunkGrain, chunkCount));
+	}
+}
+
+void JobSystem::dispatch(ChunkFn chunk, const void* body, size_t count, size_t grain) {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		chunkFn = chunk;
+		chunkBody = body;
+		chunkCount = count;
+		chunkGrain = grain;
+		nextIndex.store(0);
+		busy = static_cast<unsigned>(workers.size());
+		generation++;
+	}
+	wake.notify_all();
+
+	work();
+
+	//every worker checks in, even one that found no chunk left, before the loop's data goes away
+	std::unique_lock<std::mutex> guard(lock);
+	finished.wait(guard, [this]() { return busy == 0; });
+}
+
+void JobSystem::workerLoop() {
+	size_t seen = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			wake.wait(guard, [&]() { return stopping || generation != seen; });
+			if (stopping) return;
+			seen = generation;
+		}
+
+		work();
+
+		std::lock_guard<std::mutex> guard(lock);
+		if (--busy == 0) finished.notify_one();
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace P6 {
+	//Fixed pool of worker threads for data-parallel loops.
+	//The threads are started once and sleep between loops, so a parallelFor per step costs a
+	//wake-up, not a thread launch. The calling thread works too and parallelFor only returns
+	//once every chunk is done, so the loop body can write straight into the particle columns
+	//as long as no two indices touch the same data.
+	//
+	//	JobSystem jobs;
+	//	jobs.parallelFor(count, 1024, [&](size_t begin, size_t end) { ... });
+	class JobSystem {
+		public:
+			//0 uses every hardware thread, 1 runs everything on the calling thread
+			explicit JobSystem(unsigned threads = 0);
+			~JobSystem();
+
+			JobSystem(const JobSystem&) = delete;
+			JobSystem& operator=(const JobSystem&) = delete;
+
+			//the calling thread included
+			unsigned threadCount() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+			//calls body(begin, end) on chunks of grain indices covering [0, count)
+			//chunks go to whichever thread asks first, so body must not depend on which thread runs it
+			template <typename Body>
+			void parallelFor(size_t count, size_t grain, const Body& body);
+
+		private:
+			typedef void (*ChunkFn)(const void* body, size_t begin, size_t end);
+
+			template <typename Body>
+			static void CallChunk(const void* body, size_t begin, size_t end) {
+				(*static_cast<const Body*>(body))(begin, end);
+			}
+
+			void dispatch(ChunkFn chunk, const void* body, size_t count, size_t grain);
+			//takes chunks of the current loop until there are none left
+			void work();
+			void workerLoop();
+
+			std::vector<std::thread> workers;
+			std::mutex lock;
+			std::condition_variable wake;
+			std::condition_variable finished;
+			bool stopping = false;
+			//bumped for every loop, so workers tell a new loop from a spurious wake-up
+			size_t generation = 0;
+
+			//the loop being run
+			ChunkFn chunkFn = nullptr;
+			const void* chunkBody = nullptr;
+			size_t chunkCount = 0;
+			size_t chunkGrain = 1;
+			std::atomic<size_t> nextIndex;
+			//workers still inside the current loop
+			unsigned busy = 0;
+	};
+
+	template <typename Body>
+	void JobSystem::parallelFor(size_t count, size_t grain, const Body& body) {
+		if (grain == 0) grain = 1;
+		if (workers.empty() || count <= grain) {
+			if (count > 0) body(0, count);
+			return;
+		}
+		dispatch(&CallChunk<Body>, &body, count, grain);
+	}
+}
@@ -1,45 +1,242 @@
-#pragma once 
+#pragma once
+
+//Optional SIMD storage: define P6_MYVECTOR_SIMD in every project of the solution (C/C++ > Preprocessor)
+//and MyVector becomes a 16-byte aligned x, y, z, w register laid out like glm::aligned_vec4.
+//Magnitude, Direction, dotProduct and vectorProduct then run on glm's SSE code in glm/simd,
+//and an array of MyVector can be handed to OpenGL as vec4 data as is.
+//glm has to see GLM_FORCE_INTRINSICS before its first include, so set both defines solution-wide.
+#if defined(P6_MYVECTOR_SIMD) && !defined(GLM_FORCE_INTRINSICS)
+#define GLM_FORCE_INTRINSICS
+#endif
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <cmath>
 
-namespace P6 {
-	class MyVector {
-	public:
-		float x, y, z;
-
-		MyVector() : x(0), y(0), z(0) {}
-		MyVector(const float _x, const float _y, const float _z) : x(_x), y(_y), z(_z) {}
-
-		explicit operator glm::vec3() const { return glm::vec3(x, y, z); }
-
-		float Magnitude() const;
-
-		MyVector Direction() const;
+#ifdef P6_MYVECTOR_SIMD
+#if !(GLM_ARCH & GLM_ARCH_SSE2_BIT)
+#error "P6_MYVECTOR_SIMD needs glm built with GLM_FORCE_INTRINSICS on an SSE2 target"
+#endif
+#include <glm/simd/geometric.h>
+//the glm SIMD paths cannot be evaluated at compile time
+#define P6_VECTOR_CONSTEXPR
+#else
+#define P6_VECTOR_CONSTEXPR constexpr
+#endif
 
-		void operator+=(const MyVector v);
-
-		void operator-=(const MyVector v);
+namespace P6 {
+	class MyVector;
 
-		MyVector operator+(const MyVector v);
+	template <typename E> class ScaledExpression;
 
-		MyVector operator-(const MyVector v);
+	//Lazily evaluated vector expression.
+	//MyVector and every operator result derive from this. Operators only build a small tree
+	//of nodes, nothing is computed until the tree is assigned to a MyVector, which then
+	//evaluates each component in one pass, so Position + V*t + A*t*t*0.5 makes no temporaries.
+	//Nodes hold their operands by value, so keeping an expression in an auto never dangles.
+	template <typename E>
+	class VectorExpression {
+		public:
+			constexpr const E& self() const { return static_cast<const E&>(*this); }
+			constexpr float at(int i) const { return self().at(i); }
 
-		MyVector operator*(const MyVector v);
+			constexpr ScaledExpression<E> scalarMultiplication(float scale) const;
 
-		MyVector operator/(const MyVector v);
+			//these evaluate the expression first, then use the MyVector versions
+			template <typename R>
+			P6_VECTOR_CONSTEXPR float dotProduct(const VectorExpression<R>& v) const;
 
-		MyVector scalarMultiplication(float scale);
+			template <typename R>
+			P6_VECTOR_CONSTEXPR MyVector vectorProduct(const VectorExpression<R>& v) const;
 
-		void operator*=(const MyVector v); 
+			float Magnitude() const;
 
-		float dotProduct(const MyVector v);
+			MyVector Direction() const;
+	};
 
-		MyVector vectorProduct(const MyVector v);
+#ifdef P6_MYVECTOR_SIMD
+	class alignas(16) MyVector : public VectorExpression<MyVector> {
+		public:
+			float x, y, z;
+			//padding lane, kept at 0 so 4-wide dot products and lengths equal the 3D ones
+			float w;
+
+			constexpr MyVector() : x(0), y(0), z(0), w(0) {}
+			constexpr MyVector(const float _x, const float _y, const float _z) : x(_x), y(_y), z(_z), w(0) {}
+			explicit MyVector(glm_vec4 v) { _mm_store_ps(&x, v); }
+
+			//evaluates an expression tree
+			template <typename E>
+			constexpr MyVector(const VectorExpression<E>& e) : x(e.at(0)), y(e.at(1)), z(e.at(2)), w(0) {}
+
+			explicit operator glm::vec3() const { return glm::vec3(x, y, z); }
+			explicit operator glm::vec4() const { return glm::vec4(x, y, z, w); }
+
+			glm_vec4 simd() const { return _mm_load_ps(&x); }
+
+			constexpr float at(int i) const { return i == 0 ? x : (i == 1 ? y : z); }
+
+			float Magnitude() const {
+				return _mm_cvtss_f32(glm_vec4_length(simd()));
+			}
+
+			MyVector Direction() const {
+				glm_vec4 mag = glm_vec4_length(simd());
+				return _mm_cvtss_f32(mag) == 0 ? MyVector(0, 0, 0) : MyVector(glm_vec4_div(simd(), mag));
+			}
+
+			float dotProduct(const MyVector& v) const {
+				return _mm_cvtss_f32(glm_vec4_dot(simd(), v.simd()));
+			}
+
+			MyVector vectorProduct(const MyVector& v) const {
+				return MyVector(glm_vec4_cross(simd(), v.simd()));
+			}
+#else
+	class MyVector : public VectorExpression<MyVector> {
+		public:
+			float x, y, z;
+
+			constexpr MyVector() : x(0), y(0), z(0) {}
+			constexpr MyVector(const float _x, const float _y, const float _z) : x(_x), y(_y), z(_z) {}
+
+			//evaluates an expression tree
+			template <typename E>
+			constexpr MyVector(const VectorExpression<E>& e) : x(e.at(0)), y(e.at(1)), z(e.at(2)) {}
+
+			explicit operator glm::vec3() const { return glm::vec3(x, y, z); }
+
+			constexpr float at(int i) const { return i == 0 ? x : (i == 1 ? y : z); }
+
+			float Magnitude() const {
+				return std::sqrt(x * x + y * y + z * z);
+			}
+
+			MyVector Direction() const {
+				float mag = Magnitude();
+				return mag == 0 ? MyVector(0, 0, 0) : MyVector(x / mag, y / mag, z / mag);
+			}
+
+			constexpr float dotProduct(const MyVector& v) const {
+				return x * v.x + y * v.y + z * v.z;
+			}
+
+			constexpr MyVector vectorProduct(const MyVector& v) const {
+				return MyVector(
+					(y * v.z) - (z * v.y),
+					(z * v.x) - (x * v.z),
+					(x * v.y) - (y * v.x));
+			}
+#endif
+
+			template <typename E>
+			MyVector& operator+=(const VectorExpression<E>& v) {
+				x += v.at(0);
+				y += v.at(1);
+				z += v.at(2);
+				return *this;
+			}
+
+			template <typename E>
+			MyVector& operator-=(const VectorExpression<E>& v) {
+				x -= v.at(0);
+				y -= v.at(1);
+				z -= v.at(2);
+				return *this;
+			}
+
+			template <typename E>
+			MyVector& operator*=(const VectorExpression<E>& v) {
+				x *= v.at(0);
+				y *= v.at(1);
+				z *= v.at(2);
+				return *this;
+			}
+	};
 
+	//component-wise operations
+	struct AddOp { static constexpr float apply(float a, float b) { return a + b; } };
+	struct SubtractOp { static constexpr float apply(float a, float b) { return a - b; } };
+	struct MultiplyOp { static constexpr float apply(float a, float b) { return a * b; } };
+	struct DivideOp { static constexpr float apply(float a, float b) { return a / b; } };
+
+	template <typename L, typename R, typename Op>
+	class BinaryExpression : public VectorExpression<BinaryExpression<L, R, Op>> {
+		public:
+			constexpr BinaryExpression(const L& l, const R& r) : l(l), r(r) {}
+			constexpr float at(int i) const { return Op::apply(l.at(i), r.at(i)); }
+
+		private:
+			L l;
+			R r;
+	};
 
+	template <typename E>
+	class ScaledExpression : public VectorExpression<ScaledExpression<E>> {
+		public:
+			constexpr ScaledExpression(const E& e, float scale) : e(e), scale(scale) {}
+			constexpr float at(int i) const { return e.at(i) * scale; }
 
+		private:
+			E e;
+			float scale;
 	};
-}
\ No newline at end of file
+
+	template <typename E>
+	constexpr ScaledExpression<E> VectorExpression<E>::scalarMultiplication(float scale) const {
+		return ScaledExpression<E>(self(), scale);
+	}
+
+	template <typename E>
+	template <typename R>
+	P6_VECTOR_CONSTEXPR float VectorExpression<E>::dotProduct(const VectorExpression<R>& v) const {
+		return MyVector(*this).dotProduct(MyVector(v));
+	}
+
+	template <typename E>
+	template <typename R>
+	P6_VECTOR_CONSTEXPR MyVector VectorExpression<E>::vectorProduct(const VectorExpression<R>& v) const {
+		return MyVector(*this).vectorProduct(MyVector(v));
+	}
+
+	template <typename E>
+	float VectorExpression<E>::Magnitude() const {
+		return MyVector(*this).Magnitude();
+	}
+
+	template <typename E>
+	MyVector VectorExpression<E>::Direction() const {
+		return MyVector(*this).Direction();
+	}
+
+	template <typename L, typename R>
+	constexpr BinaryExpression<L, R, AddOp> operator+(const VectorExpression<L>& l, const VectorExpression<R>& r) {
+		return BinaryExpression<L, R, AddOp>(l.self(), r.self());
+	}
+
+	template <typename L, typename R>
+	constexpr BinaryExpression<L, R, SubtractOp> operator-(const VectorExpression<L>& l, const VectorExpression<R>& r) {
+		return BinaryExpression<L, R, SubtractOp>(l.self(), r.self());
+	}
+
+	template <typename L, typename R>
+	constexpr BinaryExpression<L, R, MultiplyOp> operator*(const VectorExpression<L>& l, const VectorExpression<R>& r) {
+		return BinaryExpression<L, R, MultiplyOp>(l.self(), r.self());
+	}
+
+	template <typename L, typename R>
+	constexpr BinaryExpression<L, R, DivideOp> operator/(const VectorExpression<L>& l, const VectorExpression<R>& r) {
+		return BinaryExpression<L, R, DivideOp>(l.self(), r.self());
+	}
+
+	template <typename E>
+	constexpr ScaledExpression<E> operator*(const VectorExpression<E>& e, float scale) {
+		return ScaledExpression<E>(e.self(), scale);
+	}
+
+	template <typename E>
+	constexpr ScaledExpression<E> operator*(float scale, const VectorExpression<E>& e) {
+		return ScaledExpression<E>(e.self(), scale);
+	}
+}
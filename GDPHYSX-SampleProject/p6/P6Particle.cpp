@@ -9,12 +9,12 @@ void P6Particle::UpdatePosition(float time) {
 	//p2 = p1 Vt+ [(At^2)/2]
 
 	float NewTime = time * time;
-	this->Position = this->Position + (this->Velocity.scalarMultiplication(time)) + (this->Acceleration.scalarMultiplication(NewTime).scalarMultiplication(0.5f));
+	this->Position = this->Position + (this->Velocity.scalarMultiplication(time)) + (this->TotalAcceleration().scalarMultiplication(NewTime).scalarMultiplication(0.5f));
 }
 
 void P6Particle::UpdateVelocity(float time) {
 	//Vf = Vi A t
-	this->Velocity = this->Velocity + (this->Acceleration.scalarMultiplication(time));
+	this->Velocity = this->Velocity + (this->TotalAcceleration().scalarMultiplication(time));
 }
 
 void P6Particle::update(float time) {
@@ -25,6 +25,23 @@ void P6Particle::update(float time) {
 	//update velocity next
 	this->UpdateVelocity(time);
 
+	//forces only last one step
+	this->ResetForce();
+
+}
+
+MyVector P6Particle::TotalAcceleration() const {
+	//forces only act on particles with mass
+	if (this->mass <= 0) return this->Acceleration;
+	return this->Acceleration + this->AccumulatedForce.scalarMultiplication(1.0f / this->mass);
+}
+
+void P6Particle::AddForce(const MyVector& force) {
+	this->AccumulatedForce += force;
+}
+
+void P6Particle::ResetForce() {
+	this->AccumulatedForce = MyVector(0, 0, 0);
 }
 
 void P6Particle::StopParticle() {
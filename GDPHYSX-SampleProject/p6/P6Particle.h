@@ -6,25 +6,58 @@
 #include <cmath>
 
 #include "MyVector.h"
+#include "Integrators.h"
 
 namespace P6 {
 	class P6Particle {
 		public:
 			float mass = 0;
+			//collision size, particles are spheres
+			float radius = 1.0f;
 			MyVector Position;
 			MyVector Velocity;
 			MyVector Acceleration;
+			//sum of the forces applied since the last update
+			MyVector AccumulatedForce;
 
 			bool active = false;
-			bool moving;
+			bool moving = true;
+			//moves further than its radius in a step: a ParticleWorld with collisions sweeps it
+			//along its path so it can't tunnel through other particles
+			bool fast = false;
 
 		protected:
 			void UpdatePosition(float time);
 			void UpdateVelocity(float time);
+			//constant acceleration plus the accumulated force over the mass
+			MyVector TotalAcceleration() const;
 
 		public:
 			void update(float time);
 			void StopParticle();
+
+			//steps with an integrator policy from Integrators.h, e.g. integrate<RK4>(time, spring)
+			//accel(position, velocity) is evaluated as often as the integrator needs, forces are not reset
+			template <typename Integrator, typename AccelFn>
+			void integrate(float time, const AccelFn& accel) {
+				ParticleState state = { this->Position, this->Velocity };
+				Integrator::step(state, time, accel);
+				this->Position = state.Position;
+				this->Velocity = state.Velocity;
+			}
+
+			//same as update, but with the chosen integrator; the acceleration is fixed for the step,
+			//so only the one-evaluation policies differ from update here
+			template <typename Integrator>
+			void integrate(float time) {
+				static_assert(Integrator::Evaluations == 1, "a fixed acceleration gives VelocityVerlet and RK4 nothing to work with");
+				const MyVector acceleration = this->TotalAcceleration();
+				this->integrate<Integrator>(time, [&acceleration](const MyVector&, const MyVector&) { return acceleration; });
+				this->ResetForce();
+			}
+
+			void AddForce(const MyVector& force);
+			void ResetForce();
 	};
 
 }
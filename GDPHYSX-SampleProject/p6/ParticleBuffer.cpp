@@ -0,0 +1,381 @@
+#include "ParticleBuffer.h"
+#include "ParticleKernels.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <utility>
+
+using namespace P6;
+
+namespace {
+	size_t AlignUp(size_t value, size_t alignment) {
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	void* AlignedAllocate(size_t bytes) {
+#ifdef _MSC_VER
+		void* memory = _aligned_malloc(bytes, ParticleBuffer::Alignment);
+#else
+		void* memory = nullptr;
+		if (posix_memalign(&memory, ParticleBuffer::Alignment, bytes) != 0) memory = nullptr;
+#endif
+		if (!memory) throw std::bad_alloc();
+		return memory;
+	}
+
+	void AlignedFree(void* memory) {
+#ifdef _MSC_VER
+		_aligned_free(memory);
+#else
+		free(memory);
+#endif
+	}
+
+	//lays every column out back to back inside one block
+	//with base == nullptr it only measures the block
+	size_t Carve(char* base, size_t capacity, ParticleStreams& out) {
+		size_t offset = 0;
+		auto floats = [&](float*& column) {
+			column = base ? reinterpret_cast<float*>(base + offset) : nullptr;
+			offset += AlignUp(capacity * sizeof(float), ParticleBuffer::Alignment);
+		};
+		auto flags = [&](uint8_t*& column) {
+			column = base ? reinterpret_cast<uint8_t*>(base + offset) : nullptr;
+			offset += AlignUp(capacity * sizeof(uint8_t), ParticleBuffer::Alignment);
+		};
+
+		floats(out.mass);
+		floats(out.invMass);
+		floats(out.radius);
+		floats(out.posX); floats(out.posY); floats(out.posZ);
+		floats(out.prevX); floats(out.prevY); floats(out.prevZ);
+		floats(out.velX); floats(out.velY); floats(out.velZ);
+		floats(out.accX); floats(out.accY); floats(out.accZ);
+		floats(out.forceX); floats(out.forceY); floats(out.forceZ);
+		flags(out.active);
+		flags(out.moving);
+		flags(out.fast);
+		return offset;
+	}
+
+	float InverseMass(float mass) {
+		//forces only act on particles with mass
+		return mass > 0 ? 1.0f / mass : 0.0f;
+	}
+
+	void CopyStreams(ParticleStreams& dst, const ParticleStreams& src, size_t count) {
+		const size_t floatBytes = count * sizeof(float);
+		std::memcpy(dst.mass, src.mass, floatBytes);
+		std::memcpy(dst.invMass, src.invMass, floatBytes);
+		std::memcpy(dst.radius, src.radius, floatBytes);
+		std::memcpy(dst.posX, src.posX, floatBytes);
+		std::memcpy(dst.posY, src.posY, floatBytes);
+		std::memcpy(dst.posZ, src.posZ, floatBytes);
+		std::memcpy(dst.prevX, src.prevX, floatBytes);
+		std::memcpy(dst.prevY, src.prevY, floatBytes);
+		std::memcpy(dst.prevZ, src.prevZ, floatBytes);
+		std::memcpy(dst.velX, src.velX, floatBytes);
+		std::memcpy(dst.velY, src.velY, floatBytes);
+		std::memcpy(dst.velZ, src.velZ, floatBytes);
+		std::memcpy(dst.accX, src.accX, floatBytes);
+		std::memcpy(dst.accY, src.accY, floatBytes);
+		std::memcpy(dst.accZ, src.accZ, floatBytes);
+		std::memcpy(dst.forceX, src.forceX, floatBytes);
+		std::memcpy(dst.forceY, src.forceY, floatBytes);
+		std::memcpy(dst.forceZ, src.forceZ, floatBytes);
+		std::memcpy(dst.active, src.active, count);
+		std::memcpy(dst.moving, src.moving, count);
+		std::memcpy(dst.fast, src.fast, count);
+	}
+}
+
+ParticleBuffer::ParticleBuffer(size_t capacity) {
+	reserve(capacity);
+}
+
+ParticleBuffer::~ParticleBuffer() {
+	release();
+}
+
+ParticleBuffer::ParticleBuffer(ParticleBuffer&& other) noexcept
+	: columns(other.columns), block(other.block), count(other.count), allocated(other.allocated) {
+	other.columns = ParticleStreams();
+	other.block = nullptr;
+	other.count = 0;
+	other.allocated = 0;
+}
+
+ParticleBuffer& ParticleBuffer::operator=(ParticleBuffer&& other) noexcept {
+	if (this != &other) {
+		release();
+		std::swap(columns, other.columns);
+		std::swap(block, other.block);
+		std::swap(count, other.count);
+		std::swap(allocated, other.allocated);
+	}
+	return *this;
+}
+
+void ParticleBuffer::release() {
+	if (block) AlignedFree(block);
+	columns = ParticleStreams();
+	block = nullptr;
+	count = 0;
+	allocated = 0;
+}
+
+void ParticleBuffer::reserve(size_t capacity) {
+	if (capacity <= allocated) return;
+
+	//keep whole cache lines of floats so vector loops never straddle the end of a column
+	capacity = AlignUp(capacity, Alignment / sizeof(float));
+
+	ParticleStreams fresh;
+	size_t bytes = Carve(nullptr, capacity, fresh);
+	char* memory = static_cast<char*>(AlignedAllocate(bytes));
+	Carve(memory, capacity, fresh);
+
+	if (block) {
+		CopyStreams(fresh, columns, count);
+		AlignedFree(block);
+	}
+
+	columns = fresh;
+	block = memory;
+	allocated = capacity;
+}
+
+size_t ParticleBuffer::add(const P6Particle& particle) {
+	return add(&particle, 1);
+}
+
+size_t ParticleBuffer::add(const P6Particle* particles, size_t amount) {
+	size_t first = count;
+	if (count + amount > allocated) reserve(std::max(count + amount, allocated * 2));
+
+	count += amount;
+	for (size_t i = 0; i < amount; i++) {
+		set(first + i, particles[i]);
+	}
+	return first;
+}
+
+void ParticleBuffer::remove(size_t index) {
+	size_t last = count - 1;
+	if (index != last) {
+		columns.mass[index] = columns.mass[last];
+		columns.invMass[index] = columns.invMass[last];
+		columns.radius[index] = columns.radius[last];
+		columns.posX[index] = columns.posX[last];
+		columns.posY[index] = columns.posY[last];
+		columns.posZ[index] = columns.posZ[last];
+		columns.prevX[index] = columns.prevX[last];
+		columns.prevY[index] = columns.prevY[last];
+		columns.prevZ[index] = columns.prevZ[last];
+		columns.velX[index] = columns.velX[last];
+		columns.velY[index] = columns.velY[last];
+		columns.velZ[index] = columns.velZ[last];
+		columns.accX[index] = columns.accX[last];
+		columns.accY[index] = columns.accY[last];
+		columns.accZ[index] = columns.accZ[last];
+		columns.forceX[index] = columns.forceX[last];
+		columns.forceY[index] = columns.forceY[last];
+		columns.forceZ[index] = columns.forceZ[last];
+		columns.active[index] = columns.active[last];
+		columns.moving[index] = columns.moving[last];
+		columns.fast[index] = columns.fast[last];
+	}
+	count = last;
+}
+
+void ParticleBuffer::remove(size_t* indices, size_t amount) {
+	//highest index first, so a swapped-in particle is never one still waiting to be removed
+	std::sort(indices, indices + amount, std::greater<size_t>());
+	for (size_t i = 0; i < amount; i++) {
+		if (i > 0 && indices[i] == indices[i - 1]) continue;
+		remove(indices[i]);
+	}
+}
+
+void ParticleBuffer::swap(size_t a, size_t b) {
+	if (a == b) return;
+	float* floats[] = {
+		columns.mass, columns.invMass, columns.radius,
+		columns.posX, columns.posY, columns.posZ, columns.prevX, columns.prevY, columns.prevZ,
+		columns.velX, columns.velY, columns.velZ, columns.accX, columns.accY, columns.accZ,
+		columns.forceX, columns.forceY, columns.forceZ
+	};
+	for (float* column : floats) std::swap(column[a], column[b]);
+	uint8_t* flags[] = { columns.active, columns.moving, columns.fast };
+	for (uint8_t* column : flags) std::swap(column[a], column[b]);
+}
+
+P6Particle ParticleBuffer::get(size_t index) const {
+	P6Particle particle;
+	particle.mass = columns.mass[index];
+	particle.radius = columns.radius[index];
+	particle.Position = MyVector(columns.posX[index], columns.posY[index], columns.posZ[index]);
+	particle.Velocity = MyVector(columns.velX[index], columns.velY[index], columns.velZ[index]);
+	particle.Acceleration = MyVector(columns.accX[index], columns.accY[index], columns.accZ[index]);
+	particle.AccumulatedForce = MyVector(columns.forceX[index], columns.forceY[index], columns.forceZ[index]);
+	particle.active = columns.active[index] != 0;
+	particle.moving = columns.moving[index] != 0;
+	particle.fast = columns.fast[index] != 0;
+	return particle;
+}
+
+void ParticleBuffer::set(size_t index, const P6Particle& particle) {
+	columns.mass[index] = particle.mass;
+	columns.invMass[index] = InverseMass(particle.mass);
+	columns.radius[index] = particle.radius;
+	columns.posX[index] = particle.Position.x;
+	columns.posY[index] = particle.Position.y;
+	columns.posZ[index] = particle.Position.z;
+	//a particle placed by hand has no motion to interpolate
+	columns.prevX[index] = particle.Position.x;
+	columns.prevY[index] = particle.Position.y;
+	columns.prevZ[index] = particle.Position.z;
+	columns.velX[index] = particle.Velocity.x;
+	columns.velY[index] = particle.Velocity.y;
+	columns.velZ[index] = particle.Velocity.z;
+	columns.accX[index] = particle.Acceleration.x;
+	columns.accY[index] = particle.Acceleration.y;
+	columns.accZ[index] = particle.Acceleration.z;
+	columns.forceX[index] = particle.AccumulatedForce.x;
+	columns.forceY[index] = particle.AccumulatedForce.y;
+	columns.forceZ[index] = particle.AccumulatedForce.z;
+	columns.active[index] = particle.active ? 1 : 0;
+	columns.moving[index] = particle.moving ? 1 : 0;
+	columns.fast[index] = particle.fast ? 1 : 0;
+}
+
+void ParticleBuffer::update(float time, size_t amount) {
+	savePositions(amount);
+	IntegrateParticles(columns, amount, time);
+}
+
+void ParticleBuffer::savePositions(size_t amount) {
+	std::memcpy(columns.prevX, columns.posX, amount * sizeof(float));
+	std::memcpy(columns.prevY, columns.posY, amount * sizeof(float));
+	std::memcpy(columns.prevZ, columns.posZ, amount * sizeof(float));
+}
+
+void ParticleBuffer::clearForces() {
+	std::memset(columns.forceX, 0, count * sizeof(float));
+	std::memset(columns.forceY, 0, count * sizeof(float));
+	std::memset(columns.forceZ, 0, count * sizeof(float));
+}
+
+MyVector ParticleView::GetPosition() const {
+	const ParticleStreams& s = buffer->streams();
+	return MyVector(s.posX[index], s.posY[index], s.posZ[index]);
+}
+
+MyVector ParticleView::GetVelocity() const {
+	const ParticleStreams& s = buffer->streams();
+	return MyVector(s.velX[index], s.velY[index], s.velZ[index]);
+}
+
+MyVector ParticleView::GetAcceleration() const {
+	const ParticleStreams& s = buffer->streams();
+	return MyVector(s.accX[index], s.accY[index], s.accZ[index]);
+}
+
+MyVector ParticleView::GetPreviousPosition() const {
+	const ParticleStreams& s = buffer->streams();
+	return MyVector(s.prevX[index], s.prevY[index], s.prevZ[index]);
+}
+
+MyVector ParticleView::GetInterpolatedPosition(float alpha) const {
+	const MyVector previous = GetPreviousPosition();
+	return previous + (GetPosition() - previous) * alpha;
+}
+
+void ParticleView::SetPosition(const MyVector& position) {
+	ParticleStreams& s = buffer->streams();
+	s.posX[index] = position.x;
+	s.posY[index] = position.y;
+	s.posZ[index] = position.z;
+}
+
+void ParticleView::SetVelocity(const MyVector& velocity) {
+	ParticleStreams& s = buffer->streams();
+	s.velX[index] = velocity.x;
+	s.velY[index] = velocity.y;
+	s.velZ[index] = velocity.z;
+}
+
+void ParticleView::SetAcceleration(const MyVector& acceleration) {
+	ParticleStreams& s = buffer->streams();
+	s.accX[index] = acceleration.x;
+	s.accY[index] = acceleration.y;
+	s.accZ[index] = acceleration.z;
+}
+
+float ParticleView::GetMass() const {
+	return buffer->streams().mass[index];
+}
+
+void ParticleView::SetMass(float mass) {
+	buffer->streams().mass[index] = mass;
+	buffer->streams().invMass[index] = InverseMass(mass);
+}
+
+float ParticleView::GetRadius() const {
+	return buffer->streams().radius[index];
+}
+
+void ParticleView::SetRadius(float radius) {
+	buffer->streams().radius[index] = radius;
+}
+
+MyVector ParticleView::GetForce() const {
+	const ParticleStreams& s = buffer->streams();
+	return MyVector(s.forceX[index], s.forceY[index], s.forceZ[index]);
+}
+
+void ParticleView::AddForce(const MyVector& force) {
+	ParticleStreams& s = buffer->streams();
+	s.forceX[index] += force.x;
+	s.forceY[index] += force.y;
+	s.forceZ[index] += force.z;
+}
+
+bool ParticleView::IsActive() const {
+	return buffer->streams().active[index] != 0;
+}
+
+void ParticleView::SetActive(bool active) {
+	buffer->streams().active[index] = active ? 1 : 0;
+}
+
+bool ParticleView::IsMoving() const {
+	return buffer->streams().moving[index] != 0;
+}
+
+void ParticleView::SetMoving(bool moving) {
+	buffer->streams().moving[index] = moving ? 1 : 0;
+}
+
+bool ParticleView::IsFast() const {
+	return buffer->streams().fast[index] != 0;
+}
+
+void ParticleView::SetFast(bool fast) {
+	buffer->streams().fast[index] = fast ? 1 : 0;
+}
+
+void ParticleView::update(float time) {
+	P6Particle particle = buffer->get(index);
+	particle.update(time);
+	buffer->set(index, particle);
+}
+
+void ParticleView::StopParticle() {
+	P6Particle particle = buffer->get(index);
+	particle.StopParticle();
+	buffer->set(index, particle);
+}
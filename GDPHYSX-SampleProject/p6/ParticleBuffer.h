@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Integrators.h"
+#include "MyVector.h"
+#include "P6Particle.h"
+#include "ParticleStreams.h"
+
+namespace P6 {
+	class ParticleBuffer;
+
+	//P6Particle-style access to a single particle stored inside a ParticleBuffer
+	//only valid until the buffer reallocates or the particle is removed
+	class ParticleView {
+		public:
+			ParticleView(ParticleBuffer& buffer, size_t index) : buffer(&buffer), index(index) {}
+
+			MyVector GetPosition() const;
+			MyVector GetVelocity() const;
+			MyVector GetAcceleration() const;
+
+			//where the particle was before the last step
+			MyVector GetPreviousPosition() const;
+			//blend between the last two steps, alpha from StepScheduler::alpha
+			MyVector GetInterpolatedPosition(float alpha) const;
+
+			void SetPosition(const MyVector& position);
+			void SetVelocity(const MyVector& velocity);
+			void SetAcceleration(const MyVector& acceleration);
+
+			float GetMass() const;
+			void SetMass(float mass);
+
+			float GetRadius() const;
+			void SetRadius(float radius);
+
+			MyVector GetForce() const;
+			void AddForce(const MyVector& force);
+
+			bool IsActive() const;
+			void SetActive(bool active);
+
+			bool IsMoving() const;
+			void SetMoving(bool moving);
+
+			bool IsFast() const;
+			void SetFast(bool fast);
+
+			size_t Index() const { return index; }
+
+			void update(float time);
+			void StopParticle();
+
+		private:
+			ParticleBuffer* buffer;
+			size_t index;
+	};
+
+	//structure-of-arrays particle store
+	//each field lives in its own aligned array so bulk updates stream through memory
+	class ParticleBuffer {
+		public:
+			static constexpr size_t Alignment = 64;
+
+			ParticleBuffer() = default;
+			explicit ParticleBuffer(size_t capacity);
+			~ParticleBuffer();
+
+			ParticleBuffer(const ParticleBuffer&) = delete;
+			ParticleBuffer& operator=(const ParticleBuffer&) = delete;
+			ParticleBuffer(ParticleBuffer&& other) noexcept;
+			ParticleBuffer& operator=(ParticleBuffer&& other) noexcept;
+
+			size_t size() const { return count; }
+			size_t capacity() const { return allocated; }
+			bool empty() const { return count == 0; }
+
+			void reserve(size_t capacity);
+			void clear() { count = 0; }
+
+			//returns the index of the new particle
+			size_t add(const P6Particle& particle);
+			//appends all particles, returns the index of the first one
+			size_t add(const P6Particle* particles, size_t amount);
+
+			//swaps the last particle into the removed slot
+			void remove(size_t index);
+			//removes every listed index, the array is sorted in place
+			void remove(size_t* indices, size_t amount);
+			//exchanges two particles, every column
+			void swap(size_t a, size_t b);
+
+			P6Particle get(size_t index) const;
+			void set(size_t index, const P6Particle& particle);
+
+			ParticleView operator[](size_t index) { return ParticleView(*this, index); }
+
+			ParticleStreams& streams() { return columns; }
+			const ParticleStreams& streams() const { return columns; }
+
+			//steps every active particle, same kinematics as P6Particle::update
+			//the accumulated forces are used but not cleared, see clearForces
+			//runs on the widest SIMD kernel the CPU supports, see ParticleKernels.h
+			void update(float time) { update(time, count); }
+			//steps only particles [0, amount), ParticleWorld keeps its sleeping particles behind those
+			void update(float time, size_t amount);
+			//copies the positions into the previous-position columns, update and integrate do this first
+			void savePositions() { savePositions(count); }
+			void savePositions(size_t amount);
+			//zeroes every force accumulator
+			void clearForces();
+
+			//steps every active particle with an integrator policy from Integrators.h, chosen at compile time
+			//accel(index, position, velocity) returns the acceleration of that particle for a trial state,
+			//so stiff forces such as springs can be re-evaluated inside RK4 or Verlet substeps.
+			//Scalar code, one particle at a time: update() stays the SIMD path for constant acceleration.
+			template <typename Integrator, typename AccelFn>
+			void integrate(float time, const AccelFn& accel) { integrate<Integrator>(time, accel, count); }
+			//only particles [0, amount)
+			template <typename Integrator, typename AccelFn>
+			void integrate(float time, const AccelFn& accel, size_t amount);
+
+			//acceleration held at acc + F / m for the whole step, like update(), so only the one-evaluation
+			//policies (ConstantAcceleration, SemiImplicitEuler) are allowed; the others need the accel overload
+			template <typename Integrator>
+			void integrate(float time) { integrate<Integrator>(time, count); }
+			template <typename Integrator>
+			void integrate(float time, size_t amount);
+
+		private:
+			void release();
+
+			ParticleStreams columns;
+			void* block = nullptr;
+			size_t count = 0;
+			size_t allocated = 0;
+	};
+
+	template <typename Integrator, typename AccelFn>
+	void ParticleBuffer::integrate(float time, const AccelFn& accel, size_t amount) {
+		savePositions(amount);
+
+		ParticleStreams& s = columns;
+		for (size_t i = 0; i < amount; i++) {
+			if (!s.active[i]) continue;
+
+			ParticleState state = {
+				MyVector(s.posX[i], s.posY[i], s.posZ[i]),
+				MyVector(s.velX[i], s.velY[i], s.velZ[i])
+			};
+			Integrator::step(state, time, [&accel, i](const MyVector& position, const MyVector& velocity) {
+				return MyVector(accel(i, position, velocity));
+			});
+
+			s.posX[i] = state.Position.x;
+			s.posY[i] = state.Position.y;
+			s.posZ[i] = state.Position.z;
+			s.velX[i] = state.Velocity.x;
+			s.velY[i] = state.Velocity.y;
+			s.velZ[i] = state.Velocity.z;
+		}
+	}
+
+	template <typename Integrator>
+	void ParticleBuffer::integrate(float time, size_t amount) {
+		static_assert(Integrator::Evaluations == 1, "a fixed acceleration gives VelocityVerlet and RK4 nothing to work with");
+		const ParticleStreams& s = columns;
+		integrate<Integrator>(time, [&s](size_t i, const MyVector&, const MyVector&) {
+			return MyVector(
+				s.accX[i] + s.forceX[i] * s.invMass[i],
+				s.accY[i] + s.forceY[i] * s.invMass[i],
+				s.accZ[i] + s.forceZ[i] * s.invMass[i]);
+		}, amount);
+	}
+}
@@ -0,0 +1,72 @@
+#include "ParticleContact.h"
+
+using namespace P6;
+
+float ParticleContact::separatingVelocity(const ParticleStreams& s) const {
+	float x = s.velX[a], y = s.velY[a], z = s.velZ[a];
+	if (b != None) {
+		x -= s.velX[b];
+		y -= s.velY[b];
+		z -= s.velZ[b];
+	}
+	return x * normal.x + y * normal.y + z * normal.z;
+}
+
+float ParticleContact::resolveVelocity(const ParticleStreams& s, float time) const {
+	const float separating = separatingVelocity(s);
+	if (separating > 0) return 0;
+
+	float newSeparating = -separating * restitution;
+
+	//closing speed that only this step's acceleration built up, the constant one and the accumulated forces'
+	float ax = s.accX[a] + s.forceX[a] * s.invMass[a];
+	float ay = s.accY[a] + s.forceY[a] * s.invMass[a];
+	float az = s.accZ[a] + s.forceZ[a] * s.invMass[a];
+	if (b != None) {
+		ax -= s.accX[b] + s.forceX[b] * s.invMass[b];
+		ay -= s.accY[b] + s.forceY[b] * s.invMass[b];
+		az -= s.accZ[b] + s.forceZ[b] * s.invMass[b];
+	}
+	const float accelerationCaused = (ax * normal.x + ay * normal.y + az * normal.z) * time;
+	if (accelerationCaused < 0) {
+		newSeparating += restitution * accelerationCaused;
+		if (newSeparating < 0) newSeparating = 0;
+	}
+
+	const float totalInverseMass = s.invMass[a] + (b != None ? s.invMass[b] : 0.0f);
+	if (totalInverseMass <= 0) return 0;
+
+	//impulse per unit of inverse mass
+	const float impulse = (newSeparating - separating) / totalInverseMass;
+	const float ia = impulse * s.invMass[a];
+	s.velX[a] += normal.x * ia;
+	s.velY[a] += normal.y * ia;
+	s.velZ[a] += normal.z * ia;
+	if (b != None) {
+		const float ib = impulse * s.invMass[b];
+		s.velX[b] -= normal.x * ib;
+		s.velY[b] -= normal.y * ib;
+		s.velZ[b] -= normal.z * ib;
+	}
+	return impulse;
+}
+
+bool ParticleContact::resolveInterpenetration(const ParticleStreams& s, MyVector& moveA, MyVector& moveB) const {
+	const float totalInverseMass = s.invMass[a] + (b != None ? s.invMass[b] : 0.0f);
+	if (penetration <= 0 || totalInverseMass <= 0) return false;
+
+	const float perInverseMass = penetration / totalInverseMass;
+	moveA = normal * (perInverseMass * s.invMass[a]);
+	s.posX[a] += moveA.x;
+	s.posY[a] += moveA.y;
+	s.posZ[a] += moveA.z;
+
+	moveB = MyVector();
+	if (b != None) {
+		moveB = normal * (-perInverseMass * s.invMass[b]);
+		s.posX[b] += moveB.x;
+		s.posY[b] += moveB.y;
+		s.posZ[b] += moveB.z;
+	}
+	return true;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+#include "MyVector.h"
+#include "ParticleStreams.h"
+
+namespace P6 {
+	//Two particles touching, or one particle against immovable scenery.
+	//Particles are dense indices into a ParticleBuffer, so a contact is only valid for the step
+	//it was generated in. The normal points from b towards a: a gets pushed along it, b against it.
+	struct ParticleContact {
+		//b for contacts with something that never moves
+		static constexpr uint32_t None = 0xFFFFFFFFu;
+
+		uint32_t a = None;
+		uint32_t b = None;
+		MyVector normal;
+		//how far the two overlap along the normal, <= 0 once they're apart
+		float penetration = 0;
+		//0 stops them dead, 1 bounces back with the full speed
+		float restitution = 0;
+
+		//relative speed along the normal, negative while closing
+		float separatingVelocity(const ParticleStreams& s) const;
+
+		//applies the impulse that leaves them separating at restitution times the closing speed
+		//contacts that only close because of this step's acceleration, the constant one plus the accumulated
+		//forces' (resting contacts), don't get that bounced back, so stacks settle instead of jittering
+		//returns the impulse it applied along the normal, 0 when there was nothing to do
+		float resolveVelocity(const ParticleStreams& s, float time) const;
+
+		//moves both apart along the normal, the lighter one further
+		//returns false when neither can move; otherwise the moves are written to moveA and moveB
+		bool resolveInterpenetration(const ParticleStreams& s, MyVector& moveA, MyVector& moveB) const;
+	};
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+namespace P6 {
+	//stable reference to a particle in a ParticleWorld
+	//the generation makes handles to killed particles fail instead of aliasing a reused slot
+	struct ParticleHandle {
+		static constexpr uint32_t Invalid = 0xFFFFFFFFu;
+
+		uint32_t slot = Invalid;
+		uint32_t generation = 0;
+
+		bool IsValid() const { return slot != Invalid; }
+		bool operator==(const ParticleHandle& other) const { return slot == other.slot && generation == other.generation; }
+		bool operator!=(const ParticleHandle& other) const { return !(*this == other); }
+	};
+}
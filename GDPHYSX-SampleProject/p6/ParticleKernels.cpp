@@ -0,0 +1,150 @@
+#include "ParticleKernels.h"
+
+#if P6_KERNELS_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+using namespace P6;
+
+namespace {
+#if P6_KERNELS_X86
+	void Cpuid(unsigned leaf, unsigned subleaf, unsigned regs[4]) {
+#ifdef _MSC_VER
+		int out[4];
+		__cpuidex(out, (int)leaf, (int)subleaf);
+		for (int i = 0; i < 4; i++) regs[i] = (unsigned)out[i];
+#else
+		__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+	}
+
+	//which register states the OS saves on a context switch
+	unsigned long long EnabledXsaveFeatures() {
+#ifdef _MSC_VER
+		return _xgetbv(0);
+#else
+		unsigned eax, edx;
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return ((unsigned long long)edx << 32) | eax;
+#endif
+	}
+
+	SimdLevel QueryCpu() {
+		unsigned regs[4] = { 0, 0, 0, 0 };
+		Cpuid(0, 0, regs);
+		unsigned maxLeaf = regs[0];
+		if (maxLeaf < 1) return SimdLevel::Scalar;
+
+		Cpuid(1, 0, regs);
+		const bool sse2 = (regs[3] & (1u << 26)) != 0;
+		const bool fma = (regs[2] & (1u << 12)) != 0;
+		const bool osxsave = (regs[2] & (1u << 27)) != 0;
+		const bool avx = (regs[2] & (1u << 28)) != 0;
+		if (!sse2) return SimdLevel::Scalar;
+		if (!osxsave || !avx || !fma || maxLeaf < 7) return SimdLevel::SSE2;
+
+		const unsigned long long xcr0 = EnabledXsaveFeatures();
+		const bool ymmState = (xcr0 & 0x6) == 0x6;
+		const bool zmmState = (xcr0 & 0xE6) == 0xE6;
+		if (!ymmState) return SimdLevel::SSE2;
+
+		Cpuid(7, 0, regs);
+		const bool avx2 = (regs[1] & (1u << 5)) != 0;
+		const bool avx512f = (regs[1] & (1u << 16)) != 0;
+		if (!avx2) return SimdLevel::SSE2;
+		if (!avx512f || !zmmState) return SimdLevel::AVX2;
+		return SimdLevel::AVX512;
+	}
+#else
+	SimdLevel QueryCpu() {
+		return SimdLevel::Scalar;
+	}
+#endif
+
+	IntegrateKernel KernelFor(SimdLevel level) {
+		switch (level) {
+#if P6_KERNELS_X86
+		case SimdLevel::AVX512:
+			return Kernels::IntegrateAVX512;
+		case SimdLevel::AVX2:
+			return Kernels::IntegrateAVX2;
+		case SimdLevel::SSE2:
+			return Kernels::IntegrateSSE2;
+#endif
+		default:
+			return Kernels::IntegrateScalar;
+		}
+	}
+
+	struct Dispatch {
+		SimdLevel level;
+		IntegrateKernel integrate;
+
+		Dispatch() : level(DetectSimdLevel()), integrate(KernelFor(level)) {}
+	};
+
+	//picked on first use, after that every call is one indirect jump
+	Dispatch& Selected() {
+		static Dispatch dispatch;
+		return dispatch;
+	}
+}
+
+SimdLevel P6::DetectSimdLevel() {
+	static const SimdLevel detected = QueryCpu();
+	return detected;
+}
+
+SimdLevel P6::ActiveSimdLevel() {
+	return Selected().level;
+}
+
+void P6::SetSimdLevel(SimdLevel level) {
+	if (level > DetectSimdLevel()) level = DetectSimdLevel();
+	Selected().level = level;
+	Selected().integrate = KernelFor(level);
+}
+
+const char* P6::SimdLevelName(SimdLevel level) {
+	switch (level) {
+	case SimdLevel::SSE2:
+		return "SSE2";
+	case SimdLevel::AVX2:
+		return "AVX2+FMA";
+	case SimdLevel::AVX512:
+		return "AVX-512";
+	default:
+		return "Scalar";
+	}
+}
+
+void P6::IntegrateParticles(const ParticleStreams& streams, size_t count, float time) {
+	Selected().integrate(streams, 0, count, time);
+}
+
+void Kernels::IntegrateScalar(const ParticleStreams& s, size_t begin, size_t end, float time) {
+	for (size_t i = begin; i < end; i++) {
+		//inactive particles step with t = 0, which leaves them untouched
+		float t = s.active[i] ? time : 0.0f;
+		float halfT2 = (t * t) * 0.5f;
+
+		//A = constant acceleration + F / m
+		float ax = s.accX[i] + s.forceX[i] * s.invMass[i];
+		float ay = s.accY[i] + s.forceY[i] * s.invMass[i];
+		float az = s.accZ[i] + s.forceZ[i] * s.invMass[i];
+
+		//p2 = p1 + Vt + [(At^2)/2]
+		s.posX[i] = s.posX[i] + s.velX[i] * t + ax * halfT2;
+		s.posY[i] = s.posY[i] + s.velY[i] * t + ay * halfT2;
+		s.posZ[i] = s.posZ[i] + s.velZ[i] * t + az * halfT2;
+
+		//Vf = Vi + At
+		s.velX[i] = s.velX[i] + ax * t;
+		s.velY[i] = s.velY[i] + ay * t;
+		s.velZ[i] = s.velZ[i] + az * t;
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+
+#include "ParticleStreams.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define P6_KERNELS_X86 1
+#else
+#define P6_KERNELS_X86 0
+#endif
+
+//gcc/clang need the instruction set enabled per function, msvc accepts the intrinsics anywhere
+//per-function targets keep inline code from the rest of the program out of the AVX encodings
+#if defined(__GNUC__) || defined(__clang__)
+#define P6_TARGET_SSE2 __attribute__((target("sse2")))
+#define P6_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define P6_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+#else
+#define P6_TARGET_SSE2
+#define P6_TARGET_AVX2
+#define P6_TARGET_AVX512
+#endif
+
+namespace P6 {
+	enum class SimdLevel {
+		Scalar,
+		SSE2,   //4 particles per instruction
+		AVX2,   //8 particles per instruction, fused multiply-add
+		AVX512  //16 particles per instruction, fused multiply-add
+	};
+
+	//steps particles [begin, end) with the P6Particle::update kinematics
+	//A = acc + F / m, p2 = p1 + Vt + [(At^2)/2], Vf = Vi + At, particles with active == 0 are left untouched
+	typedef void (*IntegrateKernel)(const ParticleStreams& streams, size_t begin, size_t end, float time);
+
+	//highest level both the CPU and the OS support, read once from CPUID/XGETBV
+	SimdLevel DetectSimdLevel();
+
+	//level used by IntegrateParticles, starts at DetectSimdLevel()
+	SimdLevel ActiveSimdLevel();
+	//forces a lower level (benchmarks, comparisons), requests above the detected level are clamped
+	void SetSimdLevel(SimdLevel level);
+
+	const char* SimdLevelName(SimdLevel level);
+
+	//Tolerance against the scalar kernel:
+	//- SSE2 does the same operations in the same order and is bit-identical
+	//- AVX2/AVX512 contract into fused multiply-adds, which round once instead of twice,
+	//  so per step a position may differ by 3 ulp of |p| + |Vt| + |At^2/2|
+	//  and a velocity by 2 ulp of |V| + |At|, where A includes the F / m term
+	void IntegrateParticles(const ParticleStreams& streams, size_t count, float time);
+
+	namespace Kernels {
+		void IntegrateScalar(const ParticleStreams& streams, size_t begin, size_t end, float time);
+#if P6_KERNELS_X86
+		void IntegrateSSE2(const ParticleStreams& streams, size_t begin, size_t end, float time);
+		void IntegrateAVX2(const ParticleStreams& streams, size_t begin, size_t end, float time);
+		void IntegrateAVX512(const ParticleStreams& streams, size_t begin, size_t end, float time);
+#endif
+	}
+}
@@ -0,0 +1,49 @@
+#include "ParticleKernels.h"
+
+#if P6_KERNELS_X86
+
+#include <immintrin.h>
+
+using namespace P6;
+
+namespace {
+	//time for every active lane, 0 for the inactive ones
+	P6_TARGET_AVX2 inline __m256 ActiveTime(const uint8_t* active, __m256 time) {
+		__m256i lanes = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(active)));
+		__m256 inactive = _mm256_castsi256_ps(_mm256_cmpeq_epi32(lanes, _mm256_setzero_si256()));
+		return _mm256_andnot_ps(inactive, time);
+	}
+}
+
+P6_TARGET_AVX2 void Kernels::IntegrateAVX2(const ParticleStreams& s, size_t begin, size_t end, float time) {
+	const __m256 timeAll = _mm256_set1_ps(time);
+	const __m256 half = _mm256_set1_ps(0.5f);
+
+	size_t i = begin;
+	for (; i + 8 <= end; i += 8) {
+		__m256 t = ActiveTime(s.active + i, timeAll);
+		__m256 halfT2 = _mm256_mul_ps(_mm256_mul_ps(t, t), half);
+
+		//A = constant acceleration + F / m
+		__m256 invMass = _mm256_loadu_ps(s.invMass + i);
+		__m256 ax = _mm256_fmadd_ps(_mm256_loadu_ps(s.forceX + i), invMass, _mm256_loadu_ps(s.accX + i));
+		__m256 ay = _mm256_fmadd_ps(_mm256_loadu_ps(s.forceY + i), invMass, _mm256_loadu_ps(s.accY + i));
+		__m256 az = _mm256_fmadd_ps(_mm256_loadu_ps(s.forceZ + i), invMass, _mm256_loadu_ps(s.accZ + i));
+		__m256 vx = _mm256_loadu_ps(s.velX + i);
+		__m256 vy = _mm256_loadu_ps(s.velY + i);
+		__m256 vz = _mm256_loadu_ps(s.velZ + i);
+
+		//p + V*t + A*(t^2/2) as two fused multiply-adds
+		_mm256_storeu_ps(s.posX + i, _mm256_fmadd_ps(ax, halfT2, _mm256_fmadd_ps(vx, t, _mm256_loadu_ps(s.posX + i))));
+		_mm256_storeu_ps(s.posY + i, _mm256_fmadd_ps(ay, halfT2, _mm256_fmadd_ps(vy, t, _mm256_loadu_ps(s.posY + i))));
+		_mm256_storeu_ps(s.posZ + i, _mm256_fmadd_ps(az, halfT2, _mm256_fmadd_ps(vz, t, _mm256_loadu_ps(s.posZ + i))));
+
+		_mm256_storeu_ps(s.velX + i, _mm256_fmadd_ps(ax, t, vx));
+		_mm256_storeu_ps(s.velY + i, _mm256_fmadd_ps(ay, t, vy));
+		_mm256_storeu_ps(s.velZ + i, _mm256_fmadd_ps(az, t, vz));
+	}
+
+	IntegrateScalar(s, i, end, time);
+}
+
+#endif
@@ -0,0 +1,42 @@
+#include "ParticleKernels.h"
+
+#if P6_KERNELS_X86
+
+#include <immintrin.h>
+
+using namespace P6;
+
+P6_TARGET_AVX512 void Kernels::IntegrateAVX512(const ParticleStreams& s, size_t begin, size_t end, float time) {
+	const __m512 timeAll = _mm512_set1_ps(time);
+	const __m512 half = _mm512_set1_ps(0.5f);
+
+	size_t i = begin;
+	for (; i + 16 <= end; i += 16) {
+		//active lanes get the time, inactive ones step with 0
+		__m512i lanes = _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s.active + i)));
+		__m512 t = _mm512_maskz_mov_ps(_mm512_test_epi32_mask(lanes, lanes), timeAll);
+		__m512 halfT2 = _mm512_mul_ps(_mm512_mul_ps(t, t), half);
+
+		//A = constant acceleration + F / m
+		__m512 invMass = _mm512_loadu_ps(s.invMass + i);
+		__m512 ax = _mm512_fmadd_ps(_mm512_loadu_ps(s.forceX + i), invMass, _mm512_loadu_ps(s.accX + i));
+		__m512 ay = _mm512_fmadd_ps(_mm512_loadu_ps(s.forceY + i), invMass, _mm512_loadu_ps(s.accY + i));
+		__m512 az = _mm512_fmadd_ps(_mm512_loadu_ps(s.forceZ + i), invMass, _mm512_loadu_ps(s.accZ + i));
+		__m512 vx = _mm512_loadu_ps(s.velX + i);
+		__m512 vy = _mm512_loadu_ps(s.velY + i);
+		__m512 vz = _mm512_loadu_ps(s.velZ + i);
+
+		//p + V*t + A*(t^2/2) as two fused multiply-adds
+		_mm512_storeu_ps(s.posX + i, _mm512_fmadd_ps(ax, halfT2, _mm512_fmadd_ps(vx, t, _mm512_loadu_ps(s.posX + i))));
+		_mm512_storeu_ps(s.posY + i, _mm512_fmadd_ps(ay, halfT2, _mm512_fmadd_ps(vy, t, _mm512_loadu_ps(s.posY + i))));
+		_mm512_storeu_ps(s.posZ + i, _mm512_fmadd_ps(az, halfT2, _mm512_fmadd_ps(vz, t, _mm512_loadu_ps(s.posZ + i))));
+
+		_mm512_storeu_ps(s.velX + i, _mm512_fmadd_ps(ax, t, vx));
+		_mm512_storeu_ps(s.velY + i, _mm512_fmadd_ps(ay, t, vy));
+		_mm512_storeu_ps(s.velZ + i, _mm512_fmadd_ps(az, t, vz));
+	}
+
+	IntegrateScalar(s, i, end, time);
+}
+
+#endif
@@ -0,0 +1,53 @@
+#include "ParticleKernels.h"
+
+#if P6_KERNELS_X86
+
+#include <cstring>
+#include <emmintrin.h>
+
+using namespace P6;
+
+namespace {
+	//time for every active lane, 0 for the inactive ones
+	P6_TARGET_SSE2 inline __m128 ActiveTime(const uint8_t* active, __m128 time) {
+		int bytes;
+		std::memcpy(&bytes, active, sizeof(bytes));
+		const __m128i zero = _mm_setzero_si128();
+		__m128i lanes = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+		__m128 inactive = _mm_castsi128_ps(_mm_cmpeq_epi32(lanes, zero));
+		return _mm_andnot_ps(inactive, time);
+	}
+}
+
+P6_TARGET_SSE2 void Kernels::IntegrateSSE2(const ParticleStreams& s, size_t begin, size_t end, float time) {
+	const __m128 timeAll = _mm_set1_ps(time);
+	const __m128 half = _mm_set1_ps(0.5f);
+
+	size_t i = begin;
+	for (; i + 4 <= end; i += 4) {
+		__m128 t = ActiveTime(s.active + i, timeAll);
+		__m128 halfT2 = _mm_mul_ps(_mm_mul_ps(t, t), half);
+
+		//A = constant acceleration + F / m
+		__m128 invMass = _mm_loadu_ps(s.invMass + i);
+		__m128 ax = _mm_add_ps(_mm_loadu_ps(s.accX + i), _mm_mul_ps(_mm_loadu_ps(s.forceX + i), invMass));
+		__m128 ay = _mm_add_ps(_mm_loadu_ps(s.accY + i), _mm_mul_ps(_mm_loadu_ps(s.forceY + i), invMass));
+		__m128 az = _mm_add_ps(_mm_loadu_ps(s.accZ + i), _mm_mul_ps(_mm_loadu_ps(s.forceZ + i), invMass));
+		__m128 vx = _mm_loadu_ps(s.velX + i);
+		__m128 vy = _mm_loadu_ps(s.velY + i);
+		__m128 vz = _mm_loadu_ps(s.velZ + i);
+
+		//same operation order as the scalar kernel: (p + V*t) + A*(t^2/2)
+		_mm_storeu_ps(s.posX + i, _mm_add_ps(_mm_add_ps(_mm_loadu_ps(s.posX + i), _mm_mul_ps(vx, t)), _mm_mul_ps(ax, halfT2)));
+		_mm_storeu_ps(s.posY + i, _mm_add_ps(_mm_add_ps(_mm_loadu_ps(s.posY + i), _mm_mul_ps(vy, t)), _mm_mul_ps(ay, halfT2)));
+		_mm_storeu_ps(s.posZ + i, _mm_add_ps(_mm_add_ps(_mm_loadu_ps(s.posZ + i), _mm_mul_ps(vz, t)), _mm_mul_ps(az, halfT2)));
+
+		_mm_storeu_ps(s.velX + i, _mm_add_ps(vx, _mm_mul_ps(ax, t)));
+		_mm_storeu_ps(s.velY + i, _mm_add_ps(vy, _mm_mul_ps(ay, t)));
+		_mm_storeu_ps(s.velZ + i, _mm_add_ps(vz, _mm_mul_ps(az, t)));
+	}
+
+	IntegrateScalar(s, i, end, time);
+}
+
+#endif
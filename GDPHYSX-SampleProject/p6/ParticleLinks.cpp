@@ -0,0 +1,173 @@
+#include "ParticleLinks.h"
+#include "ContactResolver.h"
+#include "ParticleWorld.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace P6;
+
+uint32_t ParticleLinks::addRod(ParticleHandle a, ParticleHandle b, float length) {
+	return add(a, b, MyVector(), length, 0, true);
+}
+
+uint32_t ParticleLinks::addCable(ParticleHandle a, ParticleHandle b, float maxLength, float restitution) {
+	return add(a, b, MyVector(), maxLength, restitution, false);
+}
+
+uint32_t ParticleLinks::addAnchoredRod(ParticleHandle particle, const MyVector& anchor, float length) {
+	return add(particle, ParticleHandle(), anchor, length, 0, true);
+}
+
+uint32_t ParticleLinks::addAnchoredCable(ParticleHandle particle, const MyVector& anchor, float maxLength, float restitution) {
+	return add(particle, ParticleHandle(), anchor, maxLength, restitution, false);
+}
+
+uint32_t ParticleLinks::add(ParticleHandle a, ParticleHandle b, const MyVector& anchor, float length, float restitution, bool rod) {
+	first.push_back(a);
+	second.push_back(b);
+	anchorX.push_back(anchor.x);
+	anchorY.push_back(anchor.y);
+	anchorZ.push_back(anchor.z);
+	lengths.push_back(length);
+	restitutions.push_back(restitution);
+	rods.push_back(rod ? 1 : 0);
+	carried.push_back(0);
+	located = false;
+	return static_cast<uint32_t>(first.size() - 1);
+}
+
+void ParticleLinks::setAnchor(uint32_t link, const MyVector& anchor) {
+	anchorX[link] = anchor.x;
+	anchorY[link] = anchor.y;
+	anchorZ[link] = anchor.z;
+}
+
+void ParticleLinks::setLength(uint32_t link, float length) {
+	lengths[link] = length;
+}
+
+void ParticleLinks::clear() {
+	first.clear();
+	second.clear();
+	anchorX.clear();
+	anchorY.clear();
+	anchorZ.clear();
+	lengths.clear();
+	restitutions.clear();
+	rods.clear();
+	carried.clear();
+	contact.clear();
+	indexA.clear();
+	indexB.clear();
+	located = false;
+}
+
+void ParticleLinks::locate(const ParticleWorld& world) {
+	if (located && locatedWorld == &world && locatedLayout == world.layoutVersion()) return;
+
+	const size_t count = first.size();
+	indexA.resize(count);
+	indexB.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		const size_t a = world.indexOf(first[i]);
+		const bool anchored = !second[i].IsValid();
+		const size_t b = anchored ? ParticleWorld::NotFound : world.indexOf(second[i]);
+		const bool dead = a == ParticleWorld::NotFound || (!anchored && b == ParticleWorld::NotFound);
+		indexA[i] = dead ? None : static_cast<uint32_t>(a);
+		indexB[i] = anchored ? None : static_cast<uint32_t>(b);
+	}
+	located = true;
+	locatedWorld = &world;
+	locatedLayout = world.layoutVersion();
+}
+
+void ParticleLinks::addContacts(const ParticleStreams& s, size_t awake, ContactResolver& resolver) {
+	contact.clear();
+	contact.resize(indexA.size(), static_cast<uint32_t>(None));
+	for (size_t i = 0; i < indexA.size(); i++) {
+		const uint32_t a = indexA[i], b = indexB[i];
+		if (a == None) continue;
+
+		//the contact's a is an awake end, the other end is a particle or the anchor
+		uint32_t self, other;
+		if (a < awake) {
+			self = a;
+			other = b;
+		}
+		else if (b != None && b < awake) {
+			self = b;
+			other = a;
+		}
+		else {
+			continue;
+		}
+		const bool particle = other != None;
+		const float ox = particle ? s.posX[other] : anchorX[i];
+		const float oy = particle ? s.posY[other] : anchorY[i];
+		const float oz = particle ? s.posZ[other] : anchorZ[i];
+
+		ParticleContact link;
+		link.a = self;
+		link.b = particle && other < awake ? other : ParticleContact::None;
+		const float movable = s.invMass[self] + (link.b != ParticleContact::None ? s.invMass[link.b] : 0.0f);
+		if (movable <= 0) continue;
+
+		const float dx = ox - s.posX[self];
+		const float dy = oy - s.posY[self];
+		const float dz = oz - s.posZ[self];
+		const float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+		const float stretch = distance - lengths[i];
+		//towards the other end, so a too long link pulls a in along it
+		link.normal = distance > 0 ? MyVector(dx / distance, dy / distance, dz / distance) : MyVector(0, 1, 0);
+
+		const bool taut = rods[i] || stretch >= 0;
+		const float warm = taut ? carried[i] : 0.0f;
+		if (warm != 0) {
+			const float wa = warm * s.invMass[self];
+			s.velX[self] += link.normal.x * wa;
+			s.velY[self] += link.normal.y * wa;
+			s.velZ[self] += link.normal.z * wa;
+			if (link.b != ParticleContact::None) {
+				const float wb = warm * s.invMass[link.b];
+				s.velX[link.b] -= link.normal.x * wb;
+				s.velY[link.b] -= link.normal.y * wb;
+				s.velZ[link.b] -= link.normal.z * wb;
+			}
+		}
+		carried[i] = warm;
+		if (!taut) continue;
+
+		contact[i] = static_cast<uint32_t>(resolver.size());
+		if (rods[i]) {
+			//whichever way the ends move along the rod one of the two is closing, and whichever way it is off one overlaps
+			link.penetration = stretch;
+			link.restitution = 0;
+			resolver.add(link);
+			link.normal = link.normal * -1.0f;
+			link.penetration = -stretch;
+			resolver.add(link);
+		}
+		else {
+			link.penetration = stretch;
+			link.restitution = restitutions[i];
+			resolver.add(link);
+		}
+	}
+}
+
+void ParticleLinks::collect(const ContactResolver& resolver) {
+	for (size_t i = 0; i < contact.size(); i++) {
+		const uint32_t c = contact[i];
+		if (c == None) {
+			carried[i] = 0;
+		}
+		else if (rods[i]) {
+			carried[i] += resolver.impulse(c) - resolver.impulse(c + 1);
+		}
+		else {
+			//a cable only ever pulls
+			carried[i] = restitutions[i] > 0 ? 0.0f : std::max(0.0f, carried[i] + resolver.impulse(c));
+		}
+	}
+}
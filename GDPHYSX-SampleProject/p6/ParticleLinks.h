@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MyVector.h"
+#include "ParticleHandle.h"
+#include "ParticleStreams.h"
+
+namespace P6 {
+	class ContactResolver;
+	class ParticleWorld;
+
+	//Hard distance constraints between particles, for bridges, chains and other mass-aggregate bodies.
+	//A rod keeps its two ends exactly length apart, a cable lets them come closer but never further
+	//than its length. Neither is a force: every step each link that is off its length becomes a contact
+	//and goes through the ContactResolver with the collisions, so a stiff structure holds at the normal
+	//step size instead of needing the tiny steps a stiff spring would. A rod is two opposite contacts,
+	//one of which is always closing, so the resolver stops the ends both from drifting apart and from
+	//running into each other; a cable is one contact while taut and bounces with its restitution.
+	//Each link starts a step by applying the impulse the resolver gave it the step before (warm
+	//starting), so a hanging chain's tension doesn't have to be built up again from nothing every step.
+	//Bouncy cables start cold, their last bounce isn't something to repeat. Long chains and decks still
+	//want more than the resolver's default iterations: contacts().setIterations, or setSweeps with a JobSystem.
+	//Linked particles fall asleep and wake up together. With setCollisions on, linked particles still
+	//collide with each other, so keep their radii under half the link length.
+	//Links whose particle was killed do nothing; their ids stay valid until clear().
+	//
+	//	ParticleLinks& links = world.links();
+	//	links.addRod(a, b, 2.0f);
+	//	links.addAnchoredCable(b, MyVector(0, 10, 0), 5.0f, 0.3f);
+	class ParticleLinks {
+		public:
+			//returns the link's id, ids count up from 0
+			uint32_t addRod(ParticleHandle a, ParticleHandle b, float length);
+			uint32_t addCable(ParticleHandle a, ParticleHandle b, float maxLength, float restitution = 0);
+			//the same to a fixed point
+			uint32_t addAnchoredRod(ParticleHandle particle, const MyVector& anchor, float length);
+			uint32_t addAnchoredCable(ParticleHandle particle, const MyVector& anchor, float maxLength, float restitution = 0);
+
+			size_t size() const { return first.size(); }
+			bool empty() const { return first.empty(); }
+
+			//can be changed between steps
+			void setAnchor(uint32_t link, const MyVector& anchor);
+			void setLength(uint32_t link, float length);
+			float length(uint32_t link) const { return lengths[link]; }
+
+			void clear();
+
+			//looks the ends up in the world's current layout, only does work after it changed
+			void locate(const ParticleWorld& world);
+			//dense indices of the ends as of the last locate; None for a dead end, and second is None for anchored links
+			static constexpr uint32_t None = 0xFFFFFFFFu;
+			const uint32_t* firstIndices() const { return indexA.data(); }
+			const uint32_t* secondIndices() const { return indexB.data(); }
+
+			//warm starts the links with an end in [0, awake) and adds their contacts; locate first
+			//a sleeping end has to be immovable, it is then taken as scenery
+			void addContacts(const ParticleStreams& s, size_t awake, ContactResolver& resolver);
+			//keeps the impulses the resolver just gave the contacts of the last addContacts
+			void collect(const ContactResolver& resolver);
+
+		private:
+			uint32_t add(ParticleHandle a, ParticleHandle b, const MyVector& anchor, float length, float restitution, bool rod);
+
+			//per link; second is invalid for anchored links, which use the anchor instead
+			std::vector<ParticleHandle> first, second;
+			std::vector<float> anchorX, anchorY, anchorZ;
+			std::vector<float> lengths, restitutions;
+			std::vector<uint8_t> rods;
+			//per link: the impulse pulling the ends together over the last step, and its first contact in the resolver
+			std::vector<float> carried;
+			std::vector<uint32_t> contact;
+
+			std::vector<uint32_t> indexA, indexB;
+			const ParticleWorld* locatedWorld = nullptr;
+			size_t locatedLayout = 0;
+			bool located = false;
+	};
+}
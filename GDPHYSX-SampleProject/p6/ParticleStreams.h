@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+namespace P6 {
+	//raw column pointers of a ParticleBuffer, one contiguous array per field
+	//every column starts on a ParticleBuffer::Alignment boundary
+	//kept free of glm/MyVector so the SIMD kernel files only see plain floats
+	struct ParticleStreams {
+		float* mass = nullptr;
+		//1 / mass, 0 for particles without mass so forces leave them alone
+		float* invMass = nullptr;
+		float* radius = nullptr;
+
+		float* posX = nullptr;
+		float* posY = nullptr;
+		float* posZ = nullptr;
+
+		//position at the start of the last step, for render interpolation
+		float* prevX = nullptr;
+		float* prevY = nullptr;
+		float* prevZ = nullptr;
+
+		float* velX = nullptr;
+		float* velY = nullptr;
+		float* velZ = nullptr;
+
+		float* accX = nullptr;
+		float* accY = nullptr;
+		float* accZ = nullptr;
+
+		//force accumulator, summed by the force generators and cleared every step
+		float* forceX = nullptr;
+		float* forceY = nullptr;
+		float* forceZ = nullptr;
+
+		uint8_t* active = nullptr;
+		uint8_t* moving = nullptr;
+		//swept against the others every step instead of only tested where it ends up
+		uint8_t* fast = nullptr;
+	};
+}
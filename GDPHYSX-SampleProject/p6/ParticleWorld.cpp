@@ -0,0 +1,535 @@
+#include "ParticleWorld.h"
+#include "JobSystem.h"
+#include "SignedDistanceField.h"
+#include "SweptSphere.h"
+#include "TriangleBvh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace P6;
+
+ParticleWorld::ParticleWorld(size_t capacity)
+	: particles(capacity), slotCount(capacity),
+	slotIndex(capacity), slotGeneration(capacity, 0), denseSlot(capacity), freeHead(ParticleHandle::Invalid),
+	restSteps(capacity, 0), slotIsland(capacity, 0), sleepForce(capacity * 3, 0.0f) {
+	clear();
+}
+
+void ParticleWorld::clear() {
+	particles.clear();
+	awake = 0;
+	sleepGridDirty = true;
+	layout++;
+
+	//chain every slot into the free list, lowest slot first
+	for (size_t i = 0; i < slotCount; i++) {
+		slotIndex[i] = i + 1 < slotCount ? static_cast<uint32_t>(i + 1) : ParticleHandle::Invalid;
+		slotGeneration[i]++;
+	}
+	freeHead = slotCount > 0 ? 0 : ParticleHandle::Invalid;
+}
+
+ParticleHandle ParticleWorld::spawn(const P6Particle& particle) {
+	ParticleHandle handle;
+	spawn(&particle, 1, &handle);
+	return handle;
+}
+
+size_t ParticleWorld::spawn(const P6Particle* source, size_t amount, ParticleHandle* handles) {
+	size_t spawned = 0;
+	for (; spawned < amount && freeHead != ParticleHandle::Invalid; spawned++) {
+		uint32_t slot = freeHead;
+		freeHead = slotIndex[slot];
+
+		//capacity was reserved in the constructor, so this never reallocates
+		size_t index = particles.add(source[spawned]);
+		slotIndex[slot] = static_cast<uint32_t>(index);
+		denseSlot[index] = slot;
+
+		handles[spawned].slot = slot;
+		handles[spawned].generation = slotGeneration[slot];
+
+		//new particles start awake, the first sleeper makes room at the end of the awake ones
+		restSteps[slot] = 0;
+		swapParticles(index, awake);
+		awake++;
+	}
+
+	for (size_t i = spawned; i < amount; i++) {
+		handles[i] = ParticleHandle();
+	}
+	return spawned;
+}
+
+bool ParticleWorld::kill(ParticleHandle handle) {
+	if (!alive(handle)) return false;
+
+	uint32_t slot = handle.slot;
+	uint32_t index = slotIndex[slot];
+	uint32_t last = static_cast<uint32_t>(particles.size() - 1);
+
+	//the last awake particle fills the hole first, so the awake ones stay packed
+	if (index < awake) {
+		awake--;
+		swapParticles(index, awake);
+		index = static_cast<uint32_t>(awake);
+	}
+
+	//the buffer moves its last particle into the hole, follow it in the slot table
+	particles.remove(index);
+	if (index != last) {
+		uint32_t movedSlot = denseSlot[last];
+		denseSlot[index] = movedSlot;
+		slotIndex[movedSlot] = index;
+	}
+
+	slotGeneration[slot]++;
+	slotIndex[slot] = freeHead;
+	freeHead = slot;
+	layout++;
+	return true;
+}
+
+size_t ParticleWorld::kill(const ParticleHandle* handles, size_t amount) {
+	size_t killed = 0;
+	for (size_t i = 0; i < amount; i++) {
+		if (kill(handles[i])) killed++;
+	}
+	return killed;
+}
+
+bool ParticleWorld::alive(ParticleHandle handle) const {
+	//kill and clear bump the generation, so handles to freed slots never match
+	return handle.slot < slotCount && slotGeneration[handle.slot] == handle.generation;
+}
+
+size_t ParticleWorld::indexOf(ParticleHandle handle) const {
+	return alive(handle) ? slotIndex[handle.slot] : NotFound;
+}
+
+ParticleHandle ParticleWorld::handleAt(size_t index) const {
+	ParticleHandle handle;
+	handle.slot = denseSlot[index];
+	handle.generation = slotGeneration[handle.slot];
+	return handle;
+}
+
+void ParticleWorld::update(float time) {
+	registry.applyForces(*this);
+	wakeForced(time);
+	particles.update(time, awake);
+	fabric.solve(*this, time);
+	limits.apply(particles.streams(), awake, time, jobs);
+	resolveContacts(time);
+	particles.clearForces();
+	fallAsleep();
+}
+
+void ParticleWorld::setCollisions(bool enabled, float bounce) {
+	collide = enabled;
+	restitution = bounce;
+}
+
+void ParticleWorld::setSleeping(bool enabled, float speed, int steps) {
+	if (!enabled) wakeAll();
+	sleepy = enabled;
+	sleepSpeed = speed;
+	sleepSteps = std::max(1, std::min(steps, 65535));
+}
+
+bool ParticleWorld::sleeping(ParticleHandle handle) const {
+	return alive(handle) && slotIndex[handle.slot] >= awake;
+}
+
+bool ParticleWorld::wake(ParticleHandle handle) {
+	if (!alive(handle)) return false;
+	const size_t index = slotIndex[handle.slot];
+	if (index >= awake) {
+		markIsland(index);
+		wakeMarked();
+	}
+	return true;
+}
+
+void ParticleWorld::wakeAll() {
+	ParticleStreams& s = particles.streams();
+	for (size_t i = awake; i < particles.size(); i++) {
+		restSteps[denseSlot[i]] = 0;
+		s.moving[i] = 1;
+	}
+	awake = particles.size();
+}
+
+void ParticleWorld::swapParticles(size_t a, size_t b) {
+	if (a == b) return;
+	layout++;
+	particles.swap(a, b);
+	std::swap(denseSlot[a], denseSlot[b]);
+	slotIndex[denseSlot[a]] = static_cast<uint32_t>(a);
+	slotIndex[denseSlot[b]] = static_cast<uint32_t>(b);
+}
+
+void ParticleWorld::markIsland(size_t index) {
+	wakeIslands.push_back(slotIsland[denseSlot[index]]);
+}
+
+void ParticleWorld::wakeMarked() {
+	if (wakeIslands.empty()) return;
+	std::sort(wakeIslands.begin(), wakeIslands.end());
+
+	//one pass over the sleepers; whatever a swap brings back to i was already looked at
+	ParticleStreams& s = particles.streams();
+	for (size_t i = awake; i < particles.size(); i++) {
+		const uint32_t slot = denseSlot[i];
+		if (!std::binary_search(wakeIslands.begin(), wakeIslands.end(), slotIsland[slot])) continue;
+		swapParticles(i, awake);
+		restSteps[slot] = 0;
+		s.moving[awake] = 1;
+		awake++;
+	}
+	wakeIslands.clear();
+}
+
+void ParticleWorld::wakeForced(float time) {
+	if (!sleepy || awake == particles.size()) return;
+
+	const ParticleStreams& s = particles.streams();
+	const float limit = sleepSpeed * sleepSpeed;
+	for (size_t i = awake; i < particles.size(); i++) {
+		float* asleep = &sleepForce[denseSlot[i] * 3];
+		//the first step asleep only measures what holds it there
+		if (std::isnan(asleep[0])) {
+			asleep[0] = s.forceX[i];
+			asleep[1] = s.forceY[i];
+			asleep[2] = s.forceZ[i];
+			continue;
+		}
+
+		//the change would get it past the sleep speed within this step
+		const float push = s.invMass[i] * time;
+		const float dx = (s.forceX[i] - asleep[0]) * push, dy = (s.forceY[i] - asleep[1]) * push, dz = (s.forceZ[i] - asleep[2]) * push;
+		if (dx * dx + dy * dy + dz * dz > limit) markIsland(i);
+	}
+	wakeMarked();
+}
+
+void ParticleWorld::fallAsleep() {
+	if (!sleepy) return;
+
+	ParticleStreams& s = particles.streams();
+	const float limit = sleepSpeed * sleepSpeed;
+	bool ready = false;
+	for (size_t i = 0; i < awake; i++) {
+		uint16_t& rested = restSteps[denseSlot[i]];
+		const float speed2 = s.velX[i] * s.velX[i] + s.velY[i] * s.velY[i] + s.velZ[i] * s.velZ[i];
+		if (speed2 < limit) {
+			if (rested < 65535) rested++;
+			ready = ready || rested >= sleepSteps;
+		}
+		else {
+			rested = 0;
+		}
+	}
+	if (!ready) return;
+
+	//islands: union-find over this step's contacts, the links and the cloths, nothing joins through scenery or immovable particles
+	islandParent.resize(awake);
+	for (size_t i = 0; i < awake; i++) islandParent[i] = static_cast<uint32_t>(i);
+	auto find = [&](uint32_t i) {
+		while (islandParent[i] != i) {
+			islandParent[i] = islandParent[islandParent[i]];
+			i = islandParent[i];
+		}
+		return i;
+	};
+	auto join = [&](uint32_t a, uint32_t b) {
+		if (s.invMass[a] <= 0 || s.invMass[b] <= 0) return;
+		const uint32_t ra = find(a), rb = find(b);
+		if (ra != rb) islandParent[std::max(ra, rb)] = std::min(ra, rb);
+	};
+	const ParticleContact* contact = resolver.contacts();
+	for (size_t c = 0; c < resolver.size(); c++) {
+		if (contact[c].b != ParticleContact::None) join(contact[c].a, contact[c].b);
+	}
+	//linked particles sleep together, slack cables included; resolveContacts located the links this step
+	const uint32_t* first = linkage.firstIndices();
+	const uint32_t* second = linkage.secondIndices();
+	for (size_t i = 0; i < linkage.size(); i++) {
+		if (first[i] < awake && second[i] < awake) join(first[i], second[i]);
+	}
+	//a cloth is one island, its particles joined in grid order
+	if (!fabric.empty()) fabric.locate(*this);
+	for (size_t c = 0; c < fabric.clothCount(); c++) {
+		const uint32_t* member = fabric.members(c);
+		uint32_t last = ClothSolver::None;
+		for (size_t m = 0; m < fabric.memberCount(c); m++) {
+			if (member[m] >= awake || s.invMass[member[m]] <= 0) continue;
+			if (last != ClothSolver::None) join(last, member[m]);
+			last = member[m];
+		}
+	}
+
+	//an island sleeps only if all of it rested long enough
+	islandRested.assign(awake, 1);
+	for (size_t i = 0; i < awake; i++) {
+		if (restSteps[denseSlot[i]] < sleepSteps) islandRested[find(static_cast<uint32_t>(i))] = 0;
+	}
+	sleepers.clear();
+	for (size_t i = 0; i < awake; i++) {
+		const uint32_t root = find(static_cast<uint32_t>(i));
+		if (!islandRested[root]) continue;
+		//the root's slot names the island, it is unique among the living
+		const uint32_t slot = denseSlot[i];
+		slotIsland[slot] = denseSlot[root];
+		sleepForce[slot * 3] = std::numeric_limits<float>::quiet_NaN();
+		sleepers.push_back(i);
+	}
+	if (sleepers.empty()) return;
+
+	//highest first, so the last awake particle swapped in is never one still waiting to go
+	for (size_t n = sleepers.size(); n-- > 0;) {
+		awake--;
+		swapParticles(sleepers[n], awake);
+		s.velX[awake] = s.velY[awake] = s.velZ[awake] = 0;
+		//no motion left to interpolate
+		s.prevX[awake] = s.posX[awake];
+		s.prevY[awake] = s.posY[awake];
+		s.prevZ[awake] = s.posZ[awake];
+		s.moving[awake] = 0;
+	}
+	sleepGridDirty = true;
+}
+
+void ParticleWorld::sweepFast(float time) {
+	ParticleStreams& s = particles.streams();
+	const size_t count = particles.size();
+
+	fastIndices.clear();
+	for (size_t i = 0; i < awake; i++) {
+		if (s.fast[i] && s.active[i]) fastIndices.push_back(static_cast<uint32_t>(i));
+	}
+	if (fastIndices.empty() || time <= 0) return;
+
+	//Every particle moved in a straight line from prev to pos during the step. A fast one is swept
+	//against all the others, and at its first time of impact both are put back to where they touched,
+	//bounced, and sent along the rest of the step with their new velocities. Then it is swept again
+	//from there. Only the fast particles pay for this; the rest keep the one big step.
+
+	//swept box of every particle, kept up to date as hits bend paths
+	sweptLow.resize(count * 3);
+	sweptHigh.resize(count * 3);
+	auto sweptBox = [&](size_t k) {
+		const float r = s.radius[k];
+		sweptLow[k * 3] = std::fmin(s.prevX[k], s.posX[k]) - r;
+		sweptLow[k * 3 + 1] = std::fmin(s.prevY[k], s.posY[k]) - r;
+		sweptLow[k * 3 + 2] = std::fmin(s.prevZ[k], s.posZ[k]) - r;
+		sweptHigh[k * 3] = std::fmax(s.prevX[k], s.posX[k]) + r;
+		sweptHigh[k * 3 + 1] = std::fmax(s.prevY[k], s.posY[k]) + r;
+		sweptHigh[k * 3 + 2] = std::fmax(s.prevZ[k], s.posZ[k]) + r;
+	};
+	for (size_t k = 0; k < count; k++) sweptBox(k);
+
+	for (uint32_t i : fastIndices) {
+		float from = 0;
+		for (int substep = 0; substep < fastSubsteps; substep++) {
+			const float ri = s.radius[i];
+			const float mix = s.posX[i] - s.prevX[i], miy = s.posY[i] - s.prevY[i], miz = s.posZ[i] - s.prevZ[i];
+			const float* low = &sweptLow[i * 3];
+			const float* high = &sweptHigh[i * 3];
+
+			float first = 2.0f;
+			uint32_t hit = ParticleContact::None;
+			for (uint32_t j = 0; j < count; j++) {
+				//swept boxes first, it throws out nearly everything
+				const float* lowJ = &sweptLow[j * 3];
+				const float* highJ = &sweptHigh[j * 3];
+				if (lowJ[0] > high[0] || highJ[0] < low[0] || lowJ[1] > high[1] || highJ[1] < low[1] || lowJ[2] > high[2] || highJ[2] < low[2]) continue;
+				if (j == i || (s.invMass[i] <= 0 && s.invMass[j] <= 0)) continue;
+
+				const MyVector separation(s.prevX[i] - s.prevX[j], s.prevY[i] - s.prevY[j], s.prevZ[i] - s.prevZ[j]);
+				const MyVector motion(mix - (s.posX[j] - s.prevX[j]), miy - (s.posY[j] - s.prevY[j]), miz - (s.posZ[j] - s.prevZ[j]));
+				float t;
+				if (SweptSphereHit(separation, motion, ri + s.radius[j], from, t) && t < first) {
+					first = t;
+					hit = j;
+				}
+			}
+			if (hit == ParticleContact::None) break;
+
+			//both where they touched
+			const uint32_t j = hit;
+			if (j >= awake) markIsland(j);
+			auto at = [&](uint32_t k, float t) {
+				return MyVector(s.prevX[k] + (s.posX[k] - s.prevX[k]) * t, s.prevY[k] + (s.posY[k] - s.prevY[k]) * t, s.prevZ[k] + (s.posZ[k] - s.prevZ[k]) * t);
+			};
+			const MyVector touchI = at(i, first), touchJ = at(j, first);
+
+			ParticleContact contact;
+			contact.a = i;
+			contact.b = j;
+			contact.normal = MyVector(touchI - touchJ).Direction();
+			contact.restitution = restitution;
+			contact.resolveVelocity(s, time * (1.0f - first));
+
+			//straight on from the touching point with the new velocity; prev moves back along the same
+			//line, so the path stays linear in t for the next sweep and for render interpolation
+			const float rest = time * (1.0f - first);
+			for (uint32_t k : { i, j }) {
+				if (s.invMass[k] <= 0) continue;
+				const MyVector touch = k == i ? touchI : touchJ;
+				s.posX[k] = touch.x + s.velX[k] * rest;
+				s.posY[k] = touch.y + s.velY[k] * rest;
+				s.posZ[k] = touch.z + s.velZ[k] * rest;
+				s.prevX[k] = s.posX[k] - s.velX[k] * time;
+				s.prevY[k] = s.posY[k] - s.velY[k] * time;
+				s.prevZ[k] = s.posZ[k] - s.velZ[k] * time;
+				sweptBox(k);
+			}
+			from = first;
+		}
+	}
+}
+
+void ParticleWorld::staticContacts(size_t begin, size_t end, std::vector<ParticleContact>& out) const {
+	const ParticleStreams& s = particles.streams();
+	const SphereTriangleKernel kernel = SphereTriangleKernelFor(ActiveSimdLevel());
+
+	for (size_t i = begin; i < end; i++) {
+		if (!s.active[i] || s.invMass[i] <= 0) continue;
+
+		const MyVector center(s.posX[i], s.posY[i], s.posZ[i]);
+		const float radius = s.radius[i];
+		float distance;
+		MyVector gradient;
+		if (shape && shape->sample(center, distance, gradient) && distance < radius) {
+			const float length = gradient.Magnitude();
+			//flat spots only happen past the band, where nothing is close enough to push
+			if (length > 0) {
+				ParticleContact contact;
+				contact.a = static_cast<uint32_t>(i);
+				contact.b = ParticleContact::None;
+				contact.normal = gradient * (1.0f / length);
+				contact.penetration = radius - distance;
+				contact.restitution = restitution;
+				out.push_back(contact);
+			}
+		}
+		if (!level) continue;
+
+		level->overlapSphere(center, radius, kernel, [&](const TriangleHit& hit) {
+			ParticleContact contact;
+			contact.a = static_cast<uint32_t>(i);
+			contact.b = ParticleContact::None;
+			const float distance = std::sqrt(hit.distance2);
+			if (distance > 0) {
+				contact.normal = (center - hit.closest) * (1.0f / distance);
+			}
+			else {
+				//centre right on the surface: push back to the side it came from
+				const bool behind = s.velX[i] * hit.normal.x + s.velY[i] * hit.normal.y + s.velZ[i] * hit.normal.z > 0;
+				contact.normal = behind ? hit.normal * -1.0f : hit.normal;
+			}
+			contact.penetration = radius - distance;
+			contact.restitution = restitution;
+			out.push_back(contact);
+		});
+	}
+}
+
+void ParticleWorld::resolveContacts(float time) {
+	resolver.clear();
+	if (!collide && !level && !shape && linkage.empty()) return;
+	const ParticleStreams& s = particles.streams();
+	if (collide) {
+		sweepFast(time);
+
+		//awake particles touching sleeping ones wake their islands, before anything is generated
+		if (awake < particles.size()) {
+			float largest = 0;
+			for (size_t i = 0; i < awake; i++) largest = std::max(largest, s.radius[i]);
+			if (sleepGridDirty || 2.0f * largest > sleepGrid.cellSize()) {
+				sleepGrid.setCellSize(2.0f * largest);
+				sleepGrid.build(s, awake, particles.size());
+				sleepGridFirst = awake;
+				sleepGridHandles.clear();
+				for (size_t i = awake; i < particles.size(); i++) sleepGridHandles.push_back(handleAt(i));
+				sleepGridDirty = false;
+			}
+			pairs.clear();
+			sleepGrid.findPairs(s, 0, awake, pairs);
+			for (const ParticlePair& pair : pairs) {
+				//woken since the build, then the awake pairs below have it; killed, then nobody does
+				const size_t index = indexOf(sleepGridHandles[pair.b - sleepGridFirst]);
+				if (index != NotFound && index >= awake) markIsland(index);
+			}
+		}
+		wakeMarked();
+	}
+
+	if (!linkage.empty()) {
+		//a link pulls its sleeping end awake, unless that end never moves anyway
+		linkage.locate(*this);
+		if (awake < particles.size()) {
+			const uint32_t* first = linkage.firstIndices();
+			const uint32_t* second = linkage.secondIndices();
+			for (size_t i = 0; i < linkage.size(); i++) {
+				const uint32_t a = first[i], b = second[i];
+				if (a == ParticleLinks::None || b == ParticleLinks::None || (a < awake) == (b < awake)) continue;
+				const uint32_t sleeper = a < awake ? b : a;
+				if (s.invMass[sleeper] > 0) markIsland(sleeper);
+			}
+			wakeMarked();
+			linkage.locate(*this);
+		}
+	}
+
+	if (level || shape) {
+		//fixed chunks, so the contacts come out in the same order on any number of threads
+		const size_t grain = 1024;
+		const size_t chunks = (awake + grain - 1) / grain;
+		if (staticChunks.size() < chunks) staticChunks.resize(chunks);
+		auto collect = [&](size_t first, size_t last) {
+			for (size_t c = first; c < last; c++) {
+				staticChunks[c].clear();
+				staticContacts(c * grain, std::min((c + 1) * grain, awake), staticChunks[c]);
+			}
+		};
+		if (jobs) jobs->parallelFor(chunks, 1, collect);
+		else collect(0, chunks);
+
+		for (size_t c = 0; c < chunks; c++) {
+			for (const ParticleContact& contact : staticChunks[c]) resolver.add(contact);
+		}
+	}
+
+	pairs.clear();
+	if (collide) {
+		grid.build(s, awake);
+		grid.findPairs(pairs);
+	}
+
+	for (const ParticlePair& pair : pairs) {
+		if (s.invMass[pair.a] <= 0 && s.invMass[pair.b] <= 0) continue;
+
+		const float dx = s.posX[pair.a] - s.posX[pair.b];
+		const float dy = s.posY[pair.a] - s.posY[pair.b];
+		const float dz = s.posZ[pair.a] - s.posZ[pair.b];
+		const float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+		ParticleContact contact;
+		contact.a = pair.a;
+		contact.b = pair.b;
+		//exactly on top of each other: any direction will do, pick up
+		contact.normal = distance > 0 ? MyVector(dx / distance, dy / distance, dz / distance) : MyVector(0, 1, 0);
+		contact.penetration = s.radius[pair.a] + s.radius[pair.b] - distance;
+		contact.restitution = restitution;
+		resolver.add(contact);
+	}
+	linkage.addContacts(s, awake, resolver);
+
+	if (jobs) resolver.resolveColored(s, awake, time, *jobs);
+	else resolver.resolve(s, awake, time);
+	linkage.collect(resolver);
+}
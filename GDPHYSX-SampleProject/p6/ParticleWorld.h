@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Boundaries.h"
+#include "ClothSolver.h"
+#include "ContactResolver.h"
+#include "ForceRegistry.h"
+#include "P6Particle.h"
+#include "ParticleLinks.h"
+#include "ParticleBuffer.h"
+#include "ParticleHandle.h"
+#include "SpatialHashGrid.h"
+
+namespace P6 {
+	class JobSystem;
+	class SignedDistanceField;
+	class TriangleBvh;
+
+	//fixed-capacity particle pool
+	//live particles stay packed at the front of a ParticleBuffer, so update() never visits dead slots.
+	//Handles map to those dense indices through a slot table, freed slots are recycled through a
+	//free list, and all memory is allocated up front: spawn and kill never touch the heap.
+	//With sleeping on, the awake particles are packed in front of the sleeping ones as well, and a
+	//step only integrates, collides and resolves [0, awakeCount()).
+	class ParticleWorld {
+		public:
+			static constexpr size_t NotFound = static_cast<size_t>(-1);
+
+			explicit ParticleWorld(size_t capacity);
+
+			size_t size() const { return particles.size(); }
+			size_t capacity() const { return slotCount; }
+			bool full() const { return particles.size() == slotCount; }
+
+			//returns an invalid handle when the pool is full
+			ParticleHandle spawn(const P6Particle& particle);
+			//spawns as many as fit, writes their handles and returns how many were spawned
+			size_t spawn(const P6Particle* particles, size_t amount, ParticleHandle* handles);
+
+			//returns false for handles that are stale or already killed
+			bool kill(ParticleHandle handle);
+			size_t kill(const ParticleHandle* handles, size_t amount);
+			void clear();
+
+			bool alive(ParticleHandle handle) const;
+
+			//dense index inside particles(), NotFound for dead handles
+			//only stable until the next spawn or kill
+			size_t indexOf(ParticleHandle handle) const;
+			ParticleHandle handleAt(size_t index) const;
+			//changes whenever a particle dies or one gets a new dense index, so indices looked up
+			//through indexOf can be kept for as long as it stays the same
+			size_t layoutVersion() const { return layout; }
+
+			//the handle must be alive
+			ParticleView operator[](ParticleHandle handle) { return particles[indexOf(handle)]; }
+
+			ParticleBuffer& buffer() { return particles; }
+			const ParticleBuffer& buffer() const { return particles; }
+
+			ForceRegistry& forces() { return registry; }
+
+			//sphere collisions between particles, off by default
+			//when on, every step ends by turning overlapping pairs into contacts and resolving them
+			//particles flagged fast (P6Particle::fast) are first swept along their whole path, so they
+			//hit what they pass through instead of tunnelling; the step size stays the same for everyone
+			void setCollisions(bool enabled, float restitution = 0.5f);
+			//how many hits a fast particle may bounce off in one step, 4 by default
+			void setFastSubsteps(int count) { fastSubsteps = count; }
+			bool collisionsEnabled() const { return collide; }
+			//static level geometry the particles bounce off, nullptr (the default) for none
+			//works with or without setCollisions and uses its restitution; the mesh has to outlive the world or be unset first
+			void setStaticMesh(const TriangleBvh* mesh) { level = mesh; }
+			const TriangleBvh* staticMesh() const { return level; }
+			//a baked static shape, one grid lookup per particle instead of a BVH query; same rules as the mesh
+			//and the two can be used together. Particles wider than its band are only pushed out to the band
+			void setStaticField(const SignedDistanceField* field) { shape = field; }
+			const SignedDistanceField* staticField() const { return shape; }
+			//the contacts of the last step, and the knobs of the resolver
+			ContactResolver& contacts() { return resolver; }
+			//planes and boxes the particles stay inside, none by default; applied right after integration
+			Boundaries& boundaries() { return limits; }
+			//rods and cables between particles, none by default; resolved with the contacts every step
+			ParticleLinks& links() { return linkage; }
+			//position-based cloth grids, none by default; solved right after integration, before the boundaries
+			ClothSolver& cloth() { return fabric; }
+
+			//Resting particles fall asleep, off by default. A particle rests while it is slower than speed
+			//(v^2 / 2 under speed^2 / 2 per unit mass) and particles in contact form an island: once every
+			//particle of an island has rested for steps steps in a row, the whole island stops and moves
+			//behind the awake particles. Sleeping particles cost nothing but a check of their forces.
+			//An island wakes up as a whole when an awake particle touches one of its particles, or when the
+			//forces on one change by enough to reach speed within a step. Forces are still summed for sleepers
+			//that way, but constant ones such as gravity keep them asleep; their moving flag is cleared.
+			//Positions or velocities changed from outside don't wake anything, call wake() for those.
+			void setSleeping(bool enabled, float speed = 0.1f, int steps = 60);
+			bool sleepingEnabled() const { return sleepy; }
+			//the particles the next step works on are [0, awakeCount())
+			size_t awakeCount() const { return awake; }
+			bool sleeping(ParticleHandle handle) const;
+			//wakes the handle's island, returns false for dead handles
+			bool wake(ParticleHandle handle);
+			void wakeAll();
+
+			//threads for the parallel parts of update, nullptr (the default) keeps everything on the
+			//calling thread; with jobs the contacts go through ContactResolver::resolveColored
+			//the JobSystem has to outlive the world or be unset first
+			void setJobs(JobSystem* pool) { jobs = pool; }
+			JobSystem* jobSystem() const { return jobs; }
+
+			//applies the registered forces, integrates, solves the cloth, keeps the particles inside the
+			//boundaries, resolves contacts and links, then clears the force accumulators
+			void update(float time);
+			//same with an integrator policy from Integrators.h, e.g. update<SemiImplicitEuler>(dt)
+			//the registered forces are evaluated once per step, at the start of it, so only the policies
+			//that evaluate once fit here; VelocityVerlet and RK4 would just see that same acceleration
+			//again and do no better than ConstantAcceleration. Use them through ParticleBuffer::integrate
+			//with an accel that works the forces out for the trial state.
+			template <typename Integrator>
+			void update(float time) {
+				registry.applyForces(*this);
+				wakeForced(time);
+				particles.integrate<Integrator>(time, awake);
+				fabric.solve(*this, time);
+				limits.apply(particles.streams(), awake, time, jobs);
+				resolveContacts(time);
+				particles.clearForces();
+				fallAsleep();
+			}
+
+		private:
+			//exchanges two particles in the buffer and the slot table
+			void swapParticles(size_t a, size_t b);
+			//moves the sleeping particles of the marked islands in front of the others, then clears the marks
+			void wakeMarked();
+			void markIsland(size_t index);
+			//sleepers whose force changed since they fell asleep
+			void wakeForced(float time);
+			//islands that rested long enough go to the back
+			void fallAsleep();
+			void resolveContacts(float time);
+			void sweepFast(float time);
+			//contacts between the particles [begin, end) and the static mesh and field
+			void staticContacts(size_t begin, size_t end, std::vector<ParticleContact>& out) const;
+
+			ParticleBuffer particles;
+			ForceRegistry registry;
+			size_t slotCount;
+
+			//per slot: dense index while alive, next free slot while free
+			std::vector<uint32_t> slotIndex;
+			std::vector<uint32_t> slotGeneration;
+			//per dense index: the slot that owns it
+			std::vector<uint32_t> denseSlot;
+			uint32_t freeHead;
+			size_t layout = 0;
+
+			bool sleepy = false;
+			float sleepSpeed = 0.1f;
+			int sleepSteps = 60;
+			//particles [0, awake) are awake, the rest sleep
+			size_t awake = 0;
+			//per slot: steps in a row it rested while awake, the island it fell asleep with, and the force
+			//it fell asleep under (NaN until its first step asleep has measured it)
+			std::vector<uint16_t> restSteps;
+			std::vector<uint32_t> slotIsland;
+			std::vector<float> sleepForce;
+			uint32_t nextIsland = 0;
+			//islands woken this step, sorted before use
+			std::vector<uint32_t> wakeIslands;
+			//per awake particle: its parent in the contact islands
+			std::vector<uint32_t> islandParent;
+			std::vector<uint8_t> islandRested;
+			std::vector<size_t> sleepers;
+			//the sleeping particles, rebuilt only when more fall asleep; the ones woken or killed since are
+			//found stale through the handles, per particle from sleepGridFirst on
+			SpatialHashGrid sleepGrid;
+			std::vector<ParticleHandle> sleepGridHandles;
+			size_t sleepGridFirst = 0;
+			bool sleepGridDirty = true;
+
+			JobSystem* jobs = nullptr;
+
+			bool collide = false;
+			float restitution = 0.5f;
+			int fastSubsteps = 4;
+			std::vector<uint32_t> fastIndices;
+			//per particle: box around the whole path of the step, xyz interleaved
+			std::vector<float> sweptLow, sweptHigh;
+			const TriangleBvh* level = nullptr;
+			const SignedDistanceField* shape = nullptr;
+			//static contacts per chunk of particles, appended in chunk order so threads don't change the result
+			std::vector<std::vector<ParticleContact>> staticChunks;
+			Boundaries limits;
+			ParticleLinks linkage;
+			ClothSolver fabric;
+			ContactResolver resolver;
+			SpatialHashGrid grid;
+			std::vector<ParticlePair> pairs;
+	};
+}
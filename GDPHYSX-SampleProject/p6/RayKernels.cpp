@@ -0,0 +1,45 @@
+#include "RayKernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace P6;
+
+RaySphereKernel P6::RaySphereKernelFor(SimdLevel level) {
+	switch (level) {
+#if P6_KERNELS_X86
+	case SimdLevel::AVX512:
+	case SimdLevel::AVX2:
+		return Kernels::RaySpheresAVX2;
+	case SimdLevel::SSE2:
+		return Kernels::RaySpheresSSE2;
+#endif
+	default:
+		return Kernels::RaySpheresScalar;
+	}
+}
+
+//With m = origin - centre, points of the ray are at distance t where t^2 + 2 b t + c = 0, b = m.d
+//and c = m.m - r^2. No real root misses; c > 0 with b > 0 is a sphere behind the ray's start.
+//The discriminant b^2 - c loses most of its bits when the ray starts far away, so it is taken as
+//r^2 - |m - b d|^2, the same value measured from the point of the line closest to the centre.
+//The near root -b - sqrt(disc) is negative only when the start is inside, which counts as 0.
+size_t Kernels::RaySpheresScalar(const float* x, const float* y, const float* z, const float* radius, size_t count,
+	const MyVector& origin, const MyVector& direction, float& best) {
+	size_t found = count;
+	for (size_t i = 0; i < count; i++) {
+		const float mx = origin.x - x[i], my = origin.y - y[i], mz = origin.z - z[i];
+		const float b = mx * direction.x + my * direction.y + mz * direction.z;
+		const float c = mx * mx + my * my + mz * mz - radius[i] * radius[i];
+		const float px = mx - b * direction.x, py = my - b * direction.y, pz = mz - b * direction.z;
+		const float disc = radius[i] * radius[i] - (px * px + py * py + pz * pz);
+		if (disc < 0 || (c > 0 && b > 0)) continue;
+
+		const float t = std::max(-b - std::sqrt(disc), 0.0f);
+		if (t < best) {
+			best = t;
+			found = i;
+		}
+	}
+	return found;
+}
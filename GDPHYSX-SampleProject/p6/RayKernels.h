@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+
+#include "MyVector.h"
+#include "ParticleKernels.h"
+
+namespace P6 {
+	//Ray against a run of spheres stored one column per value, centres in x, y, z. direction has
+	//to be unit length. Returns the slot in [0, count) of the sphere hit first, if it is hit closer
+	//than best, and lowers best to that distance; count when nothing is hit before best. Equal
+	//distances go to the lower slot, and a ray starting inside a sphere hits it at 0.
+	typedef size_t (*RaySphereKernel)(const float* x, const float* y, const float* z, const float* radius, size_t count,
+		const MyVector& origin, const MyVector& direction, float& best);
+
+	//the kernel for a level; AVX-512 gets the AVX2 kernel, runs are a few spheres long
+	RaySphereKernel RaySphereKernelFor(SimdLevel level);
+
+	//SSE2 does the scalar kernel's operations in the same order and returns the same slot and distance;
+	//AVX2 fuses multiply-adds, so its distances may differ in the last few ulp and two spheres hit at
+	//almost the same distance may swap
+	namespace Kernels {
+		size_t RaySpheresScalar(const float* x, const float* y, const float* z, const float* radius, size_t count,
+			const MyVector& origin, const MyVector& direction, float& best);
+#if P6_KERNELS_X86
+		size_t RaySpheresSSE2(const float* x, const float* y, const float* z, const float* radius, size_t count,
+			const MyVector& origin, const MyVector& direction, float& best);
+		size_t RaySpheresAVX2(const float* x, const float* y, const float* z, const float* radius, size_t count,
+			const MyVector& origin, const MyVector& direction, float& best);
+#endif
+	}
+}
@@ -0,0 +1,48 @@
+#include "RayKernels.h"
+
+#if P6_KERNELS_X86
+
+#include <immintrin.h>
+
+using namespace P6;
+
+//eight spheres at a time, the steps of RaySpheresSSE2 with fused multiply-adds
+P6_TARGET_AVX2 size_t Kernels::RaySpheresAVX2(const float* x, const float* y, const float* z, const float* radius, size_t count,
+	const MyVector& origin, const MyVector& direction, float& best) {
+	const __m256 ox = _mm256_set1_ps(origin.x), oy = _mm256_set1_ps(origin.y), oz = _mm256_set1_ps(origin.z);
+	const __m256 dx = _mm256_set1_ps(direction.x), dy = _mm256_set1_ps(direction.y), dz = _mm256_set1_ps(direction.z);
+	const __m256 zero = _mm256_setzero_ps();
+
+	size_t found = count;
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const __m256 mx = _mm256_sub_ps(ox, _mm256_loadu_ps(x + i));
+		const __m256 my = _mm256_sub_ps(oy, _mm256_loadu_ps(y + i));
+		const __m256 mz = _mm256_sub_ps(oz, _mm256_loadu_ps(z + i));
+		const __m256 r = _mm256_loadu_ps(radius + i);
+		const __m256 b = _mm256_fmadd_ps(mz, dz, _mm256_fmadd_ps(my, dy, _mm256_mul_ps(mx, dx)));
+		const __m256 c = _mm256_fnmadd_ps(r, r, _mm256_fmadd_ps(mz, mz, _mm256_fmadd_ps(my, my, _mm256_mul_ps(mx, mx))));
+		const __m256 px = _mm256_fnmadd_ps(b, dx, mx), py = _mm256_fnmadd_ps(b, dy, my), pz = _mm256_fnmadd_ps(b, dz, mz);
+		const __m256 disc = _mm256_sub_ps(_mm256_mul_ps(r, r), _mm256_fmadd_ps(pz, pz, _mm256_fmadd_ps(py, py, _mm256_mul_ps(px, px))));
+
+		const __m256 behind = _mm256_and_ps(_mm256_cmp_ps(c, zero, _CMP_GT_OQ), _mm256_cmp_ps(b, zero, _CMP_GT_OQ));
+		const __m256 t = _mm256_max_ps(_mm256_sub_ps(_mm256_sub_ps(zero, b), _mm256_sqrt_ps(_mm256_max_ps(disc, zero))), zero);
+		const __m256 hit = _mm256_andnot_ps(behind, _mm256_and_ps(_mm256_cmp_ps(disc, zero, _CMP_GE_OQ), _mm256_cmp_ps(t, _mm256_set1_ps(best), _CMP_LT_OQ)));
+
+		int mask = _mm256_movemask_ps(hit);
+		if (mask == 0) continue;
+		float lanes[8];
+		_mm256_storeu_ps(lanes, t);
+		for (int lane = 0; lane < 8; lane++) {
+			if (((mask >> lane) & 1) && lanes[lane] < best) {
+				best = lanes[lane];
+				found = i + lane;
+			}
+		}
+	}
+
+	const size_t tail = Kernels::RaySpheresSSE2(x + i, y + i, z + i, radius + i, count - i, origin, direction, best);
+	return tail < count - i ? i + tail : found;
+}
+
+#endif
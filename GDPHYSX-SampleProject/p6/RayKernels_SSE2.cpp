@@ -0,0 +1,48 @@
+#include "RayKernels.h"
+
+#if P6_KERNELS_X86
+
+#include <emmintrin.h>
+
+using namespace P6;
+
+//four spheres at a time, the lanes that hit are then taken in order so ties go to the lower slot
+P6_TARGET_SSE2 size_t Kernels::RaySpheresSSE2(const float* x, const float* y, const float* z, const float* radius, size_t count,
+	const MyVector& origin, const MyVector& direction, float& best) {
+	const __m128 ox = _mm_set1_ps(origin.x), oy = _mm_set1_ps(origin.y), oz = _mm_set1_ps(origin.z);
+	const __m128 dx = _mm_set1_ps(direction.x), dy = _mm_set1_ps(direction.y), dz = _mm_set1_ps(direction.z);
+	const __m128 zero = _mm_setzero_ps();
+
+	size_t found = count;
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const __m128 mx = _mm_sub_ps(ox, _mm_loadu_ps(x + i));
+		const __m128 my = _mm_sub_ps(oy, _mm_loadu_ps(y + i));
+		const __m128 mz = _mm_sub_ps(oz, _mm_loadu_ps(z + i));
+		const __m128 r = _mm_loadu_ps(radius + i);
+		const __m128 b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(mx, dx), _mm_mul_ps(my, dy)), _mm_mul_ps(mz, dz));
+		const __m128 c = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(mx, mx), _mm_mul_ps(my, my)), _mm_mul_ps(mz, mz)), _mm_mul_ps(r, r));
+		const __m128 px = _mm_sub_ps(mx, _mm_mul_ps(b, dx)), py = _mm_sub_ps(my, _mm_mul_ps(b, dy)), pz = _mm_sub_ps(mz, _mm_mul_ps(b, dz));
+		const __m128 disc = _mm_sub_ps(_mm_mul_ps(r, r), _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, px), _mm_mul_ps(py, py)), _mm_mul_ps(pz, pz)));
+
+		const __m128 behind = _mm_and_ps(_mm_cmpgt_ps(c, zero), _mm_cmpgt_ps(b, zero));
+		const __m128 t = _mm_max_ps(_mm_sub_ps(_mm_sub_ps(zero, b), _mm_sqrt_ps(_mm_max_ps(disc, zero))), zero);
+		const __m128 hit = _mm_andnot_ps(behind, _mm_and_ps(_mm_cmpge_ps(disc, zero), _mm_cmplt_ps(t, _mm_set1_ps(best))));
+
+		int mask = _mm_movemask_ps(hit);
+		if (mask == 0) continue;
+		float lanes[4];
+		_mm_storeu_ps(lanes, t);
+		for (int lane = 0; lane < 4; lane++) {
+			if (((mask >> lane) & 1) && lanes[lane] < best) {
+				best = lanes[lane];
+				found = i + lane;
+			}
+		}
+	}
+
+	const size_t tail = Kernels::RaySpheresScalar(x + i, y + i, z + i, radius + i, count - i, origin, direction, best);
+	return tail < count - i ? i + tail : found;
+}
+
+#endif
@@ -0,0 +1,346 @@
+#include "SceneQueries.h"
+#include "JobSystem.h"
+#include "ParticleWorld.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace P6;
+
+namespace {
+	//queries per chunk handed to a thread
+	const size_t Grain = 64;
+	const uint32_t None = 0xFFFFFFFFu;
+
+	size_t NextPowerOfTwo(size_t value) {
+		size_t power = 1;
+		while (power < value) power <<= 1;
+		return power;
+	}
+
+	float Axis(const MyVector& v, int axis) {
+		return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+	}
+}
+
+SceneQueries::SceneQueries(float cellSize) : requestedCellSize(cellSize) {}
+
+int SceneQueries::cellCoordinate(float value) const {
+	//far away particles share the outermost cells instead of overflowing, as in SpatialHashGrid
+	float scaled = std::floor(value * inverseCell);
+	const float limit = 1073741824.0f;
+	if (scaled > limit) return 1073741824;
+	if (scaled < -limit) return -1073741824;
+	return static_cast<int>(scaled);
+}
+
+SceneQueries::Cell SceneQueries::cellOf(const MyVector& p) const {
+	return Cell{ cellCoordinate(p.x), cellCoordinate(p.y), cellCoordinate(p.z) };
+}
+
+uint32_t SceneQueries::bucketOf(const Cell& c) const {
+	const uint32_t hash = (static_cast<uint32_t>(c.x) * 73856093u) ^ (static_cast<uint32_t>(c.y) * 19349663u) ^ (static_cast<uint32_t>(c.z) * 83492791u);
+	return hash & static_cast<uint32_t>(buckets - 1);
+}
+
+void SceneQueries::build(const ParticleWorld& world) {
+	const ParticleStreams& s = world.buffer().streams();
+	const size_t count = world.size();
+	handles.clear();
+	entryBucket.clear();
+	extent = Aabb();
+
+	float largest = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (s.active[i]) largest = std::max(largest, s.radius[i]);
+	}
+	cell = std::max(requestedCellSize > 0 ? requestedCellSize : 4.0f * largest, 2.0f * largest);
+	if (cell <= 0) cell = 1.0f;
+	inverseCell = 1.0f / cell;
+
+	//count: every cell of every particle's box, at most two per axis
+	for (size_t i = 0; i < count; i++) {
+		if (!s.active[i]) continue;
+		const MyVector center(s.posX[i], s.posY[i], s.posZ[i]);
+		const float r = s.radius[i];
+		const Aabb box = Aabb::Around(center, r);
+		extent = handles.empty() ? box : Aabb::Merge(extent, box);
+		handles.push_back(world.handleAt(i));
+	}
+	lowCell = cellOf(extent.min);
+	highCell = cellOf(extent.max);
+
+	size_t entries = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (!s.active[i]) continue;
+		const Cell low = cellOf(MyVector(s.posX[i] - s.radius[i], s.posY[i] - s.radius[i], s.posZ[i] - s.radius[i]));
+		const Cell high = cellOf(MyVector(s.posX[i] + s.radius[i], s.posY[i] + s.radius[i], s.posZ[i] + s.radius[i]));
+		entries += static_cast<size_t>(high.x - low.x + 1) * (high.y - low.y + 1) * (high.z - low.z + 1);
+	}
+
+	buckets = NextPowerOfTwo(std::max<size_t>(64, entries * 2));
+	bucketStart.assign(buckets + 1, 0);
+	entryBucket.reserve(entries);
+	for (size_t i = 0; i < count; i++) {
+		if (!s.active[i]) continue;
+		const Cell low = cellOf(MyVector(s.posX[i] - s.radius[i], s.posY[i] - s.radius[i], s.posZ[i] - s.radius[i]));
+		const Cell high = cellOf(MyVector(s.posX[i] + s.radius[i], s.posY[i] + s.radius[i], s.posZ[i] + s.radius[i]));
+		for (int z = low.z; z <= high.z; z++) {
+			for (int y = low.y; y <= high.y; y++) {
+				for (int x = low.x; x <= high.x; x++) {
+					const uint32_t bucket = bucketOf(Cell{ x, y, z });
+					entryBucket.push_back(bucket);
+					bucketStart[bucket + 1]++;
+				}
+			}
+		}
+	}
+	for (size_t b = 0; b < buckets; b++) bucketStart[b + 1] += bucketStart[b];
+
+	//scatter in the same order as the count, so entryBucket lines up
+	entryParticle.resize(entries);
+	entryX.resize(entries);
+	entryY.resize(entries);
+	entryZ.resize(entries);
+	entryRadius.resize(entries);
+	entryCorner.resize(entries);
+	size_t entry = 0;
+	uint32_t particle = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (!s.active[i]) continue;
+		const Cell low = cellOf(MyVector(s.posX[i] - s.radius[i], s.posY[i] - s.radius[i], s.posZ[i] - s.radius[i]));
+		const Cell high = cellOf(MyVector(s.posX[i] + s.radius[i], s.posY[i] + s.radius[i], s.posZ[i] + s.radius[i]));
+		for (int z = low.z; z <= high.z; z++) {
+			for (int y = low.y; y <= high.y; y++) {
+				for (int x = low.x; x <= high.x; x++) {
+					const uint32_t slot = bucketStart[entryBucket[entry++]]++;
+					entryParticle[slot] = particle;
+					entryX[slot] = s.posX[i];
+					entryY[slot] = s.posY[i];
+					entryZ[slot] = s.posZ[i];
+					entryRadius[slot] = s.radius[i];
+					entryCorner[slot] = static_cast<uint8_t>((x - low.x) | ((y - low.y) << 1) | ((z - low.z) << 2));
+				}
+			}
+		}
+		particle++;
+	}
+	for (size_t b = buckets; b > 0; b--) bucketStart[b] = bucketStart[b - 1];
+	bucketStart[0] = 0;
+}
+
+RayHit SceneQueries::cast(const Ray& ray, RaySphereKernel kernel) const {
+	RayHit hit;
+	const float length = ray.direction.Magnitude();
+	if (handles.empty() || !(length > 0)) return hit;
+	const MyVector direction = ray.direction * (1.0f / length);
+
+	//only the part of the ray inside the snapshot's bounds can hit anything
+	float enter = 0, leave = ray.maxDistance;
+	for (int axis = 0; axis < 3; axis++) {
+		const float o = Axis(ray.origin, axis), d = Axis(direction, axis);
+		const float low = Axis(extent.min, axis), high = Axis(extent.max, axis);
+		if (d == 0) {
+			if (o < low || o > high) return hit;
+			continue;
+		}
+		float a = (low - o) / d, b = (high - o) / d;
+		if (a > b) std::swap(a, b);
+		enter = std::max(enter, a);
+		leave = std::min(leave, b);
+	}
+	if (enter > leave) return hit;
+
+	//walk the cells along the ray (Amanatides and Woo), starting where it enters the bounds
+	const MyVector start = ray.origin + direction * enter;
+	int at[3] = { cellCoordinate(start.x), cellCoordinate(start.y), cellCoordinate(start.z) };
+	const int low[3] = { lowCell.x, lowCell.y, lowCell.z }, high[3] = { highCell.x, highCell.y, highCell.z };
+	int step[3];
+	float next[3], delta[3];
+	for (int axis = 0; axis < 3; axis++) {
+		at[axis] = std::min(std::max(at[axis], low[axis]), high[axis]);
+		const float o = Axis(ray.origin, axis), d = Axis(direction, axis);
+		if (d > 0) {
+			step[axis] = 1;
+			next[axis] = ((at[axis] + 1) * cell - o) / d;
+			delta[axis] = cell / d;
+		}
+		else if (d < 0) {
+			step[axis] = -1;
+			next[axis] = (at[axis] * cell - o) / d;
+			delta[axis] = -cell / d;
+		}
+		else {
+			step[axis] = 0;
+			next[axis] = std::numeric_limits<float>::infinity();
+			delta[axis] = 0;
+		}
+	}
+
+	float best = ray.maxDistance;
+	uint32_t found = None;
+	for (;;) {
+		const uint32_t bucket = bucketOf(Cell{ at[0], at[1], at[2] });
+		const uint32_t begin = bucketStart[bucket], end = bucketStart[bucket + 1];
+		const size_t slot = kernel(entryX.data() + begin, entryY.data() + begin, entryZ.data() + begin, entryRadius.data() + begin,
+			end - begin, ray.origin, direction, best);
+		if (slot < end - begin) found = begin + static_cast<uint32_t>(slot);
+
+		//every sphere hit before the cell's far side has an entry in a cell walked so far
+		const int axis = next[0] <= next[1] && next[0] <= next[2] ? 0 : next[1] <= next[2] ? 1 : 2;
+		const float exit = next[axis];
+		if (best <= exit || exit > leave) break;
+		at[axis] += step[axis];
+		if (at[axis] < low[axis] || at[axis] > high[axis]) break;
+		next[axis] += delta[axis];
+	}
+	if (found == None) return hit;
+
+	hit.particle = handles[entryParticle[found]];
+	hit.distance = best;
+	hit.point = ray.origin + direction * best;
+	const MyVector outward = hit.point - MyVector(entryX[found], entryY[found], entryZ[found]);
+	const float outwardLength = outward.Magnitude();
+	hit.normal = best > 0 && outwardLength > 0 ? outward * (1.0f / outwardLength) : direction * -1.0f;
+	return hit;
+}
+
+RayHit SceneQueries::raycast(const Ray& ray) const {
+	return cast(ray, RaySphereKernelFor(ActiveSimdLevel()));
+}
+
+void SceneQueries::raycast(const Ray* rays, size_t count, RayHit* hits, JobSystem* jobs) const {
+	const RaySphereKernel kernel = RaySphereKernelFor(ActiveSimdLevel());
+	auto body = [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) hits[i] = cast(rays[i], kernel);
+	};
+	if (jobs) jobs->parallelFor(count, Grain, body);
+	else body(0, count);
+}
+
+void SceneQueries::overlap(const SphereQuery& sphere, std::vector<ParticleHandle>& out) const {
+	if (handles.empty()) return;
+	const float reach = sphere.radius;
+	const Cell from = cellOf(MyVector(sphere.center.x - reach, sphere.center.y - reach, sphere.center.z - reach));
+	const Cell to = cellOf(MyVector(sphere.center.x + reach, sphere.center.y + reach, sphere.center.z + reach));
+	const Cell low = { std::max(from.x, lowCell.x), std::max(from.y, lowCell.y), std::max(from.z, lowCell.z) };
+	const Cell high = { std::min(to.x, highCell.x), std::min(to.y, highCell.y), std::min(to.z, highCell.z) };
+
+	for (int z = low.z; z <= high.z; z++) {
+		for (int y = low.y; y <= high.y; y++) {
+			for (int x = low.x; x <= high.x; x++) {
+				const uint32_t bucket = bucketOf(Cell{ x, y, z });
+				for (uint32_t e = bucketStart[bucket]; e < bucketStart[bucket + 1]; e++) {
+					const float dx = entryX[e] - sphere.center.x, dy = entryY[e] - sphere.center.y, dz = entryZ[e] - sphere.center.z;
+					const float touch = reach + entryRadius[e];
+					if (dx * dx + dy * dy + dz * dz >= touch * touch) continue;
+
+					//a particle sits in up to eight cells, report it from the first one both boxes share,
+					//and only through the entry for that cell, not one that hashed into the same bucket
+					const float r = entryRadius[e];
+					const Cell corner = cellOf(MyVector(entryX[e] - r, entryY[e] - r, entryZ[e] - r));
+					const uint8_t bits = entryCorner[e];
+					if (corner.x + (bits & 1) != x || corner.y + ((bits >> 1) & 1) != y || corner.z + ((bits >> 2) & 1) != z) continue;
+					if (std::max(corner.x, low.x) != x || std::max(corner.y, low.y) != y || std::max(corner.z, low.z) != z) continue;
+					out.push_back(handles[entryParticle[e]]);
+				}
+			}
+		}
+	}
+}
+
+void SceneQueries::overlap(const SphereQuery* spheres, size_t count, OverlapResults& results, JobSystem* jobs) const {
+	//each chunk collects its own hits, then they are joined in query order
+	const size_t chunks = (count + Grain - 1) / Grain;
+	std::vector<std::vector<ParticleHandle>> found(chunks);
+	results.offsets.assign(count + 1, 0);
+	auto body = [&](size_t first, size_t last) {
+		for (size_t c = first; c < last; c++) {
+			for (size_t q = c * Grain; q < std::min((c + 1) * Grain, count); q++) {
+				const size_t before = found[c].size();
+				overlap(spheres[q], found[c]);
+				results.offsets[q + 1] = static_cast<uint32_t>(found[c].size() - before);
+			}
+		}
+	};
+	if (jobs) jobs->parallelFor(chunks, 1, body);
+	else body(0, chunks);
+
+	for (size_t q = 0; q < count; q++) results.offsets[q + 1] += results.offsets[q];
+	results.particles.clear();
+	results.particles.reserve(results.offsets[count]);
+	for (const std::vector<ParticleHandle>& chunk : found) results.particles.insert(results.particles.end(), chunk.begin(), chunk.end());
+}
+
+void SceneQueries::nearestInRing(const MyVector& point, const Cell& around, int ring, float& best2, uint32_t& found) const {
+	const int zLow = std::max(around.z - ring, lowCell.z), zHigh = std::min(around.z + ring, highCell.z);
+	const int yLow = std::max(around.y - ring, lowCell.y), yHigh = std::min(around.y + ring, highCell.y);
+	const int xLow = std::max(around.x - ring, lowCell.x), xHigh = std::min(around.x + ring, highCell.x);
+	for (int z = zLow; z <= zHigh; z++) {
+		for (int y = yLow; y <= yHigh; y++) {
+			//inside the ring's faces only the two ends of the row are on it
+			const bool face = std::abs(z - around.z) == ring || std::abs(y - around.y) == ring;
+			const int stride = face || ring == 0 ? 1 : 2 * ring;
+			for (int x = face ? xLow : around.x - ring; x <= xHigh; x += stride) {
+				if (x < xLow) continue;
+				//cells wholly further than the best so far can't improve it
+				const float gx = std::max({ x * cell - point.x, point.x - (x + 1) * cell, 0.0f });
+				const float gy = std::max({ y * cell - point.y, point.y - (y + 1) * cell, 0.0f });
+				const float gz = std::max({ z * cell - point.z, point.z - (z + 1) * cell, 0.0f });
+				if (gx * gx + gy * gy + gz * gz > best2) continue;
+
+				const uint32_t bucket = bucketOf(Cell{ x, y, z });
+				for (uint32_t e = bucketStart[bucket]; e < bucketStart[bucket + 1]; e++) {
+					const float dx = entryX[e] - point.x, dy = entryY[e] - point.y, dz = entryZ[e] - point.z;
+					const float d2 = dx * dx + dy * dy + dz * dz;
+					//ties go to the particle seen first in the world, whatever order the cells come in
+					if (d2 < best2 || (d2 == best2 && found != None && entryParticle[e] < found)) {
+						best2 = d2;
+						found = entryParticle[e];
+					}
+				}
+			}
+		}
+	}
+}
+
+NearestHit SceneQueries::nearest(const MyVector& point, float maxDistance) const {
+	NearestHit hit;
+	if (handles.empty() || !(maxDistance >= 0)) return hit;
+
+	//rings closer than the bounds are empty, rings past all of them have nothing left
+	const Cell around = cellOf(point);
+	const int first = std::max({ 0, lowCell.x - around.x, around.x - highCell.x, lowCell.y - around.y, around.y - highCell.y, lowCell.z - around.z, around.z - highCell.z });
+	const int last = std::max({ around.x - lowCell.x, highCell.x - around.x, around.y - lowCell.y, highCell.y - around.y, around.z - lowCell.z, highCell.z - around.z });
+
+	float best2 = maxDistance < 1e18f ? maxDistance * maxDistance : std::numeric_limits<float>::infinity();
+	uint32_t found = None;
+	for (int ring = first; ring <= last; ring++) {
+		nearestInRing(point, around, ring, best2, found);
+
+		//the cells left are past a side of the cube walked so far, on the sides where there still are cells
+		float left = std::numeric_limits<float>::infinity();
+		const int at[3] = { around.x, around.y, around.z };
+		const int low[3] = { lowCell.x, lowCell.y, lowCell.z }, high[3] = { highCell.x, highCell.y, highCell.z };
+		for (int axis = 0; axis < 3; axis++) {
+			const float p = Axis(point, axis);
+			if (at[axis] - ring > low[axis]) left = std::min(left, p - (at[axis] - ring) * cell);
+			if (at[axis] + ring < high[axis]) left = std::min(left, (at[axis] + ring + 1) * cell - p);
+		}
+		if (best2 <= left * left) break;
+	}
+	if (found == None) return hit;
+
+	hit.particle = handles[found];
+	hit.distance = std::sqrt(best2);
+	return hit;
+}
+
+void SceneQueries::nearest(const MyVector* points, size_t count, NearestHit* hits, float maxDistance, JobSystem* jobs) const {
+	auto body = [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) hits[i] = nearest(points[i], maxDistance);
+	};
+	if (jobs) jobs->parallelFor(count, Grain, body);
+	else body(0, count);
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Aabb.h"
+#include "MyVector.h"
+#include "ParticleHandle.h"
+#include "RayKernels.h"
+
+namespace P6 {
+	class JobSystem;
+	class ParticleWorld;
+
+	//direction doesn't have to be unit length; a zero direction hits nothing
+	struct Ray {
+		MyVector origin;
+		MyVector direction;
+		float maxDistance = 1e30f;
+	};
+
+	//the first particle along a ray, particle is invalid on a miss
+	struct RayHit {
+		ParticleHandle particle;
+		//along the normalised direction, 0 for rays starting inside a particle
+		float distance = 0;
+		MyVector point;
+		//out of the sphere at point, the reverse direction for rays starting inside
+		MyVector normal;
+	};
+
+	struct SphereQuery {
+		MyVector center;
+		float radius = 0;
+	};
+
+	//the particle whose centre is closest, particle is invalid when none is within reach
+	struct NearestHit {
+		ParticleHandle particle;
+		//centre to centre
+		float distance = 0;
+	};
+
+	//the particles each overlap query found, query q's are particles[offsets[q]] up to particles[offsets[q + 1]]
+	struct OverlapResults {
+		std::vector<uint32_t> offsets;
+		std::vector<ParticleHandle> particles;
+
+		size_t count(size_t query) const { return offsets[query + 1] - offsets[query]; }
+		const ParticleHandle* begin(size_t query) const { return particles.data() + offsets[query]; }
+		const ParticleHandle* end(size_t query) const { return particles.data() + offsets[query + 1]; }
+	};
+
+	//Raycasts, sphere overlaps and nearest particle lookups against a snapshot of a ParticleWorld,
+	//for picking, line of sight and sensors. Queries come in arrays and are answered as a batch:
+	//split over a JobSystem when one is given, every answer written to its own slot, so the results
+	//are the same on any number of threads.
+	//build() hashes the active particles into a uniform grid like SpatialHashGrid's, but every particle
+	//goes into each cell its bounding box touches (at most eight, cells are at least a diameter wide).
+	//A ray then only walks the cells it passes through and stops at the first cell that ends behind
+	//a hit; a cell's spheres sit next to each other, so they are tested with a RaySphereKernel.
+	//The snapshot goes stale as soon as the world steps; rebuild it before each batch.
+	//
+	//	queries.build(world);
+	//	queries.raycast(rays.data(), rays.size(), hits.data(), &jobs);
+	//	if (hits[0].particle.IsValid()) world[hits[0].particle] ...
+	class SceneQueries {
+		public:
+			//cellSize 0 picks twice the largest diameter each build, and cells are never narrower than it
+			explicit SceneQueries(float cellSize = 0);
+
+			void setCellSize(float size) { requestedCellSize = size; }
+			float cellSize() const { return cell; }
+
+			void build(const ParticleWorld& world);
+			//particles in the snapshot
+			size_t size() const { return handles.size(); }
+			//around every particle of the snapshot
+			Aabb bounds() const { return extent; }
+
+			//hits[i] is the first particle along rays[i] within its maxDistance
+			void raycast(const Ray* rays, size_t count, RayHit* hits, JobSystem* jobs = nullptr) const;
+			//every particle overlapping each sphere, results is overwritten
+			void overlap(const SphereQuery* spheres, size_t count, OverlapResults& results, JobSystem* jobs = nullptr) const;
+			//hits[i] is the particle closest to points[i], ignoring any farther than maxDistance
+			void nearest(const MyVector* points, size_t count, NearestHit* hits, float maxDistance = 1e30f, JobSystem* jobs = nullptr) const;
+
+			//single queries, the loops the batches run
+			RayHit raycast(const Ray& ray) const;
+			NearestHit nearest(const MyVector& point, float maxDistance = 1e30f) const;
+
+		private:
+			struct Cell {
+				int x, y, z;
+			};
+
+			RayHit cast(const Ray& ray, RaySphereKernel kernel) const;
+			Cell cellOf(const MyVector& p) const;
+			int cellCoordinate(float value) const;
+			uint32_t bucketOf(const Cell& c) const;
+			//appends the particles overlapping sphere, each once
+			void overlap(const SphereQuery& sphere, std::vector<ParticleHandle>& out) const;
+			//closest centre in the cells at Chebyshev distance ring from around
+			void nearestInRing(const MyVector& point, const Cell& around, int ring, float& best2, uint32_t& found) const;
+
+			float requestedCellSize;
+			float cell = 1.0f;
+			float inverseCell = 1.0f;
+			size_t buckets = 0;
+			Aabb extent;
+			//cells of extent, rays and rings stay inside them
+			Cell lowCell = {}, highCell = {};
+
+			//per particle of the snapshot
+			std::vector<ParticleHandle> handles;
+			//per bucket: first entry, bucketStart[buckets] = entry count
+			std::vector<uint32_t> bucketStart;
+			//one entry per particle per cell it touches, in bucket order
+			std::vector<uint32_t> entryParticle;
+			std::vector<float> entryX, entryY, entryZ, entryRadius;
+			//which of the particle's cells the entry is for: bit 0 one cell up in x, bit 1 in y, bit 2 in z
+			std::vector<uint8_t> entryCorner;
+			//build scratch: the bucket of every entry
+			std::vector<uint32_t> entryBucket;
+	};
+}
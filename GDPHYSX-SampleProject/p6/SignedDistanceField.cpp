@@ -0,0 +1,316 @@
+#include "SignedDistanceField.h"
+#include "JobSystem.h"
+#include "ParticleKernels.h"
+#include "TriangleBvh.h"
+#include "TriangleMesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+using namespace P6;
+
+namespace {
+	const char Magic[4] = { 'P', '6', 'D', 'F' };
+	const uint32_t Version = 1;
+	const float Levels = 32767.0f;
+
+	float Axis(const MyVector& v, int axis) {
+		return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+	}
+
+	//twice the signed area of (a, b, p) in the plane, negated bit for bit when the edge is given the
+	//other way round, so two triangles sharing an edge agree on which side of it p is
+	double Edge(double au, double av, double bu, double bv, double pu, double pv) {
+		if (au > bu || (au == bu && av > bv)) return -Edge(bu, bv, au, av, pu, pv);
+		return (bu - au) * (pv - av) - (bv - av) * (pu - au);
+	}
+
+	//a point right on an edge belongs to the triangle on one side of it only, picked by the edge's
+	//direction, so a row through a shared edge or vertex crosses the surface once
+	bool Owns(double edge, double du, double dv) {
+		return edge > 0 || (edge == 0 && (dv > 0 || (dv == 0 && du < 0)));
+	}
+
+	template <typename T>
+	void Put(std::ofstream& out, const T& value) {
+		out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template <typename T>
+	bool Get(std::ifstream& in, T& value) {
+		return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+	}
+
+	//FNV-1a
+	void Mix(uint64_t& hash, const void* data, size_t size) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++) {
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+	}
+}
+
+void SignedDistanceField::clear() {
+	values.clear();
+	origin = MyVector();
+	cell = 0;
+	band = 0;
+	dims[0] = dims[1] = dims[2] = 0;
+	source = 0;
+	cached = false;
+}
+
+Aabb SignedDistanceField::bounds() const {
+	if (empty()) return Aabb();
+	return Aabb(origin, MyVector(origin.x + (dims[0] - 1) * cell, origin.y + (dims[1] - 1) * cell, origin.z + (dims[2] - 1) * cell));
+}
+
+uint64_t SignedDistanceField::Key(const TriangleMesh& mesh, float cellSize, float bandWidth) {
+	uint64_t hash = 14695981039346656037ull;
+	Mix(hash, &Version, sizeof(Version));
+	Mix(hash, &cellSize, sizeof(cellSize));
+	Mix(hash, &bandWidth, sizeof(bandWidth));
+	for (size_t t = 0; t < mesh.triangleCount(); t++) {
+		MyVector corners[3];
+		mesh.triangle(t, corners[0], corners[1], corners[2]);
+		for (const MyVector& v : corners) {
+			const float xyz[3] = { v.x, v.y, v.z };
+			Mix(hash, xyz, sizeof(xyz));
+		}
+	}
+	return hash;
+}
+
+void SignedDistanceField::bake(const TriangleMesh& mesh, float cellSize, float bandWidth, JobSystem* jobs) {
+	clear();
+	if (mesh.triangleCount() == 0 || !(cellSize > 0) || !(bandWidth > 0)) return;
+
+	cell = cellSize;
+	band = bandWidth;
+	source = Key(mesh, cellSize, bandWidth);
+	const Aabb box = mesh.bounds();
+	origin = MyVector(box.min.x - band, box.min.y - band, box.min.z - band);
+	for (int axis = 0; axis < 3; axis++) {
+		const float extent = Axis(box.max, axis) - Axis(box.min, axis) + 2 * band;
+		dims[axis] = static_cast<uint32_t>(std::ceil(extent / cell)) + 1;
+	}
+	const size_t total = static_cast<size_t>(dims[0]) * dims[1] * dims[2];
+
+	//unsigned distance first, one closest triangle query per node, a slice of nodes per job
+	TriangleBvh bvh;
+	bvh.build(mesh);
+	const SphereTriangleKernel kernel = SphereTriangleKernelFor(ActiveSimdLevel());
+	std::vector<float> distances(total);
+	auto measure = [&](size_t first, size_t last) {
+		for (size_t z = first; z < last; z++) {
+			for (uint32_t y = 0; y < dims[1]; y++) {
+				for (uint32_t x = 0; x < dims[0]; x++) {
+					const MyVector p(origin.x + x * cell, origin.y + y * cell, origin.z + static_cast<float>(z) * cell);
+					float closest2 = band * band;
+					bvh.overlapSphere(p, band, kernel, [&](const TriangleHit& hit) { closest2 = std::min(closest2, hit.distance2); });
+					distances[node(x, y, static_cast<uint32_t>(z))] = std::sqrt(closest2);
+				}
+			}
+		}
+	};
+	if (jobs) jobs->parallelFor(dims[2], 1, measure);
+	else measure(0, dims[2]);
+
+	std::vector<uint8_t> votes(total, 0);
+	for (int axis = 0; axis < 3; axis++) vote(mesh, axis, votes);
+
+	values.resize(total);
+	for (size_t n = 0; n < total; n++) {
+		const float d = votes[n] >= 2 ? -distances[n] : distances[n];
+		values[n] = static_cast<int16_t>(std::lround(d / band * Levels));
+	}
+}
+
+void SignedDistanceField::vote(const TriangleMesh& mesh, int axis, std::vector<uint8_t>& votes) const {
+	const int u = (axis + 1) % 3, v = (axis + 2) % 3;
+	const double originU = Axis(origin, u), originV = Axis(origin, v), originW = Axis(origin, axis);
+
+	//where every row of nodes along axis crosses a triangle: (row, coordinate along the row)
+	std::vector<std::pair<size_t, double>> crossings;
+	for (size_t t = 0; t < mesh.triangleCount(); t++) {
+		MyVector corners[3];
+		mesh.triangle(t, corners[0], corners[1], corners[2]);
+		double pu[3], pv[3], pw[3];
+		for (int k = 0; k < 3; k++) {
+			pu[k] = Axis(corners[k], u);
+			pv[k] = Axis(corners[k], v);
+			pw[k] = Axis(corners[k], axis);
+		}
+		//edge on along the rows, the triangles around it take the crossing
+		const double area = Edge(pu[0], pv[0], pu[1], pv[1], pu[2], pv[2]);
+		if (area == 0) continue;
+		if (area < 0) {
+			std::swap(pu[1], pu[2]);
+			std::swap(pv[1], pv[2]);
+			std::swap(pw[1], pw[2]);
+		}
+
+		const double lowU = std::max(0.0, std::ceil((std::min({ pu[0], pu[1], pu[2] }) - originU) / cell));
+		const double highU = std::min(dims[u] - 1.0, std::floor((std::max({ pu[0], pu[1], pu[2] }) - originU) / cell));
+		const double lowV = std::max(0.0, std::ceil((std::min({ pv[0], pv[1], pv[2] }) - originV) / cell));
+		const double highV = std::min(dims[v] - 1.0, std::floor((std::max({ pv[0], pv[1], pv[2] }) - originV) / cell));
+		for (double jv = lowV; jv <= highV; jv++) {
+			const double qv = originV + jv * cell;
+			for (double ju = lowU; ju <= highU; ju++) {
+				const double qu = originU + ju * cell;
+				const double e0 = Edge(pu[1], pv[1], pu[2], pv[2], qu, qv);
+				const double e1 = Edge(pu[2], pv[2], pu[0], pv[0], qu, qv);
+				const double e2 = Edge(pu[0], pv[0], pu[1], pv[1], qu, qv);
+				if (!Owns(e0, pu[2] - pu[1], pv[2] - pv[1]) || !Owns(e1, pu[0] - pu[2], pv[0] - pv[2]) || !Owns(e2, pu[1] - pu[0], pv[1] - pv[0])) continue;
+
+				const double w = (e0 * pw[0] + e1 * pw[1] + e2 * pw[2]) / (e0 + e1 + e2);
+				crossings.push_back(std::make_pair(static_cast<size_t>(jv) * dims[u] + static_cast<size_t>(ju), w));
+			}
+		}
+	}
+	std::sort(crossings.begin(), crossings.end());
+
+	//past an odd number of crossings a node is inside
+	for (size_t first = 0; first < crossings.size();) {
+		const size_t row = crossings[first].first;
+		size_t last = first;
+		while (last < crossings.size() && crossings[last].first == row) last++;
+
+		uint32_t at[3];
+		at[u] = static_cast<uint32_t>(row % dims[u]);
+		at[v] = static_cast<uint32_t>(row / dims[u]);
+		bool inside = false;
+		size_t next = first;
+		for (uint32_t i = 0; i < dims[axis]; i++) {
+			const double w = originW + static_cast<double>(i) * cell;
+			while (next < last && crossings[next].second < w) {
+				inside = !inside;
+				next++;
+			}
+			if (!inside) continue;
+			at[axis] = i;
+			votes[node(at[0], at[1], at[2])]++;
+		}
+		first = last;
+	}
+}
+
+bool SignedDistanceField::sample(const MyVector& point, float& distance, MyVector& gradient) const {
+	if (empty()) return false;
+	const float gx = (point.x - origin.x) / cell, gy = (point.y - origin.y) / cell, gz = (point.z - origin.z) / cell;
+	//written so NaN fails too
+	if (!(gx >= 0 && gy >= 0 && gz >= 0 && gx <= dims[0] - 1 && gy <= dims[1] - 1 && gz <= dims[2] - 1)) return false;
+
+	//the last cell takes points on the far faces
+	const uint32_t x = std::min(static_cast<uint32_t>(gx), dims[0] - 2);
+	const uint32_t y = std::min(static_cast<uint32_t>(gy), dims[1] - 2);
+	const uint32_t z = std::min(static_cast<uint32_t>(gz), dims[2] - 2);
+	const float fx = gx - x, fy = gy - y, fz = gz - z;
+
+	const size_t n = node(x, y, z);
+	const size_t dy = dims[0], dz = static_cast<size_t>(dims[0]) * dims[1];
+	const float c000 = values[n], c100 = values[n + 1];
+	const float c010 = values[n + dy], c110 = values[n + dy + 1];
+	const float c001 = values[n + dz], c101 = values[n + dz + 1];
+	const float c011 = values[n + dz + dy], c111 = values[n + dz + dy + 1];
+
+	//blend along x, then y, then z; each step's differences are the derivative along its axis
+	const float x00 = c000 + (c100 - c000) * fx, x10 = c010 + (c110 - c010) * fx;
+	const float x01 = c001 + (c101 - c001) * fx, x11 = c011 + (c111 - c011) * fx;
+	const float y0 = x00 + (x10 - x00) * fy, y1 = x01 + (x11 - x01) * fy;
+
+	const float ddx0 = (c100 - c000) + ((c110 - c010) - (c100 - c000)) * fy;
+	const float ddx1 = (c101 - c001) + ((c111 - c011) - (c101 - c001)) * fy;
+	const float ddy = (x10 - x00) + ((x11 - x01) - (x10 - x00)) * fz;
+
+	const float scale = band / Levels;
+	distance = (y0 + (y1 - y0) * fz) * scale;
+	gradient = MyVector(ddx0 + (ddx1 - ddx0) * fz, ddy, y1 - y0) * (scale / cell);
+	return true;
+}
+
+float SignedDistanceField::distance(const MyVector& point) const {
+	float d;
+	MyVector gradient;
+	return sample(point, d, gradient) ? d : band;
+}
+
+bool SignedDistanceField::bakeCached(const TriangleMesh& mesh, float cellSize, float bandWidth, const std::string& path, std::string& error, JobSystem* jobs) {
+	error.clear();
+	const uint64_t key = Key(mesh, cellSize, bandWidth);
+	std::string ignored;
+	if (load(path, ignored) && source == key) {
+		cached = true;
+		return true;
+	}
+
+	bake(mesh, cellSize, bandWidth, jobs);
+	return save(path, error);
+}
+
+bool SignedDistanceField::save(const std::string& path, std::string& error) const {
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out) {
+		error = "cannot write " + path;
+		return false;
+	}
+
+	//native byte order, a cache is meant for the machine that baked it
+	out.write(Magic, sizeof(Magic));
+	Put(out, Version);
+	Put(out, source);
+	Put(out, origin.x);
+	Put(out, origin.y);
+	Put(out, origin.z);
+	Put(out, cell);
+	Put(out, band);
+	for (uint32_t d : dims) Put(out, d);
+	if (!values.empty()) out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(int16_t));
+
+	if (!out) {
+		error = "cannot write " + path;
+		return false;
+	}
+	return true;
+}
+
+bool SignedDistanceField::load(const std::string& path, std::string& error) {
+	clear();
+	std::ifstream in(path, std::ios::binary);
+	if (!in) {
+		error = "cannot open " + path;
+		return false;
+	}
+
+	char magic[sizeof(Magic)];
+	uint32_t version = 0;
+	float x, y, z;
+	bool ok = static_cast<bool>(in.read(magic, sizeof(magic))) && std::memcmp(magic, Magic, sizeof(Magic)) == 0;
+	ok = ok && Get(in, version) && version == Version;
+	ok = ok && Get(in, source) && Get(in, x) && Get(in, y) && Get(in, z) && Get(in, cell) && Get(in, band);
+	ok = ok && Get(in, dims[0]) && Get(in, dims[1]) && Get(in, dims[2]);
+	ok = ok && cell > 0 && band > 0 && dims[0] >= 2 && dims[1] >= 2 && dims[2] >= 2;
+	if (ok) {
+		//the rest of the file is exactly the grid, checked before a broken header can size the allocation
+		const double total = static_cast<double>(dims[0]) * dims[1] * dims[2];
+		const std::streamoff start = in.tellg();
+		in.seekg(0, std::ios::end);
+		ok = static_cast<double>(in.tellg() - start) == total * sizeof(int16_t);
+		in.seekg(start);
+	}
+	if (ok) {
+		values.resize(static_cast<size_t>(dims[0]) * dims[1] * dims[2]);
+		ok = static_cast<bool>(in.read(reinterpret_cast<char*>(values.data()), values.size() * sizeof(int16_t)));
+	}
+	if (!ok) {
+		clear();
+		error = path + ": not a distance field cache of this version";
+		return false;
+	}
+	origin = MyVector(x, y, z);
+	return true;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Aabb.h"
+#include "MyVector.h"
+
+namespace P6 {
+	class JobSystem;
+	class TriangleMesh;
+
+	//Signed distance to a static TriangleMesh sampled on a regular grid, for many particles against a
+	//shape too detailed to test triangle by triangle. A lookup blends the eight grid nodes around a
+	//point, whatever the triangle count, and the blend's derivative is the push-out direction.
+	//Negative inside, positive outside. Only a band around the surface is exact: further out the
+	//distance stops at +-band, so the band has to be wider than the largest particle radius.
+	//Baking runs a closest triangle query per node, so it is paid once per asset through a cache file
+	//that stores the grid as 16 bit values and is rebaked when the mesh or the settings change.
+	//Inside and outside come from counting surface crossings along rows of nodes, a majority vote over
+	//the three axes, so small holes in the mesh (the bottom of bunny.obj) don't flip whole rows.
+	//
+	//	SignedDistanceField bunny;
+	//	if (!bunny.bakeCached(mesh, 0.002f, 0.01f, "bunny.sdf", error)) ...
+	//	world.setStaticField(&bunny);
+	class SignedDistanceField {
+		public:
+			//the grid covers the mesh plus band on every side, one node every cellSize
+			void bake(const TriangleMesh& mesh, float cellSize, float band, JobSystem* jobs = nullptr);
+			void clear();
+
+			//loads path when it was baked from this mesh with these settings, otherwise bakes and writes it
+			//false only when the new cache can't be written; the field is baked and usable either way
+			bool bakeCached(const TriangleMesh& mesh, float cellSize, float band, const std::string& path, std::string& error, JobSystem* jobs = nullptr);
+			//whether the last bakeCached found a valid cache
+			bool fromCache() const { return cached; }
+
+			bool save(const std::string& path, std::string& error) const;
+			bool load(const std::string& path, std::string& error);
+
+			bool empty() const { return values.empty(); }
+			float cellSize() const { return cell; }
+			float bandWidth() const { return band; }
+			size_t nodeCount() const { return values.size(); }
+			//in nodes
+			uint32_t dimension(int axis) const { return dims[axis]; }
+			Aabb bounds() const;
+
+			//false outside the grid; gradient is the derivative of the blend, not normalised
+			bool sample(const MyVector& point, float& distance, MyVector& gradient) const;
+			//band outside the grid
+			float distance(const MyVector& point) const;
+
+		private:
+			size_t node(uint32_t x, uint32_t y, uint32_t z) const { return (static_cast<size_t>(z) * dims[1] + y) * dims[0] + x; }
+			//adds a vote to every node a row of nodes along axis finds inside the mesh
+			void vote(const TriangleMesh& mesh, int axis, std::vector<uint8_t>& votes) const;
+			//identifies what a cache was baked from
+			static uint64_t Key(const TriangleMesh& mesh, float cellSize, float band);
+
+			MyVector origin;
+			float cell = 0;
+			float band = 0;
+			uint32_t dims[3] = {};
+			uint64_t source = 0;
+			bool cached = false;
+			//distance / band * 32767, x fastest
+			std::vector<int16_t> values;
+	};
+}
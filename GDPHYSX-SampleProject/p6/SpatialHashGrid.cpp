@@ -0,0 +1,148 @@
+#include "SpatialHashGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace P6;
+
+namespace {
+	size_t NextPowerOfTwo(size_t value) {
+		size_t power = 1;
+		while (power < value) power <<= 1;
+		return power;
+	}
+}
+
+SpatialHashGrid::SpatialHashGrid(float cellSize) : requestedCellSize(cellSize) {}
+
+int SpatialHashGrid::cellCoordinate(float value) const {
+	//far away particles share the outermost cells instead of overflowing
+	float scaled = std::floor(value * inverseCell);
+	const float limit = 1073741824.0f;
+	if (scaled > limit) return 1073741824;
+	if (scaled < -limit) return -1073741824;
+	return static_cast<int>(scaled);
+}
+
+uint32_t SpatialHashGrid::bucketOf(int x, int y, int z) const {
+	//rows along x hash once (large primes from Teschner et al.) and then run through consecutive
+	//buckets, so the three cells x - 1, x, x + 1 of a row are one contiguous run of the sorted arrays
+	uint32_t row = (static_cast<uint32_t>(y) * 19349663u) ^ (static_cast<uint32_t>(z) * 83492791u);
+	return (row + static_cast<uint32_t>(x)) & static_cast<uint32_t>(buckets - 1);
+}
+
+void SpatialHashGrid::build(const ParticleStreams& s, size_t begin, size_t end) {
+	count = end - begin;
+
+	float largest = 0;
+	for (size_t i = begin; i < end; i++) largest = std::max(largest, s.radius[i]);
+	cell = std::max(requestedCellSize, 2.0f * largest);
+	if (cell <= 0) cell = 1.0f;
+	inverseCell = 1.0f / cell;
+
+	//about two buckets per particle keeps unrelated cells from sharing a bucket
+	buckets = NextPowerOfTwo(std::max<size_t>(64, count * 2));
+
+	particleBucket.resize(count);
+	bucketStart.assign(buckets + 1, 0);
+	sortedIndex.resize(count);
+	sortedX.resize(count);
+	sortedY.resize(count);
+	sortedZ.resize(count);
+	sortedRadius.resize(count);
+
+	//count
+	for (size_t k = 0; k < count; k++) {
+		const size_t i = begin + k;
+		uint32_t bucket = bucketOf(cellCoordinate(s.posX[i]), cellCoordinate(s.posY[i]), cellCoordinate(s.posZ[i]));
+		particleBucket[k] = bucket;
+		bucketStart[bucket + 1]++;
+	}
+
+	//prefix sum, bucketStart[b] becomes the first slot of bucket b
+	for (size_t b = 0; b < buckets; b++) bucketStart[b + 1] += bucketStart[b];
+
+	//scatter, each start doubles as the write cursor of its bucket
+	for (size_t k = 0; k < count; k++) {
+		const size_t i = begin + k;
+		uint32_t slot = bucketStart[particleBucket[k]]++;
+		sortedIndex[slot] = static_cast<uint32_t>(i);
+		sortedX[slot] = s.posX[i];
+		sortedY[slot] = s.posY[i];
+		sortedZ[slot] = s.posZ[i];
+		sortedRadius[slot] = s.radius[i];
+	}
+
+	//the scatter moved every start to the end of its bucket, shift them back
+	for (size_t b = buckets; b > 0; b--) bucketStart[b] = bucketStart[b - 1];
+	bucketStart[0] = 0;
+}
+
+int SpatialHashGrid::neighbourRanges(int cx, int cy, int cz, Range* ranges) const {
+	//one run of three buckets per neighbouring row, split only where it wraps around the table
+	int used = 0;
+	for (int dz = -1; dz <= 1; dz++) {
+		for (int dy = -1; dy <= 1; dy++) {
+			uint32_t first = bucketOf(cx - 1, cy + dy, cz + dz);
+			if (first + 3 <= buckets) {
+				ranges[used++] = Range{ bucketStart[first], bucketStart[first + 3] };
+			}
+			else {
+				for (uint32_t d = 0; d < 3; d++) {
+					uint32_t bucket = (first + d) & static_cast<uint32_t>(buckets - 1);
+					ranges[used++] = Range{ bucketStart[bucket], bucketStart[bucket + 1] };
+				}
+			}
+		}
+	}
+
+	//rows can hash onto overlapping buckets, sorted runs let the callers skip what they already saw
+	std::sort(ranges, ranges + used, [](const Range& l, const Range& r) { return l.begin < r.begin; });
+	return used;
+}
+
+void SpatialHashGrid::findPairs(std::vector<ParticlePair>& pairs, float margin) const {
+	Range ranges[27];
+
+	for (size_t k = 0; k < count; k++) {
+		const float x = sortedX[k], y = sortedY[k], z = sortedZ[k], r = sortedRadius[k];
+		const int used = neighbourRanges(cellCoordinate(x), cellCoordinate(y), cellCoordinate(z), ranges);
+
+		//merge the runs so no particle is visited twice
+		uint32_t scanned = static_cast<uint32_t>(k + 1);
+		for (int n = 0; n < used; n++) {
+			//each pair is reported from its lower sorted slot only
+			uint32_t begin = std::max(ranges[n].begin, scanned);
+			uint32_t end = ranges[n].end;
+			for (uint32_t m = begin; m < end; m++) {
+				const float dx = sortedX[m] - x, dy = sortedY[m] - y, dz = sortedZ[m] - z;
+				const float reach = r + sortedRadius[m] + margin;
+				if (dx * dx + dy * dy + dz * dz < reach * reach) {
+					uint32_t a = sortedIndex[k], b = sortedIndex[m];
+					pairs.push_back(a < b ? ParticlePair{ a, b } : ParticlePair{ b, a });
+				}
+			}
+			scanned = std::max(scanned, end);
+		}
+	}
+}
+
+void SpatialHashGrid::findPairs(const ParticleStreams& s, size_t begin, size_t end, std::vector<ParticlePair>& pairs) const {
+	if (count == 0) return;
+	Range ranges[27];
+
+	for (size_t i = begin; i < end; i++) {
+		const float x = s.posX[i], y = s.posY[i], z = s.posZ[i], r = s.radius[i];
+		const int used = neighbourRanges(cellCoordinate(x), cellCoordinate(y), cellCoordinate(z), ranges);
+
+		uint32_t scanned = 0;
+		for (int n = 0; n < used; n++) {
+			for (uint32_t m = std::max(ranges[n].begin, scanned); m < ranges[n].end; m++) {
+				const float dx = sortedX[m] - x, dy = sortedY[m] - y, dz = sortedZ[m] - z;
+				const float reach = r + sortedRadius[m];
+				if (dx * dx + dy * dy + dz * dz < reach * reach) pairs.push_back(ParticlePair{ static_cast<uint32_t>(i), sortedIndex[m] });
+			}
+			scanned = std::max(scanned, ranges[n].end);
+		}
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ParticleStreams.h"
+
+namespace P6 {
+	//two particles whose spheres overlap, dense indices into the ParticleBuffer with a < b
+	struct ParticlePair {
+		uint32_t a;
+		uint32_t b;
+	};
+
+	//Uniform grid broadphase, rebuilt from scratch every step.
+	//Cells are hashed into a fixed power-of-two table, so the world has no bounds. build() is a
+	//counting sort of the particles by bucket: count, prefix sum, scatter, with every array reused
+	//between steps, so there is no per-cell allocation and the cost is linear in the particle count.
+	//Cells are at least as wide as the largest particle, so overlapping spheres always sit in
+	//neighbouring cells and findPairs only looks at the 27 cells around each particle.
+	class SpatialHashGrid {
+		public:
+			//cellSize 0 picks the largest diameter each build, which suits equal-radius particles
+			explicit SpatialHashGrid(float cellSize = 0);
+
+			void setCellSize(float size) { requestedCellSize = size; }
+			//the cell size used by the last build
+			float cellSize() const { return cell; }
+
+			//buckets particles [0, count) by position
+			void build(const ParticleStreams& streams, size_t count) { build(streams, 0, count); }
+			//buckets particles [begin, end), the pairs still use their indices in streams
+			void build(const ParticleStreams& streams, size_t begin, size_t end);
+
+			//appends every pair with |pa - pb| < ra + rb + margin, each pair once
+			//positions are the ones seen by build, margin has to be smaller than cellSize - largest diameter
+			void findPairs(std::vector<ParticlePair>& pairs, float margin = 0) const;
+			//appends every pair between particles [begin, end) of streams, which are not in the grid, and the
+			//particles that are; their radii have to be at most half the cell size
+			//a is the index from [begin, end), b the one the grid was built with
+			void findPairs(const ParticleStreams& streams, size_t begin, size_t end, std::vector<ParticlePair>& pairs) const;
+
+			size_t bucketCount() const { return buckets; }
+
+		private:
+			struct Range {
+				uint32_t begin, end;
+			};
+
+			uint32_t bucketOf(int x, int y, int z) const;
+			//runs of the sorted arrays covering the 27 cells around a cell, sorted by begin; returns how many
+			int neighbourRanges(int x, int y, int z, Range* ranges) const;
+			int cellCoordinate(float value) const;
+
+			float requestedCellSize;
+			float cell = 1.0f;
+			float inverseCell = 1.0f;
+			size_t buckets = 0;
+			size_t count = 0;
+
+			//per particle: its bucket
+			std::vector<uint32_t> particleBucket;
+			//per bucket: first slot in the sorted arrays, bucketStart[buckets] = count
+			std::vector<uint32_t> bucketStart;
+			//particles in bucket order, positions and radii copied along so the pair search streams
+			std::vector<uint32_t> sortedIndex;
+			std::vector<float> sortedX, sortedY, sortedZ, sortedRadius;
+	};
+}
@@ -0,0 +1,232 @@
+#include "SpringForces.h"
+#include "JobSystem.h"
+#include "ParticleWorld.h"
+
+#include <algorithm>
+
+using namespace P6;
+
+namespace {
+	const uint32_t None = 0xFFFFFFFFu;
+	//springs per chunk of the gather and the kernel, a multiple of the widest kernel
+	const size_t Grain = 2048;
+	//64 colours fit the masks, a particle on more springs than that spills into one last colour
+	//that is added on a single thread
+	const uint32_t Spill = 64;
+}
+
+uint32_t SpringForces::addSpring(ParticleHandle a, ParticleHandle b, float restLength, float stiffness, float damping) {
+	return add(a, b, MyVector(), restLength, stiffness, damping, false);
+}
+
+uint32_t SpringForces::addBungee(ParticleHandle a, ParticleHandle b, float restLength, float stiffness, float damping) {
+	return add(a, b, MyVector(), restLength, stiffness, damping, true);
+}
+
+uint32_t SpringForces::addAnchored(ParticleHandle particle, const MyVector& anchor, float restLength, float stiffness, float damping) {
+	return add(particle, ParticleHandle(), anchor, restLength, stiffness, damping, false);
+}
+
+uint32_t SpringForces::add(ParticleHandle a, ParticleHandle b, const MyVector& anchor, float restLength, float k, float c, bool slackWhenShort) {
+	first.push_back(a);
+	second.push_back(b);
+	anchorX.push_back(anchor.x);
+	anchorY.push_back(anchor.y);
+	anchorZ.push_back(anchor.z);
+	rest.push_back(restLength);
+	stiffness.push_back(k);
+	damping.push_back(c);
+	slack.push_back(slackWhenShort ? restLength : 0.0f);
+	bungee.push_back(slackWhenShort ? 1 : 0);
+	colorsDirty = true;
+	resolved = false;
+	return static_cast<uint32_t>(first.size() - 1);
+}
+
+void SpringForces::setAnchor(uint32_t spring, const MyVector& anchor) {
+	anchorX[spring] = anchor.x;
+	anchorY[spring] = anchor.y;
+	anchorZ[spring] = anchor.z;
+}
+
+void SpringForces::setRestLength(uint32_t spring, float restLength) {
+	rest[spring] = restLength;
+	if (bungee[spring]) slack[spring] = restLength;
+}
+
+void SpringForces::setStiffness(uint32_t spring, float k, float c) {
+	stiffness[spring] = k;
+	damping[spring] = c;
+}
+
+void SpringForces::clear() {
+	first.clear();
+	second.clear();
+	anchorX.clear();
+	anchorY.clear();
+	anchorZ.clear();
+	rest.clear();
+	stiffness.clear();
+	damping.clear();
+	slack.clear();
+	bungee.clear();
+	colorsDirty = true;
+	resolved = false;
+}
+
+void SpringForces::buildColors(size_t slotCount) {
+	const size_t count = first.size();
+	colorMask.assign(slotCount, 0);
+	springColor.resize(count);
+	uint32_t colors = 0;
+	for (size_t s = 0; s < count; s++) {
+		//stale handles still name a slot, sharing it costs a colour at worst
+		const uint32_t a = first[s].slot, b = second[s].slot;
+		const bool hasA = a < slotCount, hasB = b < slotCount;
+		uint64_t used = (hasA ? colorMask[a] : 0) | (hasB ? colorMask[b] : 0);
+
+		uint32_t color = 0;
+		while (color < Spill && (used >> color) & 1) color++;
+		springColor[s] = color;
+		colors = std::max(colors, color + 1);
+		if (color == Spill) continue;
+
+		if (hasA) colorMask[a] |= 1ull << color;
+		if (hasB) colorMask[b] |= 1ull << color;
+	}
+
+	//counting sort by colour, springs keep their order inside a colour
+	colorStart.assign(colors + 1, 0);
+	for (uint32_t color : springColor) colorStart[color + 1]++;
+	for (uint32_t k = 0; k < colors; k++) colorStart[k + 1] += colorStart[k];
+	colorOrder.resize(count);
+	for (uint32_t s = 0; s < count; s++) colorOrder[colorStart[springColor[s]]++] = s;
+	for (uint32_t k = colors; k > 0; k--) colorStart[k] = colorStart[k - 1];
+	colorStart[0] = 0;
+	colorsDirty = false;
+}
+
+void SpringForces::resolve(const ParticleWorld& world, size_t begin, size_t end) {
+	for (size_t i = begin; i < end; i++) {
+		const size_t a = world.indexOf(first[i]);
+		const bool anchored = !second[i].IsValid();
+		const size_t b = anchored ? ParticleWorld::NotFound : world.indexOf(second[i]);
+		const bool dead = a == ParticleWorld::NotFound || (!anchored && b == ParticleWorld::NotFound);
+		indexA[i] = dead ? None : static_cast<uint32_t>(a);
+		indexB[i] = anchored ? None : static_cast<uint32_t>(b);
+	}
+}
+
+void SpringForces::apply(ParticleWorld& world) {
+	const size_t count = first.size();
+	if (count == 0) return;
+	if (colorsDirty) buildColors(world.capacity());
+
+	indexA.resize(count);
+	indexB.resize(count);
+	dx.resize(count);
+	dy.resize(count);
+	dz.resize(count);
+	dvx.resize(count);
+	dvy.resize(count);
+	dvz.resize(count);
+
+	SpringColumns columns;
+	columns.dx = dx.data();
+	columns.dy = dy.data();
+	columns.dz = dz.data();
+	columns.dvx = dvx.data();
+	columns.dvy = dvy.data();
+	columns.dvz = dvz.data();
+	columns.rest = rest.data();
+	columns.stiffness = stiffness.data();
+	columns.damping = damping.data();
+	columns.slack = slack.data();
+
+	const ParticleStreams& s = world.buffer().streams();
+	const SpringKernel kernel = SpringKernelFor(ActiveSimdLevel());
+	JobSystem* jobs = world.jobSystem();
+
+	const bool lookUp = !resolved || resolvedWorld != &world || resolvedLayout != world.layoutVersion();
+
+	//gather the ends, then one kernel over the chunk
+	auto evaluate = [&](size_t begin, size_t end) {
+		if (lookUp) resolve(world, begin, end);
+		const uint32_t* ia = indexA.data();
+		const uint32_t* ib = indexB.data();
+		float* x = dx.data();
+		float* y = dy.data();
+		float* z = dz.data();
+		float* vx = dvx.data();
+		float* vy = dvy.data();
+		float* vz = dvz.data();
+		for (size_t i = begin; i < end; i++) {
+			const uint32_t a = ia[i], b = ib[i];
+			if (a == None) {
+				//no length, so no force
+				x[i] = y[i] = z[i] = 0;
+				vx[i] = vy[i] = vz[i] = 0;
+			}
+			else if (b == None) {
+				x[i] = anchorX[i] - s.posX[a];
+				y[i] = anchorY[i] - s.posY[a];
+				z[i] = anchorZ[i] - s.posZ[a];
+				vx[i] = 0 - s.velX[a];
+				vy[i] = 0 - s.velY[a];
+				vz[i] = 0 - s.velZ[a];
+			}
+			else {
+				x[i] = s.posX[b] - s.posX[a];
+				y[i] = s.posY[b] - s.posY[a];
+				z[i] = s.posZ[b] - s.posZ[a];
+				vx[i] = s.velX[b] - s.velX[a];
+				vy[i] = s.velY[b] - s.velY[a];
+				vz[i] = s.velZ[b] - s.velZ[a];
+			}
+		}
+		kernel(columns, begin, end);
+	};
+
+	//springs of one colour touch disjoint particles
+	auto scatter = [&](const uint32_t* order, size_t begin, size_t end) {
+		const uint32_t* ia = indexA.data();
+		const uint32_t* ib = indexB.data();
+		const float* x = dx.data();
+		const float* y = dy.data();
+		const float* z = dz.data();
+		float* fx = s.forceX;
+		float* fy = s.forceY;
+		float* fz = s.forceZ;
+		for (size_t t = begin; t < end; t++) {
+			const uint32_t i = order[t];
+			const uint32_t a = ia[i];
+			if (a == None) continue;
+			fx[a] += x[i];
+			fy[a] += y[i];
+			fz[a] += z[i];
+			const uint32_t b = ib[i];
+			if (b == None) continue;
+			fx[b] -= x[i];
+			fy[b] -= y[i];
+			fz[b] -= z[i];
+		}
+	};
+
+	resolved = true;
+	resolvedWorld = &world;
+	resolvedLayout = world.layoutVersion();
+	if (!jobs) {
+		evaluate(0, count);
+		scatter(colorOrder.data(), 0, count);
+		return;
+	}
+
+	jobs->parallelFor(count, Grain, evaluate);
+	for (size_t k = 0; k + 1 < colorStart.size(); k++) {
+		const uint32_t* batch = colorOrder.data() + colorStart[k];
+		const size_t size = colorStart[k + 1] - colorStart[k];
+		//the spill colour shares particles, it is never split
+		const size_t grain = k == Spill ? size : Grain;
+		jobs->parallelFor(size, grain, [&](size_t begin, size_t end) { scatter(batch, begin, end); });
+	}
+}
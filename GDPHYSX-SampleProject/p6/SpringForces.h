@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MyVector.h"
+#include "ParticleHandle.h"
+#include "SpringKernels.h"
+
+namespace P6 {
+	class ParticleWorld;
+
+	//Every spring of a world in flat columns, for ropes, nets and soft props.
+	//A step gathers each spring's end-to-end position and velocity differences into columns, runs
+	//one SpringKernel over all of them, then adds the forces to both ends. The ends' handles are only
+	//looked up again after the world's layout changed (ParticleWorld::layoutVersion). Springs are coloured
+	//greedily by the particles they touch, like ContactResolver::resolveColored does with contacts,
+	//and the forces are added colour by colour: no two springs of a colour share a particle, so with
+	//a JobSystem each colour is added on all threads without locks. The serial path adds in the same
+	//order, so the sums come out with the same bits on any number of threads.
+	//Springs whose particle was killed stop pulling; their ids stay valid until clear().
+	//
+	//	SpringForces& springs = world.forces().springs();
+	//	springs.addSpring(a, b, 1.0f, 50.0f, 0.5f);
+	//	springs.addAnchored(a, MyVector(0, 10, 0), 2.0f, 50.0f);
+	class SpringForces {
+		public:
+			//pulls and pushes the two particles towards restLength apart
+			//damping works against the speed at which the spring gets longer or shorter
+			//returns the spring's id, ids count up from 0
+			uint32_t addSpring(ParticleHandle a, ParticleHandle b, float restLength, float stiffness, float damping = 0);
+			//same as a spring while longer than restLength, no force at all while shorter
+			uint32_t addBungee(ParticleHandle a, ParticleHandle b, float restLength, float stiffness, float damping = 0);
+			//a spring from the particle to a fixed point
+			uint32_t addAnchored(ParticleHandle particle, const MyVector& anchor, float restLength, float stiffness, float damping = 0);
+
+			size_t size() const { return first.size(); }
+
+			//can be changed between steps
+			void setAnchor(uint32_t spring, const MyVector& anchor);
+			void setRestLength(uint32_t spring, float restLength);
+			void setStiffness(uint32_t spring, float stiffness, float damping);
+
+			void clear();
+
+			//adds every spring's force to the accumulators of its particles
+			//ForceRegistry::applyForces calls it after the other generators, with the world's JobSystem
+			void apply(ParticleWorld& world);
+
+			//colours the last apply added the forces in
+			size_t colorCount() const { return colorStart.empty() ? 0 : colorStart.size() - 1; }
+
+		private:
+			uint32_t add(ParticleHandle a, ParticleHandle b, const MyVector& anchor, float restLength, float stiffness, float damping, bool bungee);
+			//fills colorOrder and colorStart, over particle slots so spawns and kills don't change them
+			void buildColors(size_t slotCount);
+			//looks the ends' handles up again, when springs were added or the world's layout changed
+			void resolve(const ParticleWorld& world, size_t begin, size_t end);
+
+			//per spring; second is invalid for anchored springs, which use the anchor instead
+			std::vector<ParticleHandle> first, second;
+			std::vector<float> anchorX, anchorY, anchorZ;
+			std::vector<float> rest, stiffness, damping, slack;
+			std::vector<uint8_t> bungee;
+
+			//per spring: the ends' dense indices; a is None for a spring with a dead end, b for an anchored one
+			std::vector<uint32_t> indexA, indexB;
+			const ParticleWorld* resolvedWorld = nullptr;
+			size_t resolvedLayout = 0;
+			bool resolved = false;
+			//the SpringColumns
+			std::vector<float> dx, dy, dz, dvx, dvy, dvz;
+
+			//springs sorted by colour, and where each colour starts; built again after springs are added
+			std::vector<uint32_t> colorOrder, colorStart;
+			std::vector<uint32_t> springColor;
+			std::vector<uint64_t> colorMask;
+			bool colorsDirty = true;
+	};
+}
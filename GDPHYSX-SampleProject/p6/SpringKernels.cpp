@@ -0,0 +1,34 @@
+#include "SpringKernels.h"
+
+#include <cmath>
+
+using namespace P6;
+
+SpringKernel P6::SpringKernelFor(SimdLevel level) {
+	switch (level) {
+#if P6_KERNELS_X86
+	case SimdLevel::AVX512:
+	case SimdLevel::AVX2:
+		return Kernels::SpringForcesAVX2;
+	case SimdLevel::SSE2:
+		return Kernels::SpringForcesSSE2;
+#endif
+	default:
+		return Kernels::SpringForcesScalar;
+	}
+}
+
+void Kernels::SpringForcesScalar(const SpringColumns& c, size_t begin, size_t end) {
+	for (size_t i = begin; i < end; i++) {
+		const float x = c.dx[i], y = c.dy[i], z = c.dz[i];
+		const float length = std::sqrt((x * x + y * y) + z * z);
+		//how fast the spring gets longer
+		const float stretching = ((x * c.dvx[i] + y * c.dvy[i]) + z * c.dvz[i]) / length;
+		const float pull = (c.stiffness[i] * (length - c.rest[i]) + c.damping[i] * stretching) / length;
+		//0 / 0 for a spring of length 0, never picked since slack >= 0
+		const float scale = length > c.slack[i] ? pull : 0.0f;
+		c.dx[i] = x * scale;
+		c.dy[i] = y * scale;
+		c.dz[i] = z * scale;
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+
+#include "ParticleKernels.h"
+
+namespace P6 {
+	//one column per value, one row per spring
+	struct SpringColumns {
+		//the second end's position minus the first's; comes back as the force on the first end,
+		//the second end gets its negative
+		float* dx = nullptr;
+		float* dy = nullptr;
+		float* dz = nullptr;
+		//the second end's velocity minus the first's
+		const float* dvx = nullptr;
+		const float* dvy = nullptr;
+		const float* dvz = nullptr;
+
+		const float* rest = nullptr;
+		const float* stiffness = nullptr;
+		const float* damping = nullptr;
+		//the spring only pulls or pushes while it is longer than this: 0 for springs, the rest length for bungees
+		const float* slack = nullptr;
+	};
+
+	//Hooke's law with damping along the spring for rows [begin, end):
+	//F = d^ * (stiffness * (|d| - rest) + damping * (d.dv / |d|)), 0 where |d| <= slack
+	typedef void (*SpringKernel)(const SpringColumns& columns, size_t begin, size_t end);
+
+	//the kernel for a level; AVX-512 gets the AVX2 one, the gather and scatter around it dominate
+	SpringKernel SpringKernelFor(SimdLevel level);
+
+	//SSE2 does the scalar kernel's operations in the same order and is bit-identical;
+	//AVX2 fuses multiply-adds, so forces may differ in the last few ulp
+	namespace Kernels {
+		void SpringForcesScalar(const SpringColumns& columns, size_t begin, size_t end);
+#if P6_KERNELS_X86
+		void SpringForcesSSE2(const SpringColumns& columns, size_t begin, size_t end);
+		void SpringForcesAVX2(const SpringColumns& columns, size_t begin, size_t end);
+#endif
+	}
+}
@@ -0,0 +1,29 @@
+#include "SpringKernels.h"
+
+#if P6_KERNELS_X86
+
+#include <immintrin.h>
+
+using namespace P6;
+
+//the SSE2 steps with fused multiply-adds
+P6_TARGET_AVX2 void Kernels::SpringForcesAVX2(const SpringColumns& c, size_t begin, size_t end) {
+	size_t i = begin;
+	for (; i + 8 <= end; i += 8) {
+		const __m256 x = _mm256_loadu_ps(c.dx + i), y = _mm256_loadu_ps(c.dy + i), z = _mm256_loadu_ps(c.dz + i);
+		const __m256 length = _mm256_sqrt_ps(_mm256_fmadd_ps(z, z, _mm256_fmadd_ps(y, y, _mm256_mul_ps(x, x))));
+		const __m256 along = _mm256_fmadd_ps(z, _mm256_loadu_ps(c.dvz + i),
+			_mm256_fmadd_ps(y, _mm256_loadu_ps(c.dvy + i), _mm256_mul_ps(x, _mm256_loadu_ps(c.dvx + i))));
+		const __m256 stretching = _mm256_div_ps(along, length);
+		const __m256 pull = _mm256_div_ps(_mm256_fmadd_ps(_mm256_loadu_ps(c.stiffness + i), _mm256_sub_ps(length, _mm256_loadu_ps(c.rest + i)),
+			_mm256_mul_ps(_mm256_loadu_ps(c.damping + i), stretching)), length);
+		const __m256 scale = _mm256_and_ps(_mm256_cmp_ps(length, _mm256_loadu_ps(c.slack + i), _CMP_GT_OQ), pull);
+		_mm256_storeu_ps(c.dx + i, _mm256_mul_ps(x, scale));
+		_mm256_storeu_ps(c.dy + i, _mm256_mul_ps(y, scale));
+		_mm256_storeu_ps(c.dz + i, _mm256_mul_ps(z, scale));
+	}
+
+	SpringForcesSSE2(c, i, end);
+}
+
+#endif
@@ -0,0 +1,29 @@
+#include "SpringKernels.h"
+
+#if P6_KERNELS_X86
+
+#include <emmintrin.h>
+
+using namespace P6;
+
+P6_TARGET_SSE2 void Kernels::SpringForcesSSE2(const SpringColumns& c, size_t begin, size_t end) {
+	size_t i = begin;
+	for (; i + 4 <= end; i += 4) {
+		const __m128 x = _mm_loadu_ps(c.dx + i), y = _mm_loadu_ps(c.dy + i), z = _mm_loadu_ps(c.dz + i);
+		const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+		const __m128 along = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_loadu_ps(c.dvx + i)), _mm_mul_ps(y, _mm_loadu_ps(c.dvy + i))),
+			_mm_mul_ps(z, _mm_loadu_ps(c.dvz + i)));
+		const __m128 stretching = _mm_div_ps(along, length);
+		const __m128 pull = _mm_div_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(c.stiffness + i), _mm_sub_ps(length, _mm_loadu_ps(c.rest + i))),
+			_mm_mul_ps(_mm_loadu_ps(c.damping + i), stretching)), length);
+		//the mask clears the 0 / 0 of springs with no length
+		const __m128 scale = _mm_and_ps(_mm_cmpgt_ps(length, _mm_loadu_ps(c.slack + i)), pull);
+		_mm_storeu_ps(c.dx + i, _mm_mul_ps(x, scale));
+		_mm_storeu_ps(c.dy + i, _mm_mul_ps(y, scale));
+		_mm_storeu_ps(c.dz + i, _mm_mul_ps(z, scale));
+	}
+
+	SpringForcesScalar(c, i, end);
+}
+
+#endif
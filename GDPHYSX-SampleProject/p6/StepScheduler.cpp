@@ -0,0 +1,42 @@
+#include "StepScheduler.h"
+
+#include <algorithm>
+
+using namespace P6;
+
+StepScheduler::StepScheduler(Duration timestep, int maxSubsteps)
+	: step(std::max(timestep, Duration(1))), stepSeconds(std::chrono::duration<float>(step).count()), maxSubsteps(maxSubsteps > 0 ? maxSubsteps : 1) {
+	reset();
+}
+
+void StepScheduler::reset() {
+	accumulator = Duration::zero();
+	simulated = Duration::zero();
+	dropped = Duration::zero();
+	steps = 0;
+}
+
+int StepScheduler::advance(Duration elapsed) {
+	if (elapsed > Duration::zero()) accumulator += elapsed;
+
+	int due = 0;
+	while (accumulator >= step && due < maxSubsteps) {
+		accumulator -= step;
+		due++;
+	}
+
+	//over the cap: keep only the partial step so alpha stays meaningful
+	if (accumulator >= step) {
+		Duration excess = accumulator - accumulator % step;
+		dropped += excess;
+		accumulator -= excess;
+	}
+
+	simulated += step * due;
+	steps += due;
+	return due;
+}
+
+float StepScheduler::alpha() const {
+	return static_cast<float>(accumulator.count()) / static_cast<float>(step.count());
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <chrono>
+
+namespace P6 {
+	//fixed timestep driver for the main loop
+	//real time goes into an accumulator and comes out as whole steps of exactly timestep(),
+	//the remainder carries over to the next frame instead of being dropped or rounded.
+	//
+	//	int steps = scheduler.advance(frameTime);
+	//	for (int i = 0; i < steps; i++) world.update(scheduler.seconds());
+	//	draw(world, scheduler.alpha());
+	class StepScheduler {
+		public:
+			typedef std::chrono::nanoseconds Duration;
+
+			//maxSubsteps caps the steps per advance, so a slow frame can't snowball into ever slower frames
+			//a timestep under 1 ns is taken as 1 ns, the accumulator can't be split into empty steps
+			explicit StepScheduler(Duration timestep, int maxSubsteps = 5);
+
+			//adds elapsed real time and returns how many fixed steps to run now
+			//anything past maxSubsteps steps is thrown away and counted in droppedTime
+			int advance(Duration elapsed);
+
+			Duration timestep() const { return step; }
+			//the fixed timestep in seconds, what world.update expects
+			float seconds() const { return stepSeconds; }
+
+			//how far the leftover time is into the next step, in [0, 1)
+			//render position = previous + (current - previous) * alpha
+			float alpha() const;
+
+			//total time simulated so far, always a whole number of steps
+			Duration simulatedTime() const { return simulated; }
+			//real time skipped because of the substep cap
+			Duration droppedTime() const { return dropped; }
+			long long stepCount() const { return steps; }
+
+			void reset();
+
+		private:
+			Duration step;
+			float stepSeconds;
+			int maxSubsteps;
+
+			Duration accumulator;
+			Duration simulated;
+			Duration dropped;
+			long long steps;
+	};
+}
@@ -0,0 +1,218 @@
+#include "SweepAndPrune.h"
+#include "ParticleWorld.h"
+
+#include <algorithm>
+#include <cfloat>
+
+using namespace P6;
+
+uint64_t SweepAndPrune::Key(uint32_t a, uint32_t b) {
+	return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+}
+
+bool SweepAndPrune::Before(const Endpoint& l, const Endpoint& r) {
+	//on a tie the max goes first, so touching boxes sit apart in the list and a min that later
+	//moves below that max still has to swap past it
+	if (l.value != r.value) return l.value < r.value;
+	return (l.data & 1) > (r.data & 1);
+}
+
+void SweepAndPrune::clear() {
+	proxies.clear();
+	for (std::vector<Endpoint>& axis : axes) axis.clear();
+	pairs.clear();
+	touched.clear();
+	addedPairs.clear();
+	removedPairs.clear();
+}
+
+bool SweepAndPrune::overlapping(ParticleHandle a, ParticleHandle b) const {
+	return pairs.count(Key(a.slot, b.slot)) != 0;
+}
+
+bool SweepAndPrune::boxesOverlap(uint32_t a, uint32_t b) const {
+	//strict, boxes that only touch don't overlap, the same rule the sort swaps follow
+	const Proxy& p = proxies[a];
+	const Proxy& q = proxies[b];
+	for (int axis = 0; axis < 3; axis++) {
+		if (p.max[axis] <= q.min[axis] || q.max[axis] <= p.min[axis]) return false;
+	}
+	return true;
+}
+
+void SweepAndPrune::togglePair(uint32_t a, uint32_t b, bool overlapping) {
+	const uint64_t key = Key(a, b);
+	const bool before = pairs.count(key) != 0;
+	if (before == overlapping) return;
+
+	//first change wins, that is the state from before this update
+	touched.emplace(key, before);
+	if (overlapping) pairs.insert(key);
+	else pairs.erase(key);
+}
+
+void SweepAndPrune::refreshValues(int axis) {
+	for (Endpoint& e : axes[axis]) {
+		const Proxy& proxy = proxies[e.data >> 1];
+		e.value = (e.data & 1) ? proxy.max[axis] : proxy.min[axis];
+	}
+}
+
+void SweepAndPrune::sortAxis(int axis) {
+	std::vector<Endpoint>& list = axes[axis];
+	for (size_t i = 1; i < list.size(); i++) {
+		const Endpoint moving = list[i];
+		const bool movingMax = (moving.data & 1) != 0;
+		const uint32_t owner = moving.data >> 1;
+
+		size_t j = i;
+		while (j > 0 && Before(moving, list[j - 1])) {
+			const Endpoint& passed = list[j - 1];
+			const bool passedMax = (passed.data & 1) != 0;
+			const uint32_t other = passed.data >> 1;
+
+			if (other != owner && movingMax != passedMax) {
+				//a min moving below a max: overlap starts on this axis, the others decide
+				if (!movingMax) {
+					if (boxesOverlap(owner, other)) togglePair(owner, other, true);
+				}
+				//a max moving below a min: the boxes are apart on this axis
+				else {
+					togglePair(owner, other, false);
+				}
+			}
+
+			list[j] = passed;
+			j--;
+		}
+		list[j] = moving;
+	}
+}
+
+void SweepAndPrune::rebuild() {
+	for (int axis = 0; axis < 3; axis++) {
+		refreshValues(axis);
+		std::sort(axes[axis].begin(), axes[axis].end(), [](const Endpoint& l, const Endpoint& r) { return Before(l, r); });
+	}
+
+	//sweep x keeping the boxes whose interval is open, test the other two axes against those
+	open.clear();
+	swept.clear();
+	for (const Endpoint& e : axes[0]) {
+		const uint32_t owner = e.data >> 1;
+		if (e.data & 1) {
+			open.erase(std::find(open.begin(), open.end(), owner));
+			continue;
+		}
+		for (uint32_t other : open) {
+			if (boxesOverlap(owner, other)) swept.insert(Key(owner, other));
+		}
+		open.push_back(owner);
+	}
+
+	//diff against the old set so the events come out the same as from the incremental sort
+	std::vector<uint64_t> gone;
+	for (uint64_t key : pairs) {
+		if (!swept.count(key)) gone.push_back(key);
+	}
+	for (uint64_t key : gone) togglePair(static_cast<uint32_t>(key >> 32), static_cast<uint32_t>(key & 0xFFFFFFFFu), false);
+	for (uint64_t key : swept) togglePair(static_cast<uint32_t>(key >> 32), static_cast<uint32_t>(key & 0xFFFFFFFFu), true);
+}
+
+void SweepAndPrune::update(const ParticleWorld& world) {
+	touched.clear();
+	addedPairs.clear();
+	removedPairs.clear();
+
+	//net pair changes of the sorts so far, reported with the handles the proxies have right now
+	auto flush = [this]() {
+		for (const std::pair<const uint64_t, bool>& change : touched) {
+			const bool now = pairs.count(change.first) != 0;
+			if (now == change.second) continue;
+
+			PairEvent event;
+			event.a.slot = static_cast<uint32_t>(change.first >> 32);
+			event.a.generation = proxies[event.a.slot].generation;
+			event.b.slot = static_cast<uint32_t>(change.first & 0xFFFFFFFFu);
+			event.b.generation = proxies[event.b.slot].generation;
+			(now ? addedPairs : removedPairs).push_back(event);
+		}
+		touched.clear();
+	};
+
+	if (proxies.size() < world.capacity()) proxies.resize(world.capacity());
+
+	//killed particles: push their boxes past everything, the sort removes their pairs on the way,
+	//then drop their endpoints from the tail
+	bool anyDead = false;
+	for (uint32_t slot = 0; slot < proxies.size(); slot++) {
+		Proxy& proxy = proxies[slot];
+		ParticleHandle handle;
+		handle.slot = slot;
+		handle.generation = proxy.generation;
+		if (!proxy.live || world.alive(handle)) continue;
+
+		for (int axis = 0; axis < 3; axis++) {
+			proxy.min[axis] = FLT_MAX;
+			proxy.max[axis] = FLT_MAX;
+		}
+		anyDead = true;
+	}
+	if (anyDead) {
+		for (int axis = 0; axis < 3; axis++) {
+			refreshValues(axis);
+			sortAxis(axis);
+		}
+		flush();
+
+		for (Proxy& proxy : proxies) {
+			if (proxy.live && proxy.min[0] == FLT_MAX) proxy.live = false;
+		}
+		for (int axis = 0; axis < 3; axis++) {
+			std::vector<Endpoint>& list = axes[axis];
+			size_t tail = list.size();
+			while (tail > 0 && list[tail - 1].value == FLT_MAX) tail--;
+
+			size_t kept = tail;
+			for (size_t i = tail; i < list.size(); i++) {
+				if (proxies[list[i].data >> 1].live) list[kept++] = list[i];
+			}
+			list.resize(kept);
+		}
+	}
+
+	//current boxes straight from the columns, new particles get endpoints appended
+	const ParticleStreams& s = world.buffer().streams();
+	size_t spawned = 0;
+	for (size_t i = 0; i < world.size(); i++) {
+		const ParticleHandle handle = world.handleAt(i);
+		Proxy& proxy = proxies[handle.slot];
+
+		const float r = s.radius[i];
+		proxy.min[0] = s.posX[i] - r; proxy.max[0] = s.posX[i] + r;
+		proxy.min[1] = s.posY[i] - r; proxy.max[1] = s.posY[i] + r;
+		proxy.min[2] = s.posZ[i] - r; proxy.max[2] = s.posZ[i] + r;
+
+		if (!proxy.live) {
+			proxy.live = true;
+			proxy.generation = handle.generation;
+			spawned++;
+			for (int axis = 0; axis < 3; axis++) {
+				axes[axis].push_back(Endpoint{ proxy.min[axis], handle.slot << 1 });
+				axes[axis].push_back(Endpoint{ proxy.max[axis], (handle.slot << 1) | 1 });
+			}
+		}
+	}
+
+	//appended endpoints are unsorted, past a few of them the insertion sort turns quadratic
+	if (spawned * 8 > world.size()) {
+		rebuild();
+	}
+	else {
+		for (int axis = 0; axis < 3; axis++) {
+			refreshValues(axis);
+			sortAxis(axis);
+		}
+	}
+	flush();
+}
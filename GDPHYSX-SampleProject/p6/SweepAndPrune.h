@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ParticleHandle.h"
+
+namespace P6 {
+	class ParticleWorld;
+
+	//a pair that started or stopped overlapping during the last update
+	struct PairEvent {
+		ParticleHandle a;
+		ParticleHandle b;
+	};
+
+	//Incremental sweep and prune over the particle AABBs (position +- radius).
+	//The endpoint lists of all three axes stay sorted between updates and are repaired with an
+	//insertion sort, which is close to linear when particles move a little each step. Every swap
+	//of a min past a max is exactly where two boxes start or stop overlapping on that axis, so the
+	//sort itself produces the pair changes and update() reports those instead of the whole pair set.
+	//Box sizes don't matter, unlike a grid, so mixed particle sizes cost nothing extra.
+	//
+	//	world.update(dt);
+	//	sap.update(world);
+	//	for (const PairEvent& e : sap.added()) ...
+	class SweepAndPrune {
+		public:
+			//reads every live particle straight from the world's position and radius columns,
+			//picks up spawned and killed particles, and re-sorts
+			void update(const ParticleWorld& world);
+
+			//net changes since the previous update
+			//pairs of killed particles show up in removed(), with their old handles
+			const std::vector<PairEvent>& added() const { return addedPairs; }
+			const std::vector<PairEvent>& removed() const { return removedPairs; }
+
+			size_t pairCount() const { return pairs.size(); }
+			bool overlapping(ParticleHandle a, ParticleHandle b) const;
+
+			void clear();
+
+		private:
+			struct Endpoint {
+				float value;
+				//proxy << 1 | 1 for a max
+				uint32_t data;
+			};
+
+			struct Proxy {
+				bool live = false;
+				uint32_t generation = 0;
+				float min[3];
+				float max[3];
+			};
+
+			static uint64_t Key(uint32_t a, uint32_t b);
+			static bool Before(const Endpoint& l, const Endpoint& r);
+
+			void sortAxis(int axis);
+			void refreshValues(int axis);
+			bool boxesOverlap(uint32_t a, uint32_t b) const;
+			void togglePair(uint32_t a, uint32_t b, bool overlapping);
+			//full sort and sweep, for the first update and large batches of new particles
+			void rebuild();
+
+			std::vector<Proxy> proxies;
+			std::vector<Endpoint> axes[3];
+
+			std::unordered_set<uint64_t> pairs;
+			//pairs whose state changed this update, with the state they had before it
+			std::unordered_map<uint64_t, bool> touched;
+
+			std::vector<PairEvent> addedPairs;
+			std::vector<PairEvent> removedPairs;
+
+			//rebuild scratch
+			std::vector<uint32_t> open;
+			std::unordered_set<uint64_t> swept;
+	};
+}
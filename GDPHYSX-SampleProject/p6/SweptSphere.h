@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cmath>
+
+#include "MyVector.h"
+
+namespace P6 {
+	//Time of impact of two spheres moving in straight lines over one step, as a fraction of it.
+	//Only the relative motion matters: separation is where a is relative to b at t = 0, motion how
+	//far that changes by t = 1, reach the sum of the radii. Solves |separation + t motion| = reach for
+	//the first t in (from, 1]. Returns false when they don't touch in that range, and when they are
+	//already overlapping at t = from, which is left to the ordinary contacts.
+	inline bool SweptSphereHit(const MyVector& separation, const MyVector& motion, float reach, float from, float& t) {
+		const float a = motion.x * motion.x + motion.y * motion.y + motion.z * motion.z;
+		if (a <= 0) return false;
+
+		const MyVector start(separation.x + motion.x * from, separation.y + motion.y * from, separation.z + motion.z * from);
+		const float b = start.x * motion.x + start.y * motion.y + start.z * motion.z;
+		const float c = start.x * start.x + start.y * start.y + start.z * start.z - reach * reach;
+		//moving apart, or already inside each other
+		if (b >= 0 || c < 0) return false;
+
+		const float discriminant = b * b - a * c;
+		if (discriminant < 0) return false;
+
+		//first root of a s^2 + 2 b s + c = 0, s counted from `from`
+		const float s = (-b - std::sqrt(discriminant)) / a;
+		t = from + s;
+		return t <= 1.0f;
+	}
+}
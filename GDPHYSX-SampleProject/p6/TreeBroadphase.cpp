@@ -0,0 +1,83 @@
+#include "TreeBroadphase.h"
+#include "ParticleWorld.h"
+#include "TriangleMesh.h"
+
+using namespace P6;
+
+TreeBroadphase::TreeBroadphase(float margin) : dynamicTree(margin), fixedTree(0) {}
+
+uint32_t TreeBroadphase::addStatic(const Aabb& box) {
+	const uint32_t id = static_cast<uint32_t>(staticShapes++);
+	fixedTree.insert(box, id);
+	return id;
+}
+
+uint32_t TreeBroadphase::addStatic(const TriangleMesh& mesh) {
+	const uint32_t first = static_cast<uint32_t>(staticShapes);
+	for (size_t t = 0; t < mesh.triangleCount(); t++) addStatic(mesh.triangleBounds(t));
+	return first;
+}
+
+void TreeBroadphase::clearParticles() {
+	dynamicTree.clear();
+	proxies.clear();
+	denseSlot.clear();
+}
+
+void TreeBroadphase::update(const ParticleWorld& world) {
+	reinsertions = 0;
+	if (proxies.size() < world.capacity()) proxies.resize(world.capacity());
+
+	//killed particles, a reused slot shows up as a new generation
+	for (uint32_t slot = 0; slot < proxies.size(); slot++) {
+		Proxy& proxy = proxies[slot];
+		if (proxy.node == AabbTree::Null) continue;
+
+		ParticleHandle handle;
+		handle.slot = slot;
+		handle.generation = proxy.generation;
+		if (world.alive(handle)) continue;
+
+		dynamicTree.remove(proxy.node);
+		proxy.node = AabbTree::Null;
+	}
+
+	const ParticleStreams& s = world.buffer().streams();
+	denseSlot.resize(world.size());
+	for (size_t i = 0; i < world.size(); i++) {
+		const ParticleHandle handle = world.handleAt(i);
+		Proxy& proxy = proxies[handle.slot];
+		proxy.index = static_cast<uint32_t>(i);
+		proxy.box = Aabb::Around(MyVector(s.posX[i], s.posY[i], s.posZ[i]), s.radius[i]);
+		denseSlot[i] = handle.slot;
+
+		if (proxy.node == AabbTree::Null) {
+			proxy.node = dynamicTree.insert(proxy.box, handle.slot);
+			proxy.generation = handle.generation;
+			continue;
+		}
+
+		const MyVector displacement(s.posX[i] - s.prevX[i], s.posY[i] - s.prevY[i], s.posZ[i] - s.prevZ[i]);
+		if (dynamicTree.move(proxy.node, proxy.box, displacement)) reinsertions++;
+	}
+}
+
+void TreeBroadphase::findPairs(std::vector<ParticlePair>& particlePairs, std::vector<StaticPair>& staticPairs) const {
+	//in tree order rather than buffer order, consecutive queries then walk mostly the same nodes
+	dynamicTree.forEachLeaf([&](int32_t leaf) {
+		const Proxy& proxy = proxies[dynamicTree.userData(leaf)];
+		const uint32_t index = proxy.index;
+
+		//fat boxes only narrow it down, the exact boxes decide
+		dynamicTree.query(proxy.box, [&](int32_t node) {
+			const Proxy& other = proxies[dynamicTree.userData(node)];
+			if (other.index > index && other.box.overlaps(proxy.box)) particlePairs.push_back(ParticlePair{ index, other.index });
+			return true;
+		});
+
+		fixedTree.query(proxy.box, [&](int32_t node) {
+			staticPairs.push_back(StaticPair{ index, fixedTree.userData(node) });
+			return true;
+		});
+	});
+}
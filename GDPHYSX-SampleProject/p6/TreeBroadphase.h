@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Aabb.h"
+#include "AabbTree.h"
+#include "SpatialHashGrid.h"
+
+namespace P6 {
+	class ParticleWorld;
+	class TriangleMesh;
+
+	//a particle whose box overlaps a static shape
+	struct StaticPair {
+		//dense index into the ParticleBuffer
+		uint32_t particle;
+		//the id addStatic returned
+		uint32_t shape;
+	};
+
+	//Broadphase over two AabbTrees: one for the particles of a ParticleWorld, with fat boxes
+	//that follow them, and one for static level geometry, built once with exact boxes.
+	//Static shapes are never moved or reinserted and never tested against each other, and
+	//every particle finds its static neighbours with one O(log n) descent of the static tree,
+	//so a level of thousands of triangles costs about as much as a handful.
+	//
+	//	broadphase.addStatic(level);			//once, a box per triangle
+	//	world.update(dt);
+	//	broadphase.update(world);
+	//	broadphase.findPairs(particlePairs, staticPairs);
+	class TreeBroadphase {
+		public:
+			//how far particles may move before their fat boxes have to be reinserted
+			explicit TreeBroadphase(float margin = 0.1f);
+
+			//returns the id of the shape, ids count up from 0
+			uint32_t addStatic(const Aabb& box);
+			//one shape per triangle, returns the id of the first, triangle i gets first + i
+			uint32_t addStatic(const TriangleMesh& mesh);
+			size_t staticCount() const { return staticShapes; }
+
+			//inserts spawned particles, removes killed ones and moves the rest by their last step
+			void update(const ParticleWorld& world);
+
+			//every pair whose exact boxes overlap, as of the last update
+			//particle pairs come once each with a < b, both in dense indices
+			void findPairs(std::vector<ParticlePair>& particlePairs, std::vector<StaticPair>& staticPairs) const;
+
+			//how many particles left their fat box in the last update
+			size_t reinserted() const { return reinsertions; }
+
+			const AabbTree& particleTree() const { return dynamicTree; }
+			const AabbTree& staticTree() const { return fixedTree; }
+
+			//forgets the particles, the static shapes stay
+			void clearParticles();
+
+		private:
+			struct Proxy {
+				int32_t node = AabbTree::Null;
+				uint32_t generation = 0;
+				uint32_t index = 0;
+				Aabb box;
+			};
+
+			AabbTree dynamicTree;
+			AabbTree fixedTree;
+			size_t staticShapes = 0;
+			size_t reinsertions = 0;
+
+			//per world slot
+			std::vector<Proxy> proxies;
+			//per dense index: the slot, as of the last update
+			std::vector<uint32_t> denseSlot;
+	};
+}
@@ -0,0 +1,160 @@
+#include "TriangleBvh.h"
+#include "TriangleMesh.h"
+
+#include <algorithm>
+
+using namespace P6;
+
+namespace {
+	//what a set of triangles costs to test, the kernel takes them eight at a time
+	float Packets(size_t count) {
+		return static_cast<float>((count + TrianglePacket::Lanes - 1) / TrianglePacket::Lanes);
+	}
+
+	float Axis(const MyVector& v, int axis) {
+		return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+	}
+}
+
+void TriangleBvh::clear() {
+	nodes.clear();
+	packets.clear();
+	normals.clear();
+	triangles = 0;
+	maxDepth = 0;
+}
+
+void TriangleBvh::build(const TriangleMesh& mesh) {
+	clear();
+
+	std::vector<Build> items;
+	items.reserve(mesh.triangleCount());
+	normals.resize(mesh.triangleCount());
+	for (size_t t = 0; t < mesh.triangleCount(); t++) {
+		MyVector a, b, c;
+		mesh.triangle(t, a, b, c);
+		if (!TrianglePacket::Usable(a, b, c)) continue;
+
+		normals[t] = MyVector(b - a).vectorProduct(c - a).Direction();
+		Build item;
+		item.box = mesh.triangleBounds(t);
+		item.centroid = (a + b + c) * (1.0f / 3.0f);
+		item.triangle = static_cast<uint32_t>(t);
+		items.push_back(item);
+	}
+	triangles = items.size();
+	if (items.empty()) return;
+
+	//a full binary tree with leaves of at least one triangle
+	nodes.reserve(2 * items.size());
+	packets.reserve(items.size());
+	split(items, 0, items.size(), 0);
+
+	//the packets are filled from the mesh, the build order is only needed while splitting
+	for (TrianglePacket& packet : packets) {
+		for (int lane = 0; lane < TrianglePacket::Lanes; lane++) {
+			const uint32_t t = packet.triangle[std::min(lane, packet.count - 1)];
+			MyVector a, b, c;
+			mesh.triangle(t, a, b, c);
+			packet.set(lane, a, b, c, t);
+		}
+	}
+}
+
+void TriangleBvh::makeLeaf(Node& node, const std::vector<Build>& items, size_t begin, size_t end) {
+	node.leaf = true;
+	node.first = static_cast<uint32_t>(packets.size());
+
+	TrianglePacket packet;
+	packet.count = static_cast<int>(end - begin);
+	for (size_t i = begin; i < end; i++) packet.triangle[i - begin] = items[i].triangle;
+	packets.push_back(packet);
+}
+
+uint32_t TriangleBvh::split(std::vector<Build>& items, size_t begin, size_t end, int depth) {
+	const uint32_t index = static_cast<uint32_t>(nodes.size());
+	nodes.push_back(Node());
+	maxDepth = std::max(maxDepth, depth);
+
+	Aabb box = items[begin].box;
+	Aabb centroids(items[begin].centroid, items[begin].centroid);
+	for (size_t i = begin + 1; i < end; i++) {
+		box = Aabb::Merge(box, items[i].box);
+		centroids = Aabb::Merge(centroids, Aabb(items[i].centroid, items[i].centroid));
+	}
+	nodes[index].box = box;
+
+	const size_t count = end - begin;
+	if (count <= static_cast<size_t>(TrianglePacket::Lanes)) {
+		makeLeaf(nodes[index], items, begin, end);
+		return index;
+	}
+
+	//binned surface area heuristic over all three axes
+	int bestAxis = -1;
+	int bestSplit = 0;
+	float bestCost = 0;
+	if (depth < MaxDepth) {
+		for (int axis = 0; axis < 3; axis++) {
+			const float low = Axis(centroids.min, axis), extent = Axis(centroids.max, axis) - low;
+			if (extent <= 0) continue;
+			const float scale = Bins / extent;
+
+			size_t binCount[Bins] = {};
+			Aabb binBox[Bins];
+			for (size_t i = begin; i < end; i++) {
+				const int bin = std::min(static_cast<int>((Axis(items[i].centroid, axis) - low) * scale), Bins - 1);
+				binBox[bin] = binCount[bin]++ == 0 ? items[i].box : Aabb::Merge(binBox[bin], items[i].box);
+			}
+
+			//area and count left of every plane, then sweep back from the right
+			float leftArea[Bins - 1];
+			size_t leftCount[Bins - 1];
+			Aabb grow;
+			size_t seen = 0;
+			for (int b = 0; b < Bins - 1; b++) {
+				if (binCount[b] > 0) grow = seen == 0 ? binBox[b] : Aabb::Merge(grow, binBox[b]);
+				seen += binCount[b];
+				leftCount[b] = seen;
+				leftArea[b] = seen > 0 ? grow.surfaceArea() : 0;
+			}
+			seen = 0;
+			for (int b = Bins - 1; b > 0; b--) {
+				if (binCount[b] > 0) grow = seen == 0 ? binBox[b] : Aabb::Merge(grow, binBox[b]);
+				seen += binCount[b];
+				const size_t left = leftCount[b - 1];
+				if (left == 0 || seen == 0) continue;
+
+				const float cost = leftArea[b - 1] * Packets(left) + grow.surfaceArea() * Packets(seen);
+				if (bestAxis < 0 || cost < bestCost) {
+					bestAxis = axis;
+					bestSplit = b;
+					bestCost = cost;
+				}
+			}
+		}
+	}
+
+	size_t middle = begin;
+	if (bestAxis >= 0) {
+		const float low = Axis(centroids.min, bestAxis);
+		const float scale = Bins / (Axis(centroids.max, bestAxis) - low);
+		middle = std::partition(items.begin() + begin, items.begin() + end, [&](const Build& item) {
+			return std::min(static_cast<int>((Axis(item.centroid, bestAxis) - low) * scale), Bins - 1) < bestSplit;
+		}) - items.begin();
+	}
+	if (middle == begin || middle == end) {
+		//all centroids in one bin, or too deep: halve along the widest axis
+		const MyVector extent = centroids.max - centroids.min;
+		const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+		middle = begin + count / 2;
+		std::nth_element(items.begin() + begin, items.begin() + middle, items.begin() + end, [axis](const Build& a, const Build& b) {
+			return Axis(a.centroid, axis) < Axis(b.centroid, axis);
+		});
+	}
+
+	split(items, begin, middle, depth + 1);
+	const uint32_t right = split(items, middle, end, depth + 1);
+	nodes[index].first = right;
+	return index;
+}
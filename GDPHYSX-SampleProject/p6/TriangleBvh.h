@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Aabb.h"
+#include "MyVector.h"
+#include "TriangleKernels.h"
+
+namespace P6 {
+	class TriangleMesh;
+
+	//a triangle within reach of a sphere
+	struct TriangleHit {
+		//index into the TriangleMesh
+		uint32_t triangle;
+		//closest point of the triangle to the sphere's centre
+		MyVector closest;
+		//unit normal of the face, wound like the mesh
+		MyVector normal;
+		float distance2;
+	};
+
+	//Bounding volume hierarchy over the triangles of a static TriangleMesh, for spheres colliding
+	//with level geometry. Built once, top down: each node is split where the surface area heuristic
+	//puts it, over 16 bins per axis, counting triangles in packets of eight because that is how a
+	//leaf is tested. Every leaf holds one TrianglePacket, so a sphere that reaches a leaf tests all its
+	//triangles with one SphereTriangleKernel call. Nodes are stored depth first, the left child right
+	//after its parent. Triangles without area are left out.
+	//
+	//	TriangleBvh level;
+	//	level.build(mesh);
+	//	world.setStaticMesh(&level);
+	class TriangleBvh {
+		public:
+			static constexpr int Bins = 16;
+			//past this the build splits at the median, which always halves
+			static constexpr int MaxDepth = 48;
+
+			void build(const TriangleMesh& mesh);
+			void clear();
+
+			size_t triangleCount() const { return triangles; }
+			size_t nodeCount() const { return nodes.size(); }
+			size_t leafCount() const { return packets.size(); }
+			//0 for a single leaf
+			int depth() const { return maxDepth; }
+			Aabb bounds() const { return nodes.empty() ? Aabb() : nodes[0].box; }
+
+			//calls hit(const TriangleHit&) for every triangle closer to center than radius
+			template <typename Hit>
+			void overlapSphere(const MyVector& center, float radius, SphereTriangleKernel kernel, Hit&& hit) const;
+
+		private:
+			struct Node {
+				Aabb box;
+				//leaves: the packet; inner nodes: the right child, the left one is the next node
+				uint32_t first = 0;
+				bool leaf = false;
+			};
+
+			struct Build {
+				Aabb box;
+				MyVector centroid;
+				uint32_t triangle;
+			};
+
+			uint32_t split(std::vector<Build>& items, size_t begin, size_t end, int depth);
+			void makeLeaf(Node& node, const std::vector<Build>& items, size_t begin, size_t end);
+
+			std::vector<Node> nodes;
+			std::vector<TrianglePacket> packets;
+			size_t triangles = 0;
+			int maxDepth = 0;
+			//face normal per mesh triangle
+			std::vector<MyVector> normals;
+	};
+
+	template <typename Hit>
+	void TriangleBvh::overlapSphere(const MyVector& center, float radius, SphereTriangleKernel kernel, Hit&& hit) const {
+		const float radius2 = radius * radius;
+		//below MaxDepth the build halves, so no path is longer than MaxDepth + 32
+		uint32_t stack[MaxDepth + 34];
+		int top = 0;
+		if (!nodes.empty()) stack[top++] = 0;
+
+		SphereTriangleHits found;
+		while (top > 0) {
+			const uint32_t index = stack[--top];
+			const Node& node = nodes[index];
+
+			//squared distance from the centre to the box
+			const float dx = std::max(std::max(node.box.min.x - center.x, center.x - node.box.max.x), 0.0f);
+			const float dy = std::max(std::max(node.box.min.y - center.y, center.y - node.box.max.y), 0.0f);
+			const float dz = std::max(std::max(node.box.min.z - center.z, center.z - node.box.max.z), 0.0f);
+			if (dx * dx + dy * dy + dz * dz >= radius2) continue;
+
+			if (!node.leaf) {
+				stack[top++] = node.first;
+				stack[top++] = index + 1;
+				continue;
+			}
+
+			const TrianglePacket& packet = packets[node.first];
+			for (unsigned mask = kernel(packet, center, radius, found); mask != 0; mask &= mask - 1) {
+				int lane = 0;
+				while (!(mask & (1u << lane))) lane++;
+
+				TriangleHit result;
+				result.triangle = packet.triangle[lane];
+				result.closest = MyVector(found.x[lane], found.y[lane], found.z[lane]);
+				result.normal = normals[packet.triangle[lane]];
+				result.distance2 = found.distance2[lane];
+				hit(result);
+			}
+		}
+	}
+}
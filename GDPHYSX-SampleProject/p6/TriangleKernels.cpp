@@ -0,0 +1,88 @@
+#include "TriangleKernels.h"
+
+#include <cmath>
+
+using namespace P6;
+
+bool TrianglePacket::Usable(const MyVector& a, const MyVector& b, const MyVector& c) {
+	const MyVector ab = b - a, ac = c - a;
+	const float d00 = ab.dotProduct(ab), d01 = ab.dotProduct(ac), d11 = ac.dotProduct(ac);
+	//the squared area, relative to the squared edges so big and small meshes are treated alike
+	const float area2 = d00 * d11 - d01 * d01;
+	return area2 > 1e-12f * d00 * d11;
+}
+
+void TrianglePacket::set(int lane, const MyVector& a, const MyVector& b, const MyVector& c, uint32_t index) {
+	const MyVector ab = b - a, ac = c - a, bc = c - b;
+	ax[lane] = a.x; ay[lane] = a.y; az[lane] = a.z;
+	abx[lane] = ab.x; aby[lane] = ab.y; abz[lane] = ab.z;
+	acx[lane] = ac.x; acy[lane] = ac.y; acz[lane] = ac.z;
+
+	d00[lane] = ab.dotProduct(ab);
+	d01[lane] = ab.dotProduct(ac);
+	d11[lane] = ac.dotProduct(ac);
+	invDenom[lane] = 1.0f / (d00[lane] * d11[lane] - d01[lane] * d01[lane]);
+	invAB[lane] = 1.0f / d00[lane];
+	invAC[lane] = 1.0f / d11[lane];
+	invBC[lane] = 1.0f / bc.dotProduct(bc);
+	triangle[lane] = index;
+}
+
+SphereTriangleKernel P6::SphereTriangleKernelFor(SimdLevel level) {
+	switch (level) {
+#if P6_KERNELS_X86
+	case SimdLevel::AVX512:
+	case SimdLevel::AVX2:
+		return Kernels::SphereTrianglesAVX2;
+	case SimdLevel::SSE2:
+		return Kernels::SphereTrianglesSSE2;
+#endif
+	default:
+		return Kernels::SphereTrianglesScalar;
+	}
+}
+
+//Every candidate closest point is a + s ab + u ac: inside the triangle (s, u) are the barycentric
+//coordinates, on edge ab (t, 0), on ac (0, t) and on bc (1 - t, t). With p - a = ap, d1 = ab.ap
+//and d2 = ac.ap, the squared distance to a candidate is
+//	|ap|^2 - 2 s d1 - 2 u d2 + s^2 d00 + 2 s u d01 + u^2 d11
+//so the edges are compared without building their points, and only the winner is built.
+//The SIMD kernels do exactly these steps on four or eight lanes.
+unsigned Kernels::SphereTrianglesScalar(const TrianglePacket& k, const MyVector& center, float radius, SphereTriangleHits& hits) {
+	const float radius2 = radius * radius;
+	unsigned mask = 0;
+	for (int i = 0; i < TrianglePacket::Lanes; i++) {
+		const float apx = center.x - k.ax[i], apy = center.y - k.ay[i], apz = center.z - k.az[i];
+		const float d1 = k.abx[i] * apx + k.aby[i] * apy + k.abz[i] * apz;
+		const float d2 = k.acx[i] * apx + k.acy[i] * apy + k.acz[i] * apz;
+
+		//projection onto the plane
+		const float v = (k.d11[i] * d1 - k.d01[i] * d2) * k.invDenom[i];
+		const float w = (k.d00[i] * d2 - k.d01[i] * d1) * k.invDenom[i];
+		const bool inside = v >= 0 && w >= 0 && v + w <= 1;
+
+		auto clamp01 = [](float t) { return std::fmin(std::fmax(t, 0.0f), 1.0f); };
+		auto cost = [&](float s, float u) {
+			return s * (s * k.d00[i] - 2.0f * d1) + u * (u * k.d11[i] - 2.0f * d2) + 2.0f * s * u * k.d01[i];
+		};
+		const float tab = clamp01(d1 * k.invAB[i]);
+		const float tac = clamp01(d2 * k.invAC[i]);
+		//bc.bp = (ac - ab).(ap - ab)
+		const float tbc = clamp01((d2 - d1 + k.d00[i] - k.d01[i]) * k.invBC[i]);
+
+		float s = tab, u = 0, best = cost(tab, 0);
+		const float costAC = cost(0, tac);
+		if (costAC < best) { s = 0; u = tac; best = costAC; }
+		const float costBC = cost(1.0f - tbc, tbc);
+		if (costBC < best) { s = 1.0f - tbc; u = tbc; }
+		if (inside) { s = v; u = w; }
+
+		hits.x[i] = k.ax[i] + s * k.abx[i] + u * k.acx[i];
+		hits.y[i] = k.ay[i] + s * k.aby[i] + u * k.acy[i];
+		hits.z[i] = k.az[i] + s * k.abz[i] + u * k.acz[i];
+		const float dx = center.x - hits.x[i], dy = center.y - hits.y[i], dz = center.z - hits.z[i];
+		hits.distance2[i] = dx * dx + dy * dy + dz * dz;
+		if (hits.distance2[i] < radius2) mask |= 1u << i;
+	}
+	return mask & ((1u << k.count) - 1);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "MyVector.h"
+#include "ParticleKernels.h"
+
+namespace P6 {
+	//Eight triangles laid out one column per value, so a kernel loads each value for all of them
+	//with one instruction. Everything the closest point needs that doesn't depend on the sphere is
+	//worked out when the packet is filled. Lanes past count repeat the last triangle.
+	//Packets live in std::vector, which C++14 doesn't over-align, so the kernels load unaligned.
+	struct TrianglePacket {
+		static constexpr int Lanes = 8;
+
+		//corner a and the edges ab = b - a, ac = c - a
+		float ax[Lanes];
+		float ay[Lanes];
+		float az[Lanes];
+		float abx[Lanes];
+		float aby[Lanes];
+		float abz[Lanes];
+		float acx[Lanes];
+		float acy[Lanes];
+		float acz[Lanes];
+
+		//ab.ab, ab.ac, ac.ac
+		float d00[Lanes];
+		float d01[Lanes];
+		float d11[Lanes];
+		//1 / (d00 d11 - d01^2), for the barycentric coordinates
+		float invDenom[Lanes];
+		//1 / |ab|^2, 1 / |ac|^2, 1 / |bc|^2, to project onto the edges
+		float invAB[Lanes];
+		float invAC[Lanes];
+		float invBC[Lanes];
+
+		//index into the TriangleMesh
+		uint32_t triangle[Lanes];
+		int count = 0;
+
+		//false for triangles without area, which have no plane and are better left out
+		static bool Usable(const MyVector& a, const MyVector& b, const MyVector& c);
+		//writes lane, count is left to the caller
+		void set(int lane, const MyVector& a, const MyVector& b, const MyVector& c, uint32_t index);
+	};
+
+	//the closest points a kernel found, one column per value like the packet
+	struct SphereTriangleHits {
+		float x[TrianglePacket::Lanes];
+		float y[TrianglePacket::Lanes];
+		float z[TrianglePacket::Lanes];
+		float distance2[TrianglePacket::Lanes];
+	};
+
+	//closest point on every triangle of the packet to center, bit i of the result is set when
+	//triangle i is closer than radius; hits is filled for every lane, hit or not
+	typedef unsigned (*SphereTriangleKernel)(const TrianglePacket& packet, const MyVector& center, float radius, SphereTriangleHits& hits);
+
+	//the kernel for a level; AVX-512 has no 16-triangle packets and gets the AVX2 kernel
+	SphereTriangleKernel SphereTriangleKernelFor(SimdLevel level);
+
+	//Tolerance against the scalar kernel: SSE2 does the same operations in the same order and is
+	//bit-identical, AVX2 fuses multiply-adds, so closest points may differ in the last few ulp and
+	//a triangle exactly at radius may go either way
+	namespace Kernels {
+		unsigned SphereTrianglesScalar(const TrianglePacket& packet, const MyVector& center, float radius, SphereTriangleHits& hits);
+#if P6_KERNELS_X86
+		unsigned SphereTrianglesSSE2(const TrianglePacket& packet, const MyVector& center, float radius, SphereTriangleHits& hits);
+		unsigned SphereTrianglesAVX2(const TrianglePacket& packet, const MyVector& center, float radius, SphereTriangleHits& hits);
+#endif
+	}
+}
@@ -0,0 +1,75 @@
+#include "TriangleKernels.h"
+
+#if P6_KERNELS_X86
+
+#include <immintrin.h>
+
+using namespace P6;
+
+namespace {
+	P6_TARGET_AVX2 inline __m256 Clamp01(__m256 t) {
+		return _mm256_min_ps(_mm256_max_ps(t, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+	}
+
+	//squared distance to a + s ab + u ac, less |ap|^2
+	P6_TARGET_AVX2 inline __m256 Cost(__m256 s, __m256 u, __m256 d1, __m256 d2, __m256 d00, __m256 d01, __m256 d11) {
+		const __m256 two = _mm256_set1_ps(2.0f);
+		const __m256 along = _mm256_mul_ps(s, _mm256_fmsub_ps(s, d00, _mm256_mul_ps(two, d1)));
+		const __m256 across = _mm256_mul_ps(u, _mm256_fmsub_ps(u, d11, _mm256_mul_ps(two, d2)));
+		return _mm256_fmadd_ps(_mm256_mul_ps(_mm256_mul_ps(two, s), u), d01, _mm256_add_ps(along, across));
+	}
+}
+
+//the whole packet at once, the steps of SphereTrianglesScalar with fused multiply-adds
+P6_TARGET_AVX2 unsigned Kernels::SphereTrianglesAVX2(const TrianglePacket& k, const MyVector& center, float radius, SphereTriangleHits& hits) {
+	const __m256 px = _mm256_set1_ps(center.x), py = _mm256_set1_ps(center.y), pz = _mm256_set1_ps(center.z);
+	const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+
+	const __m256 ax = _mm256_loadu_ps(k.ax), ay = _mm256_loadu_ps(k.ay), az = _mm256_loadu_ps(k.az);
+	const __m256 abx = _mm256_loadu_ps(k.abx), aby = _mm256_loadu_ps(k.aby), abz = _mm256_loadu_ps(k.abz);
+	const __m256 acx = _mm256_loadu_ps(k.acx), acy = _mm256_loadu_ps(k.acy), acz = _mm256_loadu_ps(k.acz);
+	const __m256 d00 = _mm256_loadu_ps(k.d00), d01 = _mm256_loadu_ps(k.d01), d11 = _mm256_loadu_ps(k.d11);
+
+	const __m256 apx = _mm256_sub_ps(px, ax), apy = _mm256_sub_ps(py, ay), apz = _mm256_sub_ps(pz, az);
+	const __m256 d1 = _mm256_fmadd_ps(abz, apz, _mm256_fmadd_ps(aby, apy, _mm256_mul_ps(abx, apx)));
+	const __m256 d2 = _mm256_fmadd_ps(acz, apz, _mm256_fmadd_ps(acy, apy, _mm256_mul_ps(acx, apx)));
+
+	//projection onto the plane
+	const __m256 invDenom = _mm256_loadu_ps(k.invDenom);
+	const __m256 v = _mm256_mul_ps(_mm256_fmsub_ps(d11, d1, _mm256_mul_ps(d01, d2)), invDenom);
+	const __m256 w = _mm256_mul_ps(_mm256_fmsub_ps(d00, d2, _mm256_mul_ps(d01, d1)), invDenom);
+	const __m256 inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(v, zero, _CMP_GE_OQ), _mm256_cmp_ps(w, zero, _CMP_GE_OQ)),
+		_mm256_cmp_ps(_mm256_add_ps(v, w), one, _CMP_LE_OQ));
+
+	const __m256 tab = Clamp01(_mm256_mul_ps(d1, _mm256_loadu_ps(k.invAB)));
+	const __m256 tac = Clamp01(_mm256_mul_ps(d2, _mm256_loadu_ps(k.invAC)));
+	const __m256 tbc = Clamp01(_mm256_mul_ps(_mm256_sub_ps(_mm256_add_ps(_mm256_sub_ps(d2, d1), d00), d01), _mm256_loadu_ps(k.invBC)));
+	const __m256 sbc = _mm256_sub_ps(one, tbc);
+
+	__m256 s = tab, u = zero, best = Cost(tab, zero, d1, d2, d00, d01, d11);
+	const __m256 costAC = Cost(zero, tac, d1, d2, d00, d01, d11);
+	__m256 better = _mm256_cmp_ps(costAC, best, _CMP_LT_OQ);
+	s = _mm256_blendv_ps(s, zero, better);
+	u = _mm256_blendv_ps(u, tac, better);
+	best = _mm256_blendv_ps(best, costAC, better);
+	better = _mm256_cmp_ps(Cost(sbc, tbc, d1, d2, d00, d01, d11), best, _CMP_LT_OQ);
+	s = _mm256_blendv_ps(s, sbc, better);
+	u = _mm256_blendv_ps(u, tbc, better);
+	s = _mm256_blendv_ps(s, v, inside);
+	u = _mm256_blendv_ps(u, w, inside);
+
+	const __m256 hx = _mm256_fmadd_ps(u, acx, _mm256_fmadd_ps(s, abx, ax));
+	const __m256 hy = _mm256_fmadd_ps(u, acy, _mm256_fmadd_ps(s, aby, ay));
+	const __m256 hz = _mm256_fmadd_ps(u, acz, _mm256_fmadd_ps(s, abz, az));
+	const __m256 dx = _mm256_sub_ps(px, hx), dy = _mm256_sub_ps(py, hy), dz = _mm256_sub_ps(pz, hz);
+	const __m256 distance2 = _mm256_fmadd_ps(dz, dz, _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dx, dx)));
+
+	_mm256_storeu_ps(hits.x, hx);
+	_mm256_storeu_ps(hits.y, hy);
+	_mm256_storeu_ps(hits.z, hz);
+	_mm256_storeu_ps(hits.distance2, distance2);
+	const unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(_mm256_cmp_ps(distance2, _mm256_set1_ps(radius * radius), _CMP_LT_OQ)));
+	return mask & ((1u << k.count) - 1);
+}
+
+#endif
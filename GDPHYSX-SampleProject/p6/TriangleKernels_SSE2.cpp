@@ -0,0 +1,83 @@
+#include "TriangleKernels.h"
+
+#if P6_KERNELS_X86
+
+#include <emmintrin.h>
+
+using namespace P6;
+
+namespace {
+	//SSE2 has no blendv, the mask picks with and/andnot/or
+	P6_TARGET_SSE2 inline __m128 Select(__m128 mask, __m128 yes, __m128 no) {
+		return _mm_or_ps(_mm_and_ps(mask, yes), _mm_andnot_ps(mask, no));
+	}
+
+	P6_TARGET_SSE2 inline __m128 Clamp01(__m128 t) {
+		return _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+	}
+
+	//squared distance to a + s ab + u ac, less |ap|^2
+	P6_TARGET_SSE2 inline __m128 Cost(__m128 s, __m128 u, __m128 d1, __m128 d2, __m128 d00, __m128 d01, __m128 d11) {
+		const __m128 two = _mm_set1_ps(2.0f);
+		const __m128 along = _mm_mul_ps(s, _mm_sub_ps(_mm_mul_ps(s, d00), _mm_mul_ps(two, d1)));
+		const __m128 across = _mm_mul_ps(u, _mm_sub_ps(_mm_mul_ps(u, d11), _mm_mul_ps(two, d2)));
+		return _mm_add_ps(_mm_add_ps(along, across), _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(two, s), u), d01));
+	}
+}
+
+//four triangles at a time, the steps of SphereTrianglesScalar in the same order
+P6_TARGET_SSE2 unsigned Kernels::SphereTrianglesSSE2(const TrianglePacket& k, const MyVector& center, float radius, SphereTriangleHits& hits) {
+	const __m128 px = _mm_set1_ps(center.x), py = _mm_set1_ps(center.y), pz = _mm_set1_ps(center.z);
+	const __m128 radius2 = _mm_set1_ps(radius * radius);
+	const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+
+	unsigned mask = 0;
+	for (int i = 0; i < TrianglePacket::Lanes; i += 4) {
+		const __m128 ax = _mm_loadu_ps(k.ax + i), ay = _mm_loadu_ps(k.ay + i), az = _mm_loadu_ps(k.az + i);
+		const __m128 abx = _mm_loadu_ps(k.abx + i), aby = _mm_loadu_ps(k.aby + i), abz = _mm_loadu_ps(k.abz + i);
+		const __m128 acx = _mm_loadu_ps(k.acx + i), acy = _mm_loadu_ps(k.acy + i), acz = _mm_loadu_ps(k.acz + i);
+		const __m128 d00 = _mm_loadu_ps(k.d00 + i), d01 = _mm_loadu_ps(k.d01 + i), d11 = _mm_loadu_ps(k.d11 + i);
+
+		const __m128 apx = _mm_sub_ps(px, ax), apy = _mm_sub_ps(py, ay), apz = _mm_sub_ps(pz, az);
+		const __m128 d1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(abx, apx), _mm_mul_ps(aby, apy)), _mm_mul_ps(abz, apz));
+		const __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(acx, apx), _mm_mul_ps(acy, apy)), _mm_mul_ps(acz, apz));
+
+		//projection onto the plane
+		const __m128 invDenom = _mm_loadu_ps(k.invDenom + i);
+		const __m128 v = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(d11, d1), _mm_mul_ps(d01, d2)), invDenom);
+		const __m128 w = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(d00, d2), _mm_mul_ps(d01, d1)), invDenom);
+		const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(v, zero), _mm_cmpge_ps(w, zero)), _mm_cmple_ps(_mm_add_ps(v, w), one));
+
+		const __m128 tab = Clamp01(_mm_mul_ps(d1, _mm_loadu_ps(k.invAB + i)));
+		const __m128 tac = Clamp01(_mm_mul_ps(d2, _mm_loadu_ps(k.invAC + i)));
+		const __m128 tbc = Clamp01(_mm_mul_ps(_mm_sub_ps(_mm_add_ps(_mm_sub_ps(d2, d1), d00), d01), _mm_loadu_ps(k.invBC + i)));
+		const __m128 sbc = _mm_sub_ps(one, tbc);
+
+		__m128 s = tab, u = zero, best = Cost(tab, zero, d1, d2, d00, d01, d11);
+		const __m128 costAC = Cost(zero, tac, d1, d2, d00, d01, d11);
+		__m128 better = _mm_cmplt_ps(costAC, best);
+		s = Select(better, zero, s);
+		u = Select(better, tac, u);
+		best = Select(better, costAC, best);
+		better = _mm_cmplt_ps(Cost(sbc, tbc, d1, d2, d00, d01, d11), best);
+		s = Select(better, sbc, s);
+		u = Select(better, tbc, u);
+		s = Select(inside, v, s);
+		u = Select(inside, w, u);
+
+		const __m128 hx = _mm_add_ps(_mm_add_ps(ax, _mm_mul_ps(s, abx)), _mm_mul_ps(u, acx));
+		const __m128 hy = _mm_add_ps(_mm_add_ps(ay, _mm_mul_ps(s, aby)), _mm_mul_ps(u, acy));
+		const __m128 hz = _mm_add_ps(_mm_add_ps(az, _mm_mul_ps(s, abz)), _mm_mul_ps(u, acz));
+		const __m128 dx = _mm_sub_ps(px, hx), dy = _mm_sub_ps(py, hy), dz = _mm_sub_ps(pz, hz);
+		const __m128 distance2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+		_mm_storeu_ps(hits.x + i, hx);
+		_mm_storeu_ps(hits.y + i, hy);
+		_mm_storeu_ps(hits.z + i, hz);
+		_mm_storeu_ps(hits.distance2 + i, distance2);
+		mask |= static_cast<unsigned>(_mm_movemask_ps(_mm_cmplt_ps(distance2, radius2))) << i;
+	}
+	return mask & ((1u << k.count) - 1);
+}
+
+#endif
@@ -0,0 +1,80 @@
+#include "TriangleMesh.h"
+
+#include <algorithm>
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "../tiny_obj_loader.h"
+
+using namespace P6;
+
+bool TriangleMesh::load(const std::string& path, std::string& error) {
+	tinyobj::attrib_t attributes;
+	std::vector<tinyobj::shape_t> shapes;
+	std::vector<tinyobj::material_t> materials;
+	std::string warning;
+	error.clear();
+	if (!tinyobj::LoadObj(&attributes, &shapes, &materials, &warning, &error, path.c_str())) {
+		if (error.empty()) error = "could not read " + path;
+		return false;
+	}
+
+	clear();
+	vertices.reserve(attributes.vertices.size() / 3);
+	for (size_t i = 0; i + 2 < attributes.vertices.size(); i += 3) {
+		vertices.push_back(MyVector(attributes.vertices[i], attributes.vertices[i + 1], attributes.vertices[i + 2]));
+	}
+
+	//a missing .mtl only warns, the geometry is still fine
+	for (const tinyobj::shape_t& shape : shapes) {
+		for (const tinyobj::index_t& index : shape.mesh.indices) {
+			if (index.vertex_index < 0 || static_cast<size_t>(index.vertex_index) >= vertices.size()) {
+				clear();
+				error = path + ": face refers to a vertex that doesn't exist";
+				return false;
+			}
+			indices.push_back(static_cast<uint32_t>(index.vertex_index));
+		}
+	}
+	return true;
+}
+
+void TriangleMesh::clear() {
+	vertices.clear();
+	indices.clear();
+}
+
+void TriangleMesh::addTriangle(const MyVector& a, const MyVector& b, const MyVector& c) {
+	const uint32_t first = static_cast<uint32_t>(vertices.size());
+	vertices.push_back(a);
+	vertices.push_back(b);
+	vertices.push_back(c);
+	indices.push_back(first);
+	indices.push_back(first + 1);
+	indices.push_back(first + 2);
+}
+
+void TriangleMesh::transform(const MyVector& scale, const MyVector& offset) {
+	for (MyVector& v : vertices) {
+		v = MyVector(v.x * scale.x + offset.x, v.y * scale.y + offset.y, v.z * scale.z + offset.z);
+	}
+}
+
+void TriangleMesh::triangle(size_t index, MyVector& a, MyVector& b, MyVector& c) const {
+	a = vertices[indices[index * 3]];
+	b = vertices[indices[index * 3 + 1]];
+	c = vertices[indices[index * 3 + 2]];
+}
+
+Aabb TriangleMesh::triangleBounds(size_t index) const {
+	MyVector a, b, c;
+	triangle(index, a, b, c);
+	return Aabb(MyVector(std::min({ a.x, b.x, c.x }), std::min({ a.y, b.y, c.y }), std::min({ a.z, b.z, c.z })),
+		MyVector(std::max({ a.x, b.x, c.x }), std::max({ a.y, b.y, c.y }), std::max({ a.z, b.z, c.z })));
+}
+
+Aabb TriangleMesh::bounds() const {
+	if (vertices.empty()) return Aabb();
+	Aabb box(vertices[0], vertices[0]);
+	for (const MyVector& v : vertices) box = Aabb::Merge(box, Aabb(v, v));
+	return box;
+}
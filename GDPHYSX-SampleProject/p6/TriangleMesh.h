@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Aabb.h"
+#include "MyVector.h"
+
+namespace P6 {
+	//static triangle soup for collision, every shape of an OBJ file merged into one indexed list
+	//faces are triangulated on load, normals, texture coordinates and materials are dropped
+	class TriangleMesh {
+		public:
+			//false with the loader's message in error when the file can't be read
+			bool load(const std::string& path, std::string& error);
+
+			void clear();
+			void addTriangle(const MyVector& a, const MyVector& b, const MyVector& c);
+
+			//scales then moves every vertex, to place level geometry in the world
+			void transform(const MyVector& scale, const MyVector& offset);
+
+			size_t vertexCount() const { return vertices.size(); }
+			size_t triangleCount() const { return indices.size() / 3; }
+
+			const MyVector& vertex(size_t index) const { return vertices[index]; }
+			void triangle(size_t index, MyVector& a, MyVector& b, MyVector& c) const;
+
+			Aabb triangleBounds(size_t index) const;
+			Aabb bounds() const;
+
+		private:
+			std::vector<MyVector> vertices;
+			//three per triangle
+			std::vector<uint32_t> indices;
+	};
+}
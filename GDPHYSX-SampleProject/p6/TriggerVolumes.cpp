@@ -0,0 +1,153 @@
+#include "TriggerVolumes.h"
+#include "ParticleWorld.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace P6;
+
+//zones never move, so the tree keeps exact boxes
+TriggerVolumes::TriggerVolumes() : tree(0.0f) {}
+
+uint32_t TriggerVolumes::addSphere(const MyVector& center, float radius) {
+	Zone zone;
+	zone.box = Aabb::Around(center, radius);
+	zone.center = center;
+	zone.radius = radius;
+	zone.sphere = true;
+
+	const uint32_t id = static_cast<uint32_t>(zones.size());
+	zones.push_back(zone);
+	tree.insert(zone.box, id);
+	return id;
+}
+
+uint32_t TriggerVolumes::addBox(const Aabb& box) {
+	Zone zone;
+	zone.box = box;
+
+	const uint32_t id = static_cast<uint32_t>(zones.size());
+	zones.push_back(zone);
+	tree.insert(zone.box, id);
+	return id;
+}
+
+bool TriggerVolumes::contains(uint32_t id, const MyVector& point) const {
+	const Zone& zone = zones[id];
+	if (zone.sphere) {
+		const MyVector offset = point - zone.center;
+		return offset.x * offset.x + offset.y * offset.y + offset.z * offset.z < zone.radius * zone.radius;
+	}
+	//strict, like the finish line of the demo
+	return zone.box.min.x < point.x && point.x < zone.box.max.x
+		&& zone.box.min.y < point.y && point.y < zone.box.max.y
+		&& zone.box.min.z < point.z && point.z < zone.box.max.z;
+}
+
+bool TriggerVolumes::cross(const Zone& zone, const MyVector& from, const MyVector& motion, float& enter, float& exit) const {
+	if (zone.sphere) {
+		//|from + t motion - center| = radius
+		const MyVector start = from - zone.center;
+		const float a = motion.x * motion.x + motion.y * motion.y + motion.z * motion.z;
+		const float b = start.x * motion.x + start.y * motion.y + start.z * motion.z;
+		const float c = start.x * start.x + start.y * start.y + start.z * start.z - zone.radius * zone.radius;
+		const float discriminant = b * b - a * c;
+		if (a <= 0 || discriminant < 0) return false;
+
+		const float root = std::sqrt(discriminant);
+		enter = (-b - root) / a;
+		exit = (-b + root) / a;
+		return true;
+	}
+
+	//slabs: the line is inside the box where it is inside all three
+	enter = -std::numeric_limits<float>::infinity();
+	exit = std::numeric_limits<float>::infinity();
+	const float origin[3] = { from.x, from.y, from.z };
+	const float direction[3] = { motion.x, motion.y, motion.z };
+	const float low[3] = { zone.box.min.x, zone.box.min.y, zone.box.min.z };
+	const float high[3] = { zone.box.max.x, zone.box.max.y, zone.box.max.z };
+	for (int axis = 0; axis < 3; axis++) {
+		if (direction[axis] == 0) {
+			if (origin[axis] <= low[axis] || origin[axis] >= high[axis]) return false;
+			continue;
+		}
+		float lowCut = (low[axis] - origin[axis]) / direction[axis];
+		float highCut = (high[axis] - origin[axis]) / direction[axis];
+		if (lowCut > highCut) std::swap(lowCut, highCut);
+		enter = std::max(enter, lowCut);
+		exit = std::min(exit, highCut);
+	}
+	return enter < exit;
+}
+
+void TriggerVolumes::update(const ParticleWorld& world, float time) {
+	fired.clear();
+	const double start = clock;
+	clock += time;
+	if (zones.empty()) return;
+
+	const ParticleStreams& s = world.buffer().streams();
+	const size_t count = world.size();
+	for (size_t i = 0; i < count; i++) {
+		if (!s.active[i]) continue;
+
+		const MyVector from(s.prevX[i], s.prevY[i], s.prevZ[i]);
+		const MyVector to(s.posX[i], s.posY[i], s.posZ[i]);
+		const MyVector motion = to - from;
+		const Aabb path = Aabb::Merge(Aabb::Around(from, 0), Aabb::Around(to, 0));
+
+		tree.query(path, [&](int32_t proxy) {
+			const uint32_t id = tree.userData(proxy);
+			const bool wasInside = contains(id, from);
+			const bool isInside = contains(id, to);
+			//zones are convex, a path that starts and ends inside never left
+			if (wasInside && isInside) return true;
+
+			float enter, exit;
+			if (!cross(zones[id], from, motion, enter, exit)) {
+				if (wasInside == isInside) return true;
+				//grazing the surface, call it the end of the step that changed sides
+				enter = exit = isInside ? 1.0f : 0.0f;
+			}
+			enter = std::min(std::max(enter, 0.0f), 1.0f);
+			exit = std::min(std::max(exit, 0.0f), 1.0f);
+
+			auto emit = [&](TriggerEvent::Kind kind, float t) {
+				TriggerEvent event;
+				event.particle = world.handleAt(i);
+				event.zone = id;
+				event.kind = kind;
+				event.time = start + static_cast<double>(t) * time;
+				fired.push_back(event);
+			};
+			if (isInside) {
+				emit(TriggerEvent::Enter, enter);
+			}
+			else if (wasInside) {
+				emit(TriggerEvent::Exit, exit);
+			}
+			else if (enter < exit) {
+				//through and out again within the step
+				emit(TriggerEvent::Enter, enter);
+				emit(TriggerEvent::Exit, exit);
+			}
+			return true;
+		});
+	}
+
+	//earliest first; ties keep a fixed order so runs repeat exactly
+	std::sort(fired.begin(), fired.end(), [](const TriggerEvent& a, const TriggerEvent& b) {
+		if (a.time != b.time) return a.time < b.time;
+		if (a.particle.slot != b.particle.slot) return a.particle.slot < b.particle.slot;
+		if (a.zone != b.zone) return a.zone < b.zone;
+		return a.kind < b.kind;
+	});
+}
+
+void TriggerVolumes::clear() {
+	zones.clear();
+	tree.clear();
+	fired.clear();
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Aabb.h"
+#include "AabbTree.h"
+#include "MyVector.h"
+#include "ParticleHandle.h"
+
+namespace P6 {
+	class ParticleWorld;
+
+	//a particle crossing the surface of a zone
+	struct TriggerEvent {
+		enum Kind : uint8_t { Enter, Exit };
+
+		ParticleHandle particle;
+		//the id addSphere or addBox returned
+		uint32_t zone;
+		Kind kind;
+		//simulated seconds since the clock was reset, interpolated inside the step
+		double time;
+	};
+
+	//Sphere and box zones that report particles entering and leaving them.
+	//The zones sit in an AabbTree; after every step each particle's path from its previous to its
+	//current position is run down the tree and tested against the zones it reaches. A crossing is
+	//timed where the path cuts the zone's surface, so the event carries the exact moment inside the
+	//step instead of the end of it, and a particle that passes through a zone within one step still
+	//gets its Enter and Exit. A particle is inside when its centre is. The path counts as a straight
+	//line over the step, the same assumption GetInterpolatedPosition makes.
+	//
+	//	triggers.addBox(Aabb(MyVector(-1, -1, -1), MyVector(1, 1, 1)));
+	//	world.update(dt);
+	//	triggers.update(world, dt);
+	//	for (const TriggerEvent& event : triggers.events()) ...
+	class TriggerVolumes {
+		public:
+			TriggerVolumes();
+
+			//return the id of the zone, ids count up from 0
+			uint32_t addSphere(const MyVector& center, float radius);
+			uint32_t addBox(const Aabb& box);
+			size_t zoneCount() const { return zones.size(); }
+			bool contains(uint32_t zone, const MyVector& point) const;
+
+			//call once after every world.update(time), with the same time
+			//tests the step every active particle just took and advances the clock by time
+			void update(const ParticleWorld& world, float time);
+
+			//the crossings of the last update, earliest first
+			const std::vector<TriggerEvent>& events() const { return fired; }
+
+			//simulated seconds covered by the updates since the last reset
+			double elapsed() const { return clock; }
+			void resetClock(double time = 0) { clock = time; }
+
+			//removes every zone
+			void clear();
+
+		private:
+			struct Zone {
+				Aabb box;
+				MyVector center;
+				//0 for boxes
+				float radius = 0;
+				bool sphere = false;
+			};
+
+			//where the line from -> from + motion is inside the zone, as fractions of the motion
+			//returns false when it misses
+			bool cross(const Zone& zone, const MyVector& from, const MyVector& motion, float& enter, float& exit) const;
+
+			std::vector<Zone> zones;
+			AabbTree tree;
+			double clock = 0;
+			std::vector<TriggerEvent> fired;
+	};
+}